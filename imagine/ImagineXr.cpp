@@ -12,7 +12,6 @@
 
 #include "NFmiImage.h"
 
-#include <deque>
 #include <iostream>
 #include <stdexcept>
 
@@ -299,11 +298,11 @@ void ImagineXr::SetBlend(enum NFmiColorTools::NFmiBlendRule rule)
  *
  * Returns 'true' if there were elements, 'false' if path empty
  */
-bool ImagineXr::SetPath(const std::deque<NFmiPathElement> &path)
+bool ImagineXr::SetPath(const NFmiPathData &path)
 {
   try
   {
-    std::deque<NFmiPathElement>::const_iterator iter = path.begin();
+    NFmiPathData::const_iterator iter = path.begin();
     if (iter == path.end())
       return false;  // no elements (don't close either)
 
@@ -630,7 +629,7 @@ void ImagineXr::Composite(const ImagineXr &img2,
 /*
  *
  */
-void ImagineXr::Stroke(const std::deque<NFmiPathElement> &path,
+void ImagineXr::Stroke(const NFmiPathData &path,
                        float line_width,
                        NFmiColorTools::Color color,
                        NFmiColorTools::NFmiBlendRule rule)
@@ -660,7 +659,7 @@ void ImagineXr::Stroke(const std::deque<NFmiPathElement> &path,
 /*
  * Path fill
  */
-void ImagineXr::Fill(const std::deque<NFmiPathElement> &path,
+void ImagineXr::Fill(const NFmiPathData &path,
                      NFmiColorTools::Color color,
                      NFmiBlendRule rule)
 {
@@ -685,7 +684,7 @@ void ImagineXr::Fill(const std::deque<NFmiPathElement> &path,
 /*
  * Fill an area with a 'pattern' image
  */
-void ImagineXr::Fill(const std::deque<NFmiPathElement> &path,
+void ImagineXr::Fill(const NFmiPathData &path,
                      const ImagineXr &img2,
                      NFmiBlendRule rule,
                      float opaque)
@@ -14,11 +14,11 @@
 
 #include "NFmiAlignment.h"
 #include "NFmiColorTools.h"
+#include "NFmiPathData.h"
 #include "NFmiPathElement.h"
 
 #include <cairomm/cairomm.h>
 
-#include <deque>
 #include <string>
 
 using namespace std;
@@ -70,7 +70,7 @@ class ImagineXr
 
   void SetBlend(enum NFmiColorTools::NFmiBlendRule rule);
 
-  bool SetPath(const std::deque<NFmiPathElement> &path);
+  bool SetPath(const NFmiPathData &path);
 
   static void ApplyAlignment(enum NFmiAlignment alignment, int &x, int &y, int w, int h);
 
@@ -108,16 +108,16 @@ class ImagineXr
                  int y = 0,
                  float opaque = 1.0);
 
-  void Stroke(const std::deque<NFmiPathElement> &path,
+  void Stroke(const NFmiPathData &path,
               float line_width,
               NFmiColorTools::Color color,
               NFmiColorTools::NFmiBlendRule rule);
 
-  void Fill(const std::deque<NFmiPathElement> &path,
+  void Fill(const NFmiPathData &path,
             NFmiColorTools::Color color,
             NFmiBlendRule rule);
 
-  void Fill(const std::deque<NFmiPathElement> &path,
+  void Fill(const NFmiPathData &path,
             const ImagineXr &pattern,
             NFmiBlendRule rule = kFmiColorCopy,
             float opaque = 1.0);
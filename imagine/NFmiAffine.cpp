@@ -69,7 +69,7 @@ NFmiAffine::NFmiAffine(const NFmiAffine& theAffine)
       itsC(theAffine.itsC),
       itsD(theAffine.itsD),
       itsE(theAffine.itsE),
-      itsF(theAffine.itsE)
+      itsF(theAffine.itsF)
 {
 }
 
@@ -227,7 +227,7 @@ void NFmiAffine::Multiply(const NFmiAffine& theAffine)
  */
 // ----------------------------------------------------------------------
 
-double NFmiAffine::X(double x, double y)
+double NFmiAffine::X(double x, double y) const
 {
   try
   {
@@ -245,7 +245,7 @@ double NFmiAffine::X(double x, double y)
  */
 // ----------------------------------------------------------------------
 
-double NFmiAffine::Y(double x, double y)
+double NFmiAffine::Y(double x, double y) const
 {
   try
   {
@@ -257,6 +257,49 @@ double NFmiAffine::Y(double x, double y)
   }
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief Calculate the determinant of the transformation
+ *
+ * The transformation is invertible if and only if the
+ * determinant is nonzero.
+ */
+// ----------------------------------------------------------------------
+
+double NFmiAffine::Determinant() const
+{
+  return itsA * itsD - itsB * itsC;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Calculate the inverse transformation
+ *
+ * Throws if the transformation is not invertible.
+ */
+// ----------------------------------------------------------------------
+
+NFmiAffine NFmiAffine::Inverse() const
+{
+  try
+  {
+    const double det = Determinant();
+    if (det == 0)
+      throw Fmi::Exception(BCP, "Cannot invert a singular affine transformation");
+
+    return NFmiAffine(itsD / det,
+                      -itsB / det,
+                      -itsC / det,
+                      itsA / det,
+                      (itsC * itsF - itsD * itsE) / det,
+                      (itsB * itsE - itsA * itsF) / det);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 }  // namespace Imagine
 
 // ======================================================================
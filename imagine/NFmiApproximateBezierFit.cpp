@@ -404,7 +404,7 @@ NFmiPoint Bezier(const NFmiPathData& thePath, double theValue)
 {
   try
   {
-    NFmiPathData tmp = thePath;
+    vector<NFmiPathElement> tmp(thePath.begin(), thePath.end());
     // triangle computation
     const size_t degree = thePath.size() - 1;
     for (size_t i = 1; i <= degree; i++)
@@ -20,7 +20,11 @@
  * identifying important points (polygon intersections) is important.
  *
  * A basic requirement is that the object must support equality
- * and less-than operators.
+ * comparisons and hashing via NFmiCounterHash. Hashing is provided
+ * for all types supported by std::hash, for std::pair of hashable
+ * types and for NFmiPoint. Note that since the counts are held in
+ * a hash table, iteration over the counter does not produce the
+ * objects in any particular order.
  *
  * Sample usage:
  *
@@ -45,17 +49,51 @@
 #pragma once
 
 #include <newbase/NFmiDef.h>
-#include <map>
+#include <newbase/NFmiPoint.h>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <utility>
 
 namespace Imagine
 {
+//! Hash function object used by NFmiCounter
+template <class T>
+struct NFmiCounterHash
+{
+  std::size_t operator()(const T& theElement) const { return std::hash<T>()(theElement); }
+};
+
+//! Hashing of pairs, for example coordinates as pair<double,double>
+template <class A, class B>
+struct NFmiCounterHash<std::pair<A, B> >
+{
+  std::size_t operator()(const std::pair<A, B>& theElement) const
+  {
+    const std::size_t hash = NFmiCounterHash<A>()(theElement.first);
+    const std::size_t hash2 = NFmiCounterHash<B>()(theElement.second);
+    return hash ^ (hash2 + 0x9e3779b9 + (hash << 6) + (hash >> 2));
+  }
+};
+
+//! Hashing of points
+template <>
+struct NFmiCounterHash<NFmiPoint>
+{
+  std::size_t operator()(const NFmiPoint& thePoint) const
+  {
+    typedef std::pair<double, double> Coordinates;
+    return NFmiCounterHash<Coordinates>()(Coordinates(thePoint.X(), thePoint.Y()));
+  }
+};
+
 //! An unique object counter.
 template <class T>
 class NFmiCounter
 {
  protected:
   //! The counted data is held in this type containers.
-  typedef std::map<T, unsigned long> NFmiCounterData;
+  typedef std::unordered_map<T, unsigned long, NFmiCounterHash<T> > NFmiCounterData;
 
   //! The data counted so far, along with the counts.
   NFmiCounterData itsData;
@@ -69,9 +107,11 @@ class NFmiCounter
   ~NFmiCounter(void) {}
   //! Reset the counter to contain no data
   void Clear(void) { itsData.clear(); }
+  //! Reserve space for the given number of unique objects
+  void Reserve(std::size_t theSize) { itsData.reserve(theSize); }
   //! Add a new object to the counter.
   /*!
-   * This adds the object to a map with the object as a key.
+   * This adds the object to a hash table with the object as a key.
    * If the object already exists in the map, its counter is increased.
    * The count of the object after insertion is returned, hence it
    * is always atleast one.
@@ -41,9 +41,9 @@ void NFmiDrawable::Fill(NFmiImage& theImage,
     if (theColor == NFmiColorTools::NoColor)
       return;
 
-    // Create fillmap, clip it based on image height
+    // Create fillmap, clip it based on image size
 
-    NFmiFillMap fmap(0.0, theImage.Height());
+    NFmiFillMap fmap(0.0, theImage.Height(), 0.0, theImage.Width());
 
     // Add the drawable to the fillmap
 
@@ -75,9 +75,9 @@ void NFmiDrawable::Fill(NFmiImage& theImage,
 {
   try
   {
-    // Create fillmap, clip it based on image height
+    // Create fillmap, clip it based on image size
 
-    NFmiFillMap fmap(0.0, theImage.Height());
+    NFmiFillMap fmap(0.0, theImage.Height(), 0.0, theImage.Width());
 
     // Add the drawable to the fillmap
 
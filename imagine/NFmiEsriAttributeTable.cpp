@@ -0,0 +1,469 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of class Imagine::NFmiEsriAttributeTable
+ */
+// ======================================================================
+
+#include "NFmiEsriAttributeTable.h"
+
+#include <macgyver/Exception.h>
+#include <newbase/NFmiStringTools.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Constructor
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriAttributeTable::NFmiEsriAttributeTable(const vector<NFmiEsriAttributeName> &theNames,
+                                               const vector<int> &theOffsets,
+                                               const vector<int> &theSizes,
+                                               size_t theNumRecords,
+                                               size_t theRecordLength,
+                                               string theData)
+    : itsNames(theNames),
+      itsOffsets(theOffsets),
+      itsSizes(theSizes),
+      itsNumRecords(theNumRecords),
+      itsRecordLength(theRecordLength),
+      itsData(std::move(theData)),
+      itsColumns(new Column[theNames.size()])
+{
+  try
+  {
+    if (itsOffsets.size() != itsNames.size() || itsSizes.size() != itsNames.size())
+      throw Fmi::Exception(BCP, "Attribute field definitions are inconsistent");
+
+    if (itsData.size() < itsNumRecords * itsRecordLength)
+      throw Fmi::Exception(BCP, "Attribute data is truncated");
+
+    for (size_t i = 0; i < itsNames.size(); i++)
+    {
+      if (itsOffsets[i] < 0 || itsSizes[i] < 0 ||
+          static_cast<size_t>(itsOffsets[i] + itsSizes[i]) > itsRecordLength)
+        throw Fmi::Exception(BCP, "Attribute field '" + itsNames[i].Name() + "' is out of bounds");
+
+      // The first one wins as in the name based searches of the elements
+      itsFieldIndexes.emplace(itsNames[i].Name(), static_cast<int>(i));
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the index of the named field, or -1
+ */
+// ----------------------------------------------------------------------
+
+int NFmiEsriAttributeTable::FieldIndex(const string &theName) const
+{
+  try
+  {
+    auto it = itsFieldIndexes.find(theName);
+    if (it == itsFieldIndexes.end())
+      return -1;
+    return it->second;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the definition of the given field
+ */
+// ----------------------------------------------------------------------
+
+const NFmiEsriAttributeName &NFmiEsriAttributeTable::Name(int theField) const
+{
+  try
+  {
+    if (theField < 0 || theField >= static_cast<int>(itsNames.size()))
+      throw Fmi::Exception(BCP, "Attribute field index out of range");
+    return itsNames[theField];
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the type of the given field
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriAttributeType NFmiEsriAttributeTable::Type(int theField) const
+{
+  try
+  {
+    return Name(theField).Type();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the given column, converting it on first access
+ */
+// ----------------------------------------------------------------------
+
+const NFmiEsriAttributeTable::Column &NFmiEsriAttributeTable::Parsed(
+    int theField, NFmiEsriAttributeType theType) const
+{
+  try
+  {
+    if (Type(theField) != theType)
+      throw Fmi::Exception(BCP,
+                           "Attribute field '" + itsNames[theField].Name() + "' is of wrong type");
+
+    Column &column = itsColumns[theField];
+    std::call_once(column.parsed, [this, theField, &column]() { Parse(theField, column); });
+    return column;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Convert all the values of a column
+ */
+// ----------------------------------------------------------------------
+
+void NFmiEsriAttributeTable::Parse(int theField, Column &theColumn) const
+{
+  try
+  {
+    const size_t size = itsSizes[theField];
+    const char *data = itsData.data() + itsOffsets[theField];
+
+    string value;
+
+    switch (itsNames[theField].Type())
+    {
+      case kFmiEsriString:
+      {
+        theColumn.strings.reserve(itsNumRecords);
+        for (size_t i = 0; i < itsNumRecords; i++, data += itsRecordLength)
+        {
+          value.assign(data, size);
+          NFmiStringTools::TrimL(value);
+          NFmiStringTools::TrimR(value);
+          theColumn.strings.push_back(value);
+        }
+        break;
+      }
+      case kFmiEsriInteger:
+      {
+        theColumn.integers.reserve(itsNumRecords);
+        for (size_t i = 0; i < itsNumRecords; i++, data += itsRecordLength)
+        {
+          value.assign(data, size);
+          theColumn.integers.push_back(atoi(value.c_str()));
+        }
+        break;
+      }
+      case kFmiEsriDouble:
+      {
+        theColumn.doubles.reserve(itsNumRecords);
+        for (size_t i = 0; i < itsNumRecords; i++, data += itsRecordLength)
+        {
+          value.assign(data, size);
+          theColumn.doubles.push_back(atof(value.c_str()));
+        }
+        break;
+      }
+      case kFmiEsriDate:
+      {
+        theColumn.dates.reserve(itsNumRecords);
+        for (size_t i = 0; i < itsNumRecords; i++, data += itsRecordLength)
+        {
+          value.assign(data, size);
+          long date = atol(value.c_str());
+          int yyyy = date / 10000;
+          int mm = (date / 100) % 100;
+          int dd = date % 100;
+          theColumn.dates.push_back(NFmiMetTime(yyyy, mm, dd));
+        }
+        break;
+      }
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return a string column
+ */
+// ----------------------------------------------------------------------
+
+const vector<string> &NFmiEsriAttributeTable::Strings(int theField) const
+{
+  try
+  {
+    return Parsed(theField, kFmiEsriString).strings;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return an integer column
+ */
+// ----------------------------------------------------------------------
+
+const vector<int> &NFmiEsriAttributeTable::Integers(int theField) const
+{
+  try
+  {
+    return Parsed(theField, kFmiEsriInteger).integers;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return a floating point column
+ */
+// ----------------------------------------------------------------------
+
+const vector<double> &NFmiEsriAttributeTable::Doubles(int theField) const
+{
+  try
+  {
+    return Parsed(theField, kFmiEsriDouble).doubles;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return a date column
+ */
+// ----------------------------------------------------------------------
+
+const vector<NFmiMetTime> &NFmiEsriAttributeTable::Dates(int theField) const
+{
+  try
+  {
+    return Parsed(theField, kFmiEsriDate).dates;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return a string value
+ */
+// ----------------------------------------------------------------------
+
+const string &NFmiEsriAttributeTable::GetString(int theField, size_t theRecord) const
+{
+  try
+  {
+    return Strings(theField).at(theRecord);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return an integer value
+ */
+// ----------------------------------------------------------------------
+
+int NFmiEsriAttributeTable::GetInteger(int theField, size_t theRecord) const
+{
+  try
+  {
+    return Integers(theField).at(theRecord);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return a floating point value
+ */
+// ----------------------------------------------------------------------
+
+double NFmiEsriAttributeTable::GetDouble(int theField, size_t theRecord) const
+{
+  try
+  {
+    return Doubles(theField).at(theRecord);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return a date value
+ */
+// ----------------------------------------------------------------------
+
+const NFmiMetTime &NFmiEsriAttributeTable::GetDate(int theField, size_t theRecord) const
+{
+  try
+  {
+    return Dates(theField).at(theRecord);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Build the index of the given field unless already built
+ */
+// ----------------------------------------------------------------------
+
+void NFmiEsriAttributeTable::BuildIndex(int theField) const
+{
+  try
+  {
+    Index(theField);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test whether the given field has been indexed
+ */
+// ----------------------------------------------------------------------
+
+bool NFmiEsriAttributeTable::HasIndex(int theField) const
+{
+  try
+  {
+    Name(theField);  // validates the index
+    return itsColumns[theField].hasindex.load(std::memory_order_acquire);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the record numbers sorted by the values of the field
+ */
+// ----------------------------------------------------------------------
+
+const vector<size_t> &NFmiEsriAttributeTable::Index(int theField) const
+{
+  try
+  {
+    Name(theField);  // validates the index
+    Column &column = itsColumns[theField];
+    std::call_once(column.indexed, [this, theField, &column]() { Sort(theField, column); });
+    return column.index;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Sort the record numbers by the values of the field
+ */
+// ----------------------------------------------------------------------
+
+void NFmiEsriAttributeTable::Sort(int theField, Column &theColumn) const
+{
+  try
+  {
+    vector<size_t> index(itsNumRecords);
+    for (size_t i = 0; i < itsNumRecords; i++)
+      index[i] = i;
+
+    auto sort = [&index](const auto &values)
+    {
+      std::stable_sort(index.begin(),
+                       index.end(),
+                       [&values](size_t a, size_t b) { return values[a] < values[b]; });
+    };
+
+    switch (itsNames[theField].Type())
+    {
+      case kFmiEsriString:
+        sort(Strings(theField));
+        break;
+      case kFmiEsriInteger:
+        sort(Integers(theField));
+        break;
+      case kFmiEsriDouble:
+        sort(Doubles(theField));
+        break;
+      case kFmiEsriDate:
+        sort(Dates(theField));
+        break;
+    }
+
+    theColumn.index.swap(index);
+    theColumn.hasindex.store(true, std::memory_order_release);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Imagine
+
+// ======================================================================
@@ -0,0 +1,121 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of class Imagine::NFmiEsriAttributeTable
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiEsriAttributeTable
+ *
+ * \brief Column oriented storage for the attributes in a .dbf file
+ *
+ * The table keeps the raw .dbf records and converts a column into a
+ * typed array only when a value in it is first requested. Hence wide
+ * tables cost only their raw size unless the columns are actually used.
+ * The values are converted exactly as NFmiEsriShape::Read used to do.
+ *
+ * Columns are accessed by their index, which can be resolved once with
+ * FieldIndex. A column may also be indexed, in which case the record
+ * numbers sorted by value are available for range searches. The table
+ * is immutable apart from the lazy conversions and indexing, which are
+ * thread safe, and is shared by the elements read from the same file.
+ */
+// ======================================================================
+
+#pragma once
+
+#include "NFmiEsriAttributeName.h"
+
+#include <newbase/NFmiMetTime.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Imagine
+{
+class NFmiEsriAttributeTable
+{
+ public:
+  // The data consists of theNumRecords records of theRecordLength
+  // bytes, each beginning with the deletion flag. The offsets are
+  // relative to the beginning of a record.
+
+  NFmiEsriAttributeTable(const std::vector<NFmiEsriAttributeName> &theNames,
+                         const std::vector<int> &theOffsets,
+                         const std::vector<int> &theSizes,
+                         std::size_t theNumRecords,
+                         std::size_t theRecordLength,
+                         std::string theData);
+
+  std::size_t NumFields() const { return itsNames.size(); }
+  std::size_t NumRecords() const { return itsNumRecords; }
+
+  // Field index, or -1 if there is no such field
+
+  int FieldIndex(const std::string &theName) const;
+
+  const NFmiEsriAttributeName &Name(int theField) const;
+  NFmiEsriAttributeType Type(int theField) const;
+
+  // Values. The field must be of the requested type.
+
+  const std::string &GetString(int theField, std::size_t theRecord) const;
+  int GetInteger(int theField, std::size_t theRecord) const;
+  double GetDouble(int theField, std::size_t theRecord) const;
+  const NFmiMetTime &GetDate(int theField, std::size_t theRecord) const;
+
+  // The whole column, for scanning all records
+
+  const std::vector<std::string> &Strings(int theField) const;
+  const std::vector<int> &Integers(int theField) const;
+  const std::vector<double> &Doubles(int theField) const;
+  const std::vector<NFmiMetTime> &Dates(int theField) const;
+
+  // The record numbers ordered by the values of the field. The index
+  // is built on the first request unless built explicitly.
+
+  void BuildIndex(int theField) const;
+  bool HasIndex(int theField) const;
+  const std::vector<std::size_t> &Index(int theField) const;
+
+ private:
+  NFmiEsriAttributeTable() = delete;
+  NFmiEsriAttributeTable(const NFmiEsriAttributeTable &theOther) = delete;
+  NFmiEsriAttributeTable &operator=(const NFmiEsriAttributeTable &theOther) = delete;
+
+  struct Column
+  {
+    std::once_flag parsed;
+    std::vector<std::string> strings;
+    std::vector<int> integers;
+    std::vector<double> doubles;
+    std::vector<NFmiMetTime> dates;
+
+    std::once_flag indexed;
+    std::atomic<bool> hasindex{false};
+    std::vector<std::size_t> index;
+  };
+
+  const Column &Parsed(int theField, NFmiEsriAttributeType theType) const;
+  void Parse(int theField, Column &theColumn) const;
+  void Sort(int theField, Column &theColumn) const;
+
+  std::vector<NFmiEsriAttributeName> itsNames;
+  std::vector<int> itsOffsets;
+  std::vector<int> itsSizes;
+  std::size_t itsNumRecords;
+  std::size_t itsRecordLength;
+  std::string itsData;
+
+  std::unordered_map<std::string, int> itsFieldIndexes;
+  std::unique_ptr<Column[]> itsColumns;
+};
+
+}  // namespace Imagine
+
+// ======================================================================
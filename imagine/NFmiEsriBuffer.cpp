@@ -166,6 +166,100 @@ double NFmiEsriBuffer::LittleEndianDouble(const std::string &theBuffer, int theP
   }
 }
 
+// ----------------------------------------------------------------------
+// Read a big endian integer from raw data
+// ----------------------------------------------------------------------
+
+int NFmiEsriBuffer::BigEndianInt(const char *theData)
+{
+  try
+  {
+    unsigned char tmp[4];
+    memcpy(tmp, theData, 4);
+    if (IsCpuLittleEndian())
+    {
+      swap(tmp[0], tmp[3]);
+      swap(tmp[1], tmp[2]);
+    }
+    uint32_t value;
+    memcpy(&value, tmp, 4);
+    return value;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Read a little endian integer from raw data
+// ----------------------------------------------------------------------
+
+int NFmiEsriBuffer::LittleEndianInt(const char *theData)
+{
+  try
+  {
+    unsigned char tmp[4];
+    memcpy(tmp, theData, 4);
+    if (!IsCpuLittleEndian())
+    {
+      swap(tmp[0], tmp[3]);
+      swap(tmp[1], tmp[2]);
+    }
+    uint32_t value;
+    memcpy(&value, tmp, 4);
+    return value;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Read a little endian short integer from raw data
+// ----------------------------------------------------------------------
+
+int NFmiEsriBuffer::LittleEndianShort(const char *theData)
+{
+  try
+  {
+    return (static_cast<unsigned char>(theData[0]) +
+            static_cast<unsigned char>(theData[1]) * 256);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Read a little endian double from raw data
+// ----------------------------------------------------------------------
+
+double NFmiEsriBuffer::LittleEndianDouble(const char *theData)
+{
+  try
+  {
+    unsigned char tmp[8];
+    memcpy(tmp, theData, 8);
+    if (!IsCpuLittleEndian())
+    {
+      swap(tmp[0], tmp[7]);
+      swap(tmp[1], tmp[6]);
+      swap(tmp[2], tmp[5]);
+      swap(tmp[3], tmp[4]);
+    }
+    double value;
+    memcpy(&value, tmp, 8);
+    return value;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 // ----------------------------------------------------------------------
 // Return a big endian integer buffer
 // ----------------------------------------------------------------------
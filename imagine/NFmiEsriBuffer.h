@@ -20,6 +20,13 @@ int BigEndianShort(const std::string& theBuffer, int thePos);
 int LittleEndianShort(const std::string& theBuffer, int thePos);
 double LittleEndianDouble(const std::string& theBuffer, int thePos);
 
+// The same for raw data such as memory mapped files
+
+int BigEndianInt(const char* theData);
+int LittleEndianInt(const char* theData);
+int LittleEndianShort(const char* theData);
+double LittleEndianDouble(const char* theData);
+
 const std::string BigEndianInt(int theValue);
 const std::string LittleEndianInt(int theValue);
 const std::string LittleEndianDouble(double theValue);
@@ -6,6 +6,7 @@
 // ======================================================================
 
 #include "NFmiEsriElement.h"
+#include "NFmiEsriAttributeTable.h"
 #include <macgyver/Exception.h>
 
 using namespace std;
@@ -25,6 +26,8 @@ NFmiEsriElement& NFmiEsriElement::operator=(const NFmiEsriElement& theElement)
       itsType = theElement.itsType;
       itsNumber = theElement.itsNumber;
       itsAttributes = theElement.itsAttributes;
+      itsTable = theElement.itsTable;
+      itsRecord = theElement.itsRecord;
     }
     return *this;
   }
@@ -34,6 +37,44 @@ NFmiEsriElement& NFmiEsriElement::operator=(const NFmiEsriElement& theElement)
   }
 }
 
+// ----------------------------------------------------------------------
+// Return the index of the named field in the attribute table, or -1 if
+// there is no table, no such field, or no value for this element.
+// ----------------------------------------------------------------------
+
+int NFmiEsriElement::TableField(const string& theName) const
+{
+  try
+  {
+    if (!itsTable || itsRecord >= itsTable->NumRecords())
+      return -1;
+    return itsTable->FieldIndex(theName);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// As above, but the field must also be of the given type
+// ----------------------------------------------------------------------
+
+int NFmiEsriElement::TableField(const string& theName, NFmiEsriAttributeType theType) const
+{
+  try
+  {
+    const int field = TableField(theName);
+    if (field < 0 || itsTable->Type(field) != theType)
+      return -1;
+    return field;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 // ----------------------------------------------------------------------
 // Return type of attribute
 // ----------------------------------------------------------------------
@@ -52,6 +93,10 @@ NFmiEsriAttributeType NFmiEsriElement::GetType(const string& theName) const
         return (*iter).GetType();
     }
 
+    const int field = TableField(theName);
+    if (field >= 0)
+      return itsTable->Type(field);
+
     // Just some default value, maybe we should throw?
 
     return kFmiEsriString;
@@ -81,6 +126,10 @@ const std::string NFmiEsriElement::GetString(const string& theName) const
           return (*iter).GetString();
     }
 
+    const int field = TableField(theName, kFmiEsriString);
+    if (field >= 0)
+      return itsTable->GetString(field, itsRecord);
+
     // Return empty string if field not found
 
     static const string tmp = "";
@@ -111,6 +160,10 @@ const NFmiMetTime& NFmiEsriElement::GetDate(const std::string& theName) const
           return (*iter).GetDate();
     }
 
+    const int field = TableField(theName, kFmiEsriDate);
+    if (field >= 0)
+      return itsTable->GetDate(field, itsRecord);
+
     throw Fmi::Exception(BCP, "Date field " + theName + " not found");
   }
   catch (...)
@@ -138,6 +191,10 @@ int NFmiEsriElement::GetInteger(const string& theName) const
           return (*iter).GetInteger();
     }
 
+    const int field = TableField(theName, kFmiEsriInteger);
+    if (field >= 0)
+      return itsTable->GetInteger(field, itsRecord);
+
     // Maybe should error instead..
 
     return 0;
@@ -167,6 +224,10 @@ double NFmiEsriElement::GetDouble(const string& theName) const
           return (*iter).GetDouble();
     }
 
+    const int field = TableField(theName, kFmiEsriDouble);
+    if (field >= 0)
+      return itsTable->GetDouble(field, itsRecord);
+
     // Maybe should error instead..
 
     return 0.0;
@@ -12,6 +12,7 @@
 
 #include <memory>
 
+#include <cstddef>
 #include <iostream>
 #include <list>
 
@@ -35,6 +36,7 @@ enum NFmiEsriElementType
   kFmiEsriMultiPatch = 31
 };
 
+class NFmiEsriAttributeTable;
 class NFmiEsriBox;
 
 class NFmiEsriElement
@@ -42,7 +44,7 @@ class NFmiEsriElement
  public:
   virtual ~NFmiEsriElement(void) {}
   NFmiEsriElement(NFmiEsriElementType theType, int theNumber = 0)
-      : itsType(theType), itsNumber(theNumber), itsAttributes()
+      : itsType(theType), itsNumber(theNumber), itsAttributes(), itsTable(), itsRecord(0)
   {
   }
 
@@ -53,6 +55,22 @@ class NFmiEsriElement
   // Adding an attribute
 
   void Add(const NFmiEsriAttribute& theAttribute) { itsAttributes.push_back(theAttribute); }
+  // Attributes stored in a table shared by all elements read from the
+  // same file. Individually added attributes take precedence.
+
+  void SetAttributes(const std::shared_ptr<const NFmiEsriAttributeTable>& theTable,
+                     std::size_t theRecord)
+  {
+    itsTable = theTable;
+    itsRecord = theRecord;
+  }
+
+  const std::list<NFmiEsriAttribute>& Attributes(void) const { return itsAttributes; }
+  const std::shared_ptr<const NFmiEsriAttributeTable>& AttributeTable(void) const
+  {
+    return itsTable;
+  }
+  std::size_t AttributeRecord(void) const { return itsRecord; }
   // Returning an attribute value
 
   const std::string GetString(const std::string& theName) const;
@@ -90,15 +108,22 @@ class NFmiEsriElement
   NFmiEsriElement(const NFmiEsriElement& theElement)
       : itsType(theElement.itsType),
         itsNumber(theElement.itsNumber),
-        itsAttributes(theElement.itsAttributes)
+        itsAttributes(theElement.itsAttributes),
+        itsTable(theElement.itsTable),
+        itsRecord(theElement.itsRecord)
   {
   }
 
   NFmiEsriElement& operator=(const NFmiEsriElement& theElement);
 
+  int TableField(const std::string& theName) const;
+  int TableField(const std::string& theName, NFmiEsriAttributeType theType) const;
+
   NFmiEsriElementType itsType;
   int itsNumber;
   std::list<NFmiEsriAttribute> itsAttributes;
+  std::shared_ptr<const NFmiEsriAttributeTable> itsTable;
+  std::size_t itsRecord;
 };
 
 }  // namespace Imagine
@@ -0,0 +1,577 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of class Imagine::NFmiEsriMappedShape
+ */
+// ======================================================================
+
+#include "NFmiEsriMappedShape.h"
+#include "NFmiEsriBuffer.h"
+#include "NFmiEsriMultiPointZ.h"
+#include "NFmiEsriNull.h"
+#include "NFmiEsriPointZ.h"
+#include "NFmiEsriPolyLineZ.h"
+#include "NFmiEsriPolygonZ.h"
+#include "NFmiEsriShape.h"
+#include <macgyver/Exception.h>
+#include <newbase/NFmiFileSystem.h>
+#include <newbase/NFmiSettings.h>
+#include <newbase/NFmiStringTools.h>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+using namespace Imagine::NFmiEsriBuffer;  // Conversion tools
+using namespace std;
+
+namespace
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Find a shapefile component, trying the upper case suffix too
+ */
+// ----------------------------------------------------------------------
+
+std::string find_file(const std::string &theFilename,
+                      const std::string &theSuffix,
+                      const std::string &theUpperSuffix,
+                      const std::string &thePath)
+{
+  std::string filename = NFmiFileSystem::FileComplete(theFilename + theSuffix, thePath);
+  if (NFmiFileSystem::FileExists(filename))
+    return filename;
+  return NFmiFileSystem::FileComplete(theFilename + theUpperSuffix, thePath);
+}
+
+}  // namespace
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Construct a view to the record contents
+ *
+ * The counts are validated against the record length, hence the
+ * accessors can be used without further checks for valid indices.
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriMappedShape::Record::Record(const char *theData, int theLength, int theNumber)
+    : itsData(theData),
+      itsLength(theLength),
+      itsNumber(theNumber),
+      itsType(kFmiEsriNull),
+      itsNumParts(0),
+      itsNumPoints(0),
+      itsPointOffset(0)
+{
+  try
+  {
+    if (itsLength < 4)
+      return;
+
+    itsType = static_cast<NFmiEsriElementType>(LittleEndianInt(itsData));
+
+    int minlength = 4;
+    int partsize = 0;  // bytes per part before the points
+
+    switch (itsType)
+    {
+      case kFmiEsriNull:
+        break;
+      case kFmiEsriPoint:
+      case kFmiEsriPointM:
+      case kFmiEsriPointZ:
+        itsNumPoints = 1;
+        itsPointOffset = 4;
+        minlength = 20;
+        break;
+      case kFmiEsriMultiPoint:
+      case kFmiEsriMultiPointM:
+      case kFmiEsriMultiPointZ:
+        minlength = 40;
+        if (itsLength >= minlength)
+          itsNumPoints = LittleEndianInt(itsData + 36);
+        itsPointOffset = 40;
+        break;
+      case kFmiEsriPolyLine:
+      case kFmiEsriPolyLineM:
+      case kFmiEsriPolyLineZ:
+      case kFmiEsriPolygon:
+      case kFmiEsriPolygonM:
+      case kFmiEsriPolygonZ:
+      case kFmiEsriMultiPatch:
+        minlength = 44;
+        if (itsLength >= minlength)
+        {
+          itsNumParts = LittleEndianInt(itsData + 36);
+          itsNumPoints = LittleEndianInt(itsData + 40);
+        }
+        itsPointOffset = 44;
+        partsize = (itsType == kFmiEsriMultiPatch ? 8 : 4);
+        break;
+      default:
+        throw Fmi::Exception(BCP, "Unknown shape type in record " + to_string(itsNumber));
+    }
+
+    // The counts come from the file, hence the sizes are calculated in
+    // 64-bit arithmetic so that corrupted counts cannot overflow.
+
+    const int64_t pointoffset = itsPointOffset + static_cast<int64_t>(partsize) * itsNumParts;
+
+    if (itsLength < minlength || itsNumParts < 0 || itsNumPoints < 0 ||
+        pointoffset + 16 * static_cast<int64_t>(itsNumPoints) > itsLength)
+      throw Fmi::Exception(BCP, "Corrupted shape record " + to_string(itsNumber));
+
+    itsPointOffset = static_cast<int>(pointoffset);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the bounding box stored in the record
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriBox NFmiEsriMappedShape::Record::Box() const
+{
+  try
+  {
+    NFmiEsriBox box;
+    if (itsNumPoints == 0)
+      return box;
+
+    if (itsPointOffset == 4)
+      box.Update(X(0), Y(0));
+    else
+    {
+      box.Update(LittleEndianDouble(itsData + 4), LittleEndianDouble(itsData + 12));
+      box.Update(LittleEndianDouble(itsData + 20), LittleEndianDouble(itsData + 28));
+    }
+    return box;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the index of the first point of the given part
+ */
+// ----------------------------------------------------------------------
+
+int NFmiEsriMappedShape::Record::Part(int i) const
+{
+  return LittleEndianInt(itsData + 44 + 4 * i);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the type of the given multipatch part
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriMultiPatchType NFmiEsriMappedShape::Record::PartType(int i) const
+{
+  return static_cast<NFmiEsriMultiPatchType>(
+      LittleEndianInt(itsData + 44 + 4 * itsNumParts + 4 * i));
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the X-coordinate of the given point
+ */
+// ----------------------------------------------------------------------
+
+double NFmiEsriMappedShape::Record::X(int i) const
+{
+  return LittleEndianDouble(itsData + itsPointOffset + 16 * i);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the Y-coordinate of the given point
+ */
+// ----------------------------------------------------------------------
+
+double NFmiEsriMappedShape::Record::Y(int i) const
+{
+  return LittleEndianDouble(itsData + itsPointOffset + 16 * i + 8);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Decode the record into a new element
+ *
+ * Only the record itself is copied for the element constructors.
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriElement *NFmiEsriMappedShape::Record::Element() const
+{
+  try
+  {
+    const string buffer(itsData, itsLength);
+
+    switch (itsType)
+    {
+      case kFmiEsriNull:
+        return new NFmiEsriNull(itsNumber);
+      case kFmiEsriPoint:
+        return new NFmiEsriPoint(buffer, 0, itsNumber);
+      case kFmiEsriMultiPoint:
+        return new NFmiEsriMultiPoint(buffer, 0, itsNumber);
+      case kFmiEsriPolyLine:
+        return new NFmiEsriPolyLine(buffer, 0, itsNumber);
+      case kFmiEsriPolygon:
+        return new NFmiEsriPolygon(buffer, 0, itsNumber);
+      case kFmiEsriPointM:
+        return new NFmiEsriPointM(buffer, 0, itsNumber);
+      case kFmiEsriMultiPointM:
+        return new NFmiEsriMultiPointM(buffer, 0, itsNumber);
+      case kFmiEsriPolyLineM:
+        return new NFmiEsriPolyLineM(buffer, 0, itsNumber);
+      case kFmiEsriPolygonM:
+        return new NFmiEsriPolygonM(buffer, 0, itsNumber);
+      case kFmiEsriPointZ:
+        return new NFmiEsriPointZ(buffer, 0, itsNumber);
+      case kFmiEsriMultiPointZ:
+        return new NFmiEsriMultiPointZ(buffer, 0, itsNumber);
+      case kFmiEsriPolyLineZ:
+        return new NFmiEsriPolyLineZ(buffer, 0, itsNumber);
+      case kFmiEsriPolygonZ:
+        return new NFmiEsriPolygonZ(buffer, 0, itsNumber);
+      case kFmiEsriMultiPatch:
+        return new NFmiEsriMultiPatch(buffer, 0, itsNumber);
+    }
+
+    throw Fmi::Exception(BCP, "Unknown shape type in record " + to_string(itsNumber));
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Map the shapefile
+ *
+ * The name is given without a suffix as in NFmiEsriShape::Read. The
+ * .dbf file is optional, and is not mapped at all if fDBF is false.
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriMappedShape::NFmiEsriMappedShape(const string &theFilename, bool fDBF)
+    : itsType(kFmiEsriNull), itsNumRecords(0), itsRecordsOffset(0), itsRecordLength(0)
+{
+  try
+  {
+    const string shapes_path = NFmiSettings::Optional<string>("imagine::shapes_path", string("."));
+
+    itsSHP.reset(new NFmiMappedFile(find_file(theFilename, ".shp", ".SHP", shapes_path)));
+
+    const char *data = itsSHP->Data();
+
+    if (itsSHP->Size() < static_cast<size_t>(kFmiEsriHeaderSize) ||
+        BigEndianInt(data + kFmiEsriPosMagic) != kFmiEsriMagicNumber)
+      throw Fmi::Exception(BCP, "'" + itsSHP->Name() + "' is not a shapefile");
+
+    itsType = static_cast<NFmiEsriElementType>(LittleEndianInt(data + kFmiEsriPosType));
+
+    itsBox.Update(LittleEndianDouble(data + kFmiEsriPosXmin),
+                  LittleEndianDouble(data + kFmiEsriPosYmin));
+    itsBox.Update(LittleEndianDouble(data + kFmiEsriPosXmax),
+                  LittleEndianDouble(data + kFmiEsriPosYmax));
+
+    ReadOffsets(find_file(theFilename, ".shx", ".SHX", shapes_path));
+
+    if (!fDBF)
+      return;
+
+    const string dbffilename = find_file(theFilename, ".dbf", ".DBF", shapes_path);
+    if (NFmiFileSystem::FileEmpty(dbffilename))
+      return;
+
+    itsDBF.reset(new NFmiMappedFile(dbffilename));
+    ReadDBFHeader();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Establish the record positions
+ *
+ * The positions are taken from the .shx file if it exists, otherwise
+ * the record headers in the .shp file are scanned. The positions are
+ * validated only when the records are accessed so that the .shp file
+ * need not be read at all here.
+ */
+// ----------------------------------------------------------------------
+
+void NFmiEsriMappedShape::ReadOffsets(const string &theSHX)
+{
+  try
+  {
+    if (NFmiFileSystem::FileExists(theSHX))
+    {
+      NFmiMappedFile shx(theSHX);
+      const char *data = shx.Data();
+      if (shx.Size() < static_cast<size_t>(kFmiEsriHeaderSize) ||
+          BigEndianInt(data + kFmiEsriPosMagic) != kFmiEsriMagicNumber)
+        throw Fmi::Exception(BCP, "'" + theSHX + "' is not a shapefile index");
+
+      const size_t n = (shx.Size() - kFmiEsriHeaderSize) / 8;
+      itsOffsets.reserve(n);
+      for (size_t i = 0; i < n; i++)
+        itsOffsets.push_back(2 * static_cast<size_t>(static_cast<unsigned int>(
+                                     BigEndianInt(data + kFmiEsriHeaderSize + 8 * i))));
+      return;
+    }
+
+    const char *data = itsSHP->Data();
+    const size_t size = itsSHP->Size();
+
+    size_t pos = kFmiEsriHeaderSize;
+    while (pos + kFmiEsriRecordHeaderSize <= size)
+    {
+      const int reclen = BigEndianInt(data + pos + kFmiEsriRecordHeaderPosLen);
+      if (reclen < 0)
+        throw Fmi::Exception(BCP, "Corrupted shapefile '" + itsSHP->Name() + "'");
+      itsOffsets.push_back(pos);
+      pos += kFmiEsriRecordHeaderSize + 2 * static_cast<size_t>(reclen);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Parse the field descriptions of the .dbf file
+ *
+ * The fields are interpreted as in NFmiEsriShape::Read.
+ */
+// ----------------------------------------------------------------------
+
+void NFmiEsriMappedShape::ReadDBFHeader()
+{
+  try
+  {
+    const char *data = itsDBF->Data();
+    const size_t size = itsDBF->Size();
+
+    if (size < static_cast<size_t>(kFmixBaseHeaderSize) || data[0] != 3)
+      throw Fmi::Exception(BCP, "'" + itsDBF->Name() + "' is not a dBASE file");
+
+    itsNumRecords = static_cast<unsigned int>(LittleEndianInt(data + kFmixBaseNumRecordsPos));
+    itsRecordsOffset = LittleEndianShort(data + kFmixBaseHeaderLengthPos);
+    itsRecordLength = LittleEndianShort(data + kFmixBaseRecordLengthPos);
+
+    const int numfields =
+        (static_cast<int>(itsRecordsOffset) - kFmixBaseHeaderSize) / kFmixBaseFieldSize;
+
+    if (itsRecordsOffset + itsNumRecords * itsRecordLength > size)
+      throw Fmi::Exception(BCP, "'" + itsDBF->Name() + "' is truncated");
+
+    int offset = 1;  // size of leading delete flag is 1
+
+    for (int num = 0; num < numfields; num++)
+    {
+      const char *field = data + kFmixBaseHeaderSize + num * kFmixBaseFieldSize;
+
+      const string fname(field + kFmixBaseFieldNamePos, strnlen(field + kFmixBaseFieldNamePos, 11));
+      const char ftype = field[kFmixBaseFieldTypePos];
+      const int flen = static_cast<unsigned char>(field[kFmixBaseFieldLengthPos]);
+      const int dlen = static_cast<unsigned char>(field[kFmixBaseFieldDecimalPos]);
+      const int slen = LittleEndianShort(field + kFmixBaseFieldLengthPos);
+
+      int fsize = 0;
+      if (ftype == 'N' || ftype == 'F')
+      {
+        if (dlen == 0)
+          itsAttributes.push_back(NFmiEsriAttributeName(fname, kFmiEsriInteger, flen, dlen, -1));
+        else
+          itsAttributes.push_back(NFmiEsriAttributeName(fname, kFmiEsriDouble, flen, dlen, -1));
+        fsize = flen;
+      }
+      else if (ftype == 'C')
+      {
+        itsAttributes.push_back(NFmiEsriAttributeName(fname, kFmiEsriString, -1, -1, slen));
+        fsize = slen;
+      }
+      else if (ftype == 'D')
+      {
+        itsAttributes.push_back(NFmiEsriAttributeName(fname, kFmiEsriDate, 8, 8, -1));
+        fsize = 8;
+      }
+      else
+        throw Fmi::Exception(BCP, string("Unrecognized shape value type '") + ftype + "'");
+
+      if (offset + fsize > static_cast<int>(itsRecordLength))
+        throw Fmi::Exception(BCP, "Invalid field sizes in '" + itsDBF->Name() + "'");
+
+      itsFieldOffsets.push_back(offset);
+      itsFieldSizes.push_back(fsize);
+      offset += fsize;
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return a view to the given record
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriMappedShape::Record NFmiEsriMappedShape::operator[](size_t theRecord) const
+{
+  try
+  {
+    const size_t pos = itsOffsets.at(theRecord);
+    const size_t size = itsSHP->Size();
+    const char *data = itsSHP->Data();
+
+    if (pos + kFmiEsriRecordHeaderSize > size)
+      throw Fmi::Exception(BCP, "Shape record position outside '" + itsSHP->Name() + "'");
+
+    const int recnum = BigEndianInt(data + pos + kFmiEsriRecordHeaderPosNum);
+    const int reclen = BigEndianInt(data + pos + kFmiEsriRecordHeaderPosLen);
+
+    if (reclen < 0 || reclen > numeric_limits<int>::max() / 2 ||
+        pos + kFmiEsriRecordHeaderSize + 2 * static_cast<size_t>(reclen) > size)
+      throw Fmi::Exception(BCP, "Shape record " + to_string(recnum) + " is truncated");
+
+    return Record(data + pos + kFmiEsriRecordHeaderSize, 2 * reclen, recnum);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the index of the named attribute, or -1 if there is none
+ */
+// ----------------------------------------------------------------------
+
+int NFmiEsriMappedShape::AttributeIndex(const string &theName) const
+{
+  try
+  {
+    for (size_t i = 0; i < itsAttributes.size(); i++)
+      if (itsAttributes[i].Name() == theName)
+        return static_cast<int>(i);
+    return -1;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test whether the given .dbf record is marked deleted
+ */
+// ----------------------------------------------------------------------
+
+bool NFmiEsriMappedShape::Deleted(size_t theRecord) const
+{
+  try
+  {
+    if (theRecord >= itsNumRecords)
+      throw Fmi::Exception(BCP, "Attribute record index out of range");
+    return (itsDBF->Data()[itsRecordsOffset + theRecord * itsRecordLength] == '*');
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the given attribute value of the given record
+ */
+// ----------------------------------------------------------------------
+
+string NFmiEsriMappedShape::String(size_t theRecord, int theAttribute) const
+{
+  try
+  {
+    if (theRecord >= itsNumRecords)
+      throw Fmi::Exception(BCP, "Attribute record index out of range");
+    if (theAttribute < 0 || theAttribute >= static_cast<int>(itsAttributes.size()))
+      throw Fmi::Exception(BCP, "Attribute index out of range");
+
+    const char *field = itsDBF->Data() + itsRecordsOffset + theRecord * itsRecordLength +
+                        itsFieldOffsets[theAttribute];
+
+    string value(field, itsFieldSizes[theAttribute]);
+    NFmiStringTools::TrimL(value);
+    NFmiStringTools::TrimR(value);
+    return value;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Copy the attributes of the given records into a table
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<NFmiEsriAttributeTable> NFmiEsriMappedShape::AttributeTable(
+    const vector<size_t> &theRecords) const
+{
+  try
+  {
+    string data;
+    size_t count = 0;
+
+    if (itsDBF)
+    {
+      data.reserve(theRecords.size() * itsRecordLength);
+      for (size_t rec : theRecords)
+      {
+        if (rec >= itsNumRecords)
+          break;
+        data.append(itsDBF->Data() + itsRecordsOffset + rec * itsRecordLength, itsRecordLength);
+        ++count;
+      }
+    }
+
+    return make_shared<NFmiEsriAttributeTable>(
+        itsAttributes, itsFieldOffsets, itsFieldSizes, count, itsRecordLength, std::move(data));
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Imagine
+
+// ======================================================================
@@ -0,0 +1,156 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of class Imagine::NFmiEsriMappedShape
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiEsriMappedShape
+ *
+ * \brief Memory mapped read only access to ESRI shapefiles
+ *
+ * NFmiEsriShape::Read copies the whole .shp and .dbf files into memory
+ * and converts every record into an element object, which takes a long
+ * time for large files. This class instead maps the .shp, .shx and .dbf
+ * files into memory and provides records as lightweight views into the
+ * mapped data, decoding the values only when they are requested:
+ * \code
+ * NFmiEsriMappedShape shape("coastlines");
+ * for (std::size_t i = 0; i < shape.Size(); i++)
+ * {
+ *   NFmiEsriMappedShape::Record record = shape[i];
+ *   for (int j = 0; j < record.NumPoints(); j++)
+ *     path.LineTo(record.X(j), record.Y(j));
+ * }
+ * \endcode
+ * Opening a file reads the record positions from the .shx file if it
+ * exists, otherwise the record headers in the .shp file are scanned.
+ * Either way the time taken is linear in the number of records, but
+ * the record contents are not read until they are accessed. The files
+ * are searched in the same manner as in NFmiEsriShape::Read.
+ *
+ * The views and the pointers returned are valid for the lifetime of
+ * the shape object. Element returns a conventional element object for
+ * code requiring one. It copies the record, since the element
+ * constructors parse a string, so it is no faster than
+ * NFmiEsriShape::Read per record.
+ *
+ * NFmiEsriShape::Read does not use this class. Reading a full file
+ * with it still copies the whole .shp and .dbf files into memory,
+ * only the box and record filtered reads avoid that.
+ */
+// ======================================================================
+
+#pragma once
+
+#include "NFmiEsriAttributeName.h"
+#include "NFmiEsriAttributeTable.h"
+#include "NFmiEsriBox.h"
+#include "NFmiEsriElement.h"
+#include "NFmiEsriMultiPatch.h"
+#include "NFmiMappedFile.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Imagine
+{
+class NFmiEsriMappedShape
+{
+ public:
+  // A view to a single record in the .shp file
+
+  class Record
+  {
+   public:
+    Record(const char *theData, int theLength, int theNumber);
+
+    int Number() const { return itsNumber; }
+    NFmiEsriElementType Type() const { return itsType; }
+
+    // Bounding box, invalid for null records
+
+    NFmiEsriBox Box() const;
+
+    // Parts are empty for points and multipoints, a point has one point
+
+    int NumParts() const { return itsNumParts; }
+    int NumPoints() const { return itsNumPoints; }
+
+    int Part(int i) const;
+    NFmiEsriMultiPatchType PartType(int i) const;  // multipatches only
+    double X(int i) const;
+    double Y(int i) const;
+
+    // A new element decoded from the record, owned by the caller
+
+    NFmiEsriElement *Element() const;
+
+   private:
+    const char *itsData;
+    int itsLength;
+    int itsNumber;
+    NFmiEsriElementType itsType;
+    int itsNumParts;
+    int itsNumPoints;
+    int itsPointOffset;
+  };
+
+  explicit NFmiEsriMappedShape(const std::string &theFilename, bool fDBF = true);
+
+  // Shapefile header information
+
+  NFmiEsriElementType Type() const { return itsType; }
+  const NFmiEsriBox &Box() const { return itsBox; }
+
+  // Record access
+
+  std::size_t Size() const { return itsOffsets.size(); }
+  Record operator[](std::size_t theRecord) const;
+
+  // Attribute access. The values are returned as stored in the .dbf
+  // file, with leading and trailing spaces removed.
+
+  bool HasAttributes() const { return (itsDBF != nullptr); }
+  std::size_t AttributeRecords() const { return itsNumRecords; }
+  const std::vector<NFmiEsriAttributeName> &Attributes() const { return itsAttributes; }
+  int AttributeIndex(const std::string &theName) const;
+
+  bool Deleted(std::size_t theRecord) const;
+  std::string String(std::size_t theRecord, int theAttribute) const;
+
+  // Copy the attributes of the given records into a table, the rows of
+  // which are in the given order. Copying stops at the first record
+  // beyond the end of the .dbf file.
+
+  std::shared_ptr<NFmiEsriAttributeTable> AttributeTable(
+      const std::vector<std::size_t> &theRecords) const;
+
+ private:
+  NFmiEsriMappedShape(const NFmiEsriMappedShape &theOther) = delete;
+  NFmiEsriMappedShape &operator=(const NFmiEsriMappedShape &theOther) = delete;
+
+  void ReadOffsets(const std::string &theSHX);
+  void ReadDBFHeader();
+
+  std::unique_ptr<NFmiMappedFile> itsSHP;
+  std::unique_ptr<NFmiMappedFile> itsDBF;
+
+  NFmiEsriElementType itsType;
+  NFmiEsriBox itsBox;
+
+  std::vector<std::size_t> itsOffsets;  // record header positions in the .shp file
+
+  std::vector<NFmiEsriAttributeName> itsAttributes;
+  std::vector<int> itsFieldOffsets;  // field positions in a .dbf record
+  std::vector<int> itsFieldSizes;    // field sizes in a .dbf record
+  std::size_t itsNumRecords;         // records in the .dbf file
+  std::size_t itsRecordsOffset;      // position of the first .dbf record
+  std::size_t itsRecordLength;       // length of a .dbf record
+};
+
+}  // namespace Imagine
+
+// ======================================================================
@@ -195,16 +195,7 @@ void NFmiEsriMultiPatch::Project(const NFmiEsriProjector& theProjector)
   try
   {
     theProjector.SetBox(itsBox);
-
-    static_cast<NFmiEsriBox>(itsBox).Init();
-    for (int i = 0; i < NumPoints(); i++)
-    {
-      NFmiEsriPoint tmp(itsPoints[i].X(), itsPoints[i].Y());
-      tmp = theProjector(tmp);
-      itsPoints[i].X(tmp.X());
-      itsPoints[i].Y(tmp.Y());
-      static_cast<NFmiEsriBox>(itsBox).Update(tmp.X(), tmp.Y());
-    }
+    theProjector.ProjectPoints(itsPoints, itsBox);
   }
   catch (...)
   {
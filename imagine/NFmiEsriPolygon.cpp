@@ -174,16 +174,7 @@ void NFmiEsriPolygon::Project(const NFmiEsriProjector& theProjector)
   try
   {
     theProjector.SetBox(itsBox);
-
-    itsBox.Init();
-    for (int i = 0; i < NumPoints(); i++)
-    {
-      NFmiEsriPoint tmp(itsPoints[i].X(), itsPoints[i].Y());
-      tmp = theProjector(tmp);
-      itsPoints[i].X(tmp.X());
-      itsPoints[i].Y(tmp.Y());
-      itsBox.Update(tmp.X(), tmp.Y());
-    }
+    theProjector.ProjectPoints(itsPoints, itsBox);
   }
   catch (...)
   {
@@ -0,0 +1,39 @@
+// ======================================================================
+//
+// Abstract base class, from which any actual projector should be derived.
+//
+// ======================================================================
+
+#include "NFmiEsriProjector.h"
+#include "NFmiEsriPoint.h"
+#include <macgyver/Exception.h>
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+// Project a batch of coordinates one point at a time
+// ----------------------------------------------------------------------
+
+void NFmiEsriProjector::Project(std::vector<double>& theX, std::vector<double>& theY) const
+{
+  try
+  {
+    if (theX.size() != theY.size())
+      throw Fmi::Exception(BCP, "Coordinate arrays to be projected are of different size");
+
+    for (std::size_t i = 0; i < theX.size(); i++)
+    {
+      NFmiEsriPoint tmp = (*this)(NFmiEsriPoint(theX[i], theY[i]));
+      theX[i] = tmp.X();
+      theY[i] = tmp.Y();
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Imagine
+
+// ======================================================================
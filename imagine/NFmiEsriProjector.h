@@ -14,6 +14,9 @@
 
 #include <newbase/NFmiDef.h>
 
+#include <cstddef>
+#include <vector>
+
 namespace Imagine
 {
 class NFmiEsriPoint;  // introduce projector argument type
@@ -26,6 +29,43 @@ class NFmiEsriProjector
   NFmiEsriProjector() {}
   virtual NFmiEsriPoint operator()(const NFmiEsriPoint& thePoint) const = 0;
   virtual void SetBox(const NFmiEsriBox& theBox) const = 0;
+
+  // Project a batch of coordinates in place. The default implementation
+  // projects the points one at a time.
+
+  virtual void Project(std::vector<double>& theX, std::vector<double>& theY) const;
+
+  // An independent copy for use in another thread, or null if the
+  // projector cannot be copied. NFmiEsriShape::Project projects in
+  // parallel only if the projector can be cloned.
+
+  virtual NFmiEsriProjector* Clone() const { return nullptr; }
+
+  // Project the X and Y coordinates of the points via the batch
+  // interface and update the bounding box in the same pass
+
+  template <typename Points, typename Box>
+  void ProjectPoints(Points& thePoints, Box& theBox) const
+  {
+    const std::size_t n = thePoints.size();
+    std::vector<double> x(n);
+    std::vector<double> y(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+      x[i] = thePoints[i].X();
+      y[i] = thePoints[i].Y();
+    }
+
+    Project(x, y);
+
+    theBox.Init();
+    for (std::size_t i = 0; i < n; i++)
+    {
+      thePoints[i].X(x[i]);
+      thePoints[i].Y(y[i]);
+      theBox.Update(x[i], y[i]);
+    }
+  }
 };
 
 }  // namespace Imagine
@@ -0,0 +1,192 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of class Imagine::NFmiEsriRTree
+ */
+// ======================================================================
+
+#include "NFmiEsriRTree.h"
+#include "NFmiEsriBox.h"
+#include <macgyver/Exception.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+namespace
+{
+// Maximum number of children in a node
+
+const std::size_t node_capacity = 16;
+
+}  // namespace
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Build the tree from the given boxes
+ *
+ * The indices returned by Query refer to the given vector.
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriRTree::NFmiEsriRTree(const vector<NFmiEsriBox> &theBoxes)
+{
+  try
+  {
+    for (size_t i = 0; i < theBoxes.size(); i++)
+    {
+      const NFmiEsriBox &box = theBoxes[i];
+      if (box.IsValid())
+        itsItems.push_back(Entry{Rect{box.Xmin(), box.Ymin(), box.Xmax(), box.Ymax()}, i, 0});
+    }
+
+    if (itsItems.empty())
+      return;
+
+    // Pack each level until only the root remains
+
+    vector<Entry> parents;
+    Pack(itsItems, parents);
+
+    while (parents.size() > 1)
+    {
+      itsNodes.push_back(std::move(parents));
+      parents.clear();
+      Pack(itsNodes.back(), parents);
+    }
+    itsNodes.push_back(std::move(parents));
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Sort the entries of a level and create the parent nodes for them
+ */
+// ----------------------------------------------------------------------
+
+void NFmiEsriRTree::Pack(vector<Entry> &theEntries, vector<Entry> &theNodes) const
+{
+  try
+  {
+    const size_t n = theEntries.size();
+    const size_t nodes = (n + node_capacity - 1) / node_capacity;
+    const size_t slices = static_cast<size_t>(ceil(sqrt(static_cast<double>(nodes))));
+    const size_t slicesize = slices * node_capacity;
+
+    sort(theEntries.begin(),
+         theEntries.end(),
+         [](const Entry &theFirst, const Entry &theSecond)
+         {
+           return (theFirst.rect.xmin + theFirst.rect.xmax <
+                   theSecond.rect.xmin + theSecond.rect.xmax);
+         });
+
+    for (size_t slice = 0; slice < n; slice += slicesize)
+    {
+      const size_t sliceend = min(n, slice + slicesize);
+
+      sort(theEntries.begin() + slice,
+           theEntries.begin() + sliceend,
+           [](const Entry &theFirst, const Entry &theSecond)
+           {
+             return (theFirst.rect.ymin + theFirst.rect.ymax <
+                     theSecond.rect.ymin + theSecond.rect.ymax);
+           });
+
+      for (size_t first = slice; first < sliceend; first += node_capacity)
+      {
+        const size_t last = min(sliceend, first + node_capacity);
+        Rect rect = theEntries[first].rect;
+        for (size_t i = first + 1; i < last; i++)
+        {
+          const Rect &r = theEntries[i].rect;
+          rect.xmin = min(rect.xmin, r.xmin);
+          rect.ymin = min(rect.ymin, r.ymin);
+          rect.xmax = max(rect.xmax, r.xmax);
+          rect.ymax = max(rect.ymax, r.ymax);
+        }
+        theNodes.push_back(Entry{rect, first, last - first});
+      }
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the indices of the boxes intersecting the given rectangle
+ *
+ * Boxes touching the rectangle are included. The indices are returned
+ * in ascending order.
+ */
+// ----------------------------------------------------------------------
+
+vector<size_t> NFmiEsriRTree::Query(double theXmin,
+                                    double theYmin,
+                                    double theXmax,
+                                    double theYmax) const
+{
+  try
+  {
+    vector<size_t> result;
+
+    if (itsNodes.empty())
+      return result;
+
+    auto intersects = [&](const Rect &theRect)
+    {
+      return !(theRect.xmin > theXmax || theRect.xmax < theXmin || theRect.ymin > theYmax ||
+               theRect.ymax < theYmin);
+    };
+
+    // Nodes to be visited as level and position pairs
+
+    vector<pair<size_t, size_t> > stack;
+    stack.push_back(make_pair(itsNodes.size() - 1, 0));
+
+    while (!stack.empty())
+    {
+      const size_t level = stack.back().first;
+      const Entry &node = itsNodes[level][stack.back().second];
+      stack.pop_back();
+
+      if (!intersects(node.rect))
+        continue;
+
+      const size_t last = node.first + node.count;
+      if (level == 0)
+      {
+        for (size_t i = node.first; i < last; i++)
+          if (intersects(itsItems[i].rect))
+            result.push_back(itsItems[i].first);
+      }
+      else
+      {
+        for (size_t i = node.first; i < last; i++)
+          stack.push_back(make_pair(level - 1, i));
+      }
+    }
+
+    sort(result.begin(), result.end());
+    return result;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Imagine
+
+// ======================================================================
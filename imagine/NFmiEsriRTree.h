@@ -0,0 +1,72 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of class Imagine::NFmiEsriRTree
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiEsriRTree
+ *
+ * \brief Static R-tree over the bounding boxes of shape elements
+ *
+ * The tree is bulk loaded with the Sort-Tile-Recursive algorithm:
+ * the boxes are sorted into vertical slices by their x-centers, each
+ * slice is sorted by the y-centers and packed into full nodes, and the
+ * same is repeated for the nodes until a single root remains. The
+ * tree cannot be modified once built, it must be rebuilt if the boxes
+ * change.
+ *
+ * Query returns the indices of the boxes intersecting the given
+ * rectangle in ascending order, hence the elements can be rendered in
+ * their original order. Invalid boxes never match.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Imagine
+{
+class NFmiEsriBox;
+
+class NFmiEsriRTree
+{
+ public:
+  NFmiEsriRTree(const std::vector<NFmiEsriBox> &theBoxes);
+
+  std::size_t Size() const { return itsItems.size(); }
+
+  std::vector<std::size_t> Query(double theXmin,
+                                 double theYmin,
+                                 double theXmax,
+                                 double theYmax) const;
+
+ private:
+  struct Rect
+  {
+    double xmin;
+    double ymin;
+    double xmax;
+    double ymax;
+  };
+
+  // A leaf item, or a node whose children are [first,first+count) on the level below
+
+  struct Entry
+  {
+    Rect rect;
+    std::size_t first;
+    std::size_t count;
+  };
+
+  void Pack(std::vector<Entry> &theEntries, std::vector<Entry> &theNodes) const;
+
+  std::vector<Entry> itsItems;                // leaf level, first is the box index
+  std::vector<std::vector<Entry> > itsNodes;  // node levels from the leaves up to the root
+};
+
+}  // namespace Imagine
+
+// ======================================================================
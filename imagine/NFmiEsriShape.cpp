@@ -138,12 +138,15 @@
 
 #include "NFmiEsriShape.h"
 
+#include "NFmiEsriAttributeTable.h"
+#include "NFmiEsriMappedShape.h"
 #include "NFmiEsriMultiPatch.h"
 #include "NFmiEsriMultiPointZ.h"
 #include "NFmiEsriNull.h"
 #include "NFmiEsriPointZ.h"
 #include "NFmiEsriPolyLineZ.h"
 #include "NFmiEsriPolygonZ.h"
+#include "NFmiEsriRTree.h"
 
 #include <fmt/format.h>
 #include <macgyver/Exception.h>
@@ -151,12 +154,21 @@
 #include <newbase/NFmiSettings.h>
 #include <newbase/NFmiTime.h>
 
+#include <algorithm>
+#include <exception>
 #include <fstream>
 #include <iomanip>
+#include <thread>
 
 using namespace Imagine::NFmiEsriBuffer;  // Conversion tools
 using namespace std;
 
+namespace
+{
+// Shapes with fewer points are projected in a single thread
+const std::size_t parallel_projection_limit = 100000;
+}  // namespace
+
 namespace Imagine
 {
 // ----------------------------------------------------------------------
@@ -165,6 +177,7 @@ namespace Imagine
 //	Destroy attributename pointees, clear the list
 //	Destroy element pointees, clear the vector
 //	Initialize bounding box
+//	Discard the spatial index
 //	Initialize type
 // ----------------------------------------------------------------------
 
@@ -196,6 +209,10 @@ void NFmiEsriShape::Init(void)
 
     itsBox.Init();
 
+    // Discard the spatial index
+
+    itsIndex.reset();
+
     // Initialize type
 
     itsShapeType = kFmiEsriNull;
@@ -216,6 +233,7 @@ void NFmiEsriShape::Add(NFmiEsriElement *theElement)
   {
     itsElements.push_back(theElement);
     theElement->Update(itsBox);
+    itsIndex.reset();
   }
   catch (...)
   {
@@ -239,6 +257,48 @@ void NFmiEsriShape::Add(NFmiEsriAttributeName *theAttributeName)
   }
 }
 
+// ----------------------------------------------------------------------
+// Keep only the given elements
+// ----------------------------------------------------------------------
+
+void NFmiEsriShape::Retain(const vector<size_t> &theIndices)
+{
+  try
+  {
+    for (size_t i = 0; i < theIndices.size(); i++)
+      if (theIndices[i] >= itsElements.size() || (i > 0 && theIndices[i] <= theIndices[i - 1]))
+        throw Fmi::Exception(BCP, "Element indices to retain must be ascending and in range");
+
+    elements_type elements;
+    elements.reserve(theIndices.size());
+
+    size_t next = 0;
+    for (size_t i = 0; i < itsElements.size(); i++)
+    {
+      if (next < theIndices.size() && theIndices[next] == i)
+      {
+        elements.push_back(itsElements[i]);
+        ++next;
+      }
+      else
+        delete itsElements[i];
+    }
+
+    itsElements.swap(elements);
+
+    itsBox.Init();
+    for (const auto *element : itsElements)
+      if (element != nullptr)
+        element->Update(itsBox);
+
+    itsIndex.reset();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 // ----------------------------------------------------------------------
 // Reading a shapefile and a database file. Returns TRUE if reading
 // was succesful, false otherwise. Note that we read the entire
@@ -365,22 +425,7 @@ bool NFmiEsriShape::Read(const string &theFilename, bool fDBF)
       pos += reclen * 2;  // Esri sizes are in 16-bit units!
     }
 
-    // We do not parse .proj files. We assume WGS84, unless one of the following files exists:
-    string fmifilename = NFmiFileSystem::FileComplete(theFilename + ".fmi", shapes_path);
-    string ykjfilename = NFmiFileSystem::FileComplete(theFilename + ".ykj", shapes_path);
-
-    std::string proj4 = "WGS84";
-    if (NFmiFileSystem::FileExists(fmifilename))
-      proj4 = fmt::format("+proj=longlat +R={:.0f} +over +no_defs +towgs84=0,0,0", kRearth);
-    else if (NFmiFileSystem::FileExists(ykjfilename))
-      proj4 =
-          "+proj=tmerc +lat_0=0 +lon_0=27 +k=1 +x_0=3500000 +y_0=0 +ellps=intl +units=m +wktext "
-          "+towgs84=-96.0617,-82.4278,-121.7535,4.80107,0.34543,-1.37646,1.4964 +no_defs";
-
-    auto err = itsSpatialReference.SetFromUserInput(proj4.c_str());
-
-    if (err != OGRERR_NONE)
-      throw Fmi::Exception(BCP, "Failed to create spatial reference from '" + proj4 + "'");
+    ReadSpatialReference(theFilename);
 
     // We're done if the DBF file is not desired
 
@@ -443,9 +488,8 @@ bool NFmiEsriShape::Read(const string &theFilename, bool fDBF)
 
     // These are just utility vectors to aid reading the data part:
 
-    vector<int> fieldoffsets;                  // offset to field
-    vector<int> fieldsizes;                    // size of field in bytes
-    vector<NFmiEsriAttributeType> fieldtypes;  // field type
+    vector<int> fieldoffsets;  // offset to field
+    vector<int> fieldsizes;    // size of field in bytes
 
     for (int num = 0; num < numfields; num++)
     {
@@ -456,8 +500,8 @@ bool NFmiEsriShape::Read(const string &theFilename, bool fDBF)
       // See the docs in the beginning, slen and flen,dlen are mutually
       // exclusive fields, the one to be used depends in the field type
 
-      int flen = dbffields[fieldpos + kFmixBaseFieldLengthPos];
-      int dlen = dbffields[fieldpos + kFmixBaseFieldDecimalPos];
+      int flen = static_cast<unsigned char>(dbffields[fieldpos + kFmixBaseFieldLengthPos]);
+      int dlen = static_cast<unsigned char>(dbffields[fieldpos + kFmixBaseFieldDecimalPos]);
 
       int slen = LittleEndianShort(dbffields, fieldpos + kFmixBaseFieldLengthPos);
 
@@ -467,27 +511,19 @@ bool NFmiEsriShape::Read(const string &theFilename, bool fDBF)
       if (ftype == 'N' || ftype == 'F')
       {
         if (dlen == 0)
-        {
           Add(new NFmiEsriAttributeName(fname, kFmiEsriInteger, flen, dlen, -1));
-          fieldtypes.push_back(kFmiEsriInteger);
-        }
         else
-        {
           Add(new NFmiEsriAttributeName(fname, kFmiEsriDouble, flen, dlen, -1));
-          fieldtypes.push_back(kFmiEsriDouble);
-        }
         fieldsizes.push_back(flen);
       }
       else if (ftype == 'C')
       {
         Add(new NFmiEsriAttributeName(fname, kFmiEsriString, -1, -1, slen));
         fieldsizes.push_back(slen);
-        fieldtypes.push_back(kFmiEsriString);
       }
       else  // ftype=D for date in YYYYMMDD form
       {
         Add(new NFmiEsriAttributeName(fname, kFmiEsriDate, 8, 8, -1));
-        fieldtypes.push_back(kFmiEsriDate);
         fieldsizes.push_back(8);
       }
 
@@ -497,14 +533,6 @@ bool NFmiEsriShape::Read(const string &theFilename, bool fDBF)
         fieldoffsets.push_back(fieldoffsets[num - 1] + fieldsizes[num - 1]);
     }
 
-    // Read in the attributes themselves. By ESRI shapefile definition the
-    // record order is the exact same in the shp file and the dbf file, hence
-    // we need not worry about matching records.
-
-    // The first shape to get an attribute
-
-    NFmiEsriShape::iterator elementiter = itsElements.begin();
-
     // Read all the records at once, including the leading terminator byte
 
     string dbfrecord;
@@ -513,61 +541,174 @@ bool NFmiEsriShape::Read(const string &theFilename, bool fDBF)
       dbffile.close();
       return false;
     }
+    dbfrecord.erase(0, 1);
+
+    // The values are converted only when a column is first used. By ESRI
+    // shapefile definition the record order is the exact same in the shp
+    // file and the dbf file, hence we need not worry about matching records.
+
+    vector<NFmiEsriAttributeName> fieldnames;
+    for (const auto *name : itsAttributeNames)
+      fieldnames.push_back(*name);
+
+    auto table = make_shared<NFmiEsriAttributeTable>(
+        fieldnames, fieldoffsets, fieldsizes, numrecords, recordlength, std::move(dbfrecord));
+
+    for (int rec = 0; rec < numrecords; rec++)
+      itsElements[rec]->SetAttributes(table, rec);
+
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Reading only the records intersecting the given box
+// ----------------------------------------------------------------------
+
+bool NFmiEsriShape::Read(const string &theFilename, const NFmiEsriBox &theBox, bool fDBF)
+{
+  try
+  {
+    return ReadFiltered(theFilename, &theBox, nullptr, fDBF);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Reading only the given records
+// ----------------------------------------------------------------------
+
+bool NFmiEsriShape::Read(const string &theFilename, const set<size_t> &theRecords, bool fDBF)
+{
+  try
+  {
+    return ReadFiltered(theFilename, nullptr, &theRecords, fDBF);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Reading only the given records which intersect the given box
+// ----------------------------------------------------------------------
+
+bool NFmiEsriShape::Read(const string &theFilename,
+                         const NFmiEsriBox &theBox,
+                         const set<size_t> &theRecords,
+                         bool fDBF)
+{
+  try
+  {
+    return ReadFiltered(theFilename, &theBox, &theRecords, fDBF);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Filtered reading. The files are mapped to memory instead of being
+// read in full, the record positions are taken from the .shx file,
+// and the bounding box in each record header is tested before the
+// record is decoded. Hence only the pages containing the accepted
+// records and their attributes are ever read from the disk.
+//
+// The records are numbered by their position in the .shp file
+// starting from zero. An invalid box accepts nothing.
+// ----------------------------------------------------------------------
 
-    // And loop over it, extracting the records and fields
+bool NFmiEsriShape::ReadFiltered(const string &theFilename,
+                                 const NFmiEsriBox *theBox,
+                                 const set<size_t> *theRecords,
+                                 bool fDBF)
+{
+  try
+  {
+    // Delete old contents if there are any
+
+    if (!itsElements.empty())
+      Init();
+
+    // Corrupted or missing files are failures as in the full read
 
-    for (int rec = 1; rec <= numrecords; rec++, ++elementiter)
+    unique_ptr<NFmiEsriMappedShape> shape;
+    try
     {
-      // Offset to the record (including the leading 1 byte terminator)
+      shape.reset(new NFmiEsriMappedShape(theFilename, fDBF));
+    }
+    catch (...)
+    {
+      return false;
+    }
 
-      int recpos = 1 + (rec - 1) * recordlength;
+    itsShapeType = shape->Type();
 
-      attributes_type::iterator nameiter = itsAttributeNames.begin();
-      for (int fieldnum = 0; fieldnum < numfields; ++fieldnum, ++nameiter)
+    // Select the records
+
+    vector<size_t> records;
+    if (theRecords == nullptr)
+    {
+      records.reserve(shape->Size());
+      for (size_t i = 0; i < shape->Size(); i++)
+        records.push_back(i);
+    }
+    else
+    {
+      for (size_t i : *theRecords)
       {
-        // Position and size of the field
+        if (i >= shape->Size())
+          break;
+        records.push_back(i);
+      }
+    }
 
-        int offset = recpos + fieldoffsets[fieldnum];
-        int size = fieldsizes[fieldnum];
+    vector<size_t> accepted;
+    accepted.reserve(records.size());
 
-        // Extract the field data
+    for (size_t i : records)
+    {
+      const NFmiEsriMappedShape::Record record = (*shape)[i];
 
-        switch (fieldtypes[fieldnum])
-        {
-          case kFmiEsriString:
-          {
-            string value = dbfrecord.substr(offset, size);
-            NFmiStringTools::TrimL(value);
-            NFmiStringTools::TrimR(value);
-            (*elementiter)->Add(NFmiEsriAttribute(value, *nameiter));
-            break;
-          }
-          case kFmiEsriInteger:
-          {
-            int value = atoi(dbfrecord.substr(offset, size).c_str());
-            (*elementiter)->Add(NFmiEsriAttribute(value, *nameiter));
-            break;
-          }
-          case kFmiEsriDouble:
-          {
-            double value = atof(dbfrecord.substr(offset, size).c_str());
-            (*elementiter)->Add(NFmiEsriAttribute(value, *nameiter));
-            break;
-          }
-          case kFmiEsriDate:
-          {
-            long value = atol(dbfrecord.substr(offset, size).c_str());
-            int yyyy = value / 10000;
-            int mm = (value / 100) % 100;
-            int dd = value % 100;
-            NFmiMetTime t(yyyy, mm, dd);
-            (*elementiter)->Add(NFmiEsriAttribute(t, *nameiter));
-            break;
-          }
-        }
+      if (theBox != nullptr)
+      {
+        const NFmiEsriBox box = record.Box();
+        if (!box.IsValid() || !theBox->IsValid() || box.Xmax() < theBox->Xmin() ||
+            box.Xmin() > theBox->Xmax() || box.Ymax() < theBox->Ymin() ||
+            box.Ymin() > theBox->Ymax())
+          continue;
       }
+
+      Add(record.Element());
+      accepted.push_back(i);
     }
 
+    ReadSpatialReference(theFilename);
+
+    if (!shape->HasAttributes())
+      return true;
+
+    // Attribute names
+
+    for (const auto &name : shape->Attributes())
+      Add(new NFmiEsriAttributeName(name));
+
+    // And the attributes of the accepted records
+
+    auto table = shape->AttributeTable(accepted);
+
+    for (size_t k = 0; k < table->NumRecords(); k++)
+      itsElements[k]->SetAttributes(table, k);
+
     return true;
   }
   catch (...)
@@ -576,6 +717,39 @@ bool NFmiEsriShape::Read(const string &theFilename, bool fDBF)
   }
 }
 
+// ----------------------------------------------------------------------
+// Establish the spatial reference. We do not parse .proj files, instead
+// we assume WGS84 unless a .fmi or a .ykj file accompanies the shape.
+// ----------------------------------------------------------------------
+
+void NFmiEsriShape::ReadSpatialReference(const string &theFilename)
+{
+  try
+  {
+    const string shapes_path = NFmiSettings::Optional<string>("imagine::shapes_path", string("."));
+
+    string fmifilename = NFmiFileSystem::FileComplete(theFilename + ".fmi", shapes_path);
+    string ykjfilename = NFmiFileSystem::FileComplete(theFilename + ".ykj", shapes_path);
+
+    std::string proj4 = "WGS84";
+    if (NFmiFileSystem::FileExists(fmifilename))
+      proj4 = fmt::format("+proj=longlat +R={:.0f} +over +no_defs +towgs84=0,0,0", kRearth);
+    else if (NFmiFileSystem::FileExists(ykjfilename))
+      proj4 =
+          "+proj=tmerc +lat_0=0 +lon_0=27 +k=1 +x_0=3500000 +y_0=0 +ellps=intl +units=m +wktext "
+          "+towgs84=-96.0617,-82.4278,-121.7535,4.80107,0.34543,-1.37646,1.4964 +no_defs";
+
+    auto err = itsSpatialReference.SetFromUserInput(proj4.c_str());
+
+    if (err != OGRERR_NONE)
+      throw Fmi::Exception(BCP, "Failed to create spatial reference from '" + proj4 + "'");
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 // ----------------------------------------------------------------------
 // Add a new element in stringed form (read as string from a file)
 // ----------------------------------------------------------------------
@@ -1046,28 +1220,149 @@ void NFmiEsriShape::WriteHeader(ostream &os, int theFileLength) const
 }
 
 // ----------------------------------------------------------------------
-// Data element projector
+// Data element projector. Large shapes are projected in parallel if the
+// projector can be cloned, each thread using its own clone since the
+// projectors are stateful. The elements are split into contiguous
+// blocks of about equal numbers of points, and each block collects its
+// own bounding box while projecting.
 // ----------------------------------------------------------------------
 
 void NFmiEsriShape::Project(const NFmiEsriProjector &theProjector)
 {
   try
   {
-    // Invalidate the bounding box X-Y limits first
-    // Note that we do not initialize the M or Z parts
+    itsIndex.reset();
+
+    const size_t n = itsElements.size();
 
-    static_cast<NFmiEsriBox>(itsBox).Init();
+    vector<size_t> points(n + 1, 0);  // cumulative point counts
+    for (size_t i = 0; i < n; i++)
+    {
+      const NFmiEsriElement *element = itsElements[i];
+      const int count = (element != nullptr ? element->NumPoints() : 0);
+      points[i + 1] = points[i] + max(1, count);
+    }
 
-    NFmiEsriShape::iterator iter = itsElements.begin();
+    size_t nthreads =
+        (points[n] < parallel_projection_limit ? 1 : max(1u, thread::hardware_concurrency()));
+    nthreads = min(nthreads, max<size_t>(1, n));
 
-    for (; iter != itsElements.end(); ++iter)
+    vector<unique_ptr<NFmiEsriProjector>> projectors;
+    for (size_t i = 1; i < nthreads; i++)
     {
-      if (*iter != nullptr)
+      projectors.emplace_back(theProjector.Clone());
+      if (!projectors.back())
+      {
+        projectors.clear();
+        nthreads = 1;
+        break;
+      }
+    }
+
+    // Block boundaries by point counts
+
+    vector<size_t> first(nthreads + 1, n);
+    first[0] = 0;
+    for (size_t block = 1; block < nthreads; block++)
+      first[block] = static_cast<size_t>(
+          lower_bound(points.begin(), points.end(), block * points[n] / nthreads) -
+          points.begin());
+
+    vector<NFmiEsriBox> boxes(nthreads);
+    vector<exception_ptr> errors(nthreads);
+
+    auto worker = [&](size_t theBlock)
+    {
+      try
+      {
+        const NFmiEsriProjector &projector =
+            (theBlock == 0 ? theProjector : *projectors[theBlock - 1]);
+
+        for (size_t i = first[theBlock]; i < first[theBlock + 1]; i++)
+        {
+          NFmiEsriElement *element = itsElements[i];
+          if (element != nullptr)
+          {
+            element->Project(projector);
+            element->Update(boxes[theBlock]);
+          }
+        }
+      }
+      catch (...)
       {
-        (*iter)->Project(theProjector);
-        (*iter)->Update(itsBox);
+        errors[theBlock] = current_exception();
       }
+    };
+
+    vector<thread> threads;
+    for (size_t block = 1; block < nthreads; block++)
+      threads.emplace_back(worker, block);
+
+    worker(0);
+
+    for (thread &t : threads)
+      t.join();
+
+    for (const auto &error : errors)
+      if (error)
+        rethrow_exception(error);
+
+    itsBox.Init();
+    for (const auto &box : boxes)
+      if (box.IsValid())
+        itsBox.Update(box);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Build the spatial index over the element bounding boxes. Deleted
+// and null elements get invalid boxes and are never returned.
+// ----------------------------------------------------------------------
+
+void NFmiEsriShape::BuildIndex(void) const
+{
+  try
+  {
+    lock_guard<mutex> lock(itsIndexMutex);
+    if (itsIndex)
+      return;
+
+    vector<NFmiEsriBox> boxes(itsElements.size());
+    for (size_t i = 0; i < itsElements.size(); i++)
+      if (itsElements[i] != nullptr)
+        itsElements[i]->Update(boxes[i]);
+
+    itsIndex = make_shared<NFmiEsriRTree>(boxes);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Return the indices of the elements intersecting the given box
+// ----------------------------------------------------------------------
+
+vector<size_t> NFmiEsriShape::Query(double theXmin,
+                                    double theYmin,
+                                    double theXmax,
+                                    double theYmax) const
+{
+  try
+  {
+    BuildIndex();
+
+    shared_ptr<const NFmiEsriRTree> index;
+    {
+      lock_guard<mutex> lock(itsIndexMutex);
+      index = itsIndex;
     }
+    return index->Query(theXmin, theYmin, theXmax, theYmax);
   }
   catch (...)
   {
@@ -9,11 +9,16 @@
 //
 //	shp.Read("filename");			// reads .shp, .dbf
 //	shp.Read("filename",false);		// reads .shp only
+//	shp.Read("filename",box);		// reads records intersecting box
+//	shp.Read("filename",records);		// reads the given records only
 //
 //	shp.Write("filename");			// writes .shp .shx .dbf
 //	shp.Write("filename",false);		// writes .shp .shx
 //	shp.Write("filename",false,false)	// writes .shp
 //
+//	// indices of the elements intersecting a box
+//	std::vector<std::size_t> visible = shp.Query(x1,y1,x2,y2);
+//
 // History:
 //
 // 30.08.2001 Mika Heiskanen
@@ -34,10 +39,15 @@
 
 #include <ogr_spatialref.h>
 
+#include <memory>
+#include <mutex>
+#include <set>
 #include <vector>
 
 namespace Imagine
 {
+class NFmiEsriRTree;
+
 // ESRI Shapefile Technical Description, page 2
 // Any number smaller than this limit is considered "no-data"
 
@@ -122,9 +132,33 @@ class NFmiEsriShape
 
   void Add(NFmiEsriAttributeName *theAttributeName);
 
+  // Keep only the elements at the given ascending indices, deleting the
+  // rest. The kept elements are not copied.
+
+  void Retain(const std::vector<std::size_t> &theIndices);
+
   // Reading and writing data
+  //
+  // Reading the full file still copies the whole .shp and .dbf files
+  // into memory and converts every record into an element. Use
+  // NFmiEsriMappedShape for read only access to large files.
 
   bool Read(const std::string &theFilename, bool fDBF = true);
+
+  // Reading only the records whose bounding boxes intersect the given
+  // box and/or whose zero based positions in the file are in the given
+  // set. The records are located via the .shx file when available, and
+  // the points of the rejected records are never decoded.
+
+  bool Read(const std::string &theFilename, const NFmiEsriBox &theBox, bool fDBF = true);
+  bool Read(const std::string &theFilename,
+            const std::set<std::size_t> &theRecords,
+            bool fDBF = true);
+  bool Read(const std::string &theFilename,
+            const NFmiEsriBox &theBox,
+            const std::set<std::size_t> &theRecords,
+            bool fDBF = true);
+
   bool Write(const std::string &theFilename, bool fDBF = true, bool fSHX = true) const;
 
   bool WriteSHP(const std::string &theFilename) const;
@@ -135,6 +169,18 @@ class NFmiEsriShape
 
   void Project(const NFmiEsriProjector &theProjector);
 
+  // Spatial index over the element bounding boxes. The index is built
+  // on the first query unless built explicitly, and is discarded when
+  // elements are added or projected. Query returns the indices of the
+  // elements whose bounding boxes intersect the given box in ascending
+  // order.
+
+  void BuildIndex(void) const;
+  std::vector<std::size_t> Query(double theXmin,
+                                 double theYmin,
+                                 double theXmax,
+                                 double theYmax) const;
+
   // Return desired attributename, or null pointer if not found
 
   NFmiEsriAttributeName *AttributeName(const std::string &theFieldName) const;
@@ -156,6 +202,17 @@ class NFmiEsriShape
 
   int CountRecords(const std::string &theBuffer) const;
 
+  // Filtered reading, either filter may be omitted
+
+  bool ReadFiltered(const std::string &theFilename,
+                    const NFmiEsriBox *theBox,
+                    const std::set<std::size_t> *theRecords,
+                    bool fDBF);
+
+  // Establish the spatial reference of the named shapefile
+
+  void ReadSpatialReference(const std::string &theFilename);
+
   // Header writing utility
 
   void WriteHeader(std::ostream &os, int theFileLength) const;
@@ -175,6 +232,11 @@ class NFmiEsriShape
 
   attributes_type itsAttributeNames;
 
+  // Lazily built spatial index, shared with queries in progress
+
+  mutable std::mutex itsIndexMutex;
+  mutable std::shared_ptr<const NFmiEsriRTree> itsIndex;
+
   OGRSpatialReference itsSpatialReference{nullptr};
 };
 
@@ -1,8 +1,11 @@
 #include "NFmiEsriTools.h"
+#include "NFmiEsriAttributeTable.h"
 #include "NFmiEsriShape.h"
 #include <macgyver/Exception.h>
 #include <newbase/NFmiStringTools.h>
+#include <algorithm>
 #include <list>
+#include <memory>
 #include <stdexcept>
 
 using namespace std;
@@ -11,157 +14,509 @@ namespace Imagine
 {
 namespace NFmiEsriTools
 {
+namespace
+{
 // ----------------------------------------------------------------------
 /*!
- * \brief Filter a shape based on a condition of form NAME<op>VALUE
+ * \brief Compare two values
  */
 // ----------------------------------------------------------------------
 
-NFmiEsriShape* filter(const NFmiEsriShape& theShape, const std::string& theCondition)
+template <typename T>
+bool compare(const T& theValue, Predicate::Operator theOperator, const T& theLimit)
+{
+  switch (theOperator)
+  {
+    case Predicate::kEqual:
+      return (theValue == theLimit);
+    case Predicate::kNotEqual:
+      return (theValue != theLimit);
+    case Predicate::kLess:
+      return (theValue < theLimit);
+    case Predicate::kGreater:
+      return (theValue > theLimit);
+    case Predicate::kLessEqual:
+      return (theValue <= theLimit);
+    case Predicate::kGreaterEqual:
+      return (theValue >= theLimit);
+  }
+  return false;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief The records of a column satisfying a comparison, in ascending order
+ *
+ * An indexed column is searched for the range of matching values,
+ * otherwise all values are compared.
+ */
+// ----------------------------------------------------------------------
+
+template <typename T>
+vector<size_t> matching_records(const NFmiEsriAttributeTable& theTable,
+                                int theField,
+                                const vector<T>& theValues,
+                                Predicate::Operator theOperator,
+                                const T& theLimit)
+{
+  vector<size_t> records;
+
+  if (!theTable.HasIndex(theField))
+  {
+    for (size_t i = 0; i < theValues.size(); i++)
+      if (compare(theValues[i], theOperator, theLimit))
+        records.push_back(i);
+    return records;
+  }
+
+  const vector<size_t>& index = theTable.Index(theField);
+
+  auto below = [&theValues](size_t row, const T& value) { return theValues[row] < value; };
+  auto above = [&theValues](const T& value, size_t row) { return value < theValues[row]; };
+
+  auto lo = lower_bound(index.begin(), index.end(), theLimit, below);
+  auto hi = upper_bound(lo, index.end(), theLimit, above);
+
+  switch (theOperator)
+  {
+    case Predicate::kEqual:
+      records.assign(lo, hi);
+      break;
+    case Predicate::kNotEqual:
+      records.assign(index.begin(), lo);
+      records.insert(records.end(), hi, index.end());
+      break;
+    case Predicate::kLess:
+      records.assign(index.begin(), lo);
+      break;
+    case Predicate::kGreater:
+      records.assign(hi, index.end());
+      break;
+    case Predicate::kLessEqual:
+      records.assign(index.begin(), hi);
+      break;
+    case Predicate::kGreaterEqual:
+      records.assign(lo, index.end());
+      break;
+  }
+
+  sort(records.begin(), records.end());
+  return records;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Split a string at the given separator
+ */
+// ----------------------------------------------------------------------
+
+vector<string> split(const string& theString, const string& theSeparator)
+{
+  vector<string> parts;
+  string::size_type pos1 = 0;
+  while (true)
+  {
+    string::size_type pos2 = theString.find(theSeparator, pos1);
+    if (pos2 == string::npos)
+    {
+      parts.push_back(theString.substr(pos1));
+      return parts;
+    }
+    parts.push_back(theString.substr(pos1, pos2 - pos1));
+    pos1 = pos2 + theSeparator.size();
+  }
+}
+
+}  // namespace
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Compile a condition for the given shape
+ */
+// ----------------------------------------------------------------------
+
+Predicate::Predicate(const NFmiEsriShape& theShape, const std::string& theCondition)
+{
+  try
+  {
+    // Shapes read from a file share a single attribute table
+
+    for (const auto* element : theShape.Elements())
+    {
+      if (element != nullptr && element->AttributeTable())
+      {
+        itsTable = element->AttributeTable();
+        break;
+      }
+    }
+
+    for (const auto& alternative : split(theCondition, "||"))
+    {
+      Clause clause;
+      for (const auto& condition : split(alternative, "&&"))
+        clause.push_back(Compile(theShape, condition));
+      itsClauses.push_back(clause);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Compile a condition of form NAME<op>VALUE
+ */
+// ----------------------------------------------------------------------
+
+Predicate::Term Predicate::Compile(const NFmiEsriShape& theShape,
+                                   const std::string& theCondition) const
 {
   try
   {
     // Parse the relevant option
 
-    list<string> comparisons;
-    comparisons.push_back("==");
-    comparisons.push_back("<=");
-    comparisons.push_back(">=");
-    comparisons.push_back("<>");
-    comparisons.push_back("<");
-    comparisons.push_back(">");
-    comparisons.push_back("=");
+    const list<pair<string, Operator>> comparisons{{"==", kEqual},
+                                                   {"<=", kLessEqual},
+                                                   {">=", kGreaterEqual},
+                                                   {"<>", kNotEqual},
+                                                   {"<", kLess},
+                                                   {">", kGreater},
+                                                   {"=", kEqual}};
 
-    string fieldname, fieldvalue, fieldcomparison;
-    list<string> words;
+    Term term;
+    string fieldvalue;
+    bool found = false;
 
-    for (list<string>::const_iterator it = comparisons.begin(); it != comparisons.end(); ++it)
+    for (const auto& comparison : comparisons)
     {
-      string::size_type pos = theCondition.find(*it);
+      string::size_type pos = theCondition.find(comparison.first);
       if (pos != string::npos)
       {
-        fieldcomparison = *it;
-        fieldname = theCondition.substr(0, pos);
-        fieldvalue = theCondition.substr(pos + it->size());
+        term.op = comparison.second;
+        term.name = theCondition.substr(0, pos);
+        fieldvalue = theCondition.substr(pos + comparison.first.size());
+        found = true;
         break;
       }
     }
 
-    if (fieldcomparison.empty())
+    if (!found)
       throw Fmi::Exception(BCP, "Unable to parse comparison option");
 
+    NFmiStringTools::TrimL(term.name);
+    NFmiStringTools::TrimR(term.name);
+    NFmiStringTools::TrimL(fieldvalue);
+    NFmiStringTools::TrimR(fieldvalue);
+
     // Fetch the attribute name
 
-    const NFmiEsriAttributeName* name = theShape.AttributeName(fieldname);
+    const NFmiEsriAttributeName* name = theShape.AttributeName(term.name);
     if (name == 0)
-      throw Fmi::Exception(BCP, "The shape does not have a field named '" + fieldname + "'");
+      throw Fmi::Exception(BCP, "The shape does not have a field named '" + term.name + "'");
 
-    // Preparse the desired field value
+    term.type = name->Type();
 
-    const NFmiEsriAttributeType atype = name->Type();
+    // Preparse the desired field value
 
-    string svalue = "";
-    int ivalue = 0;
-    double dvalue = 0;
+    term.ivalue = 0;
+    term.dvalue = 0;
 
-    switch (atype)
+    switch (term.type)
     {
       case kFmiEsriString:
-        svalue = fieldvalue;
+        term.svalue = fieldvalue;
         break;
       case kFmiEsriInteger:
-        ivalue = NFmiStringTools::Convert<int>(fieldvalue);
+        term.ivalue = NFmiStringTools::Convert<int>(fieldvalue);
         break;
       case kFmiEsriDouble:
-        dvalue = NFmiStringTools::Convert<double>(fieldvalue);
+        term.dvalue = NFmiStringTools::Convert<double>(fieldvalue);
         break;
       default:
-        throw Fmi::Exception(BCP, "The field '" + fieldname + "' is of unknown type");
+        throw Fmi::Exception(BCP, "The field '" + term.name + "' is of unknown type");
     }
 
-    NFmiEsriShape* shape = new NFmiEsriShape(theShape.Type());
+    // Resolve the column in the attribute table
 
-    for (NFmiEsriShape::attributes_type::const_iterator ait = theShape.Attributes().begin();
-         ait != theShape.Attributes().end();
-         ++ait)
+    term.field = -1;
+    if (itsTable)
     {
-      shape->Add(new NFmiEsriAttributeName(**ait));
+      const int field = itsTable->FieldIndex(term.name);
+      if (field >= 0 && itsTable->Type(field) == term.type)
+        term.field = field;
     }
 
-    for (NFmiEsriShape::const_iterator it = theShape.Elements().begin();
-         it != theShape.Elements().end();
-         ++it)
-    {
-      // Skip empty elements
-      if (*it == 0)
-        continue;
+    return term;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test a single condition
+ */
+// ----------------------------------------------------------------------
 
-      // Check if the value is correct
+bool Predicate::Matches(const Term& theTerm, const NFmiEsriElement& theElement) const
+{
+  try
+  {
+    // Read directly from the column unless the attribute may have been
+    // added to the element individually
 
-      bool ok = false;
-      if (fieldcomparison == "==" || fieldcomparison == "=")
-      {
-        if (atype == kFmiEsriString)
-          ok = ((*it)->GetString(fieldname) == svalue);
-        else if (atype == kFmiEsriInteger)
-          ok = ((*it)->GetInteger(fieldname) == ivalue);
-        else
-          ok = ((*it)->GetDouble(fieldname) == dvalue);
-      }
-      else if (fieldcomparison == "<>")
-      {
-        if (atype == kFmiEsriString)
-          ok = ((*it)->GetString(fieldname) != svalue);
-        else if (atype == kFmiEsriInteger)
-          ok = ((*it)->GetInteger(fieldname) != ivalue);
-        else
-          ok = ((*it)->GetDouble(fieldname) != dvalue);
-      }
-      else if (fieldcomparison == "<")
-      {
-        if (atype == kFmiEsriString)
-          ok = ((*it)->GetString(fieldname) < svalue);
-        else if (atype == kFmiEsriInteger)
-          ok = ((*it)->GetInteger(fieldname) < ivalue);
-        else
-          ok = ((*it)->GetDouble(fieldname) < dvalue);
-      }
-      else if (fieldcomparison == ">")
+    const bool column = (theTerm.field >= 0 && theElement.AttributeTable() == itsTable &&
+                         theElement.Attributes().empty() &&
+                         theElement.AttributeRecord() < itsTable->NumRecords());
+
+    if (column)
+    {
+      const size_t record = theElement.AttributeRecord();
+      switch (theTerm.type)
       {
-        if (atype == kFmiEsriString)
-          ok = ((*it)->GetString(fieldname) > svalue);
-        else if (atype == kFmiEsriInteger)
-          ok = ((*it)->GetInteger(fieldname) > ivalue);
-        else
-          ok = ((*it)->GetDouble(fieldname) > dvalue);
+        case kFmiEsriString:
+          return compare(itsTable->Strings(theTerm.field)[record], theTerm.op, theTerm.svalue);
+        case kFmiEsriInteger:
+          return compare(itsTable->Integers(theTerm.field)[record], theTerm.op, theTerm.ivalue);
+        case kFmiEsriDouble:
+          return compare(itsTable->Doubles(theTerm.field)[record], theTerm.op, theTerm.dvalue);
+        default:
+          return false;
       }
-      else if (fieldcomparison == "<=")
+    }
+
+    switch (theTerm.type)
+    {
+      case kFmiEsriString:
+        return compare(theElement.GetString(theTerm.name), theTerm.op, theTerm.svalue);
+      case kFmiEsriInteger:
+        return compare(theElement.GetInteger(theTerm.name), theTerm.op, theTerm.ivalue);
+      case kFmiEsriDouble:
+        return compare(theElement.GetDouble(theTerm.name), theTerm.op, theTerm.dvalue);
+      default:
+        return false;
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test an element
+ */
+// ----------------------------------------------------------------------
+
+bool Predicate::operator()(const NFmiEsriElement& theElement) const
+{
+  try
+  {
+    for (const auto& clause : itsClauses)
+    {
+      bool ok = true;
+      for (const auto& term : clause)
       {
-        if (atype == kFmiEsriString)
-          ok = ((*it)->GetString(fieldname) <= svalue);
-        else if (atype == kFmiEsriInteger)
-          ok = ((*it)->GetInteger(fieldname) <= ivalue);
-        else
-          ok = ((*it)->GetDouble(fieldname) <= dvalue);
+        if (!Matches(term, theElement))
+        {
+          ok = false;
+          break;
+        }
       }
-      else if (fieldcomparison == ">=")
+      if (ok)
+        return true;
+    }
+    return false;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief The table records satisfying a single condition
+ */
+// ----------------------------------------------------------------------
+
+vector<size_t> Predicate::Records(const Term& theTerm) const
+{
+  try
+  {
+    switch (theTerm.type)
+    {
+      case kFmiEsriString:
+        return matching_records(*itsTable,
+                                theTerm.field,
+                                itsTable->Strings(theTerm.field),
+                                theTerm.op,
+                                theTerm.svalue);
+      case kFmiEsriInteger:
+        return matching_records(*itsTable,
+                                theTerm.field,
+                                itsTable->Integers(theTerm.field),
+                                theTerm.op,
+                                theTerm.ivalue);
+      case kFmiEsriDouble:
+        return matching_records(*itsTable,
+                                theTerm.field,
+                                itsTable->Doubles(theTerm.field),
+                                theTerm.op,
+                                theTerm.dvalue);
+      default:
+        return {};
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Select the matching elements of a shape
+ *
+ * When the elements are in the same order as the records of the
+ * attribute table, as they are after a full read, the conditions are
+ * evaluated on whole columns. Otherwise each element is tested.
+ */
+// ----------------------------------------------------------------------
+
+vector<size_t> Predicate::Select(const NFmiEsriShape& theShape) const
+{
+  try
+  {
+    const NFmiEsriShape::elements_type& elements = theShape.Elements();
+
+    bool aligned = static_cast<bool>(itsTable) && elements.size() <= itsTable->NumRecords();
+
+    for (const auto& clause : itsClauses)
+      for (const auto& term : clause)
+        aligned &= (term.field >= 0);
+
+    for (size_t i = 0; aligned && i < elements.size(); i++)
+    {
+      const NFmiEsriElement* element = elements[i];
+      aligned = (element != nullptr && element->AttributeTable() == itsTable &&
+                 element->AttributeRecord() == i && element->Attributes().empty());
+    }
+
+    vector<size_t> selected;
+
+    if (!aligned)
+    {
+      for (size_t i = 0; i < elements.size(); i++)
+        if (elements[i] != nullptr && (*this)(*elements[i]))
+          selected.push_back(i);
+      return selected;
+    }
+
+    for (const auto& clause : itsClauses)
+    {
+      vector<size_t> records = Records(clause.front());
+      for (size_t t = 1; t < clause.size() && !records.empty(); t++)
       {
-        if (atype == kFmiEsriString)
-          ok = ((*it)->GetString(fieldname) >= svalue);
-        else if (atype == kFmiEsriInteger)
-          ok = ((*it)->GetInteger(fieldname) >= ivalue);
-        else
-          ok = ((*it)->GetDouble(fieldname) >= dvalue);
+        const vector<size_t> other = Records(clause[t]);
+        vector<size_t> both;
+        set_intersection(records.begin(),
+                         records.end(),
+                         other.begin(),
+                         other.end(),
+                         back_inserter(both));
+        records.swap(both);
       }
 
-      if (!ok)
-        continue;
+      vector<size_t> either;
+      set_union(selected.begin(),
+                selected.end(),
+                records.begin(),
+                records.end(),
+                back_inserter(either));
+      selected.swap(either);
+    }
+
+    // The table may have more records than there are elements
+
+    selected.erase(lower_bound(selected.begin(), selected.end(), elements.size()),
+                   selected.end());
+    return selected;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Select the elements satisfying the predicate
+ */
+// ----------------------------------------------------------------------
+
+FilteredView::FilteredView(const NFmiEsriShape& theShape, const Predicate& thePredicate)
+    : itsShape(theShape), itsIndices(thePredicate.Select(theShape))
+{
+  try
+  {
+    itsElements.reserve(itsIndices.size());
+    for (size_t i : itsIndices)
+      itsElements.push_back(theShape.Elements()[i]);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Filter a shape based on a condition of form NAME<op>VALUE
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriShape* filter(const NFmiEsriShape& theShape, const std::string& theCondition)
+{
+  try
+  {
+    return filter(theShape, Predicate(theShape, theCondition));
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Filter a shape based on a compiled predicate
+ */
+// ----------------------------------------------------------------------
+
+NFmiEsriShape* filter(const NFmiEsriShape& theShape, const Predicate& thePredicate)
+{
+  try
+  {
+    unique_ptr<NFmiEsriShape> shape(new NFmiEsriShape(theShape.Type()));
+    *shape->SpatialReference() = *theShape.SpatialReference();
 
-      NFmiEsriElement* tmp = (*it)->Clone();
-      shape->Add(tmp);
+    for (NFmiEsriShape::attributes_type::const_iterator ait = theShape.Attributes().begin();
+         ait != theShape.Attributes().end();
+         ++ait)
+    {
+      shape->Add(new NFmiEsriAttributeName(**ait));
     }
 
-    return shape;
+    for (size_t i : thePredicate.Select(theShape))
+      shape->Add(theShape.Elements()[i]->Clone());
+
+    return shape.release();
   }
   catch (...)
   {
@@ -2,10 +2,89 @@
 
 #include "NFmiEsriShape.h"
 
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace Imagine
 {
+class NFmiEsriAttributeTable;
+
 namespace NFmiEsriTools
 {
+// A compiled condition of the form NAME<op>VALUE, where op is one of
+// ==, =, <>, <, >, <= or >=. Conditions may be combined with && and ||,
+// && binding tighter than ||. The fields and the values are resolved
+// against the given shape once, so the same predicate can be evaluated
+// repeatedly without reparsing. Indexed attribute columns are searched
+// via their indexes.
+
+class Predicate
+{
+ public:
+  enum Operator
+  {
+    kEqual,
+    kNotEqual,
+    kLess,
+    kGreater,
+    kLessEqual,
+    kGreaterEqual
+  };
+
+  Predicate(const NFmiEsriShape& theShape, const std::string& theCondition);
+
+  bool operator()(const NFmiEsriElement& theElement) const;
+
+  // Indices of the matching elements in ascending order
+
+  std::vector<std::size_t> Select(const NFmiEsriShape& theShape) const;
+
+ private:
+  struct Term
+  {
+    std::string name;
+    NFmiEsriAttributeType type;
+    Operator op;
+    std::string svalue;
+    int ivalue;
+    double dvalue;
+    int field;  // index in itsTable, or -1
+  };
+
+  typedef std::vector<Term> Clause;  // terms joined by &&
+
+  Term Compile(const NFmiEsriShape& theShape, const std::string& theCondition) const;
+
+  bool Matches(const Term& theTerm, const NFmiEsriElement& theElement) const;
+  std::vector<std::size_t> Records(const Term& theTerm) const;
+
+  std::vector<Clause> itsClauses;  // clauses joined by ||
+  std::shared_ptr<const NFmiEsriAttributeTable> itsTable;  // of the compiled shape
+};
+
+// The elements of a shape satisfying a predicate. The view refers to
+// the elements of the original shape, which must outlive the view.
+
+class FilteredView
+{
+ public:
+  FilteredView(const NFmiEsriShape& theShape, const Predicate& thePredicate);
+
+  const NFmiEsriShape& Shape() const { return itsShape; }
+  const std::vector<std::size_t>& Indices() const { return itsIndices; }
+  const NFmiEsriShape::elements_type& Elements() const { return itsElements; }
+
+ private:
+  const NFmiEsriShape& itsShape;
+  std::vector<std::size_t> itsIndices;
+  NFmiEsriShape::elements_type itsElements;
+};
+
+// A new shape with copies of the matching elements
+
 NFmiEsriShape* filter(const NFmiEsriShape& theShape, const std::string& theCondition);
-}
+NFmiEsriShape* filter(const NFmiEsriShape& theShape, const Predicate& thePredicate);
+}  // namespace NFmiEsriTools
 }  // namespace Imagine
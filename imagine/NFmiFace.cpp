@@ -230,6 +230,27 @@ void NFmiFace::Draw(NFmiImage& theImage,
   }
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief Measure text without rendering it
+ *
+ * \param theText The text to measure
+ * \return The extents of the text as it would be drawn
+ */
+// ----------------------------------------------------------------------
+
+NFmiTextExtent NFmiFace::Measure(const string& theText) const
+{
+  try
+  {
+    return NFmiFreeType::Instance().Measure(itsFile, itsWidth, itsHeight, theText);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 }  // namespace Imagine
 
 #endif  // UNIX
@@ -23,6 +23,7 @@ namespace Imagine
 {
 class NFmiFreeType;
 class NFmiImage;
+struct NFmiTextExtent;
 
 class NFmiFace
 {
@@ -48,7 +49,11 @@ class NFmiFace
             NFmiColorTools::Color theColor = NFmiColorTools::Black,
             NFmiColorTools::NFmiBlendRule theRule = NFmiColorTools::kFmiColorOnOpaque) const;
 
+  NFmiTextExtent Measure(const std::string& theText) const;
+
  private:
+  friend class NFmiLabelBatch;
+
   NFmiFace();
 
   std::string itsFile;
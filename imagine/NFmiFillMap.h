@@ -27,6 +27,11 @@
 // This is meaningful when we are rendering only a small part
 // of the polygon, for example when zooming into the data.
 //
+// Limits for the X coordinates may be given too. They are not
+// used by the map itself, since edges outside them still affect
+// the filled area, but drawables may use them to skip closed
+// polygons which are completely outside the limits.
+//
 // History:
 //
 // 13.08.2001 Mika Heiskanen
@@ -64,8 +69,15 @@ class NFmiFillMap : public NFmiDrawable
  public:
   // Constructors, destructors:
 
-  NFmiFillMap(float theLoLimit = kFloatMissing, float theHiLimit = kFloatMissing)
-      : itsData(), itsLoLimit(theLoLimit), itsHiLimit(theHiLimit)
+  NFmiFillMap(float theLoLimit = kFloatMissing,
+              float theHiLimit = kFloatMissing,
+              float theLeftLimit = kFloatMissing,
+              float theRightLimit = kFloatMissing)
+      : itsData(),
+        itsLoLimit(theLoLimit),
+        itsHiLimit(theHiLimit),
+        itsLeftLimit(theLeftLimit),
+        itsRightLimit(theRightLimit)
   {
   }
 
@@ -74,6 +86,10 @@ class NFmiFillMap : public NFmiDrawable
   // Data access
 
   const NFmiFillMapData& MapData(void) const { return itsData; }
+  float LoLimit(void) const { return itsLoLimit; }
+  float HiLimit(void) const { return itsHiLimit; }
+  float LeftLimit(void) const { return itsLeftLimit; }
+  float RightLimit(void) const { return itsRightLimit; }
   // Adding a line, conic or cubic segment
 
   using NFmiDrawable::Add;
@@ -137,6 +153,8 @@ class NFmiFillMap : public NFmiDrawable
   NFmiFillMapData itsData;
   float itsLoLimit;
   float itsHiLimit;
+  float itsLeftLimit;
+  float itsRightLimit;
 };
 
 }  // namespace Imagine
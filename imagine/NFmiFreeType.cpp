@@ -21,6 +21,21 @@
  * The singleton makes sure the FreeType library is initialized
  * when the first face is requested.
  *
+ * Text may be drawn from several threads simultaneously. Each thread
+ * has its own FreeType library instance and faces, and the font path
+ * lookups are cached per thread. Only the rendered glyphs are shared
+ * by all threads.
+ *
+ * Faces are normally opened when first needed. Servers should call
+ * \code
+ * NFmiFreeType::Instance().Preload();
+ * \endcode
+ * at startup to open the faces listed in imagine::preload_fonts and
+ * to render their common glyphs in advance. If imagine::font_mmap is
+ * true, the font files are memory mapped instead of being read by
+ * each thread separately. The mapped pages are then shared by all
+ * threads and all processes using the same fonts, and opening a
+ * face in a new thread requires no file I/O.
  */
 // ======================================================================
 
@@ -29,16 +44,19 @@
 #include "NFmiFreeType.h"
 #include "NFmiColorBlend.h"
 #include "NFmiFace.h"
+#include "NFmiGlyphCache.h"
+#include "NFmiLruCache.h"
+#include "NFmiMappedFile.h"
 #include "NFmiPath.h"
 #include <macgyver/Exception.h>
 #include <newbase/NFmiFileSystem.h>
 #include <newbase/NFmiSettings.h>
+#include <newbase/NFmiStringTools.h>
 
 extern "C"
 {
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include FT_CACHE_H
 }
 
 // Required on Mandrake 9.0 (freetype 9.0.3, freetype 9.3.3 is fine)
@@ -50,22 +68,51 @@ extern "C"
 #define FT_RENDER_MODE_NORMAL ft_render_mode_normal
 #endif
 
+#include <algorithm>
 #include <cmath>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <vector>
 
 using namespace std;
 
+namespace Imagine
+{
 namespace
 {
+// The glyphs rendered by Preload unless specified otherwise
+
+const char* const printable_ascii =
+    " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
+    "abcdefghijklmnopqrstuvwxyz{|}~";
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief A laid out text ready for rendering
+ *
+ * The positions are those of the top left corners of the glyph
+ * bitmaps relative to the start of the baseline.
+ */
+// ----------------------------------------------------------------------
+
+struct GlyphRun
+{
+  vector<shared_ptr<const NFmiGlyph> > glyphs;
+  vector<FT_Vector> positions;
+  FT_BBox bbox;
+  FT_Pos advance;  // in pixels
+};
+
 // ----------------------------------------------------------------------
 /*!
  * \brief Compute glyph sequence bounding box
  */
 // ----------------------------------------------------------------------
 
-FT_BBox compute_bbox(const vector<FT_Glyph>& theGlyphs, const vector<FT_Vector>& thePositions)
+FT_BBox compute_bbox(const vector<shared_ptr<const NFmiGlyph> >& theGlyphs,
+                     const vector<FT_Vector>& thePositions)
 {
   try
   {
@@ -75,18 +122,16 @@ FT_BBox compute_bbox(const vector<FT_Glyph>& theGlyphs, const vector<FT_Vector>&
     bbox.xMin = bbox.yMin = 32000;
     bbox.xMax = bbox.yMax = -32000;
 
-    // for each glyph image, compute its bounding box,
-    // translate it, and grow the string bbox
+    // for each glyph image, translate its bounding box
+    // and grow the string bbox
 
     for (string::size_type i = 0; i < theGlyphs.size(); i++)
     {
       FT_BBox glyph_bbox;
-      FT_Glyph_Get_CBox(theGlyphs[i], ft_glyph_bbox_pixels, &glyph_bbox);
-
-      glyph_bbox.xMin += thePositions[i].x;
-      glyph_bbox.xMax += thePositions[i].x;
-      glyph_bbox.yMin += thePositions[i].y;
-      glyph_bbox.yMax += thePositions[i].y;
+      glyph_bbox.xMin = theGlyphs[i]->xmin + thePositions[i].x;
+      glyph_bbox.xMax = theGlyphs[i]->xmax + thePositions[i].x;
+      glyph_bbox.yMin = theGlyphs[i]->ymin + thePositions[i].y;
+      glyph_bbox.yMax = theGlyphs[i]->ymax + thePositions[i].y;
 
       if (glyph_bbox.xMin < bbox.xMin)
         bbox.xMin = glyph_bbox.xMin;
@@ -118,10 +163,116 @@ FT_BBox compute_bbox(const vector<FT_Glyph>& theGlyphs, const vector<FT_Vector>&
   }
 }
 
-}  // namespace
+// ----------------------------------------------------------------------
+/*!
+ * \brief LRU cache of laid out texts
+ *
+ * Labels such as station numbers repeat often, hence the layout of
+ * each distinct text is cached by face, size and text. The runs
+ * hold on to their glyphs even if the glyph cache evicts them.
+ *
+ * Every Draw and Measure consults the cache, so like the glyph cache
+ * it is split into independently locked shards, each holding an
+ * equal share of the memory limit.
+ */
+// ----------------------------------------------------------------------
 
-namespace Imagine
+class RunCache
 {
+ public:
+  struct Key
+  {
+    int face;
+    int width;
+    int height;
+    string text;
+
+    bool operator==(const Key& theOther) const
+    {
+      return (face == theOther.face && width == theOther.width && height == theOther.height &&
+              text == theOther.text);
+    }
+  };
+
+  explicit RunCache(size_t theMaxBytes)
+  {
+    for (Shard& shard : itsShards)
+      shard.MaxBytes(theMaxBytes / NumShards);
+  }
+
+  shared_ptr<const GlyphRun> Find(const Key& theKey) { return GetShard(theKey).Find(theKey); }
+
+  void Insert(const Key& theKey, const shared_ptr<const GlyphRun>& theRun)
+  {
+    GetShard(theKey).Insert(theKey, theRun);
+  }
+
+ private:
+  struct Hash
+  {
+    size_t operator()(const Key& theKey) const
+    {
+      size_t hash = std::hash<string>()(theKey.text);
+      hash = hash * 31 + static_cast<size_t>(theKey.face);
+      hash = hash * 31 + static_cast<size_t>(theKey.width);
+      hash = hash * 31 + static_cast<size_t>(theKey.height);
+      return hash;
+    }
+  };
+
+  struct Size
+  {
+    size_t operator()(const Key& theKey, const GlyphRun& theRun) const
+    {
+      return sizeof(Key) + sizeof(GlyphRun) + 2 * theKey.text.size() +
+             theRun.glyphs.size() * (sizeof(theRun.glyphs[0]) + sizeof(FT_Vector));
+    }
+  };
+
+  using Shard = NFmiLruCache<Key, GlyphRun, Hash, Size>;
+
+  static const size_t NumShards = 16;
+
+  Shard& GetShard(const Key& theKey) { return itsShards[Hash()(theKey) % NumShards]; }
+
+  Shard itsShards[NumShards];
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Copy a rendered FreeType bitmap into a glyph
+ */
+// ----------------------------------------------------------------------
+
+void copy_bitmap(const FT_Bitmap& theBitmap, NFmiGlyph& theGlyph)
+{
+  const int width = theBitmap.width;
+  const int rows = theBitmap.rows;
+
+  theGlyph.width = width;
+  theGlyph.rows = rows;
+  theGlyph.coverage.resize(static_cast<size_t>(width) * rows);
+
+  for (int j = 0; j < rows; j++)
+  {
+    const unsigned char* src = theBitmap.buffer + j * theBitmap.pitch;
+    unsigned char* dst = &theGlyph.coverage[static_cast<size_t>(j) * width];
+
+    if (theBitmap.pixel_mode == FT_PIXEL_MODE_GRAY)
+    {
+      for (int i = 0; i < width; i++)
+        dst[i] = src[i];
+    }
+    else
+    {
+      for (int i = 0; i < width; i++)
+        dst[i] = (((src[i >> 3] << (i & 7)) & 128) != 0 ? 255 : 0);
+    }
+  }
+}
+
+}  // namespace
+
 // ----------------------------------------------------------------------
 /*!
  * \brief Implementation hiding pimple
@@ -131,28 +282,69 @@ namespace Imagine
 class NFmiFreeType::Pimple
 {
  public:
-  typedef map<string, FT_Face> Faces;
+  //! An open face and its identifier in the glyph cache
+  struct FontFace
+  {
+    FT_Face face;
+    int id;
+    shared_ptr<const NFmiMappedFile> file;  //!< The mapped font file, if any
+  };
+
+  typedef map<string, FontFace> Faces;
 
-  bool itsInitialized;
-  FT_Library itsLibrary;             //!< Freetype library reference
-  Faces itsFaces;                    //!< Face name to Face ID mapping
-  map<string, string> itsFontPaths;  //!< Font name to path cache
+  //! FreeType state private to a single thread
+  struct ThreadState
+  {
+    FT_Library library;             //!< Freetype library reference
+    Faces faces;                    //!< Font file to face mapping
+    map<string, string> fontpaths;  //!< Font name to path cache
+
+    ~ThreadState();
+    ThreadState();
+  };
+
+  mutex itsMutex;                    //!< Protects the shared mappings below
+  map<string, string> itsFontPaths;  //!< Font name to path mapping of all threads
+  map<string, int> itsFaceIds;       //!< Font file to face identifier mapping
+  map<string, weak_ptr<const NFmiMappedFile> > itsFontFiles;  //!< Memory mapped font files
+  bool itsMapFonts;                                            //!< Memory map the font files?
+  NFmiGlyphCache itsGlyphCache;                                //!< Rendered glyphs
+  RunCache itsRunCache;                                        //!< Laid out texts
 
  public:
-  ~Pimple();
   Pimple();
 
+  static ThreadState& threadState();
+
   const string& findFont(const string& theName);
 
-  FT_Face getFont(const string& theFont);
+  const FontFace& getFont(const string& theFont);
+
+  shared_ptr<const NFmiMappedFile> mapFont(const string& theFont);
+
+  void setSize(const FontFace& theFace, int theWidth, int theHeight, const string& theFont);
+
+  shared_ptr<const NFmiGlyph> getGlyph(const FontFace& theFace,
+                                       int theWidth,
+                                       int theHeight,
+                                       FT_UInt theIndex,
+                                       int theSubpixel);
+
+  GlyphRun Layout(const FontFace& theFace, int theWidth, int theHeight, const string& theText);
+
+  shared_ptr<const GlyphRun> getRun(const string& theFont,
+                                    int theWidth,
+                                    int theHeight,
+                                    const string& theText);
+
+  void preload(const string& theFont, int theWidth, int theHeight, const string& theGlyphs);
 
   template <class T>
   void Draw(T theBlender,
-            const FT_Face& theFace,
+            const GlyphRun& theRun,
             NFmiImage& theImage,
             FT_Int theX,
             FT_Int theY,
-            const string& theText,
             NFmiAlignment theAlignment,
             NFmiColorTools::Color theColor,
             bool theBackgroundOn,
@@ -164,8 +356,8 @@ class NFmiFreeType::Pimple
   template <class T>
   void Draw(T theBlender,
             NFmiImage& theImage,
-            NFmiColorTools::Color theColor,
-            const FT_Bitmap& theBitmap,
+            const NFmiColorTools::Color* theColors,
+            const NFmiGlyph& theGlyph,
             FT_Int theX,
             FT_Int theY);
 
@@ -173,47 +365,83 @@ class NFmiFreeType::Pimple
 
 // ----------------------------------------------------------------------
 /*!
- * \brief Pimple destructor
+ * \brief Thread state destructor
+ *
+ * Releasing the library releases the faces too.
  */
 // ----------------------------------------------------------------------
 
-NFmiFreeType::Pimple::~Pimple()
+NFmiFreeType::Pimple::ThreadState::~ThreadState()
 {
-// According to valgrind this should NOT be done
-#if 0
-	for(Faces::iterator it = itsFaces.begin(); it != itsFaces.end(); ++it)
-	  delete it->second;
-#endif  // UNIX
+  FT_Done_FreeType(library);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Thread state constructor initializes Freetype
+ *
+ * FreeType library and face objects may not be used by several
+ * threads simultaneously. Each thread drawing text hence gets its
+ * own library instance and faces when it draws text for the first
+ * time.
+ */
+// ----------------------------------------------------------------------
 
-  if (itsInitialized)
-    FT_Done_FreeType(itsLibrary);
+NFmiFreeType::Pimple::ThreadState::ThreadState() : library()
+{
+  try
+  {
+    FT_Error error = FT_Init_FreeType(&library);
+    if (error)
+      throw Fmi::Exception(BCP, "Initializing FreeType failed");
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
 }
 
 // ----------------------------------------------------------------------
 /*!
- * \brief Pimple constructor initializes Freetype
+ * \brief Pimple constructor
  *
  * Note that the Pimple constructor is called only when
  * NFmiFreeType::Instance is called for the first time.
- * This implies rendering is about to be done, and hence
- * initialization should be done.
  *
  * The Pimple is NOT constructed before the Instance method
  * is called, which ensures no CPU time is wasted if
  * Freetype is not used.
  *
+ * The glyph cache size is imagine::glyph_cache_size megabytes
+ * (default 16), and the laid out text cache size is
+ * imagine::text_cache_size megabytes (default 4). The font files
+ * are memory mapped if imagine::font_mmap is true (default false).
  */
 // ----------------------------------------------------------------------
 
-NFmiFreeType::Pimple::Pimple() : itsInitialized(false), itsLibrary()
+NFmiFreeType::Pimple::Pimple()
+    : itsMapFonts(NFmiSettings::Optional<bool>("imagine::font_mmap", false)),
+      itsGlyphCache(static_cast<size_t>(
+                        max(0, NFmiSettings::Optional<int>("imagine::glyph_cache_size", 16))) *
+                    1024 * 1024),
+      itsRunCache(static_cast<size_t>(
+                      max(0, NFmiSettings::Optional<int>("imagine::text_cache_size", 4))) *
+                  1024 * 1024)
+{
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the FreeType state of the calling thread
+ */
+// ----------------------------------------------------------------------
+
+NFmiFreeType::Pimple::ThreadState& NFmiFreeType::Pimple::threadState()
 {
   try
   {
-    FT_Error error = FT_Init_FreeType(&itsLibrary);
-    if (error)
-      throw Fmi::Exception(BCP, "Initializing FreeType failed");
-
-    itsInitialized = true;
+    static thread_local ThreadState state;
+    return state;
   }
   catch (...)
   {
@@ -224,6 +452,9 @@ NFmiFreeType::Pimple::Pimple() : itsInitialized(false), itsLibrary()
 // ----------------------------------------------------------------------
 /*!
  * \brief Find a FreeType font face
+ *
+ * Each thread caches the paths it has used, hence the shared mapping
+ * is locked only when a thread uses a font for the first time.
  */
 // ----------------------------------------------------------------------
 
@@ -231,15 +462,24 @@ const string& NFmiFreeType::Pimple::findFont(const string& theName)
 {
   try
   {
-    map<string, string>::const_iterator it = itsFontPaths.find(theName);
+    ThreadState& state = threadState();
+
+    map<string, string>::const_iterator it = state.fontpaths.find(theName);
 
-    if (it != itsFontPaths.end())
+    if (it != state.fontpaths.end())
       return it->second;
 
-    const string path = NFmiSettings::Optional<string>("imagine::font_path", ".");
-    const string file = NFmiFileSystem::FileComplete(theName, path);
+    lock_guard<mutex> lock(itsMutex);
 
-    return (itsFontPaths[theName] = file);
+    it = itsFontPaths.find(theName);
+    if (it == itsFontPaths.end())
+    {
+      const string path = NFmiSettings::Optional<string>("imagine::font_path", ".");
+      const string file = NFmiFileSystem::FileComplete(theName, path);
+      it = itsFontPaths.insert(make_pair(theName, file)).first;
+    }
+
+    return (state.fontpaths[theName] = it->second);
   }
   catch (...)
   {
@@ -249,21 +489,37 @@ const string& NFmiFreeType::Pimple::findFont(const string& theName)
 
 // ----------------------------------------------------------------------
 /*!
- * \brief Get a FreeType font face
+ * \brief Get a FreeType font face of the calling thread
+ *
+ * The face identifiers used as glyph cache keys are shared by all
+ * threads, so that the rendered glyphs are shared too.
  */
 // ----------------------------------------------------------------------
 
-FT_Face NFmiFreeType::Pimple::getFont(const string& theFont)
+const NFmiFreeType::Pimple::FontFace& NFmiFreeType::Pimple::getFont(const string& theFont)
 {
   try
   {
-    Faces::const_iterator it = itsFaces.find(theFont);
-    if (it != itsFaces.end())
+    ThreadState& state = threadState();
+
+    Faces::const_iterator it = state.faces.find(theFont);
+    if (it != state.faces.end())
       return it->second;
 
-    FT_Face face;
+    FontFace fontface;
+    FT_Error error;
 
-    FT_Error error = FT_New_Face(itsLibrary, theFont.c_str(), 0, &face);
+    if (itsMapFonts)
+    {
+      fontface.file = mapFont(theFont);
+      error = FT_New_Memory_Face(state.library,
+                                 reinterpret_cast<const FT_Byte*>(fontface.file->Data()),
+                                 static_cast<FT_Long>(fontface.file->Size()),
+                                 0,
+                                 &fontface.face);
+    }
+    else
+      error = FT_New_Face(state.library, theFont.c_str(), 0, &fontface.face);
 
     if (error == FT_Err_Unknown_File_Format)
       throw Fmi::Exception(BCP, "Unknown font format in '" + theFont + "'");
@@ -271,9 +527,13 @@ FT_Face NFmiFreeType::Pimple::getFont(const string& theFont)
     if (error)
       throw Fmi::Exception(BCP, "Failed while reading font '" + theFont + "'");
 
-    itsFaces.insert(Faces::value_type(theFont, face));
+    {
+      lock_guard<mutex> lock(itsMutex);
+      const int id = static_cast<int>(itsFaceIds.size());
+      fontface.id = itsFaceIds.insert(make_pair(theFont, id)).first->second;
+    }
 
-    return face;
+    return state.faces.insert(Faces::value_type(theFont, fontface)).first->second;
   }
   catch (...)
   {
@@ -283,43 +543,155 @@ FT_Face NFmiFreeType::Pimple::getFont(const string& theFont)
 
 // ----------------------------------------------------------------------
 /*!
- * \brief Render the given text
+ * \brief Get the shared memory mapping of a font file
+ *
+ * The faces of all threads refer to the same mapping. Only the faces
+ * own the mapping, hence it is released when the last thread using
+ * the font exits, and mapped again should the font be needed later.
  */
 // ----------------------------------------------------------------------
 
-template <class T>
-void NFmiFreeType::Pimple::Draw(T theBlender,
-                                const FT_Face& theFace,
-                                NFmiImage& theImage,
-                                FT_Int theX,
-                                FT_Int theY,
-                                const string& theText,
-                                NFmiAlignment theAlignment,
-                                NFmiColorTools::Color theColor,
-                                bool theBackgroundOn,
-                                int theBackgroundWidth,
-                                int theBackgroundHeight,
-                                NFmiColorTools::Color theBackgroundColor,
-                                NFmiColorTools::NFmiBlendRule theBackgroundRule)
+shared_ptr<const NFmiMappedFile> NFmiFreeType::Pimple::mapFont(const string& theFont)
 {
   try
   {
-    FT_Error error;
-    FT_GlyphSlot slot = theFace->glyph;
-    FT_UInt glyph_index;
-    FT_Vector pen;
+    lock_guard<mutex> lock(itsMutex);
 
-    vector<FT_Glyph> glyphs(theText.size());
-    vector<FT_Vector> pos(theText.size());
+    weak_ptr<const NFmiMappedFile>& mapping = itsFontFiles[theFont];
+    shared_ptr<const NFmiMappedFile> file = mapping.lock();
+    if (!file)
+    {
+      file = make_shared<NFmiMappedFile>(theFont);
+      mapping = file;
+    }
+    return file;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-    // start at (0,0)
-    pen.x = 0;
-    pen.y = 0;
+// ----------------------------------------------------------------------
+/*!
+ * \brief Set the pixel size of a face
+ */
+// ----------------------------------------------------------------------
+
+void NFmiFreeType::Pimple::setSize(const FontFace& theFace,
+                                   int theWidth,
+                                   int theHeight,
+                                   const string& theFont)
+{
+  try
+  {
+    FT_Error error = FT_Set_Pixel_Sizes(theFace.face, theWidth, theHeight);
+
+    if (error)
+      throw Fmi::Exception(BCP,
+                           "Failed to set font size " + NFmiStringTools::Convert(theWidth) + 'x' +
+                               NFmiStringTools::Convert(theHeight) + " in font '" + theFont + "'");
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Get a rendered glyph from the cache, rendering it if necessary
+ *
+ * The face must already have been set to the desired size. The glyph
+ * is rendered shifted right by theSubpixel/SubpixelBuckets pixels.
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiGlyph> NFmiFreeType::Pimple::getGlyph(
+    const FontFace& theFace, int theWidth, int theHeight, FT_UInt theIndex, int theSubpixel)
+{
+  try
+  {
+    const NFmiGlyphCache::Key key{
+        theFace.id, theWidth, theHeight, static_cast<unsigned int>(theIndex), theSubpixel};
 
-    FT_Bool use_kerning = FT_HAS_KERNING(theFace);
+    shared_ptr<const NFmiGlyph> cached = itsGlyphCache.Find(key);
+    if (cached)
+      return cached;
+
+    shared_ptr<NFmiGlyph> glyph = make_shared<NFmiGlyph>();
+
+    // load glyph image into the slot without rendering
+
+    FT_Error error = FT_Load_Glyph(theFace.face, theIndex, FT_LOAD_DEFAULT);
+    if (error)
+      return shared_ptr<const NFmiGlyph>();
+
+    glyph->advance = theFace.face->glyph->advance.x;
+
+    // Extract glyph image and measure it before rendering
+
+    FT_Glyph image;
+    error = FT_Get_Glyph(theFace.face->glyph, &image);
+    if (error)
+      return shared_ptr<const NFmiGlyph>();
+
+    FT_BBox cbox;
+    FT_Glyph_Get_CBox(image, ft_glyph_bbox_pixels, &cbox);
+    glyph->xmin = cbox.xMin;
+    glyph->ymin = cbox.yMin;
+    glyph->xmax = cbox.xMax;
+    glyph->ymax = cbox.yMax;
+
+    FT_Vector origin;
+    origin.x = theSubpixel * 64 / NFmiGlyphCache::SubpixelBuckets;
+    origin.y = 0;
+
+    error = FT_Glyph_To_Bitmap(&image, FT_RENDER_MODE_NORMAL, &origin, 1);
+    if (!error)
+    {
+      FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(image);
+      glyph->left = bit->left;
+      glyph->top = bit->top;
+      copy_bitmap(bit->bitmap, *glyph);
+    }
+
+    FT_Done_Glyph(image);
+
+    itsGlyphCache.Insert(key, glyph);
+    return glyph;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Lay out the given text
+ *
+ * The face must already have been set to the desired size.
+ */
+// ----------------------------------------------------------------------
+
+GlyphRun NFmiFreeType::Pimple::Layout(const FontFace& theFace,
+                                      int theWidth,
+                                      int theHeight,
+                                      const string& theText)
+{
+  try
+  {
+    GlyphRun run;
+    run.glyphs.reserve(theText.size());
+    run.positions.reserve(theText.size());
+
+    // start at (0,0), the pen is in whole pixels
+    FT_Pos pen = 0;
+
+    FT_Bool use_kerning = FT_HAS_KERNING(theFace.face);
     FT_UInt previous = 0;
 
-    string::size_type glyphpos = 0;
     string::size_type i = 0;
     while (i < theText.size())
     {
@@ -364,61 +736,157 @@ void NFmiFreeType::Pimple::Draw(T theBlender,
           ++i;
       }
 
-      glyph_index = FT_Get_Char_Index(theFace, ch);
+      FT_UInt glyph_index = FT_Get_Char_Index(theFace.face, ch);
 
       // Retrieve kerning distance and move pen accordingly
       if (use_kerning && previous != 0 && glyph_index != 0)
       {
         FT_Vector delta;
-        FT_Get_Kerning(theFace, previous, glyph_index, FT_KERNING_DEFAULT, &delta);
-        pen.x += (delta.x >> 6);
+        FT_Get_Kerning(theFace.face, previous, glyph_index, FT_KERNING_DEFAULT, &delta);
+        pen += (delta.x >> 6);
       }
 
-      // load glyph image into the slot without rendering
+      // the pen is in whole pixels, hence the sub-pixel offset is always zero
 
-      error = FT_Load_Glyph(theFace, glyph_index, FT_LOAD_DEFAULT);
-      if (error)
+      shared_ptr<const NFmiGlyph> glyph = getGlyph(theFace, theWidth, theHeight, glyph_index, 0);
+      if (!glyph)
         continue;
 
-      // Extract glyph image and store it in our table
-      error = FT_Get_Glyph(theFace->glyph, &glyphs[glyphpos]);
-      if (error)
-        continue;
+      // store the bitmap position
 
-      // store current pen position
+      FT_Vector pos;
+      pos.x = pen + glyph->left;
+      pos.y = -glyph->top;
 
-      pos[glyphpos].x = pen.x;
-      pos[glyphpos].y = pen.y;
-
-#if 1
-      FT_Glyph image = glyphs[glyphpos];
-      error = FT_Glyph_To_Bitmap(&image, FT_RENDER_MODE_NORMAL, &pen, 0);
-      if (!error)
-      {
-        FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(image);
-        pos[glyphpos].x += bit->left;
-        pos[glyphpos].y -= bit->top;
-      }
-#endif
-
-      glyphpos++;
+      run.glyphs.push_back(glyph);
+      run.positions.push_back(pos);
 
       // Increment pen position
-      pen.x += (slot->advance.x >> 6);
+      pen += (glyph->advance >> 6);
 
       // Record current glyph index
       previous = glyph_index;
     }
 
     // Compute bounding box
-    const FT_BBox bbox = compute_bbox(glyphs, pos);
+    run.bbox = compute_bbox(run.glyphs, run.positions);
+    run.advance = pen;
+
+    return run;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Get a laid out text from the cache, laying it out if necessary
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const GlyphRun> NFmiFreeType::Pimple::getRun(const string& theFont,
+                                                        int theWidth,
+                                                        int theHeight,
+                                                        const string& theText)
+{
+  try
+  {
+    if (theWidth < 0 || theHeight < 0)
+      throw Fmi::Exception(BCP, "Face width and height cannot both be zero");
+
+    // Find the face
+
+    const string& file = findFont(theFont);
+
+    // Create the face
+
+    const FontFace& face = getFont(file);
+
+    const RunCache::Key key{face.id, theWidth, theHeight, theText};
+
+    shared_ptr<const GlyphRun> cached = itsRunCache.Find(key);
+    if (cached)
+      return cached;
+
+    setSize(face, theWidth, theHeight, file);
+
+    // Lay out the text using cached glyphs
+
+    shared_ptr<const GlyphRun> run =
+        make_shared<GlyphRun>(Layout(face, theWidth, theHeight, theText));
+
+    itsRunCache.Insert(key, run);
+    return run;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Open a face in the calling thread and render the given glyphs
+ */
+// ----------------------------------------------------------------------
+
+void NFmiFreeType::Pimple::preload(const string& theFont,
+                                   int theWidth,
+                                   int theHeight,
+                                   const string& theGlyphs)
+{
+  try
+  {
+    if (theWidth < 0 || theHeight < 0)
+      throw Fmi::Exception(BCP, "Face width and height cannot both be zero");
+
+    const string& file = findFont(theFont);
+    const FontFace& face = getFont(file);
+
+    setSize(face, theWidth, theHeight, file);
+
+    // Laying out the glyphs renders them into the glyph cache
+
+    Layout(face, theWidth, theHeight, theGlyphs.empty() ? string(printable_ascii) : theGlyphs);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Render the given text
+ */
+// ----------------------------------------------------------------------
+
+template <class T>
+void NFmiFreeType::Pimple::Draw(T theBlender,
+                                const GlyphRun& theRun,
+                                NFmiImage& theImage,
+                                FT_Int theX,
+                                FT_Int theY,
+                                NFmiAlignment theAlignment,
+                                NFmiColorTools::Color theColor,
+                                bool theBackgroundOn,
+                                int theBackgroundWidth,
+                                int theBackgroundHeight,
+                                NFmiColorTools::Color theBackgroundColor,
+                                NFmiColorTools::NFmiBlendRule theBackgroundRule)
+{
+  try
+  {
+    const FT_BBox& bbox = theRun.bbox;
 
     // string pixel size
 
     const int width = bbox.xMax - bbox.xMin;
     const int height = bbox.yMax - bbox.yMin;
 
-    // Compute start position in 26.6 cartesian pixels
+    // Compute the start of the baseline
 
     const double xfactor = XAlignmentFactor(theAlignment);
     const double yfactor = YAlignmentFactor(theAlignment);
@@ -445,33 +913,25 @@ void NFmiFreeType::Pimple::Draw(T theBlender,
       path.Fill(theImage, theBackgroundColor, theBackgroundRule);
     }
 
-    // And render the glyphs
+    // The colour for each coverage value
 
-    for (i = 0; i < glyphpos; i++)
+    NFmiColorTools::Color colors[256];
+    const int a = NFmiColorTools::GetAlpha(theColor);
+    for (int alpha = 0; alpha < 256; alpha++)
     {
-      FT_Glyph image = glyphs[i];
-
-      pen.x = start_x + pos[i].x;
-      pen.y = start_y + pos[i].y;
-
-      error = FT_Glyph_To_Bitmap(&image, FT_RENDER_MODE_NORMAL, &pen, 0);
+      int aa = static_cast<int>(a + (1.0 - alpha / 255.0) * (NFmiColorTools::MaxAlpha - a));
+      colors[alpha] = NFmiColorTools::ReplaceAlpha(theColor, aa);
+    }
 
-      if (!error)
-      {
-        FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(image);
-
-#if 0
-			this->Draw(theBlender, theImage, theColor,
-					   bit->bitmap,
-					   pen.x + bit->left,
-					   pen.y - bit->top);
-#else
-        this->Draw(theBlender, theImage, theColor, bit->bitmap, pen.x, pen.y);
-#endif
+    // And render the glyphs
 
-        FT_Done_Glyph(image);
-      }
-    }
+    for (string::size_type i = 0; i < theRun.glyphs.size(); i++)
+      this->Draw(theBlender,
+                 theImage,
+                 colors,
+                 *theRun.glyphs[i],
+                 start_x + theRun.positions[i].x,
+                 start_y + theRun.positions[i].y);
   }
   catch (...)
   {
@@ -488,47 +948,30 @@ void NFmiFreeType::Pimple::Draw(T theBlender,
 template <class T>
 void NFmiFreeType::Pimple::Draw(T theBlender,
                                 NFmiImage& theImage,
-                                NFmiColorTools::Color theColor,
-                                const FT_Bitmap& theBitmap,
+                                const NFmiColorTools::Color* theColors,
+                                const NFmiGlyph& theGlyph,
                                 FT_Int theX,
                                 FT_Int theY)
 {
   try
   {
-    FT_Int i, j, p, q;
-    FT_Int x = theX;
-    FT_Int y = theY;
+    if (theGlyph.width == 0 || theGlyph.rows == 0)
+      return;
 
-    FT_Int x_max = x + theBitmap.width;
-    FT_Int y_max = y + theBitmap.rows;
+    // Clip the bitmap to the image
 
-    for (i = x, p = 0; i < x_max; i++, p++)
-    {
-      for (j = y, q = 0; j < y_max; j++, q++)
-      {
-        if (i < 0 || j < 0 || i >= theImage.Width() || j >= theImage.Height())
-          continue;
+    const FT_Int i1 = max(theX, 0);
+    const FT_Int j1 = max(theY, 0);
+    const FT_Int i2 = min(theX + theGlyph.width, theImage.Width());
+    const FT_Int j2 = min(theY + theGlyph.rows, theImage.Height());
 
-        int alpha = 0;
-        if (theBitmap.pixel_mode == FT_PIXEL_MODE_GRAY)
-          alpha = theBitmap.buffer[q * theBitmap.width + p];
-        else
-        {
-          int value = theBitmap.buffer[q * (theBitmap.pitch) + (p >> 3)];
-          int bit = (value << (p & 7)) & 128;
-          alpha = (bit != 0 ? 255 : 0);
-        }
+    for (FT_Int j = j1; j < j2; j++)
+    {
+      const unsigned char* row =
+          theGlyph.coverage.data() + static_cast<size_t>(j - theY) * theGlyph.width;
 
-        if (alpha == 255)
-          theImage(i, j) = theBlender.Blend(theColor, theImage(i, j));
-        else
-        {
-          int a = NFmiColorTools::GetAlpha(theColor);
-          int aa = static_cast<int>(a + (1.0 - alpha / 255.0) * (NFmiColorTools::MaxAlpha - a));
-          NFmiColorTools::Color c = NFmiColorTools::ReplaceAlpha(theColor, aa);
-          theImage(i, j) = theBlender.Blend(c, theImage(i, j));
-        }
-      }
+      for (FT_Int i = i1; i < i2; i++)
+        theImage(i, j) = theBlender.Blend(theColors[row[i - theX]], theImage(i, j));
     }
   }
   catch (...)
@@ -572,6 +1015,133 @@ NFmiFreeType& NFmiFreeType::Instance()
   }
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the cache of rendered glyphs
+ *
+ * The cache can be used to adjust the memory limit and to
+ * inspect the cache statistics.
+ */
+// ----------------------------------------------------------------------
+
+NFmiGlyphCache& NFmiFreeType::GlyphCache()
+{
+  return itsPimple->itsGlyphCache;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Open a face and render its common glyphs in advance
+ *
+ * The face is opened in the calling thread, while the font path and
+ * the rendered glyphs are shared by all threads.
+ *
+ * \param theFont The font name
+ * \param theWidth The pixel width
+ * \param theHeight The pixel height
+ * \param theGlyphs UTF-8 characters to render, printable ASCII if empty
+ */
+// ----------------------------------------------------------------------
+
+void NFmiFreeType::Preload(const string& theFont,
+                           int theWidth,
+                           int theHeight,
+                           const string& theGlyphs) const
+{
+  try
+  {
+    itsPimple->preload(theFont, theWidth, theHeight, theGlyphs);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Preload the configured faces
+ *
+ * imagine::preload_fonts is a comma separated list of font
+ * specifications of the form
+ * \code
+ * <fontname>:<width>x<height>
+ * \endcode
+ * as in NFmiFace. The glyphs to render may be set using
+ * imagine::preload_glyphs, the default is printable ASCII.
+ */
+// ----------------------------------------------------------------------
+
+void NFmiFreeType::Preload() const
+{
+  try
+  {
+    const string fonts = NFmiSettings::Optional<string>("imagine::preload_fonts", "");
+    const string glyphs = NFmiSettings::Optional<string>("imagine::preload_glyphs", "");
+
+    if (fonts.empty())
+      return;
+
+    const vector<string> specs = NFmiStringTools::Split(fonts, ",");
+
+    for (string spec : specs)
+    {
+      NFmiStringTools::Trim(spec);
+      if (spec.empty())
+        continue;
+
+      const vector<string> words = NFmiStringTools::Split(spec, ":");
+      if (words.size() != 2)
+        throw Fmi::Exception(BCP, "Invalid font specification '" + spec + "'");
+
+      const vector<int> sizes = NFmiStringTools::Split<vector<int> >(words[1], "x");
+      if (sizes.size() != 2)
+        throw Fmi::Exception(BCP, "Invalid font specification '" + spec + "'");
+
+      itsPimple->preload(words[0], sizes[0], sizes[1], glyphs);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Measure text without rendering it
+ *
+ * The text is laid out exactly as in Draw, and the layout is cached
+ * for a subsequent Draw of the same text. The bounding box is the
+ * one Draw aligns the text by, the start of the baseline being at
+ * its bottom left corner.
+ */
+// ----------------------------------------------------------------------
+
+NFmiTextExtent NFmiFreeType::Measure(const string& theFont,
+                                     int theWidth,
+                                     int theHeight,
+                                     const string& theText) const
+{
+  try
+  {
+    const shared_ptr<const GlyphRun> run =
+        itsPimple->getRun(theFont, theWidth, theHeight, theText);
+
+    NFmiTextExtent extent;
+    extent.xmin = 0;
+    extent.ymin = -static_cast<int>(run->bbox.yMax - run->bbox.yMin);
+    extent.xmax = static_cast<int>(run->bbox.xMax - run->bbox.xMin);
+    extent.ymax = 0;
+    extent.advance = static_cast<int>(run->advance);
+    return extent;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 // ----------------------------------------------------------------------
 /*!
  * \brief Render text onto image
@@ -598,8 +1168,8 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
   try
   {
     // Note that it is not possible to call this method except via
-    // Instance(), which ensures the Pimple and hence Freetype
-    // have been properly initialized
+    // Instance(), which ensures the Pimple has been properly
+    // initialized. FreeType itself is initialized per thread.
 
     // Quick exit if color is not real
 
@@ -618,36 +1188,21 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
     if (rule == NFmiColorTools::kFmiColorKeep)
       return;
 
-    // Now we construct the needed FT_Face object
+    // Lay out the text
 
-    if (theWidth < 0 || theHeight < 0)
-      throw Fmi::Exception(BCP, "Face width and height cannot both be zero");
-
-    // Find the face
-
-    const string file = itsPimple->findFont(theFont);
-
-    // Create the face
-
-    FT_Face face = itsPimple->getFont(file);
-
-    FT_Error error = FT_Set_Pixel_Sizes(face, theWidth, theHeight);
+    const shared_ptr<const GlyphRun> run =
+        itsPimple->getRun(theFont, theWidth, theHeight, theText);
 
-    if (error)
-      throw Fmi::Exception(BCP,
-                           "Failed to set font size " + NFmiStringTools::Convert(theWidth) + 'x' +
-                               NFmiStringTools::Convert(theHeight) + " in font '" + file + "'");
     // And render
 
     switch (rule)
     {
       case NFmiColorTools::kFmiColorClear:
         itsPimple->Draw(NFmiColorBlendClear(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -658,11 +1213,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorCopy:
         itsPimple->Draw(NFmiColorBlendCopy(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -673,11 +1227,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorAddContrast:
         itsPimple->Draw(NFmiColorBlendAddContrast(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -688,11 +1241,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorReduceContrast:
         itsPimple->Draw(NFmiColorBlendReduceConstrast(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -703,11 +1255,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorOver:
         itsPimple->Draw(NFmiColorBlendOver(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -718,11 +1269,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorUnder:
         itsPimple->Draw(NFmiColorBlendUnder(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -733,11 +1283,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorIn:
         itsPimple->Draw(NFmiColorBlendIn(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -748,11 +1297,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorKeepIn:
         itsPimple->Draw(NFmiColorBlendKeepIn(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -763,11 +1311,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorOut:
         itsPimple->Draw(NFmiColorBlendOut(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -778,11 +1325,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorKeepOut:
         itsPimple->Draw(NFmiColorBlendKeepOut(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -793,11 +1339,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorAtop:
         itsPimple->Draw(NFmiColorBlendAtop(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -808,11 +1353,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorKeepAtop:
         itsPimple->Draw(NFmiColorBlendKeepAtop(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -823,11 +1367,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorXor:
         itsPimple->Draw(NFmiColorBlendXor(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -838,11 +1381,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorPlus:
         itsPimple->Draw(NFmiColorBlendPlus(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -853,11 +1395,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorMinus:
         itsPimple->Draw(NFmiColorBlendMinus(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -868,11 +1409,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorAdd:
         itsPimple->Draw(NFmiColorBlendAdd(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -883,11 +1423,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorSubstract:
         itsPimple->Draw(NFmiColorBlendSubstract(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -898,11 +1437,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorMultiply:
         itsPimple->Draw(NFmiColorBlendMultiply(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -913,11 +1451,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorDifference:
         itsPimple->Draw(NFmiColorBlendDifference(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -928,11 +1465,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorCopyRed:
         itsPimple->Draw(NFmiColorBlendCopyRed(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -943,11 +1479,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorCopyGreen:
         itsPimple->Draw(NFmiColorBlendCopyGreen(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -958,11 +1493,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorCopyBlue:
         itsPimple->Draw(NFmiColorBlendCopyBlue(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -973,11 +1507,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorCopyMatte:
         itsPimple->Draw(NFmiColorBlendCopyMatte(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -988,11 +1521,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorCopyHue:
         itsPimple->Draw(NFmiColorBlendCopyHue(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1003,11 +1535,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorCopyLightness:
         itsPimple->Draw(NFmiColorBlendCopyLightness(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1018,11 +1549,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorCopySaturation:
         itsPimple->Draw(NFmiColorBlendCopySaturation(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1033,11 +1563,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorKeepMatte:
         itsPimple->Draw(NFmiColorBlendKeepMatte(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1048,11 +1577,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorKeepHue:
         itsPimple->Draw(NFmiColorBlendKeepHue(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1063,11 +1591,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorKeepLightness:
         itsPimple->Draw(NFmiColorBlendKeepLightness(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1078,11 +1605,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorKeepSaturation:
         itsPimple->Draw(NFmiColorBlendKeepSaturation(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1093,11 +1619,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorBumpmap:
         itsPimple->Draw(NFmiColorBlendBumpmap(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1108,11 +1633,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorDentmap:
         itsPimple->Draw(NFmiColorBlendDentmap(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1123,11 +1647,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorOnOpaque:
         itsPimple->Draw(NFmiColorBlendOnOpaque(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
@@ -1138,11 +1661,10 @@ void NFmiFreeType::Draw(NFmiImage& theImage,
         break;
       case NFmiColorTools::kFmiColorOnTransparent:
         itsPimple->Draw(NFmiColorBlendOnTransparent(),
-                        face,
+                        *run,
                         theImage,
                         theX,
                         theY,
-                        theText,
                         theAlignment,
                         theColor,
                         theBackgroundOn,
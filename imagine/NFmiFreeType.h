@@ -23,8 +23,23 @@
 
 namespace Imagine
 {
+class NFmiGlyphCache;
 class NFmiImage;
 
+//! Extents of a text in pixels relative to the start of its baseline, y grows downwards
+
+struct NFmiTextExtent
+{
+  int xmin = 0;     //!< left edge of the bounding box
+  int ymin = 0;     //!< top edge of the bounding box
+  int xmax = 0;     //!< right edge of the bounding box
+  int ymax = 0;     //!< bottom edge of the bounding box
+  int advance = 0;  //!< pen advance
+
+  int Width() const { return xmax - xmin; }
+  int Height() const { return ymax - ymin; }
+};
+
 class NFmiFreeType
 {
  public:
@@ -47,6 +62,19 @@ class NFmiFreeType
       NFmiColorTools::Color theBackgroundColor = NFmiColorTools::MakeColor(180, 180, 180, 32),
       NFmiColorTools::NFmiBlendRule theBackgroundRule = NFmiColorTools::kFmiColorOnOpaque) const;
 
+  NFmiTextExtent Measure(const std::string& theFont,
+                         int theWidth,
+                         int theHeight,
+                         const std::string& theText) const;
+
+  void Preload(const std::string& theFont,
+               int theWidth,
+               int theHeight,
+               const std::string& theGlyphs = "") const;
+  void Preload() const;
+
+  NFmiGlyphCache& GlyphCache();
+
  private:
   class Pimple;
   std::shared_ptr<Pimple> itsPimple;
@@ -20,6 +20,10 @@
 #include <gis/SpatialReference.h>
 #include <macgyver/Exception.h>
 
+#include <cmath>
+#include <limits>
+#include <vector>
+
 using namespace std;
 
 namespace Imagine
@@ -34,13 +38,49 @@ bool overlaps(double min1, double max1, double min2, double max2)
 class ProjectXYEsriPoint : public NFmiEsriProjector
 {
  public:
-  ProjectXYEsriPoint(OGRSpatialReference *theShapeReference, NFmiArea *theArea)
-      : itsArea(theArea),
+  ProjectXYEsriPoint(OGRSpatialReference *theShapeReference, const NFmiArea *theArea)
+      : itsShapeReference(theShapeReference),
+        itsArea(theArea),
         itsXshift(0),
         itsTransformation(*theShapeReference, theArea->SpatialReference())
   {
   }
 
+  // A copy with its own transformation, since the transformations are not thread safe
+
+  NFmiEsriProjector *Clone() const { return new ProjectXYEsriPoint(itsShapeReference, itsArea); }
+
+  // Transform all the coordinates at once
+
+  void Project(std::vector<double> &theX, std::vector<double> &theY) const
+  {
+    try
+    {
+      if (theX.size() != theY.size())
+        throw Fmi::Exception(BCP, "Coordinate arrays to be projected are of different size");
+
+      if (itsXshift != 0)
+        for (double &x : theX)
+          x += itsXshift;
+
+      itsTransformation.transform(theX, theY);
+
+      for (std::size_t i = 0; i < theX.size(); i++)
+      {
+        if (!std::isfinite(theX[i]) || !std::isfinite(theY[i]))
+          throw Fmi::Exception(BCP, "Failed to project shape coordinates");
+
+        auto xy = itsArea->WorldXYToXY(NFmiPoint(theX[i], theY[i]));
+        theX[i] = xy.X();
+        theY[i] = xy.Y();
+      }
+    }
+    catch (...)
+    {
+      throw Fmi::Exception::Trace(BCP, "Operation failed!");
+    }
+  }
+
   NFmiEsriPoint operator()(const NFmiEsriPoint &thePoint) const
   {
     try
@@ -78,6 +118,8 @@ class ProjectXYEsriPoint : public NFmiEsriProjector
         itsXshift = 360;
       else if (overlaps(x1, x2, theBox.Xmin() - 360, theBox.Xmax() - 360))
         itsXshift = -360;
+      else
+        itsXshift = 0;  // the result must not depend on the previous element
     }
     catch (...)
     {
@@ -86,6 +128,7 @@ class ProjectXYEsriPoint : public NFmiEsriProjector
   }
 
  private:
+  OGRSpatialReference *itsShapeReference;
   const NFmiArea *itsArea;
   mutable double itsXshift;
   Fmi::CoordinateTransformation itsTransformation;
@@ -130,7 +173,39 @@ const NFmiPath NFmiGeoShape::Path() const
     switch (Type())
     {
       case kFmiGeoShapeEsri:
-        out = PathEsri();
+        if (itsEsriShape != nullptr)
+          out = PathEsri(itsEsriShape->Elements());
+        break;
+      case kFmiGeoShapeShoreLine:
+        throw Fmi::Exception(BCP, "NFmiGeoShape::Path() kFmiGeoShapeShoreLine not implemented");
+      case kFmiGeoShapeGMT:
+        throw Fmi::Exception(BCP, "NFmiGeoShape::Path() kFmiGeoShapeGMT not implemented");
+    }
+    return out;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Build a path from the map data intersecting the given box. Elements
+// are either included completely or not at all.
+// ----------------------------------------------------------------------
+
+const NFmiPath NFmiGeoShape::Path(double theXmin,
+                                  double theYmin,
+                                  double theXmax,
+                                  double theYmax) const
+{
+  try
+  {
+    NFmiPath out;
+    switch (Type())
+    {
+      case kFmiGeoShapeEsri:
+        out = PathEsri(EsriElements(theXmin, theYmin, theXmax, theYmax));
         break;
       case kFmiGeoShapeShoreLine:
         throw Fmi::Exception(BCP, "NFmiGeoShape::Path() kFmiGeoShapeShoreLine not implemented");
@@ -259,6 +334,46 @@ void NFmiGeoShape::WriteImageMap(std::ostream &os, const string &theFieldName) c
   }
 }
 
+// ----------------------------------------------------------------------
+// Return the ESRI elements whose bounding boxes intersect the given box.
+// The spatial index of the shape is used only when the shape is not
+// completely inside the box, since that is the common case for
+// unzoomed maps.
+// ----------------------------------------------------------------------
+
+NFmiEsriShape::elements_type NFmiGeoShape::EsriElements(double theXmin,
+                                                        double theYmin,
+                                                        double theXmax,
+                                                        double theYmax) const
+{
+  try
+  {
+    NFmiEsriShape::elements_type elements;
+
+    // Just a safety, should not happen
+
+    if (itsEsriShape == nullptr)
+      return elements;
+
+    const NFmiEsriBox &box = itsEsriShape->Box();
+    if (box.IsValid() && box.Xmin() >= theXmin && box.Xmax() <= theXmax &&
+        box.Ymin() >= theYmin && box.Ymax() <= theYmax)
+      return itsEsriShape->Elements();
+
+    const vector<size_t> indices = itsEsriShape->Query(theXmin, theYmin, theXmax, theYmax);
+
+    elements.reserve(indices.size());
+    for (size_t i : indices)
+      elements.push_back(itsEsriShape->Elements()[i]);
+
+    return elements;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 // ----------------------------------------------------------------------
 // Build a path from ESRI shape data. Depending on the data element type,
 // the returned data is:
@@ -274,7 +389,7 @@ void NFmiGeoShape::WriteImageMap(std::ostream &os, const string &theFieldName) c
 //
 // ----------------------------------------------------------------------
 
-const NFmiPath NFmiGeoShape::PathEsri() const
+const NFmiPath NFmiGeoShape::PathEsri(const NFmiEsriShape::elements_type &theElements) const
 {
   try
   {
@@ -282,16 +397,11 @@ const NFmiPath NFmiGeoShape::PathEsri() const
 
     NFmiPath outpath;
 
-    // Just a safety, should not happen
-
-    if (itsEsriShape == nullptr)
-      return outpath;
+    // Iterate through all given elements
 
-    // Iterate through all elements
+    NFmiEsriShape::const_iterator iter = theElements.begin();
 
-    NFmiEsriShape::const_iterator iter = itsEsriShape->Elements().begin();
-
-    for (; iter != itsEsriShape->Elements().end(); ++iter)
+    for (; iter != theElements.end(); ++iter)
     {
       // There may be deleted elements in the shape, which are to be ignored
 
@@ -463,11 +573,27 @@ void NFmiGeoShape::AddEsri(NFmiFillMap &theMap) const
     if (itsEsriShape == nullptr)
       return;
 
-    // Iterate through all elements
+    // Polygons and multipatches consist of closed rings, hence elements
+    // completely outside the limits of the map cannot affect it. A margin
+    // is used since the map rounds the coordinates.
 
-    NFmiEsriShape::const_iterator iter = itsEsriShape->Elements().begin();
+    const double inf = numeric_limits<double>::infinity();
+    auto limit = [](float theLimit, double theMargin, double theDefault)
+    {
+      return (theLimit == kFloatMissing ? theDefault : theLimit + theMargin);
+    };
 
-    for (; iter != itsEsriShape->Elements().end(); ++iter)
+    const NFmiEsriShape::elements_type elements =
+        EsriElements(limit(theMap.LeftLimit(), -1, -inf),
+                     limit(theMap.LoLimit(), -1, -inf),
+                     limit(theMap.RightLimit(), 1, inf),
+                     limit(theMap.HiLimit(), 1, inf));
+
+    // Iterate through the elements
+
+    NFmiEsriShape::const_iterator iter = elements.begin();
+
+    for (; iter != elements.end(); ++iter)
     {
       // There may be deleted elements in the shape, which are to be ignored
 
@@ -608,7 +734,7 @@ void NFmiGeoShape::StrokeEsri(ImagineXr_or_NFmiImage &img,
     // Note that filling has no such special cases, hence we did optimize
     // Add(NFmiFillMap) above.
 
-    NFmiPath path = Path();
+    NFmiPath path = PathEsri(EsriElements(-1, -1, img.Width() + 1, img.Height() + 1));
     path.Stroke(img, theColor, theRule);
   }
   catch (...)
@@ -635,11 +761,18 @@ void NFmiGeoShape::MarkEsri(ImagineXr_or_NFmiImage &img,
     if (itsEsriShape == nullptr)
       return;
 
-    // Iterate through all elements
+    // Only markers which may overlap the image are needed
 
-    NFmiEsriShape::const_iterator iter = itsEsriShape->Elements().begin();
+    const double dx = marker.Width();
+    const double dy = marker.Height();
+    const NFmiEsriShape::elements_type elements =
+        EsriElements(-dx, -dy, img.Width() + dx, img.Height() + dy);
 
-    for (; iter != itsEsriShape->Elements().end(); ++iter)
+    // Iterate through the elements
+
+    NFmiEsriShape::const_iterator iter = elements.begin();
+
+    for (; iter != elements.end(); ++iter)
     {
       // There may be deleted elements in the shape, which are to be ignored
 
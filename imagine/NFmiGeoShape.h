@@ -81,6 +81,11 @@ class NFmiGeoShape
 
   const NFmiPath Path() const;
 
+  // Create a path from the map data intersecting the given box, for
+  // example the visible part of a zoomed view
+
+  const NFmiPath Path(double theXmin, double theYmin, double theXmax, double theYmax) const;
+
 // Add the data to a fill map
 #ifndef IMAGINE_WITH_CAIRO
   void Add(NFmiFillMap &theMap) const;
@@ -130,11 +135,12 @@ class NFmiGeoShape
         if (!itsEsriShape->Read(theFilename))
           throw Fmi::Exception(BCP, std::string("Failed to read shape ") + theFilename);
 
+        // Drop the rejected elements in place instead of copying the accepted ones
+
         if (!theFilter.empty())
         {
-          NFmiEsriShape *tmp = NFmiEsriTools::filter(*itsEsriShape, theFilter);
-          delete itsEsriShape;
-          itsEsriShape = tmp;
+          const NFmiEsriTools::Predicate predicate(*itsEsriShape, theFilter);
+          itsEsriShape->Retain(predicate.Select(*itsEsriShape));
         }
 
         break;
@@ -156,13 +162,20 @@ class NFmiGeoShape
             NFmiColorTools::NFmiBlendRule rule) const
 #endif
   {
-    PathEsri().Fill(image, col, rule);
+    PathEsri(EsriElements(-1, -1, image.Width() + 1, image.Height() + 1)).Fill(image, col, rule);
   }
 
  private:
+  // The elements intersecting the given box
+
+  NFmiEsriShape::elements_type EsriElements(double theXmin,
+                                            double theYmin,
+                                            double theXmax,
+                                            double theYmax) const;
+
   // Path creation
 
-  const NFmiPath PathEsri() const;
+  const NFmiPath PathEsri(const NFmiEsriShape::elements_type &theElements) const;
 
   // Stroking
 
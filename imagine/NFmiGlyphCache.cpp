@@ -0,0 +1,200 @@
+#ifndef IMAGINE_WITH_CAIRO
+
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of class Imagine::NFmiGlyphCache
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiGlyphCache
+ *
+ * \brief LRU cache of rendered glyph bitmaps
+ *
+ * Station plots and similar products draw the same few glyphs
+ * over and over again using only a handful of faces and sizes.
+ * NFmiFreeType stores each rendered glyph here so that drawing a
+ * label becomes a sequence of coverage bitmap blends.
+ *
+ * Glyphs are identified by the face, pixel size, glyph index and
+ * a horizontal sub-pixel offset bucket, since a glyph rendered at
+ * a fractional pen position has a different coverage bitmap.
+ *
+ * The least recently used glyphs are dropped when the estimated
+ * memory use exceeds the limit. All methods are thread safe, and
+ * the glyphs themselves are immutable once inserted. The cache is
+ * split into separately locked shards, each holding an equal share
+ * of the memory limit, so that concurrent text rendering scales.
+ */
+// ======================================================================
+
+#ifdef UNIX
+
+#include "NFmiGlyphCache.h"
+#include <macgyver/Exception.h>
+
+using namespace std;
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Hash value for a glyph key
+ */
+// ----------------------------------------------------------------------
+
+size_t NFmiGlyphCache::Hash::operator()(const Key& theKey) const
+{
+  size_t hash = static_cast<size_t>(theKey.face);
+  hash = hash * 31 + static_cast<size_t>(theKey.width);
+  hash = hash * 31 + static_cast<size_t>(theKey.height);
+  hash = hash * 1000003 + theKey.index;
+  hash = hash * SubpixelBuckets + static_cast<size_t>(theKey.subpixel);
+  return hash;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Estimated memory use of a glyph
+ */
+// ----------------------------------------------------------------------
+
+size_t NFmiGlyphCache::Size::operator()(const Key&, const NFmiGlyph& theGlyph) const
+{
+  return sizeof(NFmiGlyph) + sizeof(Key) + theGlyph.coverage.capacity();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Constructor
+ *
+ * \param theMaxBytes The memory limit
+ */
+// ----------------------------------------------------------------------
+
+NFmiGlyphCache::NFmiGlyphCache(size_t theMaxBytes) : itsMaxBytes(theMaxBytes)
+{
+  for (Shard& shard : itsShards)
+    shard.MaxBytes(theMaxBytes / NumShards);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the shard responsible for the given key
+ */
+// ----------------------------------------------------------------------
+
+NFmiGlyphCache::Shard& NFmiGlyphCache::GetShard(const Key& theKey)
+{
+  return itsShards[Hash()(theKey) % NumShards];
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Find a rendered glyph
+ *
+ * \return The glyph, or an empty pointer if the glyph is not cached
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiGlyph> NFmiGlyphCache::Find(const Key& theKey)
+{
+  try
+  {
+    return GetShard(theKey).Find(theKey);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Insert a rendered glyph
+ *
+ * Glyphs too large for the memory limit are not cached. Should two
+ * threads race to render the same glyph, the latter one replaces
+ * the former.
+ */
+// ----------------------------------------------------------------------
+
+void NFmiGlyphCache::Insert(const Key& theKey, const shared_ptr<const NFmiGlyph>& theGlyph)
+{
+  try
+  {
+    GetShard(theKey).Insert(theKey, theGlyph);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Set the memory limit in bytes, evicting glyphs if necessary
+ */
+// ----------------------------------------------------------------------
+
+void NFmiGlyphCache::MaxBytes(size_t theBytes)
+{
+  itsMaxBytes = theBytes;
+  for (Shard& shard : itsShards)
+    shard.MaxBytes(theBytes / NumShards);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the memory limit in bytes
+ */
+// ----------------------------------------------------------------------
+
+size_t NFmiGlyphCache::MaxBytes() const
+{
+  return itsMaxBytes;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Drop all cached glyphs. Glyphs still in use remain valid.
+ */
+// ----------------------------------------------------------------------
+
+void NFmiGlyphCache::Clear()
+{
+  for (Shard& shard : itsShards)
+    shard.Clear();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return a snapshot of the cache counters
+ */
+// ----------------------------------------------------------------------
+
+NFmiGlyphCache::Statistics NFmiGlyphCache::GetStatistics() const
+{
+  Statistics stats;
+  stats.maxbytes = itsMaxBytes;
+
+  for (const Shard& shard : itsShards)
+  {
+    const auto shardstats = shard.GetStatistics();
+    stats.hits += shardstats.hits;
+    stats.misses += shardstats.misses;
+    stats.evictions += shardstats.evictions;
+    stats.glyphs += shardstats.entries;
+    stats.bytes += shardstats.bytes;
+  }
+  return stats;
+}
+
+}  // namespace Imagine
+
+#endif  // UNIX
+
+#endif
+// IMAGINE_WITH_CAIRO
+
+// ======================================================================
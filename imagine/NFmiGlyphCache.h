@@ -0,0 +1,121 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of class Imagine::NFmiGlyphCache
+ */
+// ======================================================================
+
+#ifdef UNIX
+
+#pragma once
+
+#include "imagine-config.h"
+
+#ifdef IMAGINE_WITH_CAIRO
+#error "Either Cairo or us"
+#endif
+
+#include "NFmiLruCache.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Imagine
+{
+//! A rendered glyph
+
+struct NFmiGlyph
+{
+  int left = 0;                         //!< bitmap offset from the pen position in pixels
+  int top = 0;                          //!< bitmap top above the baseline in pixels
+  int width = 0;                        //!< bitmap width in pixels
+  int rows = 0;                         //!< bitmap height in pixels
+  long advance = 0;                     //!< pen advance in 26.6 pixels
+  int xmin = 0;                         //!< outline control box in pixels, y grows upwards
+  int ymin = 0;                         //!< outline control box in pixels
+  int xmax = 0;                         //!< outline control box in pixels
+  int ymax = 0;                         //!< outline control box in pixels
+  std::vector<unsigned char> coverage;  //!< width*rows coverage values 0-255
+};
+
+class NFmiGlyphCache
+{
+ public:
+  //! Number of horizontal sub-pixel positions a glyph can be rendered at
+
+  static const int SubpixelBuckets = 4;
+
+  //! Glyph identification
+
+  struct Key
+  {
+    int face;            //!< face identifier
+    int width;           //!< pixel width
+    int height;          //!< pixel height
+    unsigned int index;  //!< glyph index in the face
+    int subpixel;        //!< horizontal offset in 1/SubpixelBuckets pixels
+
+    bool operator==(const Key& theOther) const
+    {
+      return (face == theOther.face && width == theOther.width && height == theOther.height &&
+              index == theOther.index && subpixel == theOther.subpixel);
+    }
+  };
+
+  //! Cache usage counters
+
+  struct Statistics
+  {
+    std::size_t hits = 0;       //!< requests served from the cache
+    std::size_t misses = 0;     //!< requests which required rendering the glyph
+    std::size_t evictions = 0;  //!< glyphs dropped to satisfy the memory limit
+    std::size_t glyphs = 0;     //!< number of glyphs currently cached
+    std::size_t bytes = 0;      //!< estimated memory used by the cached glyphs
+    std::size_t maxbytes = 0;   //!< the memory limit
+  };
+
+  explicit NFmiGlyphCache(std::size_t theMaxBytes);
+
+  std::shared_ptr<const NFmiGlyph> Find(const Key& theKey);
+  void Insert(const Key& theKey, const std::shared_ptr<const NFmiGlyph>& theGlyph);
+
+  void MaxBytes(std::size_t theBytes);
+  std::size_t MaxBytes() const;
+
+  void Clear();
+  Statistics GetStatistics() const;
+
+ private:
+  NFmiGlyphCache(const NFmiGlyphCache& theOther) = delete;
+  NFmiGlyphCache& operator=(const NFmiGlyphCache& theOther) = delete;
+
+  struct Hash
+  {
+    std::size_t operator()(const Key& theKey) const;
+  };
+
+  struct Size
+  {
+    std::size_t operator()(const Key&, const NFmiGlyph& theGlyph) const;
+  };
+
+  // The cache is split into independently locked shards so that
+  // threads drawing text concurrently rarely contend for a lock.
+  // Each shard holds an equal share of the memory limit.
+
+  using Shard = NFmiLruCache<Key, NFmiGlyph, Hash, Size>;
+
+  static const std::size_t NumShards = 16;
+
+  Shard& GetShard(const Key& theKey);
+
+  std::atomic<std::size_t> itsMaxBytes;
+  Shard itsShards[NumShards];
+
+};  // class NFmiGlyphCache
+}  // namespace Imagine
+
+#endif  // UNIX
+
+// ======================================================================
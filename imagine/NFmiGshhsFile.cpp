@@ -0,0 +1,412 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of class Imagine::NFmiGshhsFile
+ */
+// ======================================================================
+
+#include "NFmiGshhsFile.h"
+
+#include <macgyver/Exception.h>
+#include <newbase/NFmiFileSystem.h>
+
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+// Size of a polygon header in the file: 8 ints and 2 shorts
+
+const size_t header_size = 36;
+
+// Size of a point in the file
+
+const size_t point_size = 8;
+
+// Sidecar index file header
+
+const char index_magic[8] = {'G', 'S', 'H', 'H', 'S', 'I', 'D', 'X'};
+const uint32_t index_version = 1;
+const uint32_t index_byteorder = 0x01020304;
+
+struct IndexHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteorder;  // detects sidecars written on machines of different endianness
+  uint64_t filesize;
+  int64_t modtime;
+  uint32_t swapped;
+  uint32_t count;
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Decode a 4-byte integer
+ */
+// ----------------------------------------------------------------------
+
+inline int32_t decode4(const char *thePtr, bool theSwap)
+{
+  char ch[4];
+  memcpy(ch, thePtr, 4);
+  if (theSwap)
+  {
+    std::swap(ch[0], ch[3]);
+    std::swap(ch[1], ch[2]);
+  }
+  int32_t value;
+  memcpy(&value, ch, 4);
+  return value;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Decode a 2-byte integer
+ */
+// ----------------------------------------------------------------------
+
+inline int16_t decode2(const char *thePtr, bool theSwap)
+{
+  char ch[2];
+  memcpy(ch, thePtr, 2);
+  if (theSwap)
+    std::swap(ch[0], ch[1]);
+  int16_t value;
+  memcpy(&value, ch, 2);
+  return value;
+}
+
+}  // namespace
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Map the file and index its polygons
+ */
+// ----------------------------------------------------------------------
+
+NFmiGshhsFile::NFmiGshhsFile(const string &theFilename)
+    : itsFile(new NFmiMappedFile(theFilename)),
+      itsModificationTime(NFmiFileSystem::FileModificationTime(theFilename)),
+      itsSwapped(false)
+{
+  try
+  {
+    BuildIndex();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Failed to index GSHHS file " + theFilename);
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Map the file and read its index from a sidecar file
+ *
+ * The index is rebuilt and the sidecar file rewritten if the sidecar
+ * does not exist or does not match the file. Failure to write the
+ * sidecar is not an error, the index is then simply rebuilt each time.
+ */
+// ----------------------------------------------------------------------
+
+NFmiGshhsFile::NFmiGshhsFile(const string &theFilename, const string &theIndexFile)
+    : itsFile(new NFmiMappedFile(theFilename)),
+      itsModificationTime(NFmiFileSystem::FileModificationTime(theFilename)),
+      itsSwapped(false)
+{
+  try
+  {
+    if (ReadIndex(theIndexFile))
+      return;
+
+    BuildIndex();
+    WriteIndex(theIndexFile);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Failed to index GSHHS file " + theFilename);
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Decode all the polygon headers
+ *
+ * The byte order is established from the level of the first polygon.
+ * A trailing incomplete header is ignored.
+ */
+// ----------------------------------------------------------------------
+
+void NFmiGshhsFile::BuildIndex()
+{
+  try
+  {
+    const char *data = itsFile->Data();
+    const size_t size = itsFile->Size();
+
+    itsPolygons.clear();
+
+    if (size < header_size)
+      return;
+
+    const int level = decode4(data + 8, false);
+    itsSwapped = !(level > 0 && level < 5);
+
+    size_t pos = 0;
+    while (pos + header_size <= size)
+    {
+      const char *ptr = data + pos;
+
+      Polygon polygon;
+      polygon.id = decode4(ptr, itsSwapped);
+      polygon.n = decode4(ptr + 4, itsSwapped);
+      polygon.level = decode4(ptr + 8, itsSwapped);
+      polygon.west = decode4(ptr + 12, itsSwapped);
+      polygon.east = decode4(ptr + 16, itsSwapped);
+      polygon.south = decode4(ptr + 20, itsSwapped);
+      polygon.north = decode4(ptr + 24, itsSwapped);
+      polygon.area = decode4(ptr + 28, itsSwapped);
+      polygon.greenwich = decode2(ptr + 32, itsSwapped);
+      polygon.source = decode2(ptr + 34, itsSwapped);
+      polygon.offset = pos + header_size;
+
+      if (polygon.n < 0 || (size - polygon.offset) / point_size < static_cast<size_t>(polygon.n))
+        throw Fmi::Exception(BCP, "File " + Name() + " is corrupt");
+
+      itsPolygons.push_back(polygon);
+      pos = polygon.offset + polygon.n * point_size;
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Read the index from a sidecar file
+ *
+ * \return False if the sidecar is missing or does not match the file
+ */
+// ----------------------------------------------------------------------
+
+bool NFmiGshhsFile::ReadIndex(const string &theIndexFile)
+{
+  try
+  {
+    if (!NFmiFileSystem::FileExists(theIndexFile))
+      return false;
+
+    NFmiMappedFile file(theIndexFile);
+
+    IndexHeader header;
+    if (file.Size() < sizeof(header))
+      return false;
+
+    memcpy(&header, file.Data(), sizeof(header));
+
+    if (memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 ||
+        header.version != index_version || header.byteorder != index_byteorder ||
+        header.filesize != itsFile->Size() || header.modtime != itsModificationTime ||
+        file.Size() != sizeof(header) + header.count * sizeof(Polygon))
+      return false;
+
+    vector<Polygon> polygons(header.count);
+    if (header.count > 0)
+      memcpy(polygons.data(), file.Data() + sizeof(header), header.count * sizeof(Polygon));
+
+    // Do not trust the sidecar to point inside the file
+
+    for (const Polygon &polygon : polygons)
+      if (polygon.n < 0 || polygon.offset > itsFile->Size() ||
+          (itsFile->Size() - polygon.offset) / point_size < static_cast<size_t>(polygon.n))
+        return false;
+
+    itsSwapped = (header.swapped != 0);
+    itsPolygons.swap(polygons);
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Write the index into a sidecar file
+ *
+ * The file is written atomically so that concurrent readers never
+ * see a partial index.
+ */
+// ----------------------------------------------------------------------
+
+bool NFmiGshhsFile::WriteIndex(const string &theIndexFile) const
+{
+  try
+  {
+    IndexHeader header;
+    memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.version = index_version;
+    header.byteorder = index_byteorder;
+    header.filesize = itsFile->Size();
+    header.modtime = itsModificationTime;
+    header.swapped = (itsSwapped ? 1 : 0);
+    header.count = static_cast<uint32_t>(itsPolygons.size());
+
+    const string dir = NFmiFileSystem::DirName(theIndexFile);
+    const string tmp = NFmiFileSystem::TemporaryFile(dir);
+
+    FILE *out = fopen(tmp.c_str(), "wb");
+    if (out == nullptr)
+      return false;
+
+    bool ok = (fwrite(&header, sizeof(header), 1, out) == 1);
+    if (ok && !itsPolygons.empty())
+      ok = (fwrite(itsPolygons.data(), sizeof(Polygon), itsPolygons.size(), out) ==
+            itsPolygons.size());
+    ok = (fclose(out) == 0 && ok);
+
+    if (ok)
+      ok = NFmiFileSystem::RenameFile(tmp, theIndexFile);
+
+    if (!ok)
+      NFmiFileSystem::RemoveFile(tmp);
+
+    return ok;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Select the polygons intersecting the given box
+ */
+// ----------------------------------------------------------------------
+
+vector<size_t> NFmiGshhsFile::Select(double theMinLongitude,
+                                     double theMinLatitude,
+                                     double theMaxLongitude,
+                                     double theMaxLatitude,
+                                     double theMinArea) const
+{
+  try
+  {
+    vector<size_t> ret;
+
+    if (theMinLongitude >= theMaxLongitude || theMinLatitude >= theMaxLatitude)
+      return ret;
+
+    for (size_t i = 0; i < itsPolygons.size(); i++)
+    {
+      const Polygon &polygon = itsPolygons[i];
+
+      const double area = 0.1 * polygon.area;  // now in km^2
+      if (area < theMinArea && theMinArea >= 0)
+        continue;
+
+      const double w = 1.0e-6 * polygon.west;
+      const double e = 1.0e-6 * polygon.east;
+      const double s = 1.0e-6 * polygon.south;
+      const double n = 1.0e-6 * polygon.north;
+
+      if (s > theMaxLatitude || n < theMinLatitude)
+        continue;
+
+      const double ww = (w < -180 ? w + 360 : w > 180 ? w - 360 : w);
+      const double ee = (e < -180 ? e + 360 : e > 180 ? e - 360 : e);
+
+      // Polygons such as Eurasia wrap around the dateline
+      const bool outside =
+          (ee < ww ? (ww > theMaxLongitude && ee < theMinLongitude)
+                   : (ww > theMaxLongitude || ee < theMinLongitude));
+
+      if (!outside)
+        ret.push_back(i);
+    }
+
+    return ret;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Decode a raw point coordinate
+ */
+// ----------------------------------------------------------------------
+
+int32_t NFmiGshhsFile::Coordinate(size_t thePolygon, int thePoint, int theCoordinate) const
+{
+  try
+  {
+    const Polygon &polygon = itsPolygons.at(thePolygon);
+    if (thePoint < 0 || thePoint >= polygon.n)
+      throw Fmi::Exception(BCP, "GSHHS point index out of range");
+
+    const char *ptr = itsFile->Data() + polygon.offset + thePoint * point_size + 4 * theCoordinate;
+    return decode4(ptr, itsSwapped);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the longitude of a point
+ *
+ * Only the first polygon, Eurasiafrica, extends beyond 180 degrees.
+ */
+// ----------------------------------------------------------------------
+
+double NFmiGshhsFile::Longitude(size_t thePolygon, int thePoint) const
+{
+  try
+  {
+    const int32_t x = Coordinate(thePolygon, thePoint, 0);
+    const int32_t max = (thePolygon == 0 ? 270000000 : 180000000);
+    if (itsPolygons[thePolygon].greenwich && x > max)
+      return x * 1.0e-6 - 360;
+    return x * 1.0e-6;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the latitude of a point
+ */
+// ----------------------------------------------------------------------
+
+double NFmiGshhsFile::Latitude(size_t thePolygon, int thePoint) const
+{
+  try
+  {
+    return Coordinate(thePolygon, thePoint, 1) * 1.0e-6;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Imagine
+
+// ======================================================================
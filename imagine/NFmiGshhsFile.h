@@ -0,0 +1,112 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of class Imagine::NFmiGshhsFile
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiGshhsFile
+ *
+ * \brief Indexed memory mapped access to binary GSHHS files
+ *
+ * The file is mapped into memory and the polygon headers are decoded
+ * once into an index, which records the position of the points of each
+ * polygon. Bounding box and area queries are answered from the index
+ * alone, and only the points of the selected polygons are ever touched:
+ * \code
+ * NFmiGshhsFile gshhs("gshhs_f.b");
+ * for (std::size_t i : gshhs.Select(19, 59, 32, 71))
+ *   for (int j = 0; j < gshhs[i].n; j++)
+ *     path.LineTo(gshhs.Longitude(i, j), gshhs.Latitude(i, j));
+ * \endcode
+ * Building the index requires a pass over the headers spread all over
+ * the file. The index may therefore also be stored into a sidecar file,
+ * from which it is read back the next time unless the GSHHS file has
+ * changed. The sidecar file is in native byte order and is rebuilt if
+ * used on a machine of different endianness.
+ */
+// ======================================================================
+
+#pragma once
+
+#include "NFmiMappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Imagine
+{
+class NFmiGshhsFile
+{
+ public:
+  // A decoded polygon header. The values are in the units of the file,
+  // degrees are in micro-degrees and the area in 1/10 km^2.
+
+  struct Polygon
+  {
+    std::int32_t id;
+    std::int32_t n;      // number of points
+    std::int32_t level;  // 1 land, 2 lake, 3 island in lake, 4 pond in island
+    std::int32_t west;
+    std::int32_t east;
+    std::int32_t south;
+    std::int32_t north;
+    std::int32_t area;
+    std::int32_t greenwich;  // 1 if Greenwich is crossed
+    std::int32_t source;
+    std::uint64_t offset;  // position of the first point in the file
+  };
+
+  explicit NFmiGshhsFile(const std::string &theFilename);
+  NFmiGshhsFile(const std::string &theFilename, const std::string &theIndexFile);
+
+  const std::string &Name() const { return itsFile->Name(); }
+  std::size_t FileSize() const { return itsFile->Size(); }
+  std::time_t ModificationTime() const { return itsModificationTime; }
+
+  // Polygon access
+
+  std::size_t Size() const { return itsPolygons.size(); }
+  const Polygon &operator[](std::size_t thePolygon) const { return itsPolygons[thePolygon]; }
+
+  // Indices of the polygons in file order which intersect the given
+  // box and whose area in km^2 is at least the given minimum. A
+  // negative minimum area implies no minimum.
+
+  std::vector<std::size_t> Select(double theMinLongitude,
+                                  double theMinLatitude,
+                                  double theMaxLongitude,
+                                  double theMaxLatitude,
+                                  double theMinArea = -1) const;
+
+  // Point coordinates in degrees. Longitudes of polygons crossing
+  // Greenwich are shifted to be continuous.
+
+  double Longitude(std::size_t thePolygon, int thePoint) const;
+  double Latitude(std::size_t thePolygon, int thePoint) const;
+
+  // Store the index into a sidecar file, returns false on failure
+
+  bool WriteIndex(const std::string &theIndexFile) const;
+
+ private:
+  NFmiGshhsFile(const NFmiGshhsFile &theOther) = delete;
+  NFmiGshhsFile &operator=(const NFmiGshhsFile &theOther) = delete;
+
+  void BuildIndex();
+  bool ReadIndex(const std::string &theIndexFile);
+  std::int32_t Coordinate(std::size_t thePolygon, int thePoint, int theCoordinate) const;
+
+  std::unique_ptr<NFmiMappedFile> itsFile;
+  std::time_t itsModificationTime;
+  bool itsSwapped;  // file is in the opposite byte order
+  std::vector<Polygon> itsPolygons;
+};
+
+}  // namespace Imagine
+
+// ======================================================================
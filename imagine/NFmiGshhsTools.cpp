@@ -6,10 +6,15 @@
 // ======================================================================
 
 #include "NFmiGshhsTools.h"
+#include "NFmiGshhsFile.h"
 #include "NFmiPath.h"
 #include <macgyver/Exception.h>
 #include <newbase/NFmiFileSystem.h>
 #include <newbase/NFmiSettings.h>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 
 using namespace std;
@@ -22,65 +27,53 @@ namespace
 {
 // ----------------------------------------------------------------------
 /*!
- * \brief Byteswapping subroutine
+ * \brief Indexed GSHHS files opened so far
  *
- * \param The number to byteswap
+ * A file is reopened if it has been modified since it was indexed.
  */
 // ----------------------------------------------------------------------
 
-inline void swab2(short *theValue)
-{
-  char *ch = reinterpret_cast<char *>(theValue);
-  std::swap(ch[0], ch[1]);
-}
+mutex gshhs_mutex;
+map<string, shared_ptr<const Imagine::NFmiGshhsFile>> gshhs_files;
 
 // ----------------------------------------------------------------------
 /*!
- * \brief Byteswapping subroutine
- *
- * \param The number to byteswap
+ * \brief Return the indexed GSHHS file
  */
 // ----------------------------------------------------------------------
 
-inline void swab4(int *theValue)
+shared_ptr<const Imagine::NFmiGshhsFile> gshhs_file(const string &theFilename)
 {
-  char *ch = reinterpret_cast<char *>(theValue);
-  std::swap(ch[0], ch[3]);
-  std::swap(ch[1], ch[2]);
-}
+  try
+  {
+    const time_t modtime = NFmiFileSystem::FileModificationTime(theFilename);
+    const long filesize = NFmiFileSystem::FileSize(theFilename);
 
-// ----------------------------------------------------------------------
-/*!
- * \brief GSHHS header structure
- */
-// ----------------------------------------------------------------------
+    {
+      lock_guard<mutex> lock(gshhs_mutex);
+      auto it = gshhs_files.find(theFilename);
+      if (it != gshhs_files.end() && it->second->ModificationTime() == modtime &&
+          static_cast<long>(it->second->FileSize()) == filesize)
+        return it->second;
+    }
 
-struct GSHHS
-{
-  int id;               //!< unique polygon id number, starting at 0
-  int n;                //!< number of points in this polygon
-  int level;            //!< 1 land, 2 lake, 3 island in lake, 4 pond in..
-  int west;             //!< min longitude in micro-degrees
-  int east;             //!< max longitude in micro-degrees
-  int south;            //!< min latitude in micro-degrees
-  int north;            //!< max latitude in micro-degrees
-  int area;             //!< area of polygon in 1/10 km^2
-  short int greenwich;  //!< 1 if Greenwich is crossed
-  short int source;     //!< 0 = CIA WDBII, 1 = WVS
-
-};  // struct GSHHS
+    // Index without holding the lock, the latter of racing threads wins
 
-// ----------------------------------------------------------------------
-/*!
- * \brief GSHHS coordinate structure
- */
-// ----------------------------------------------------------------------
+    shared_ptr<const Imagine::NFmiGshhsFile> file;
+    if (NFmiSettings::Optional<bool>("imagine::gshhs_index", false))
+      file = make_shared<Imagine::NFmiGshhsFile>(theFilename, theFilename + ".idx");
+    else
+      file = make_shared<Imagine::NFmiGshhsFile>(theFilename);
 
-struct POINT
-{
-  int x;  //!< x-coordinate
-  int y;  //!< y-coordinate
-};
+    lock_guard<mutex> lock(gshhs_mutex);
+    gshhs_files[theFilename] = file;
+    return file;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Failed to index GSHHS file " + theFilename);
+  }
+}
 
 }  // namespace
 
@@ -132,100 +125,143 @@ const NFmiPath ReadPath(const std::string &theFilename,
 
     const string filename = NFmiFileSystem::FileComplete(theFilename, gshhs_path);
 
-    FILE *fp = fopen(filename.c_str(), "rb");
-
-    // Throw if failed to open
-
-    if (fp == nullptr)
+    if (!NFmiFileSystem::FileReadable(filename))
       throw Fmi::Exception(BCP, "Failed to open " + theFilename + " for reading");
 
-    // Read the first header
-    GSHHS header;
-    POINT point;
-    int n_read = fread(static_cast<void *>(&header), size_t(sizeof(struct GSHHS)), size_t(1), fp);
+    shared_ptr<const NFmiGshhsFile> file = gshhs_file(filename);
 
-    // Establish whether byteswapping is needed from first header
+    // Only the points of the selected polygons are ever read
 
-    const bool flip = !(header.level > 0 && header.level < 5);
-
-    int max = 270000000;  // initial value for polygon offsetting
-
-    while (n_read == 1)
+    for (size_t i : file->Select(
+             theMinLongitude, theMinLatitude, theMaxLongitude, theMaxLatitude, theMinArea))
     {
-      if (flip)
+      const int n = (*file)[i].n;
+      for (int k = 0; k < n; k++)
       {
-        swab4(&header.id);
-        swab4(&header.n);
-        swab4(&header.level);
-        swab4(&header.west);
-        swab4(&header.east);
-        swab4(&header.south);
-        swab4(&header.north);
-        swab4(&header.area);
-        swab2(&header.greenwich);
-        swab2(&header.source);
+        const double lon = file->Longitude(i, k);
+        const double lat = file->Latitude(i, k);
+
+        if (k == 0)
+          ret.MoveTo(lon, lat);
+        else
+          ret.LineTo(lon, lat);
       }
+    }
 
-      const double w = 1.0e-6 * header.west;
-      const double e = 1.0e-6 * header.east;
-      const double s = 1.0e-6 * header.south;
-      const double n = 1.0e-6 * header.north;
+    ret.Clip(theMinLongitude, theMinLatitude, theMaxLongitude, theMaxLatitude);
+    return ret;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-      const double area = 0.1 * header.area;  // now in km^2
+// ----------------------------------------------------------------------
+/*!
+ * \brief Read the path within the given bounding box at the given resolution
+ */
+// ----------------------------------------------------------------------
+
+const NFmiPath ReadPath(Resolution theResolution,
+                        double theMinLongitude,
+                        double theMinLatitude,
+                        double theMaxLongitude,
+                        double theMaxLatitude,
+                        double theMinArea)
+{
+  try
+  {
+    return ReadPath(Filename(theResolution),
+                    theMinLongitude,
+                    theMinLatitude,
+                    theMaxLongitude,
+                    theMaxLatitude,
+                    theMinArea);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-      const double ww = (w < -180 ? w + 360 : w > 180 ? w - 360 : w);
-      const double ee = (e < -180 ? e + 360 : e > 180 ? e - 360 : e);
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the standard file name for the given resolution
+ */
+// ----------------------------------------------------------------------
 
-      bool outside = (ww > theMaxLongitude || ee < theMinLongitude || s > theMaxLatitude ||
-                      n < theMinLatitude);
+const std::string &Filename(Resolution theResolution)
+{
+  try
+  {
+    static const string names[] = {
+        "gshhs_c.b", "gshhs_l.b", "gshhs_i.b", "gshhs_h.b", "gshhs_f.b"};
 
-      // Correct test for Eurasia
-      if (ee < ww)
-      {
-        bool outside1 = (ww > theMaxLongitude || s > theMaxLatitude || n < theMinLatitude);
+    if (theResolution < kCrude || theResolution > kFull)
+      throw Fmi::Exception(BCP, "Invalid GSHHS resolution");
 
-        bool outside2 = (ee < theMinLongitude || s > theMaxLatitude || n < theMinLatitude);
+    return names[theResolution];
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-        outside = (outside1 && outside2);
-      }
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the approximate kilometres per pixel for the given box
+ *
+ * The width of the box is measured at its middle latitude.
+ */
+// ----------------------------------------------------------------------
 
-      if (outside || (area < theMinArea && theMinArea >= 0))
-      {
-        const size_t skipsize = header.n * sizeof(struct POINT);
-        fseek(fp, skipsize, SEEK_CUR);
-      }
-      else
-      {
-        for (int k = 0; k < header.n; k++)
-        {
-          if (fread(static_cast<void *>(&point), size_t(sizeof(struct POINT)), size_t(1), fp) != 1)
-            throw Fmi::Exception(BCP, "File " + theFilename + " is corrupt");
-
-          if (flip)
-          {
-            swab4(&point.x);
-            swab4(&point.y);
-          }
-          const double lon =
-              (header.greenwich && point.x > max ? point.x * 1.0e-6 - 360 : point.x * 1.0e-6);
-          const double lat = point.y * 1.0e-6;
-
-          if (k == 0)
-            ret.MoveTo(lon, lat);
-          else
-            ret.LineTo(lon, lat);
-        }
-      }
+double Scale(double theMinLongitude,
+             double theMinLatitude,
+             double theMaxLongitude,
+             double theMaxLatitude,
+             int theWidth)
+{
+  try
+  {
+    if (theWidth <= 0)
+      throw Fmi::Exception(BCP, "Map width must be positive");
 
-      max = 180000000;  // only Eurasiafrica needs 270
+    const double km_per_degree = 111.32;
+    const double lat = 0.5 * (theMinLatitude + theMaxLatitude);
+    const double width =
+        km_per_degree * fabs(theMaxLongitude - theMinLongitude) * cos(lat * M_PI / 180);
 
-      n_read = fread(static_cast<void *>(&header), size_t(sizeof(struct GSHHS)), size_t(1), fp);
-    }
+    return width / theWidth;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-    fclose(fp);
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the coarsest resolution accurate at the given scale
+ *
+ * \param theScale Kilometres per pixel
+ */
+// ----------------------------------------------------------------------
 
-    ret.Clip(theMinLongitude, theMinLatitude, theMaxLongitude, theMaxLatitude);
-    return ret;
+Resolution SelectResolution(double theScale)
+{
+  try
+  {
+    if (theScale >= 25)
+      return kCrude;
+    if (theScale >= 5)
+      return kLow;
+    if (theScale >= 1)
+      return kIntermediate;
+    if (theScale >= 0.2)
+      return kHigh;
+    return kFull;
   }
   catch (...)
   {
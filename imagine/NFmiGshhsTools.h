@@ -19,6 +19,19 @@
  * Note that the reader only understands the binary gshhs*.b files,
  * it does not understand the newer *.cdf files.
  *
+ * The files are memory mapped and indexed once per process, see
+ * NFmiGshhsFile. If setting imagine::gshhs_index is true, the indexes
+ * are also stored into sidecar files named by appending ".idx" to the
+ * names of the GSHHS files.
+ *
+ * The resolution may also be chosen automatically from the scale of
+ * the map, in which case the standard file names gshhs_c.b, gshhs_l.b,
+ * gshhs_i.b, gshhs_h.b and gshhs_f.b are used:
+ * \code
+ * double scale = NFmiGshhsTools::Scale(19, 59, 32, 71, 800);
+ * NFmiPath path = NFmiGshhsTools::ReadPath(NFmiGshhsTools::SelectResolution(scale),
+ *                                          19, 59, 32, 71);
+ * \endcode
  */
 // ======================================================================
 
@@ -32,6 +45,15 @@ class NFmiPath;
 
 namespace NFmiGshhsTools
 {
+enum Resolution
+{
+  kCrude,         // 25 km
+  kLow,           // 5 km
+  kIntermediate,  // 1 km
+  kHigh,          // 0.2 km
+  kFull           // original data
+};
+
 const NFmiPath ReadPath(const std::string& theFilename,
                         double theMinLongitude,
                         double theMinLatitude,
@@ -39,6 +61,27 @@ const NFmiPath ReadPath(const std::string& theFilename,
                         double theMaxLatitude,
                         double theMinArea = -1);
 
+const NFmiPath ReadPath(Resolution theResolution,
+                        double theMinLongitude,
+                        double theMinLatitude,
+                        double theMaxLongitude,
+                        double theMaxLatitude,
+                        double theMinArea = -1);
+
+const std::string& Filename(Resolution theResolution);
+
+// Approximate kilometres per pixel when the box is drawn into the given width
+
+double Scale(double theMinLongitude,
+             double theMinLatitude,
+             double theMaxLongitude,
+             double theMaxLatitude,
+             int theWidth);
+
+// The coarsest resolution still accurate at the given kilometres per pixel
+
+Resolution SelectResolution(double theScale);
+
 }  // namespace NFmiGshhsTools
 
 }  // namespace Imagine
@@ -19,10 +19,12 @@
                                  // -funktiolla.
 #endif
 
+#include "NFmiAffine.h"
 #include "NFmiColorBlend.h"
 #include "NFmiColorReduce.h"
 
 #include "NFmiImage.h"
+#include "NFmiImageAnalysis.h"
 
 #ifndef IMAGINE_WITH_CAIRO
 #include "NFmiImageTools.h"
@@ -33,6 +35,7 @@
 #include <newbase/NFmiStringTools.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>  // for rand, RAND_MAX
 #include <iostream>
 #include <sstream>
@@ -355,6 +358,218 @@ static void Composite2(T theBlender,
 #endif
 // not IMAGINE_WITH_CAIRO
 
+#ifndef IMAGINE_WITH_CAIRO
+// ----------------------------------------------------------------------
+// Bilinear sample of a pattern at 16.16 fixed point coordinates, pixel
+// centers being at integer coordinates. Coordinates beyond the outermost
+// pixel centers are clamped to the edge, so pixels outside the pattern
+// never contribute. The colours are weighted by their opacity to prevent
+// the colour of transparent pixels from bleeding into the result.
+// ----------------------------------------------------------------------
+
+static inline NFmiColorTools::Color SampleBilinear(const NFmiImage &thePattern,
+                                                   long long theU,
+                                                   long long theV)
+{
+  const int w = thePattern.Width();
+  const int h = thePattern.Height();
+
+  const int i = static_cast<int>(theU >> 16);
+  const int j = static_cast<int>(theV >> 16);
+  const unsigned int fx = static_cast<unsigned int>((theU >> 8) & 0xff);
+  const unsigned int fy = static_cast<unsigned int>((theV >> 8) & 0xff);
+
+  const int i1 = std::min(std::max(i, 0), w - 1);
+  const int i2 = std::min(std::max(i + 1, 0), w - 1);
+  const int j1 = std::min(std::max(j, 0), h - 1);
+  const int j2 = std::min(std::max(j + 1, 0), h - 1);
+
+  NFmiColorTools::Color c[4];
+  c[0] = thePattern(i1, j1);
+  c[1] = thePattern(i2, j1);
+  c[2] = thePattern(i1, j2);
+  c[3] = thePattern(i2, j2);
+
+  // Flat areas need no interpolation
+  if (c[0] == c[1] && c[0] == c[2] && c[0] == c[3])
+    return c[0];
+
+  // The weights sum up to 65536, hence the sums cannot overflow
+
+  const unsigned int wx[2] = {256 - fx, fx};
+  const unsigned int wy[2] = {256 - fy, fy};
+
+  unsigned int sa = 0;
+  unsigned int sr = 0;
+  unsigned int sg = 0;
+  unsigned int sb = 0;
+
+  for (int k = 0; k < 4; k++)
+  {
+    const unsigned int opacity = NFmiColorTools::MaxAlpha - NFmiColorTools::GetAlpha(c[k]);
+    const unsigned int weight = opacity * wx[k & 1] * wy[k >> 1];
+    sa += weight;
+    sr += weight * NFmiColorTools::GetRed(c[k]);
+    sg += weight * NFmiColorTools::GetGreen(c[k]);
+    sb += weight * NFmiColorTools::GetBlue(c[k]);
+  }
+
+  if (sa == 0)
+    return NFmiColorTools::TransparentColor;
+
+  return NFmiColorTools::MakeColor((sr + sa / 2) / sa,
+                                   (sg + sa / 2) / sa,
+                                   (sb + sa / 2) / sa,
+                                   NFmiColorTools::MaxAlpha - ((sa + 32768) >> 16));
+}
+
+// ----------------------------------------------------------------------
+// Restrict the column range [theX1,theX2] to the columns for which the
+// pattern coordinate theS0 + x * theDS is in the range [0,theSize], that
+// is, to the columns whose pixel center may be covered by the pattern.
+// Returns false if the range becomes empty.
+// ----------------------------------------------------------------------
+
+static bool RestrictSpan(double theS0, double theDS, int theSize, int &theX1, int &theX2)
+{
+  if (theDS == 0)
+    return (theS0 >= 0 && theS0 < theSize);
+
+  double lo = -theS0 / theDS;
+  double hi = (theSize - theS0) / theDS;
+  if (lo > hi)
+    std::swap(lo, hi);
+
+  // Clamp before converting to avoid overflows
+
+  lo = std::max(lo, static_cast<double>(theX1));
+  hi = std::min(hi, static_cast<double>(theX2));
+
+  theX1 = static_cast<int>(std::ceil(lo));
+  theX2 = static_cast<int>(std::floor(hi));
+
+  return (theX1 <= theX2);
+}
+
+// ----------------------------------------------------------------------
+// Composition of an affinely transformed pattern for a specific blending
+// rule. Only the pixels whose centers are covered by the transformed
+// pattern are blended, hence destructive rules such as Copy and Clear
+// never modify pixels outside the pattern. Along each row only the span
+// covered by the pattern is processed, and the pattern coordinates are
+// stepped incrementally in 16.16 fixed point.
+// ----------------------------------------------------------------------
+
+template <class T>
+static void CompositeAffine2(T theBlender,
+                             const NFmiImage &thePattern,
+                             const NFmiAffine &theTransform,
+                             float theAlpha,
+                             NFmiImage &theThisImage)
+{
+  try
+  {
+    const int w = thePattern.Width();
+    const int h = thePattern.Height();
+
+    if (w <= 0 || h <= 0 || theThisImage.Width() <= 0 || theThisImage.Height() <= 0)
+      return;
+
+    // A singular transformation collapses the pattern into a line or a point
+
+    if (theTransform.Determinant() == 0)
+      return;
+
+    // Bounding box of the transformed pattern
+
+    const double xs[4] = {0.0, static_cast<double>(w), 0.0, static_cast<double>(w)};
+    const double ys[4] = {0.0, 0.0, static_cast<double>(h), static_cast<double>(h)};
+
+    double xmin = theTransform.X(xs[0], ys[0]);
+    double ymin = theTransform.Y(xs[0], ys[0]);
+    double xmax = xmin;
+    double ymax = ymin;
+
+    for (int k = 1; k < 4; k++)
+    {
+      const double x = theTransform.X(xs[k], ys[k]);
+      const double y = theTransform.Y(xs[k], ys[k]);
+      xmin = std::min(xmin, x);
+      xmax = std::max(xmax, x);
+      ymin = std::min(ymin, y);
+      ymax = std::max(ymax, y);
+    }
+
+    if (xmax < 0 || ymax < 0 || xmin >= theThisImage.Width() || ymin >= theThisImage.Height())
+      return;
+
+    const int x1 = std::max(0, static_cast<int>(std::floor(xmin)));
+    const int y1 = std::max(0, static_cast<int>(std::floor(ymin)));
+    const int x2 = std::min(theThisImage.Width() - 1, static_cast<int>(std::ceil(xmax)));
+    const int y2 = std::min(theThisImage.Height() - 1, static_cast<int>(std::ceil(ymax)));
+
+    // The inverse transformation maps image pixel centers to pattern
+    // coordinates. Stepping one pixel right is a constant offset.
+
+    const NFmiAffine inverse = theTransform.Inverse();
+
+    const double du = inverse.X(1, 0) - inverse.X(0, 0);
+    const double dv = inverse.Y(1, 0) - inverse.Y(0, 0);
+
+    const double one = 65536.0;
+    const long long ustep = std::llround(du * one);
+    const long long vstep = std::llround(dv * one);
+    // Pixel centers in the range [-0.5,size-0.5) are covered by the pattern
+
+    const long long umin = -32768;
+    const long long vmin = -32768;
+    const long long umax = (static_cast<long long>(w) << 16) - 32768;
+    const long long vmax = (static_cast<long long>(h) << 16) - 32768;
+
+    const float beta = (1.0 - theAlpha) * NFmiColorTools::MaxAlpha;
+
+    for (int y = y1; y <= y2; y++)
+    {
+      // Pattern coordinates at column zero, shifted so that the pattern
+      // pixel centers are at integer coordinates
+
+      const double u0 = inverse.X(0.5, y + 0.5) - 0.5;
+      const double v0 = inverse.Y(0.5, y + 0.5) - 0.5;
+
+      int i1 = x1;
+      int i2 = x2;
+      if (!RestrictSpan(u0 + 0.5, du, w, i1, i2) || !RestrictSpan(v0 + 0.5, dv, h, i1, i2))
+        continue;
+
+      long long u = std::llround((u0 + i1 * du) * one);
+      long long v = std::llround((v0 + i1 * dv) * one);
+
+      for (int i = i1; i <= i2; i++, u += ustep, v += vstep)
+      {
+        // Rounding may step slightly outside the span ends
+
+        if (u < umin || v < vmin || u >= umax || v >= vmax)
+          continue;
+
+        NFmiColorTools::Color c = SampleBilinear(thePattern, u, v);
+
+        if (theAlpha != 1.0)
+        {
+          int aa = static_cast<int>(theAlpha * NFmiColorTools::GetAlpha(c) + beta);
+          c = NFmiColorTools::ReplaceAlpha(c, aa);
+        }
+
+        theThisImage(i, y) = theBlender.Blend(c, theThisImage(i, y));
+      }
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+#endif
+
 // ----------------------------------------------------------------------
 // Destructor
 // ----------------------------------------------------------------------
@@ -485,6 +700,37 @@ void NFmiImage::DefaultOptions(void)
   }
 }
 
+// ----------------------------------------------------------------------
+// Copy the output options of another image
+// ----------------------------------------------------------------------
+
+void NFmiImage::CopyOptions(const NFmiImage &theImage)
+{
+  try
+  {
+#ifdef IMAGINE_FORMAT_JPEG
+    itsJpegQuality = theImage.itsJpegQuality;
+#endif
+#ifdef IMAGINE_FORMAT_PNG
+    itsPngQuality = theImage.itsPngQuality;
+    itsPngFilter = theImage.itsPngFilter;
+#endif
+#if (defined IMAGINE_FORMAT_JPEG) || (defined IMAGINE_FORMAT_PNG)
+    itsAlphaLimit = theImage.itsAlphaLimit;
+    itsGamma = theImage.itsGamma;
+    itsIntent = theImage.itsIntent;
+
+    itsSaveAlphaFlag = theImage.itsSaveAlphaFlag;
+    itsWantPaletteFlag = theImage.itsWantPaletteFlag;
+    itsForcePaletteFlag = theImage.itsForcePaletteFlag;
+#endif
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
 // ----------------------------------------------------------------------
 // Assignment operator
 // ----------------------------------------------------------------------
@@ -694,7 +940,7 @@ void NFmiImage::WritePng(const string &theFileName) const
     if (out == nullptr)
       throw Fmi::Exception(BCP, "Failed to open '" + theFileName + "' for writing a PNG");
 
-    WritePNG(out);
+    WritePNG(out, NFmiImageAnalysis(*this));
     fclose(out);
 
     bool status = NFmiFileSystem::RenameFile(tmp, theFileName);
@@ -756,7 +1002,7 @@ void NFmiImage::WriteGif(const string &theFileName) const
     if (out == nullptr)
       throw Fmi::Exception(BCP, "Failed to open '" + theFileName + "' for writing a GIF");
 
-    WriteGIF(out);
+    WriteGIF(out, NFmiImageAnalysis(*this));
     fclose(out);
 
     bool status = NFmiFileSystem::RenameFile(tmp, theFileName);
@@ -774,7 +1020,7 @@ void NFmiImage::WriteGif(const string &theFileName) const
 // Write image as PNM into given file.
 // ----------------------------------------------------------------------
 
-void NFmiImage::WritePnm(const string &theFileName) const
+void NFmiImage::WritePnm(const string &theFileName, int theMaxValue) const
 {
   try
   {
@@ -786,7 +1032,7 @@ void NFmiImage::WritePnm(const string &theFileName) const
     if (out == nullptr)
       throw Fmi::Exception(BCP, "Failed to open '" + theFileName + "' for writing a PNM");
 
-    WritePNM(out);
+    WritePNM(out, theMaxValue);
     fclose(out);
 
     bool status = NFmiFileSystem::RenameFile(tmp, theFileName);
@@ -804,7 +1050,7 @@ void NFmiImage::WritePnm(const string &theFileName) const
 // Write image as PGM into given file.
 // ----------------------------------------------------------------------
 
-void NFmiImage::WritePgm(const string &theFileName) const
+void NFmiImage::WritePgm(const string &theFileName, int theMaxValue) const
 {
   try
   {
@@ -816,7 +1062,7 @@ void NFmiImage::WritePgm(const string &theFileName) const
     if (out == nullptr)
       throw Fmi::Exception(BCP, "Failed to open '" + theFileName + "' for writing a PGM");
 
-    WritePGM(out);
+    WritePGM(out, theMaxValue);
     fclose(out);
 
     bool status = NFmiFileSystem::RenameFile(tmp, theFileName);
@@ -1490,6 +1736,139 @@ void NFmiImage::Composite(const NFmiImage &thePattern,
 }
 #endif
 
+// ----------------------------------------------------------------------
+// Composite an affinely transformed image over another using given
+// blending rule. The transformation maps the pattern pixel coordinates
+// into image pixel coordinates, and the pattern is sampled bilinearly.
+// ----------------------------------------------------------------------
+
+#ifndef IMAGINE_WITH_CAIRO
+void NFmiImage::Composite(const NFmiImage &thePattern,
+                          const NFmiAffine &theTransform,
+                          NFmiColorTools::NFmiBlendRule theRule,
+                          float theAlpha)
+{
+  try
+  {
+    switch (theRule)
+    {
+      case NFmiColorTools::kFmiColorClear:
+        CompositeAffine2(NFmiColorBlendClear(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorCopy:
+        CompositeAffine2(NFmiColorBlendCopy(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorAddContrast:
+        CompositeAffine2(NFmiColorBlendAddContrast(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorReduceContrast:
+        CompositeAffine2(
+            NFmiColorBlendReduceConstrast(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorOver:
+        CompositeAffine2(NFmiColorBlendOver(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorUnder:
+        CompositeAffine2(NFmiColorBlendUnder(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorIn:
+        CompositeAffine2(NFmiColorBlendIn(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorKeepIn:
+        CompositeAffine2(NFmiColorBlendKeepIn(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorOut:
+        CompositeAffine2(NFmiColorBlendOut(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorKeepOut:
+        CompositeAffine2(NFmiColorBlendKeepOut(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorAtop:
+        CompositeAffine2(NFmiColorBlendAtop(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorKeepAtop:
+        CompositeAffine2(NFmiColorBlendKeepAtop(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorXor:
+        CompositeAffine2(NFmiColorBlendXor(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorPlus:
+        CompositeAffine2(NFmiColorBlendPlus(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorMinus:
+        CompositeAffine2(NFmiColorBlendMinus(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorAdd:
+        CompositeAffine2(NFmiColorBlendAdd(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorSubstract:
+        CompositeAffine2(NFmiColorBlendSubstract(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorMultiply:
+        CompositeAffine2(NFmiColorBlendMultiply(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorDifference:
+        CompositeAffine2(NFmiColorBlendDifference(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorCopyRed:
+        CompositeAffine2(NFmiColorBlendCopyRed(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorCopyGreen:
+        CompositeAffine2(NFmiColorBlendCopyGreen(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorCopyBlue:
+        CompositeAffine2(NFmiColorBlendCopyBlue(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorCopyMatte:
+        CompositeAffine2(NFmiColorBlendCopyMatte(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorCopyHue:
+        CompositeAffine2(NFmiColorBlendCopyHue(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorCopyLightness:
+        CompositeAffine2(NFmiColorBlendCopyLightness(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorCopySaturation:
+        CompositeAffine2(NFmiColorBlendCopySaturation(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorKeepMatte:
+        CompositeAffine2(NFmiColorBlendKeepMatte(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorKeepHue:
+        CompositeAffine2(NFmiColorBlendKeepHue(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorKeepLightness:
+        CompositeAffine2(NFmiColorBlendKeepLightness(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorKeepSaturation:
+        CompositeAffine2(NFmiColorBlendKeepSaturation(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorBumpmap:
+        CompositeAffine2(NFmiColorBlendBumpmap(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorDentmap:
+        CompositeAffine2(NFmiColorBlendDentmap(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorOnOpaque:
+        CompositeAffine2(NFmiColorBlendOnOpaque(), thePattern, theTransform, theAlpha, *this);
+        break;
+      case NFmiColorTools::kFmiColorOnTransparent:
+        CompositeAffine2(NFmiColorBlendOnTransparent(), thePattern, theTransform, theAlpha, *this);
+        break;
+
+      // Some special cases
+      case NFmiColorTools::kFmiColorKeep:
+      case NFmiColorTools::kFmiColorRuleMissing:
+        break;
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+#endif
+
 }  // namespace Imagine
 
 // ======================================================================
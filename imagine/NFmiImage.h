@@ -23,9 +23,12 @@
 #include "NFmiDrawable.h"
 #endif
 
+#include <cstddef>
 #include <cstdio>
 #include <set>  // for sets
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #ifdef __BORLANDC__
 using std::FILE;
@@ -87,11 +90,27 @@ struct NFmiImageCorruptError : public NFmiImageError
 };
 #endif
 
+class NFmiAffine;
+class NFmiImageAnalysis;
+
+//! Output specification for writing an image in several formats at once
+
+struct NFmiImageOutput
+{
+  std::string filename;  // the file to write
+  std::string type;      // png, jpeg, gif, wbmp, pnm or pgm
+  int width = 0;         // desired width, 0 = keep aspect ratio or image size
+  int height = 0;        // desired height, 0 = keep aspect ratio or image size
+  int quality = -1;      // JPEG quality or PNG compression level, -1 = image setting
+};
+
 class NFmiImage
 #ifndef IMAGINE_WITH_CAIRO
     : public NFmiDrawable
 #endif
 {
+  friend class NFmiImageAnalysis;
+
  private:
   // Data elements
   //
@@ -184,10 +203,18 @@ class NFmiImage
   void Read(const std::string &fn);
 #endif
 
+  // Reading a binary PNM (P6) or PGM (P5) image from memory
+  //
+  void ReadPnm(const char *theData, std::size_t theSize);
+
   // Writing the image
   //
   void Write(const std::string &fn, const std::string &type) const;
 
+  // Writing the image in several formats and sizes at once
+  //
+  void Write(const std::vector<NFmiImageOutput> &theOutputs) const;
+
 #ifdef IMAGINE_FORMAT_JPEG
   void WriteJpeg(const std::string &theFileName) const;
 #endif
@@ -196,8 +223,13 @@ class NFmiImage
 #endif
   void WriteWbmp(const std::string &theFileName) const;
   void WriteGif(const std::string &theFileName) const;
-  void WritePnm(const std::string &theFileName) const;
-  void WritePgm(const std::string &theFileName) const;
+  void WritePnm(const std::string &theFileName, int theMaxValue = 255) const;
+  void WritePgm(const std::string &theFileName, int theMaxValue = 255) const;
+
+  // Binary PNM/PGM file contents, maxval 65535 gives 16-bit samples
+  //
+  std::string PnmData(int theMaxValue = 255) const;
+  std::string PgmData(int theMaxValue = 255) const;
 
   void ReduceColors();
 
@@ -223,6 +255,14 @@ class NFmiImage
                  int theY = 0,
                  float theAlpha = 1.0);
 
+  // Composite a transformed image over another using bilinear sampling.
+  // The transformation maps pattern pixel coordinates to image coordinates.
+  //
+  void Composite(const NFmiImage &theImage,
+                 const NFmiAffine &theTransform,
+                 NFmiColorTools::NFmiBlendRule theRule,
+                 float theAlpha = 1.0);
+
   /******
    */
  private:
@@ -231,26 +271,34 @@ class NFmiImage
   void Destroy();
   void Allocate(int width, int height);
   void Reallocate(int width, int height);
+  void CopyOptions(const NFmiImage &theImage);
 
 // Reading and writing various image formats
 #ifdef IMAGINE_FORMAT_JPEG
   void ReadJPEG(FILE *in);
-  void WriteJPEG(FILE *out) const;
+  void WriteJPEG(FILE *out, int theQuality = -1) const;
 #endif
 #ifdef IMAGINE_FORMAT_PNG
   void ReadPNG(FILE *in);
-  void WritePNG(FILE *out) const;
+  void WritePNG(FILE *out, const NFmiImageAnalysis &theAnalysis, int theQuality = -1) const;
 #endif
-  void WritePNM(FILE *out) const;
+  void WritePNM(FILE *out, int theMaxValue = 255) const;
   void ReadPNM(FILE *out);
 
-  void WritePGM(FILE *out) const;
+  void WritePGM(FILE *out, int theMaxValue = 255) const;
   void ReadPGM(FILE *out);
 
+  void ReadNetpbm(FILE *in, const std::string &theType);
+
   void WriteWBMP(FILE *out) const;
 
   void ReadGIF(FILE *in);
-  void WriteGIF(FILE *out) const;
+  void WriteGIF(FILE *out, const NFmiImageAnalysis &theAnalysis) const;
+
+  void WriteFile(const std::string &theFileName,
+                 const std::string &theType,
+                 const NFmiImageAnalysis *theAnalysis,
+                 int theQuality) const;
 
   // Test whether the image is opaque
   //
@@ -0,0 +1,175 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of class Imagine::NFmiImageAnalysis
+ */
+// ======================================================================
+
+#include "NFmiImageAnalysis.h"
+#include "NFmiImage.h"
+#include <macgyver/Exception.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+namespace
+{
+// Images with more distinct colours than this cannot be written with a
+// palette anyway, hence there is no point in recording the colours
+
+const std::size_t max_recorded_colors = 1024;
+
+}  // namespace
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Analyze the given image
+ */
+// ----------------------------------------------------------------------
+
+NFmiImageAnalysis::NFmiImageAnalysis(const NFmiImage &theImage)
+    : itsImage(theImage), itsMaxAlpha(0), itsBinaryAlpha(true), itsColorOverflow(false)
+{
+  try
+  {
+    const NFmiColorTools::Color *pixels = theImage.itsPixels;
+    const int n = theImage.Width() * theImage.Height();
+
+    NFmiColorTools::Color last = NFmiColorTools::NoColor;
+
+    for (int i = 0; i < n; i++)
+    {
+      const NFmiColorTools::Color color = pixels[i];
+      const int alpha = NFmiColorTools::GetAlpha(color);
+
+      itsMaxAlpha = max(itsMaxAlpha, alpha);
+      itsBinaryAlpha &= (alpha == NFmiColorTools::Opaque || alpha == NFmiColorTools::Transparent);
+
+      if (!itsColorOverflow && color != last)
+      {
+        itsColors.insert(color);
+        last = color;
+        if (itsColors.size() > max_recorded_colors)
+        {
+          itsColorOverflow = true;
+          itsColors.clear();
+        }
+      }
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test whether the image is opaque
+ *
+ * Equivalent to NFmiImage::IsOpaque
+ */
+// ----------------------------------------------------------------------
+
+bool NFmiImageAnalysis::IsOpaque(int threshold) const
+{
+  return itsMaxAlpha <= max(threshold, 0);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test whether the image is fully opaque or transparent
+ *
+ * Equivalent to NFmiImage::IsFullyOpaqueOrTransparent
+ */
+// ----------------------------------------------------------------------
+
+bool NFmiImageAnalysis::IsFullyOpaqueOrTransparent(int threshold) const
+{
+  return (threshold >= 0 || itsBinaryAlpha);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Find an RGB triple not used in the image
+ *
+ * Equivalent to NFmiImage::UnusedColor, but the known colours
+ * are tested without rescanning the image.
+ */
+// ----------------------------------------------------------------------
+
+NFmiColorTools::Color NFmiImageAnalysis::UnusedColor() const
+{
+  try
+  {
+    if (itsColorOverflow)
+      return itsImage.UnusedColor();
+
+    set<NFmiColorTools::Color> used;
+    for (NFmiColorTools::Color color : itsColors)
+      used.insert(NFmiColorTools::GetRGB(color));
+
+    for (int try_number = 0; try_number < 1000; try_number++)
+    {
+      int r = rand() * NFmiColorTools::MaxRGB / RAND_MAX;
+      int g = rand() * NFmiColorTools::MaxRGB / RAND_MAX;
+      int b = rand() * NFmiColorTools::MaxRGB / RAND_MAX;
+
+      NFmiColorTools::Color rgb = NFmiColorTools::MakeColor(r, g, b);
+      if (used.find(rgb) == used.end())
+        return rgb;
+    }
+
+    return NFmiColorTools::NoColor;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Add the colors used in the image into the given set of colors
+ *
+ * Equivalent to NFmiImage::AddColors. The image is rescanned only if
+ * it has too many colours for them to have been recorded.
+ */
+// ----------------------------------------------------------------------
+
+bool NFmiImageAnalysis::AddColors(set<NFmiColorTools::Color> &theSet,
+                                  int maxcolors,
+                                  int opaquethreshold,
+                                  bool ignoreAlpha) const
+{
+  try
+  {
+    if (itsColorOverflow)
+      return itsImage.AddColors(theSet, maxcolors, opaquethreshold, ignoreAlpha);
+
+    int colorsnow = theSet.size();
+    if (maxcolors > 0 && colorsnow > maxcolors)
+      return true;
+
+    for (NFmiColorTools::Color color : itsColors)
+    {
+      auto iter = theSet.insert(NFmiColorTools::Simplify(color, opaquethreshold, ignoreAlpha));
+      if (iter.second && maxcolors > 0 && ++colorsnow > maxcolors)
+        return true;
+    }
+
+    return false;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Imagine
+
+// ======================================================================
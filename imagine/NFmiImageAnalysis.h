@@ -0,0 +1,56 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of class Imagine::NFmiImageAnalysis
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiImageAnalysis
+ *
+ * \brief Opacity and colour information needed by the image writers
+ *
+ * The PNG and GIF writers need to know whether the image is opaque,
+ * whether its alpha channel is binary and which colours it uses.
+ * The analysis gathers all of this in a single pass over the pixels,
+ * so that writing the same image in several formats does not rescan
+ * the image for each output.
+ *
+ * The analysis refers to the image, which must outlive it and must
+ * not be modified while the analysis is in use. The methods are
+ * thread safe.
+ */
+// ======================================================================
+
+#pragma once
+
+#include "NFmiColorTools.h"
+#include <set>
+
+namespace Imagine
+{
+class NFmiImage;
+
+class NFmiImageAnalysis
+{
+ public:
+  explicit NFmiImageAnalysis(const NFmiImage &theImage);
+
+  bool IsOpaque(int threshold = -1) const;
+  bool IsFullyOpaqueOrTransparent(int threshold = -1) const;
+  NFmiColorTools::Color UnusedColor() const;
+  bool AddColors(std::set<NFmiColorTools::Color> &theSet,
+                 int maxcolors = -1,
+                 int opaquethreshold = -1,
+                 bool ignoreAlpha = false) const;
+
+ private:
+  const NFmiImage &itsImage;
+  int itsMaxAlpha;         // largest alpha value in the image
+  bool itsBinaryAlpha;     // all pixels are fully opaque or transparent
+  bool itsColorOverflow;   // too many colours to be recorded
+  std::set<NFmiColorTools::Color> itsColors;  // the colours if no overflow
+
+};  // class NFmiImageAnalysis
+}  // namespace Imagine
+
+// ======================================================================
@@ -0,0 +1,254 @@
+#ifndef IMAGINE_WITH_CAIRO
+
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of singleton class Imagine::NFmiImageCache
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiImageCache
+ *
+ * \brief Process wide cache of decoded images
+ *
+ * Markers and fill patterns are typically read from a small set of
+ * files over and over again. Instead of decoding them on every
+ * request, use
+ * \code
+ * auto marker = NFmiImageCache::Instance().Get(filename);
+ * shape.Mark(image, *marker, rule, alignment, alpha);
+ * \endcode
+ * The images are shared between all users and must not be modified.
+ *
+ * An image is identified by its filename, modification time and size.
+ * If the file changes on disk, the next request decodes it again.
+ * The least recently used images are dropped when the estimated memory
+ * use of the cached images exceeds the limit, which defaults to
+ * imagine::image_cache_size megabytes (default 64). Images larger than
+ * the limit are returned without caching them.
+ *
+ * All methods are thread safe. Decoding is done outside the lock, so
+ * a slow decode never blocks other threads from using the cache.
+ */
+// ======================================================================
+
+#include "NFmiImageCache.h"
+#include "NFmiImage.h"
+#include "NFmiLruCache.h"
+#include <macgyver/Exception.h>
+#include <newbase/NFmiFileSystem.h>
+#include <newbase/NFmiSettings.h>
+
+#include <ctime>
+
+using namespace std;
+
+namespace Imagine
+{
+namespace
+{
+//! A decoded image and the identity of the file it was decoded from
+
+struct CachedImage
+{
+  time_t modtime;
+  long filesize;
+  shared_ptr<const NFmiImage> image;
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Estimated memory use of an image
+ */
+// ----------------------------------------------------------------------
+
+struct ImageSize
+{
+  size_t operator()(const string&, const CachedImage& theImage) const
+  {
+    return sizeof(NFmiImage) + static_cast<size_t>(theImage.image->Width()) *
+                                   theImage.image->Height() * sizeof(NFmiColorTools::Color);
+  }
+};
+
+}  // namespace
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Implementation hiding pimple for NFmiImageCache
+ */
+// ----------------------------------------------------------------------
+
+class NFmiImageCache::Pimple
+{
+ public:
+  Pimple();
+
+  shared_ptr<const NFmiImage> Get(const string& theFileName);
+
+  NFmiLruCache<string, CachedImage, hash<string>, ImageSize> itsCache;
+
+};  // class NFmiImageCache::Pimple
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Pimple constructor
+ */
+// ----------------------------------------------------------------------
+
+NFmiImageCache::Pimple::Pimple()
+{
+  try
+  {
+    const int megabytes = NFmiSettings::Optional<int>("imagine::image_cache_size", 64);
+    itsCache.MaxBytes(static_cast<size_t>(max(0, megabytes)) * 1024 * 1024);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the decoded image for the given file
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiImage> NFmiImageCache::Pimple::Get(const string& theFileName)
+{
+  try
+  {
+    const time_t modtime = NFmiFileSystem::FileModificationTime(theFileName);
+    const long filesize = NFmiFileSystem::FileSize(theFileName);
+
+    // An image decoded from an older version of the file is dropped
+
+    shared_ptr<const CachedImage> cached =
+        itsCache.Find(theFileName, [modtime, filesize](const CachedImage& theImage) {
+          return theImage.modtime == modtime && theImage.filesize == filesize;
+        });
+    if (cached)
+      return cached->image;
+
+    // Decode without holding the lock. Should two threads race to decode the
+    // same file, the latter one simply replaces the former entry.
+
+    shared_ptr<const NFmiImage> image = make_shared<NFmiImage>(theFileName);
+    itsCache.Insert(theFileName, make_shared<CachedImage>(CachedImage{modtime, filesize, image}));
+    return image;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Failed to get image " + theFileName + " from cache");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Destructor
+ */
+// ----------------------------------------------------------------------
+
+NFmiImageCache::~NFmiImageCache() {}
+// ----------------------------------------------------------------------
+/*!
+ * \brief Constructor used privately by Instance()
+ */
+// ----------------------------------------------------------------------
+
+NFmiImageCache::NFmiImageCache() : itsPimple(new Pimple()) {}
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return an instance of NFmiImageCache
+ *
+ * \return A reference to a NFmiImageCache singleton
+ */
+// ----------------------------------------------------------------------
+
+NFmiImageCache& NFmiImageCache::Instance()
+{
+  try
+  {
+    static NFmiImageCache cache;
+    return cache;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the decoded image for the given file
+ *
+ * Throws if the file cannot be read.
+ *
+ * \param theFileName The image file
+ * \return A shared read-only image
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiImage> NFmiImageCache::Get(const string& theFileName)
+{
+  return itsPimple->Get(theFileName);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Set the memory limit in bytes, evicting images if necessary
+ */
+// ----------------------------------------------------------------------
+
+void NFmiImageCache::MaxBytes(size_t theBytes)
+{
+  itsPimple->itsCache.MaxBytes(theBytes);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the memory limit in bytes
+ */
+// ----------------------------------------------------------------------
+
+size_t NFmiImageCache::MaxBytes() const
+{
+  return itsPimple->itsCache.MaxBytes();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Drop all cached images
+ */
+// ----------------------------------------------------------------------
+
+void NFmiImageCache::Clear()
+{
+  itsPimple->itsCache.Clear();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the cache counters
+ */
+// ----------------------------------------------------------------------
+
+NFmiImageCache::Statistics NFmiImageCache::GetStatistics() const
+{
+  const auto cachestats = itsPimple->itsCache.GetStatistics();
+
+  Statistics stats;
+  stats.hits = cachestats.hits;
+  stats.misses = cachestats.misses;
+  stats.evictions = cachestats.evictions;
+  stats.images = cachestats.entries;
+  stats.bytes = cachestats.bytes;
+  stats.maxbytes = cachestats.maxbytes;
+  return stats;
+}
+
+}  // namespace Imagine
+
+#endif
+// ======================================================================
@@ -0,0 +1,65 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of singleton class Imagine::NFmiImageCache
+ */
+// ======================================================================
+
+#pragma once
+
+#include "imagine-config.h"
+
+#ifdef IMAGINE_WITH_CAIRO
+#error "Either Cairo or this"
+#endif
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Imagine
+{
+class NFmiImage;
+
+class NFmiImageCache
+{
+ public:
+  //! Cache usage counters
+
+  struct Statistics
+  {
+    std::size_t hits = 0;       //!< requests served from the cache
+    std::size_t misses = 0;     //!< requests which required decoding the file
+    std::size_t evictions = 0;  //!< images dropped to satisfy the memory limit
+    std::size_t images = 0;     //!< number of images currently cached
+    std::size_t bytes = 0;      //!< estimated memory used by the cached images
+    std::size_t maxbytes = 0;   //!< the memory limit
+  };
+
+  static NFmiImageCache& Instance();
+
+  std::shared_ptr<const NFmiImage> Get(const std::string& theFileName);
+
+  void MaxBytes(std::size_t theBytes);
+  std::size_t MaxBytes() const;
+
+  void Clear();
+  Statistics GetStatistics() const;
+
+ private:
+  class Pimple;
+  std::shared_ptr<Pimple> itsPimple;
+
+  // Private - only NFmiImageCache itself is allowed to call these
+  ~NFmiImageCache();
+  NFmiImageCache();
+
+  // Disabled intentionally:
+
+  NFmiImageCache(const NFmiImageCache& theOb);
+  NFmiImageCache& operator=(const NFmiImageCache& theOb);
+
+};  // class NFmiImageCache
+}  // namespace Imagine
+
+// ======================================================================
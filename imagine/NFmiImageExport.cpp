@@ -0,0 +1,254 @@
+// ======================================================================
+//
+// NFmiImage addendum - writing several outputs at once
+//
+// Products are often published in several formats and sizes at the
+// same time. Writing them one by one would rescan the image for each
+// output and scale it separately for each thumbnail. Here each
+// distinct size is produced and analyzed only once, and the outputs
+// are then encoded in parallel.
+// ======================================================================
+
+#include "NFmiImage.h"
+#include "NFmiImageAnalysis.h"
+#include "NFmiImageTools.h"
+#include <macgyver/Exception.h>
+#include <newbase/NFmiFileSystem.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <list>
+#include <map>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+namespace Imagine
+{
+namespace
+{
+// ----------------------------------------------------------------------
+// Establish the output size, preserving the aspect ratio if only one
+// of the dimensions is given
+// ----------------------------------------------------------------------
+
+pair<int, int> output_size(const NFmiImage &theImage, const NFmiImageOutput &theOutput)
+{
+  int w = theOutput.width;
+  int h = theOutput.height;
+
+  if ((w <= 0 && h <= 0) || theImage.Width() <= 0 || theImage.Height() <= 0)
+    return make_pair(theImage.Width(), theImage.Height());
+
+  if (w <= 0)
+    w = max(1, static_cast<int>(lround(1.0 * h * theImage.Width() / theImage.Height())));
+  else if (h <= 0)
+    h = max(1, static_cast<int>(lround(1.0 * w * theImage.Height() / theImage.Width())));
+
+  return make_pair(w, h);
+}
+
+}  // namespace
+
+// ----------------------------------------------------------------------
+// Write image of desired type using precalculated image analysis.
+// The analysis is needed only by the PNG and GIF writers, and is made
+// here if none is given. A negative quality means the image setting.
+// ----------------------------------------------------------------------
+
+void NFmiImage::WriteFile(const string &theFileName,
+                          const string &theType,
+                          const NFmiImageAnalysis *theAnalysis,
+                          int theQuality) const
+{
+  try
+  {
+    unique_ptr<NFmiImageAnalysis> analysis;
+    if (theAnalysis == nullptr && (theType == "png" || theType == "gif"))
+    {
+      analysis.reset(new NFmiImageAnalysis(*this));
+      theAnalysis = analysis.get();
+    }
+
+    const string dir = NFmiFileSystem::DirName(theFileName);
+    const string tmp = NFmiFileSystem::TemporaryFile(dir);
+
+    FILE *out;
+    out = fopen(tmp.c_str(), "wb");
+    if (out == nullptr)
+      throw Fmi::Exception(BCP, "Failed to open '" + theFileName + "' for writing");
+
+    try
+    {
+      if (0)
+        ;
+#ifdef IMAGINE_FORMAT_PNG
+      else if (theType == "png")
+        WritePNG(out, *theAnalysis, theQuality);
+#endif
+#ifdef IMAGINE_FORMAT_JPEG
+      else if (theType == "jpeg" || theType == "jpg")
+        WriteJPEG(out, theQuality);
+#endif
+      else if (theType == "gif")
+        WriteGIF(out, *theAnalysis);
+      else if (theType == "wbmp")
+        WriteWBMP(out);
+      else if (theType == "pnm")
+        WritePNM(out);
+      else if (theType == "pgm")
+        WritePGM(out);
+      else
+        throw Fmi::Exception(BCP, "Image format '" + theType + "' is not supported");
+    }
+    catch (...)
+    {
+      fclose(out);
+      remove(tmp.c_str());
+      throw;
+    }
+
+    fclose(out);
+
+    bool status = NFmiFileSystem::RenameFile(tmp, theFileName);
+
+    if (!status)
+      throw Fmi::Exception(BCP, "Failed to write '" + theFileName + "'");
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Write the image in several formats and sizes at once.
+//
+// The image is scaled only once for each distinct output size, and
+// analyzed only if a PNG or GIF output of that size needs it. The
+// outputs are then encoded in parallel by at most as many threads as
+// there are processors. The first error encountered is rethrown once
+// all encoders have finished.
+// ----------------------------------------------------------------------
+
+void NFmiImage::Write(const vector<NFmiImageOutput> &theOutputs) const
+{
+  try
+  {
+    if (theOutputs.empty())
+      return;
+
+    // The scaled images and the analyses. Lists keep the references stable.
+
+    list<NFmiImage> images;
+    list<NFmiImageAnalysis> analyses;
+
+    struct Source
+    {
+      const NFmiImage *image = nullptr;
+      const NFmiImageAnalysis *analysis = nullptr;
+      bool analyze = false;
+    };
+
+    map<pair<int, int>, Source> sources;
+
+    vector<Source *> jobs;
+    jobs.reserve(theOutputs.size());
+
+    for (const NFmiImageOutput &output : theOutputs)
+    {
+      const pair<int, int> size = output_size(*this, output);
+      if (size.first <= 0 || size.second <= 0)
+        throw Fmi::Exception(BCP, "Invalid output size for '" + output.filename + "'");
+
+      Source &source = sources[size];
+      if (output.type == "png" || output.type == "gif")
+        source.analyze = true;
+      jobs.push_back(&source);
+    }
+
+    for (auto &item : sources)
+    {
+      const pair<int, int> &size = item.first;
+      Source &source = item.second;
+
+      source.image = this;
+      if (size.first != itsWidth || size.second != itsHeight)
+      {
+        images.emplace_back(size.first, size.second);
+        images.back().CopyOptions(*this);
+        NFmiImageTools::Resample(*this, images.back(), NFmiImageTools::kFmiResampleBox);
+        source.image = &images.back();
+      }
+
+      if (source.analyze)
+      {
+        analyses.emplace_back(*source.image);
+        source.analysis = &analyses.back();
+      }
+    }
+
+    // Encode the outputs in parallel, the workers take the next
+    // unprocessed output until all are done
+
+    const size_t n = jobs.size();
+
+    vector<exception_ptr> errors(n);
+    atomic<size_t> next(0);
+
+    auto encode = [&]()
+    {
+      for (size_t i = next++; i < n; i = next++)
+      {
+        try
+        {
+          const NFmiImageOutput &output = theOutputs[i];
+          jobs[i]->image->WriteFile(
+              output.filename, output.type, jobs[i]->analysis, output.quality);
+        }
+        catch (...)
+        {
+          errors[i] = current_exception();
+        }
+      }
+    };
+
+    const size_t nthreads = min(n, static_cast<size_t>(max(1u, thread::hardware_concurrency())));
+
+    // Should starting a thread fail, the started ones must be joined
+    // before the exception is passed on
+
+    vector<thread> threads;
+    try
+    {
+      for (size_t i = 1; i < nthreads; i++)
+        threads.emplace_back(encode);
+    }
+    catch (...)
+    {
+      for (thread &t : threads)
+        t.join();
+      throw;
+    }
+
+    encode();
+
+    for (thread &t : threads)
+      t.join();
+
+    for (const exception_ptr &error : errors)
+      if (error)
+        rethrow_exception(error);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Imagine
+
+// ======================================================================
@@ -8,6 +8,7 @@
 
 #include "NFmiEsriBuffer.h"
 #include "NFmiImage.h"
+#include "NFmiImageAnalysis.h"
 #include <macgyver/Exception.h>
 
 #include <algorithm>
@@ -662,7 +663,7 @@ void NFmiImage::ReadGIF(FILE *in)
     }                                                \
   }
 
-void NFmiImage::WriteGIF(FILE *out) const
+void NFmiImage::WriteGIF(FILE *out, const NFmiImageAnalysis &theAnalysis) const
 {
   try
   {
@@ -685,7 +686,7 @@ void NFmiImage::WriteGIF(FILE *out) const
     bool ignorealpha = true;  // Mik� arvo t�lle?
 #endif
 
-    bool overflow = AddColors(theColors, MaxColors, opaquethreshold, ignorealpha);
+    bool overflow = theAnalysis.AddColors(theColors, MaxColors, opaquethreshold, ignorealpha);
 
     // If overflow occurred, we must quantize the image
 
@@ -145,10 +145,11 @@ void NFmiImage::ReadJPEG(FILE *in)
 }
 
 // ----------------------------------------------------------------------
-// Write JPEG image with desired quality (0-100)
+// Write JPEG image with desired quality (0-100), negative quality
+// means the image setting
 // ----------------------------------------------------------------------
 
-void NFmiImage::WriteJPEG(FILE *out) const
+void NFmiImage::WriteJPEG(FILE *out, int theQuality) const
 {
   try
   {
@@ -208,7 +209,7 @@ void NFmiImage::WriteJPEG(FILE *out) const
     // Now you can set any non-default parameters you wish to.
     // Here we just illustrate the use of quality (quantization table) scaling:
 
-    jpeg_set_quality(&cinfo, itsJpegQuality, TRUE);
+    jpeg_set_quality(&cinfo, (theQuality >= 0 ? theQuality : itsJpegQuality), TRUE);
 
     // Step 4: Start compressor
 
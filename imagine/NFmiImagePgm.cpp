@@ -1,15 +1,15 @@
 // ======================================================================
 //
 // NFmiImage addendum - PGM reading and writing
+//
+// The actual parsing is shared with PNM images, see NFmiImagePnm.cpp
 // ======================================================================
 
 #include "NFmiImage.h"
+#include <fmt/format.h>
 #include <macgyver/Exception.h>
 #include <newbase/NFmiStringTools.h>
 
-#include <iostream>
-#include <sstream>
-
 using namespace std;
 
 namespace Imagine
@@ -22,70 +22,59 @@ void NFmiImage::ReadPGM(FILE *in)
 {
   try
   {
-    const int maxbufsize = 1024;
-    char buffer[maxbufsize + 1];
-
-    // Safety against empty lines in future fgets calls
-    buffer[0] = ' ';
-
-    // The first line contains the P5 header
-
-    fseek(in, 3, SEEK_CUR);
+    ReadNetpbm(in, "pgm");
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-    // Then there may be multiple comment lines or empty lines
+// ----------------------------------------------------------------------
+// Return the image as a binary PGM
+// ----------------------------------------------------------------------
 
-    fgets(buffer, maxbufsize, in);
-    while (buffer[0] == '#' || buffer[0] == '\n')
-    {
-      fgets(buffer, maxbufsize, in);
-      if (strlen(buffer) == 0)
-        throw Fmi::Exception(BCP, "Invalid PGM image data");
-    }
+std::string NFmiImage::PgmData(int theMaxValue) const
+{
+  try
+  {
+    if (theMaxValue <= 0 || theMaxValue > 65535)
+      throw Fmi::Exception(BCP,
+                           "PGM color size must be in the range 1-65535 (size=" +
+                               NFmiStringTools::Convert(theMaxValue) + ")");
 
-    // Then there are the dimensions X Y
+    const std::string header = fmt::format("P5\n{} {}\n{}\n", itsWidth, itsHeight, theMaxValue);
 
-    int width, height;
-    {
-      istringstream input(buffer);
-      input >> width >> height;
-      if (input.bad())
-        throw Fmi::Exception(BCP, "Failed to read PGM dimensions");
+    const int samplesize = (theMaxValue > 255 ? 2 : 1);
+    const std::size_t npixels = static_cast<std::size_t>(itsWidth) * itsHeight;
 
-      if (width <= 0 || height <= 0)
-        throw Fmi::Exception(BCP, "PGM dimensions must be positive");
-    }
+    std::string data(header.size() + samplesize * npixels, '\0');
+    std::copy(header.begin(), header.end(), data.begin());
 
-    // And the size of each color component (normally 255)
+    unsigned char *dst = reinterpret_cast<unsigned char *>(&data[header.size()]);
+    const NFmiColorTools::Color *src = itsPixels;
 
-    int colorsize;
+    if (theMaxValue == 255)
     {
-      fgets(buffer, maxbufsize, in);
-      istringstream input(buffer);
-      input >> colorsize;
-      if (input.bad())
-        throw Fmi::Exception(BCP, "Failed to read PGM color size");
-
-      if (colorsize != 255)
-        throw Fmi::Exception(BCP,
-                             "Only colorsize 255 is supported for PGM images (size=" +
-                                 NFmiStringTools::Convert(colorsize) + ")");
+      for (std::size_t i = 0; i < npixels; i++)
+        dst[i] = static_cast<unsigned char>(NFmiColorTools::Intensity(src[i]));
+      return data;
     }
 
-    // And then there is the raw data
+    // Samples must be rescaled
 
-    Allocate(width, height);
+    int table[256];
+    for (int i = 0; i < 256; i++)
+      table[i] = static_cast<int>((static_cast<long>(theMaxValue) * i + 127) / 255);
 
-    for (int j = 0; j < height; j++)
+    for (std::size_t i = 0; i < npixels; i++)
     {
-      for (int i = 0; i < width; i++)
-      {
-        const int gray = fgetc(in);
-        if (gray == EOF)
-          throw Fmi::Exception(BCP, "PGM data ends abruptly");
-
-        (*this)(i, j) = NFmiColorTools::MakeColor(gray, gray, gray);
-      }
+      const int gray = table[NFmiColorTools::Intensity(src[i])];
+      if (samplesize == 2)
+        *dst++ = static_cast<unsigned char>(gray >> 8);
+      *dst++ = static_cast<unsigned char>(gray & 0xff);
     }
+    return data;
   }
   catch (...)
   {
@@ -97,33 +86,13 @@ void NFmiImage::ReadPGM(FILE *in)
 // Write PGM image
 // ----------------------------------------------------------------------
 
-void NFmiImage::WritePGM(FILE *out) const
+void NFmiImage::WritePGM(FILE *out, int theMaxValue) const
 {
   try
   {
-    // First write the P5 header
-
-    fprintf(out, "P5\n");
-
-    // Then write the image dimensions
-
-    fprintf(out, "%d %d\n", itsWidth, itsHeight);
-
-    // Then write the color component size, which is always 255 in Imagine
-
-    fprintf(out, "255\n");
-
-    // Then write the image data itself
-
-    for (int j = 0; j < itsHeight; j++)
-    {
-      for (int i = 0; i < itsWidth; i++)
-      {
-        const NFmiColorTools::Color color = (*this)(i, j);
-        const int gray = NFmiColorTools::Intensity(color);
-        fprintf(out, "%c", gray);
-      }
-    }
+    const std::string data = PgmData(theMaxValue);
+    if (fwrite(data.data(), 1, data.size(), out) != data.size())
+      throw Fmi::Exception(BCP, "Failed to write PGM data");
   }
   catch (...)
   {
@@ -11,6 +11,7 @@
 // ======================================================================
 
 #include "NFmiImage.h"
+#include "NFmiImageAnalysis.h"
 #include <macgyver/Exception.h>
 
 #ifdef IMAGINE_FORMAT_PNG
@@ -167,10 +168,11 @@ void NFmiImage::ReadPNG(FILE *in)
 }
 
 // ----------------------------------------------------------------------
-// Write PNG image
+// Write PNG image with desired compression level (0-9), negative level
+// means the image setting
 // ----------------------------------------------------------------------
 
-void NFmiImage::WritePNG(FILE *out) const
+void NFmiImage::WritePNG(FILE *out, const NFmiImageAnalysis &theAnalysis, int theQuality) const
 {
   try
   {
@@ -196,7 +198,7 @@ void NFmiImage::WritePNG(FILE *out) const
 
     // compression options
 
-    png_set_compression_level(png_ptr, itsPngQuality);
+    png_set_compression_level(png_ptr, (theQuality >= 0 ? theQuality : itsPngQuality));
     png_set_filter(png_ptr, 0, itsPngFilter);
 
     // Establish whether a palette version can be made
@@ -210,12 +212,12 @@ void NFmiImage::WritePNG(FILE *out) const
 
     // Establish whether we're saving RGB or RGBA
 
-    bool savealpha = itsSaveAlphaFlag && !IsOpaque(opaquethreshold);
+    bool savealpha = itsSaveAlphaFlag && !theAnalysis.IsOpaque(opaquethreshold);
     bool ignorealpha = !savealpha;
 
     if (itsForcePaletteFlag)
     {
-      bool overflow = AddColors(theColors, maxcolors, opaquethreshold, ignorealpha);
+      bool overflow = theAnalysis.AddColors(theColors, maxcolors, opaquethreshold, ignorealpha);
 
       // Should force quantization here if overflow occurred
       // For now we'll just use truecolor instead as if the
@@ -225,7 +227,7 @@ void NFmiImage::WritePNG(FILE *out) const
     }
     else if (itsWantPaletteFlag)
     {
-      truecolor = AddColors(theColors, maxcolors, opaquethreshold, ignorealpha);
+      truecolor = theAnalysis.AddColors(theColors, maxcolors, opaquethreshold, ignorealpha);
     }
 
     // Establish optional sRGB rendering intent
@@ -261,9 +263,9 @@ void NFmiImage::WritePNG(FILE *out) const
       NFmiColorTools::Color transcolor = NFmiColorTools::NoColor;
 
       if (savealpha)
-        separate = IsFullyOpaqueOrTransparent(opaquethreshold);
+        separate = theAnalysis.IsFullyOpaqueOrTransparent(opaquethreshold);
       if (separate)
-        transcolor = UnusedColor();
+        transcolor = theAnalysis.UnusedColor();
 
       bool rgba = (separate ? false : savealpha);
 
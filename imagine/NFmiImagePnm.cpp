@@ -1,93 +1,241 @@
 // ======================================================================
 //
 // NFmiImage addendum - PNM reading and writing
+//
+// The raster is always moved in one piece: files are read with a
+// single fread and written with a single fwrite, and the pixels are
+// converted in tight loops over contiguous memory. Both 8-bit and
+// 16-bit (maxval > 255) samples are supported.
 // ======================================================================
 
 #include "NFmiImage.h"
+#include <fmt/format.h>
 #include <macgyver/Exception.h>
 #include <newbase/NFmiStringTools.h>
 
-#include <iostream>
-#include <sstream>
+#include <cctype>
+#include <vector>
 
 using namespace std;
 
 namespace Imagine
 {
+namespace
+{
 // ----------------------------------------------------------------------
-// Read PNM image
+// Binary PNM/PGM header information
 // ----------------------------------------------------------------------
 
-void NFmiImage::ReadPNM(FILE *in)
+struct NetpbmHeader
+{
+  char format;         // '5' for PGM, '6' for PNM
+  int width;           // image width
+  int height;          // image height
+  int maxval;          // maximum sample value
+  std::size_t offset;  // start of the raster
+};
+
+// ----------------------------------------------------------------------
+// Skip whitespace and comments in a PNM header
+// ----------------------------------------------------------------------
+
+void skip_whitespace(const char *theData, std::size_t theSize, std::size_t &thePos)
+{
+  while (thePos < theSize)
+  {
+    if (theData[thePos] == '#')
+    {
+      while (thePos < theSize && theData[thePos] != '\n' && theData[thePos] != '\r')
+        ++thePos;
+    }
+    else if (isspace(static_cast<unsigned char>(theData[thePos])))
+      ++thePos;
+    else
+      break;
+  }
+}
+
+// ----------------------------------------------------------------------
+// Read a positive integer from a PNM header
+// ----------------------------------------------------------------------
+
+int read_number(const char *theData,
+                std::size_t theSize,
+                std::size_t &thePos,
+                const std::string &theName)
+{
+  skip_whitespace(theData, theSize, thePos);
+
+  if (thePos >= theSize || !isdigit(static_cast<unsigned char>(theData[thePos])))
+    throw Fmi::Exception(BCP, "Failed to read PNM " + theName);
+
+  long value = 0;
+  while (thePos < theSize && isdigit(static_cast<unsigned char>(theData[thePos])))
+  {
+    value = 10 * value + (theData[thePos++] - '0');
+    if (value > 0x7fffffff)
+      throw Fmi::Exception(BCP, "PNM " + theName + " is too large");
+  }
+  return static_cast<int>(value);
+}
+
+// ----------------------------------------------------------------------
+// Parse a binary PNM or PGM header
+// ----------------------------------------------------------------------
+
+NetpbmHeader read_header(const char *theData, std::size_t theSize)
+{
+  if (theSize < 2 || theData[0] != 'P' || (theData[1] != '5' && theData[1] != '6'))
+    throw Fmi::Exception(BCP, "Invalid PNM image data");
+
+  NetpbmHeader header;
+  std::size_t pos = 2;
+
+  header.format = theData[1];
+  header.width = read_number(theData, theSize, pos, "width");
+  header.height = read_number(theData, theSize, pos, "height");
+  header.maxval = read_number(theData, theSize, pos, "color size");
+
+  if (header.width <= 0 || header.height <= 0)
+    throw Fmi::Exception(BCP, "PNM dimensions must be positive");
+
+  if (header.maxval <= 0 || header.maxval > 65535)
+    throw Fmi::Exception(BCP,
+                         "PNM color size must be in the range 1-65535 (size=" +
+                             NFmiStringTools::Convert(header.maxval) + ")");
+
+  // Exactly one whitespace character separates the header from the raster
+
+  if (pos >= theSize || !isspace(static_cast<unsigned char>(theData[pos])))
+    throw Fmi::Exception(BCP, "Invalid PNM image data");
+
+  header.offset = pos + 1;
+  return header;
+}
+
+// ----------------------------------------------------------------------
+// Table for scaling samples in range 0-maxval to range 0-255
+// ----------------------------------------------------------------------
+
+std::vector<unsigned char> unpack_table(int theMaxValue)
+{
+  std::vector<unsigned char> table(theMaxValue + 1);
+  for (int i = 0; i <= theMaxValue; i++)
+    table[i] = static_cast<unsigned char>((255L * i + theMaxValue / 2) / theMaxValue);
+  return table;
+}
+
+// ----------------------------------------------------------------------
+// Read a 16-bit big endian sample, clamped to the maximum value
+// ----------------------------------------------------------------------
+
+inline int sample16(const unsigned char *theData, int theMaxValue)
+{
+  return min((theData[0] << 8) | theData[1], theMaxValue);
+}
+
+}  // namespace
+
+// ----------------------------------------------------------------------
+// Read binary PNM or PGM image from memory
+// ----------------------------------------------------------------------
+
+void NFmiImage::ReadPnm(const char *theData, std::size_t theSize)
 {
   try
   {
-    const int maxbufsize = 1024;
-    char buffer[maxbufsize + 1];
+    const NetpbmHeader header = read_header(theData, theSize);
 
-    // Safety against empty lines in future fgets calls
-    buffer[0] = ' ';
+    const int channels = (header.format == '6' ? 3 : 1);
+    const int samplesize = (header.maxval > 255 ? 2 : 1);
+    const std::size_t npixels = static_cast<std::size_t>(header.width) * header.height;
 
-    // The first line contains the P6 header
+    if (theSize - header.offset < npixels * channels * samplesize)
+      throw Fmi::Exception(BCP, "PNM data ends abruptly");
 
-    fseek(in, 3, SEEK_CUR);
+    Destroy();
+    Allocate(header.width, header.height);
+    itsType = (header.format == '6' ? "pnm" : "pgm");
 
-    // Then there may be multiple comment lines
+    const unsigned char *src = reinterpret_cast<const unsigned char *>(theData + header.offset);
+    NFmiColorTools::Color *dst = itsPixels;
 
-    fgets(buffer, maxbufsize, in);
-    while (buffer[0] == '#' || buffer[0] == '\n')
+    if (header.maxval == 255)
     {
-      fgets(buffer, maxbufsize, in);
-      if (strlen(buffer) == 0)
-        throw Fmi::Exception(BCP, "Invalid PNM image data");
+      if (channels == 3)
+        for (std::size_t i = 0; i < npixels; i++, src += 3)
+          dst[i] = NFmiColorTools::MakeColor(src[0], src[1], src[2]);
+      else
+        for (std::size_t i = 0; i < npixels; i++)
+          dst[i] = NFmiColorTools::MakeColor(src[i], src[i], src[i]);
+      return;
     }
 
-    // Then there are the dimensions X Y
+    // Samples must be rescaled
 
-    int width, height;
-    {
-      istringstream input(buffer);
-      input >> width >> height;
-      if (input.bad())
-        throw Fmi::Exception(BCP, "Failed to read PNM dimensions");
+    const std::vector<unsigned char> table = unpack_table(header.maxval);
+    const int maxval = header.maxval;
 
-      if (width <= 0 || height <= 0)
-        throw Fmi::Exception(BCP, "PNM dimensions must be positive");
+    if (samplesize == 1)
+    {
+      if (channels == 3)
+        for (std::size_t i = 0; i < npixels; i++, src += 3)
+          dst[i] = NFmiColorTools::MakeColor(table[min<int>(src[0], maxval)],
+                                             table[min<int>(src[1], maxval)],
+                                             table[min<int>(src[2], maxval)]);
+      else
+        for (std::size_t i = 0; i < npixels; i++)
+        {
+          const int gray = table[min<int>(src[i], maxval)];
+          dst[i] = NFmiColorTools::MakeColor(gray, gray, gray);
+        }
     }
-
-    // And the size of each color component (normally 255)
-
-    int colorsize;
+    else
     {
-      fgets(buffer, maxbufsize, in);
-      istringstream input(buffer);
-      input >> colorsize;
-      if (input.bad())
-        throw Fmi::Exception(BCP, "Failed to read PNM color size");
-
-      if (colorsize != 255)
-        throw Fmi::Exception(BCP,
-                             "Only colorsize 255 is supported for PNM images (size=" +
-                                 NFmiStringTools::Convert(colorsize) + ")");
+      if (channels == 3)
+        for (std::size_t i = 0; i < npixels; i++, src += 6)
+          dst[i] = NFmiColorTools::MakeColor(table[sample16(src, maxval)],
+                                             table[sample16(src + 2, maxval)],
+                                             table[sample16(src + 4, maxval)]);
+      else
+        for (std::size_t i = 0; i < npixels; i++, src += 2)
+        {
+          const int gray = table[sample16(src, maxval)];
+          dst[i] = NFmiColorTools::MakeColor(gray, gray, gray);
+        }
     }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
 
-    // And then there is the raw data
+// ----------------------------------------------------------------------
+// Read a binary PNM or PGM file of the given type with a single read
+// ----------------------------------------------------------------------
 
-    Allocate(width, height);
+void NFmiImage::ReadNetpbm(FILE *in, const std::string &theType)
+{
+  try
+  {
+    if (fseek(in, 0, SEEK_END) != 0)
+      throw Fmi::Exception(BCP, "Failed to determine " + theType + " file size");
 
-    for (int j = 0; j < height; j++)
-    {
-      for (int i = 0; i < width; i++)
-      {
-        const int r = fgetc(in);
-        const int g = fgetc(in);
-        const int b = fgetc(in);
-        if (r == EOF || g == EOF || b == EOF)
-          throw Fmi::Exception(BCP, "PNM data ends abruptly");
+    const long size = ftell(in);
+    if (size < 0)
+      throw Fmi::Exception(BCP, "Failed to determine " + theType + " file size");
 
-        (*this)(i, j) = NFmiColorTools::MakeColor(r, g, b);
-      }
-    }
+    rewind(in);
+
+    std::string data(size, '\0');
+    if (fread(&data[0], 1, size, in) != static_cast<std::size_t>(size))
+      throw Fmi::Exception(BCP, "Failed to read " + theType + " data");
+
+    ReadPnm(data.data(), data.size());
+
+    if (itsType != theType)
+      throw Fmi::Exception(BCP, "Expected a " + theType + " image, got " + itsType);
   }
   catch (...)
   {
@@ -96,34 +244,98 @@ void NFmiImage::ReadPNM(FILE *in)
 }
 
 // ----------------------------------------------------------------------
-// Write PNM image
+// Read PNM image
+// ----------------------------------------------------------------------
+
+void NFmiImage::ReadPNM(FILE *in)
+{
+  try
+  {
+    ReadNetpbm(in, "pnm");
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Return the image as a binary PNM
 // ----------------------------------------------------------------------
 
-void NFmiImage::WritePNM(FILE *out) const
+std::string NFmiImage::PnmData(int theMaxValue) const
 {
-  // First write the P6 header
+  try
+  {
+    if (theMaxValue <= 0 || theMaxValue > 65535)
+      throw Fmi::Exception(BCP,
+                           "PNM color size must be in the range 1-65535 (size=" +
+                               NFmiStringTools::Convert(theMaxValue) + ")");
 
-  fprintf(out, "P6\n");
+    const std::string header = fmt::format("P6\n{} {}\n{}\n", itsWidth, itsHeight, theMaxValue);
 
-  // Then write the image dimensions
+    const int samplesize = (theMaxValue > 255 ? 2 : 1);
+    const std::size_t npixels = static_cast<std::size_t>(itsWidth) * itsHeight;
 
-  fprintf(out, "%d %d\n", itsWidth, itsHeight);
+    std::string data(header.size() + 3 * samplesize * npixels, '\0');
+    std::copy(header.begin(), header.end(), data.begin());
 
-  // Then write the color component size, which is always 255 in Imagine
+    unsigned char *dst = reinterpret_cast<unsigned char *>(&data[header.size()]);
+    const NFmiColorTools::Color *src = itsPixels;
 
-  fprintf(out, "255\n");
+    if (theMaxValue == 255)
+    {
+      for (std::size_t i = 0; i < npixels; i++, dst += 3)
+      {
+        dst[0] = static_cast<unsigned char>(NFmiColorTools::GetRed(src[i]));
+        dst[1] = static_cast<unsigned char>(NFmiColorTools::GetGreen(src[i]));
+        dst[2] = static_cast<unsigned char>(NFmiColorTools::GetBlue(src[i]));
+      }
+      return data;
+    }
 
-  // Then write the image data itself
+    // Samples must be rescaled
 
-  for (int j = 0; j < itsHeight; j++)
-    for (int i = 0; i < itsWidth; i++)
+    int table[256];
+    for (int i = 0; i < 256; i++)
+      table[i] = static_cast<int>((static_cast<long>(theMaxValue) * i + 127) / 255);
+
+    for (std::size_t i = 0; i < npixels; i++)
     {
-      const NFmiColorTools::Color color = (*this)(i, j);
-      const unsigned char red = NFmiColorTools::GetRed(color);
-      const unsigned char green = NFmiColorTools::GetGreen(color);
-      const unsigned char blue = NFmiColorTools::GetBlue(color);
-      fprintf(out, "%c%c%c", red, green, blue);
+      const int rgb[3] = {table[NFmiColorTools::GetRed(src[i])],
+                          table[NFmiColorTools::GetGreen(src[i])],
+                          table[NFmiColorTools::GetBlue(src[i])]};
+      for (int c = 0; c < 3; c++)
+      {
+        if (samplesize == 2)
+          *dst++ = static_cast<unsigned char>(rgb[c] >> 8);
+        *dst++ = static_cast<unsigned char>(rgb[c] & 0xff);
+      }
     }
+    return data;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Write PNM image
+// ----------------------------------------------------------------------
+
+void NFmiImage::WritePNM(FILE *out, int theMaxValue) const
+{
+  try
+  {
+    const std::string data = PnmData(theMaxValue);
+    if (fwrite(data.data(), 1, data.size(), out) != data.size())
+      throw Fmi::Exception(BCP, "Failed to write PNM data");
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
 }
 
 }  // namespace Imagine
@@ -0,0 +1,518 @@
+#ifndef IMAGINE_WITH_CAIRO
+
+// ======================================================================
+/*!
+ * \file
+ * \brief Image resampling tools in namespace Imagine::NFmiImageTools
+ *
+ * The resampler is separable: each image row is first filtered
+ * horizontally into an intermediate buffer, which is then filtered
+ * vertically. The colours are filtered with premultiplied alpha so
+ * that transparent pixels do not bleed their colour into the result.
+ *
+ * The intermediate data is stored as interleaved single precision
+ * RGBA quadruplets, and all inner loops run over contiguous memory
+ * with no data dependent branches so that the compiler can
+ * vectorize them. Large images are processed in parallel in blocks
+ * of rows.
+ */
+// ======================================================================
+
+#include "NFmiImage.h"
+#include "NFmiImageTools.h"
+#include <macgyver/Exception.h>
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace Imagine
+{
+namespace
+{
+// Images smaller than this many pixels are not worth processing in parallel
+
+const long parallel_limit = 256 * 256;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Filter support radius in source pixels when not shrinking
+ */
+// ----------------------------------------------------------------------
+
+double filter_support(NFmiImageTools::NFmiResampleFilter theFilter)
+{
+  switch (theFilter)
+  {
+    case NFmiImageTools::kFmiResampleBox:
+      return 0.5;
+    case NFmiImageTools::kFmiResampleBilinear:
+      return 1.0;
+    case NFmiImageTools::kFmiResampleLanczos:
+      return 3.0;
+  }
+  throw Fmi::Exception(BCP, "Unknown resampling filter");
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Evaluate a filter
+ */
+// ----------------------------------------------------------------------
+
+double filter_value(NFmiImageTools::NFmiResampleFilter theFilter, double x)
+{
+  switch (theFilter)
+  {
+    case NFmiImageTools::kFmiResampleBox:
+      return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+    case NFmiImageTools::kFmiResampleBilinear:
+      return max(0.0, 1.0 - fabs(x));
+    case NFmiImageTools::kFmiResampleLanczos:
+    {
+      if (x == 0)
+        return 1.0;
+      if (fabs(x) >= 3)
+        return 0.0;
+      const double pi = 3.14159265358979323846;
+      const double px = pi * x;
+      return 3 * sin(px) * sin(px / 3) / (px * px);
+    }
+  }
+  throw Fmi::Exception(BCP, "Unknown resampling filter");
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Precalculated filter weights for one dimension
+ *
+ * Output pixel i is the weighted sum of source pixels first[i] ...
+ * first[i]+taps-1 with weights weights[i*taps] ... Windows shorter
+ * than taps are padded with zero weights, so that the inner loops
+ * always have the same length.
+ */
+// ----------------------------------------------------------------------
+
+struct Kernel
+{
+  int taps;
+  vector<int> first;
+  vector<float> weights;
+};
+
+Kernel make_kernel(int theSourceSize,
+                   int theTargetSize,
+                   NFmiImageTools::NFmiResampleFilter theFilter)
+{
+  const double scale = static_cast<double>(theSourceSize) / theTargetSize;
+  const double fscale = max(1.0, scale);
+  const double support = filter_support(theFilter) * fscale;
+
+  Kernel kernel;
+  kernel.taps = min(theSourceSize, static_cast<int>(ceil(2 * support)) + 1);
+  kernel.first.resize(theTargetSize);
+  kernel.weights.assign(static_cast<size_t>(theTargetSize) * kernel.taps, 0.0f);
+
+  vector<double> w(kernel.taps);
+
+  for (int i = 0; i < theTargetSize; i++)
+  {
+    const double center = (i + 0.5) * scale;
+
+    // Keep the window inside the source, the extra taps will get zero weights
+
+    int first = static_cast<int>(floor(center - support));
+    first = max(0, min(first, theSourceSize - kernel.taps));
+
+    double sum = 0;
+    for (int k = 0; k < kernel.taps; k++)
+    {
+      w[k] = filter_value(theFilter, (first + k + 0.5 - center) / fscale);
+      sum += w[k];
+    }
+
+    kernel.first[i] = first;
+    float *weights = &kernel.weights[static_cast<size_t>(i) * kernel.taps];
+
+    if (sum == 0)
+    {
+      // Can only happen for the box filter at exact pixel edges, use the nearest pixel
+      const int nearest = min(theSourceSize - 1, static_cast<int>(center));
+      weights[nearest - first] = 1.0f;
+    }
+    else
+    {
+      for (int k = 0; k < kernel.taps; k++)
+        weights[k] = static_cast<float>(w[k] / sum);
+    }
+  }
+
+  return kernel;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Process rows 0...n-1 in parallel blocks if the job is large
+ *
+ * Exceptions thrown by the blocks are passed on to the caller once
+ * all threads have finished.
+ */
+// ----------------------------------------------------------------------
+
+template <typename T>
+void parallel_rows(int theRows, long thePixels, T theFunction)
+{
+  const int nthreads =
+      (thePixels < parallel_limit ? 1
+                                  : min(theRows, static_cast<int>(thread::hardware_concurrency())));
+
+  if (nthreads <= 1)
+  {
+    theFunction(0, theRows);
+    return;
+  }
+
+  const int blocksize = (theRows + nthreads - 1) / nthreads;
+  const int nblocks = (theRows + blocksize - 1) / blocksize;
+
+  vector<exception_ptr> errors(nblocks);
+
+  auto worker = [&](int theBlock)
+  {
+    try
+    {
+      const int first = theBlock * blocksize;
+      theFunction(first, min(theRows, first + blocksize));
+    }
+    catch (...)
+    {
+      errors[theBlock] = current_exception();
+    }
+  };
+
+  // Should starting a thread fail, the started ones must be joined
+  // before the exception is passed on
+
+  vector<thread> threads;
+  try
+  {
+    for (int block = 1; block < nblocks; block++)
+      threads.emplace_back(worker, block);
+  }
+  catch (...)
+  {
+    for (thread &t : threads)
+      t.join();
+    throw;
+  }
+
+  worker(0);
+
+  for (thread &t : threads)
+    t.join();
+
+  for (const exception_ptr &error : errors)
+    if (error)
+      rethrow_exception(error);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Convert a row of pixels to premultiplied RGBA floats
+ *
+ * The alpha component is stored as opacity in the range 0-1.
+ */
+// ----------------------------------------------------------------------
+
+void unpack_row(const NFmiColorTools::Color *__restrict theRow,
+                int theWidth,
+                float *__restrict theOutput)
+{
+  const float scale = 1.0f / NFmiColorTools::MaxAlpha;
+
+  for (int i = 0; i < theWidth; i++)
+  {
+    const NFmiColorTools::Color c = theRow[i];
+    const float opacity = (NFmiColorTools::MaxAlpha - NFmiColorTools::GetAlpha(c)) * scale;
+    theOutput[4 * i + 0] = opacity * NFmiColorTools::GetRed(c);
+    theOutput[4 * i + 1] = opacity * NFmiColorTools::GetGreen(c);
+    theOutput[4 * i + 2] = opacity * NFmiColorTools::GetBlue(c);
+    theOutput[4 * i + 3] = opacity;
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Convert premultiplied RGBA floats back to colours
+ */
+// ----------------------------------------------------------------------
+
+void pack_row(const float *__restrict theInput, int theWidth, NFmiColorTools::Color *theRow)
+{
+  for (int i = 0; i < theWidth; i++)
+  {
+    const float *p = theInput + 4 * i;
+    const float opacity = min(1.0f, p[3]);
+    if (opacity <= 0)
+      theRow[i] = NFmiColorTools::TransparentColor;
+    else
+    {
+      const float scale = 1.0f / opacity;
+      const int r = static_cast<int>(lround(min(255.0f, max(0.0f, p[0] * scale))));
+      const int g = static_cast<int>(lround(min(255.0f, max(0.0f, p[1] * scale))));
+      const int b = static_cast<int>(lround(min(255.0f, max(0.0f, p[2] * scale))));
+      const int a = static_cast<int>(lround(NFmiColorTools::MaxAlpha * (1.0f - opacity)));
+      theRow[i] = NFmiColorTools::MakeColor(r, g, b, a);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Filter a row of premultiplied pixels horizontally
+ */
+// ----------------------------------------------------------------------
+
+void filter_row(const Kernel &theKernel,
+                const float *__restrict theInput,
+                int theWidth,
+                float *__restrict theOutput)
+{
+  const int taps = theKernel.taps;
+  for (int i = 0; i < theWidth; i++)
+  {
+    const float *src = theInput + 4 * theKernel.first[i];
+    const float *w = &theKernel.weights[static_cast<size_t>(i) * taps];
+    float sum[4] = {0, 0, 0, 0};
+    for (int k = 0; k < taps; k++)
+      for (int c = 0; c < 4; c++)
+        sum[c] += w[k] * src[4 * k + c];
+    for (int c = 0; c < 4; c++)
+      theOutput[4 * i + c] = sum[c];
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Average a 2x2 block of pixels with premultiplied alpha
+ */
+// ----------------------------------------------------------------------
+
+inline NFmiColorTools::Color average4(NFmiColorTools::Color c1,
+                                      NFmiColorTools::Color c2,
+                                      NFmiColorTools::Color c3,
+                                      NFmiColorTools::Color c4)
+{
+  using namespace NFmiColorTools;
+  const int o1 = MaxAlpha - GetAlpha(c1);
+  const int o2 = MaxAlpha - GetAlpha(c2);
+  const int o3 = MaxAlpha - GetAlpha(c3);
+  const int o4 = MaxAlpha - GetAlpha(c4);
+  const int opacity = o1 + o2 + o3 + o4;
+
+  if (opacity == 0)
+    return TransparentColor;
+
+  const int half = opacity / 2;
+  const int r = (o1 * GetRed(c1) + o2 * GetRed(c2) + o3 * GetRed(c3) + o4 * GetRed(c4) + half);
+  const int g =
+      (o1 * GetGreen(c1) + o2 * GetGreen(c2) + o3 * GetGreen(c3) + o4 * GetGreen(c4) + half);
+  const int b = (o1 * GetBlue(c1) + o2 * GetBlue(c2) + o3 * GetBlue(c3) + o4 * GetBlue(c4) + half);
+
+  return MakeColor(r / opacity, g / opacity, b / opacity, MaxAlpha - (opacity + 2) / 4);
+}
+
+}  // namespace
+
+namespace NFmiImageTools
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Resample an image to the size of the target image
+ *
+ * \param theSource The image to resample
+ * \param theTarget The image to fill, its size determines the scaling
+ * \param theFilter The filter to use
+ */
+// ----------------------------------------------------------------------
+
+void Resample(const NFmiImage& theSource, NFmiImage& theTarget, NFmiResampleFilter theFilter)
+{
+  try
+  {
+    const int sw = theSource.Width();
+    const int sh = theSource.Height();
+    const int tw = theTarget.Width();
+    const int th = theTarget.Height();
+
+    if (tw == 0 || th == 0)
+      return;
+
+    if (sw == 0 || sh == 0)
+      throw Fmi::Exception(BCP, "Cannot resample an empty image");
+
+    const Kernel xkernel = make_kernel(sw, tw, theFilter);
+    const Kernel ykernel = make_kernel(sh, th, theFilter);
+
+    // Horizontal pass: sh rows of tw premultiplied pixels
+
+    vector<float> tmp(static_cast<size_t>(sh) * tw * 4);
+
+    parallel_rows(sh,
+                  static_cast<long>(sw) * sh,
+                  [&](int theFirstRow, int theLastRow)
+                  {
+                    vector<float> row(static_cast<size_t>(sw) * 4);
+                    for (int j = theFirstRow; j < theLastRow; j++)
+                    {
+                      unpack_row(&theSource(0, j), sw, &row[0]);
+                      filter_row(xkernel, &row[0], tw, &tmp[static_cast<size_t>(j) * tw * 4]);
+                    }
+                  });
+
+    // Vertical pass: accumulate whole rows, which vectorizes trivially
+
+    const size_t rowsize = static_cast<size_t>(tw) * 4;
+
+    parallel_rows(th,
+                  static_cast<long>(tw) * th,
+                  [&](int theFirstRow, int theLastRow)
+                  {
+                    vector<float> sum(rowsize);
+                    for (int j = theFirstRow; j < theLastRow; j++)
+                    {
+                      fill(sum.begin(), sum.end(), 0.0f);
+                      float *__restrict acc = &sum[0];
+
+                      const int taps = ykernel.taps;
+                      const float *w = &ykernel.weights[static_cast<size_t>(j) * taps];
+                      for (int k = 0; k < taps; k++)
+                      {
+                        const float weight = w[k];
+                        const float *__restrict src =
+                            &tmp[static_cast<size_t>(ykernel.first[j] + k) * rowsize];
+                        for (size_t x = 0; x < rowsize; x++)
+                          acc[x] += weight * src[x];
+                      }
+                      pack_row(acc, tw, &theTarget(0, j));
+                    }
+                  });
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return a resampled copy of an image
+ *
+ * \param theImage The image to resample
+ * \param theWidth The desired width
+ * \param theHeight The desired height
+ * \param theFilter The filter to use
+ * \return The resampled image
+ */
+// ----------------------------------------------------------------------
+
+NFmiImage Resample(const NFmiImage& theImage,
+                   int theWidth,
+                   int theHeight,
+                   NFmiResampleFilter theFilter)
+{
+  try
+  {
+    NFmiImage image(theWidth, theHeight);
+    Resample(theImage, image, theFilter);
+    return image;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Build a mipmap pyramid by repeated 2x downsampling
+ *
+ * Each level is half the size of the previous one, rounded up, and
+ * each pixel is the premultiplied average of a 2x2 block. For odd
+ * sizes the last row and column are repeated.
+ *
+ * \param theImage The full resolution image
+ * \param theLevels The number of levels to build, negative means
+ *                  until the image size is 1x1
+ * \return The levels, the first one is half the size of the image
+ */
+// ----------------------------------------------------------------------
+
+vector<NFmiImage> MipPyramid(const NFmiImage& theImage, int theLevels)
+{
+  try
+  {
+    vector<NFmiImage> pyramid;
+
+    int levels = 0;
+    for (int w = theImage.Width(), h = theImage.Height(); (w > 1 || h > 1); levels++)
+    {
+      w = (w + 1) / 2;
+      h = (h + 1) / 2;
+    }
+    if (theLevels >= 0)
+      levels = min(levels, theLevels);
+
+    // Reserve first, NFmiImage would otherwise be copied when the vector grows
+    pyramid.reserve(levels);
+
+    const NFmiImage* source = &theImage;
+
+    for (int level = 0; level < levels; level++)
+    {
+      const int sw = source->Width();
+      const int sh = source->Height();
+      const int tw = (sw + 1) / 2;
+      const int th = (sh + 1) / 2;
+
+      pyramid.emplace_back(tw, th);
+      NFmiImage& target = pyramid.back();
+
+      parallel_rows(th,
+                    static_cast<long>(tw) * th,
+                    [&](int theFirstRow, int theLastRow)
+                    {
+                      for (int j = theFirstRow; j < theLastRow; j++)
+                      {
+                        const NFmiColorTools::Color* row1 = &(*source)(0, 2 * j);
+                        const NFmiColorTools::Color* row2 = &(*source)(0, min(2 * j + 1, sh - 1));
+                        NFmiColorTools::Color* out = &target(0, j);
+                        for (int i = 0; i < tw; i++)
+                        {
+                          const int i1 = 2 * i;
+                          const int i2 = min(i1 + 1, sw - 1);
+                          out[i] = average4(row1[i1], row1[i2], row2[i1], row2[i2]);
+                        }
+                      }
+                    });
+
+      source = &target;
+    }
+
+    return pyramid;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace NFmiImageTools
+}  // namespace Imagine
+
+#endif
+// ======================================================================
@@ -11,6 +11,7 @@
 #include "NFmiImage.h"
 #include <macgyver/Exception.h>
 
+#include <cctype>
 #include <stdexcept>
 
 using namespace std;
@@ -145,9 +146,11 @@ std::string MimeType(const string& theFileName)
       return "png";
     if (magic == 0x47494638)
       return "gif";
-    if (strmagic[0] == 'P' && strmagic[1] == '6' && strmagic[2] == '\n')
+    if (strmagic[0] == 'P' && strmagic[1] == '6' &&
+        isspace(static_cast<unsigned char>(strmagic[2])))
       return "pnm";
-    if (strmagic[0] == 'P' && strmagic[1] == '5' && strmagic[2] == '\n')
+    if (strmagic[0] == 'P' && strmagic[1] == '5' &&
+        isspace(static_cast<unsigned char>(strmagic[2])))
       return "pgm";
     if (strmagic[0] == 'I' && strmagic[1] == 'I' && strmagic[2] == '*')
       return "tiff";
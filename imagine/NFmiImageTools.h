@@ -14,6 +14,7 @@
 #endif
 
 #include <string>
+#include <vector>
 
 namespace Imagine
 {
@@ -21,6 +22,15 @@ class NFmiImage;
 
 namespace NFmiImageTools
 {
+//! Resampling filters
+
+enum NFmiResampleFilter
+{
+  kFmiResampleBox,       // area average when shrinking, nearest pixel when enlarging
+  kFmiResampleBilinear,  // triangle filter
+  kFmiResampleLanczos    // 3-lobed Lanczos filter
+};
+
 void CompressBits(NFmiImage& theImage,
                   int theRedBits = 8,
                   int theGreenBits = 8,
@@ -29,6 +39,17 @@ void CompressBits(NFmiImage& theImage,
 
 std::string MimeType(const std::string& theFileName);
 
+void Resample(const NFmiImage& theSource,
+              NFmiImage& theTarget,
+              NFmiResampleFilter theFilter = kFmiResampleLanczos);
+
+NFmiImage Resample(const NFmiImage& theImage,
+                   int theWidth,
+                   int theHeight,
+                   NFmiResampleFilter theFilter = kFmiResampleLanczos);
+
+std::vector<NFmiImage> MipPyramid(const NFmiImage& theImage, int theLevels = -1);
+
 }  // namespace NFmiImageTools
 
 }  // namespace Imagine
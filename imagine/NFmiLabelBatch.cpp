@@ -0,0 +1,375 @@
+#include "imagine-config.h"
+
+#ifndef IMAGINE_WITH_CAIRO
+
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of class Imagine::NFmiLabelBatch
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiLabelBatch
+ *
+ * \brief Collision free rendering of a large number of labels
+ *
+ * Station plots and similar products place thousands of labels,
+ * many of which would overlap. Instead of drawing each label
+ * separately, the candidate labels are collected into a batch
+ * \code
+ * NFmiLabelBatch labels;
+ * labels.Margin(2);
+ * for (...)
+ *   labels.Add(face, x, y, text, kFmiAlignCenter, color, rule, priority);
+ * labels.Render(image);
+ * \endcode
+ * Render places the labels in order of decreasing priority, ties
+ * being resolved in insertion order. A label is dropped if it would
+ * come closer than the margin to an already placed label, or if it
+ * would fall completely outside the image. The label sizes are
+ * measured using the cached text layouts of NFmiFreeType, and the
+ * collisions are resolved using a uniform grid so that only nearby
+ * labels are compared. The surviving labels are finally drawn grouped
+ * by face.
+ */
+// ======================================================================
+
+#ifdef UNIX
+
+#include "NFmiLabelBatch.h"
+#include "NFmiFreeType.h"
+#include "NFmiImage.h"
+
+#include <macgyver/Exception.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Constructor
+ */
+// ----------------------------------------------------------------------
+
+NFmiLabelBatch::NFmiLabelBatch() : itsMargin(0) {}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Set the minimum distance between labels in pixels
+ */
+// ----------------------------------------------------------------------
+
+void NFmiLabelBatch::Margin(int theMargin)
+{
+  itsMargin = max(0, theMargin);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the index of the face, adding it if necessary
+ */
+// ----------------------------------------------------------------------
+
+size_t NFmiLabelBatch::FaceIndex(const NFmiFace& theFace)
+{
+  try
+  {
+    for (size_t i = 0; i < itsFaces.size(); i++)
+    {
+      const Face& face = itsFaces[i];
+      if (face.file == theFace.itsFile && face.width == theFace.itsWidth &&
+          face.height == theFace.itsHeight && face.backgroundOn == theFace.itsBackgroundOn &&
+          face.backgroundWidth == theFace.itsBackgroundWidth &&
+          face.backgroundHeight == theFace.itsBackgroundHeight &&
+          face.backgroundColor == theFace.itsBackgroundColor &&
+          face.backgroundRule == theFace.itsBackgroundRule)
+        return i;
+    }
+
+    Face face{theFace.itsFile,
+              theFace.itsWidth,
+              theFace.itsHeight,
+              theFace.itsBackgroundOn,
+              theFace.itsBackgroundWidth,
+              theFace.itsBackgroundHeight,
+              theFace.itsBackgroundColor,
+              theFace.itsBackgroundRule};
+    itsFaces.push_back(face);
+    return itsFaces.size() - 1;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Add a candidate label
+ *
+ * The arguments are as in NFmiFace::Draw. Labels with a higher
+ * priority are placed first.
+ *
+ * \return The index of the label for use with Placed
+ */
+// ----------------------------------------------------------------------
+
+size_t NFmiLabelBatch::Add(const NFmiFace& theFace,
+                           int theX,
+                           int theY,
+                           const string& theText,
+                           NFmiAlignment theAlignment,
+                           NFmiColorTools::Color theColor,
+                           NFmiColorTools::NFmiBlendRule theRule,
+                           int thePriority)
+{
+  try
+  {
+    Label label{
+        FaceIndex(theFace), theX, theY, theText, theAlignment, theColor, theRule, thePriority};
+    itsLabels.push_back(label);
+    return itsLabels.size() - 1;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Calculate the area covered by a label when drawn
+ *
+ * The alignment is handled exactly as in NFmiFreeType::Draw.
+ */
+// ----------------------------------------------------------------------
+
+NFmiLabelBatch::Box NFmiLabelBatch::LabelBox(const Label& theLabel) const
+{
+  try
+  {
+    const Face& face = itsFaces[theLabel.face];
+
+    const NFmiTextExtent extent =
+        NFmiFreeType::Instance().Measure(face.file, face.width, face.height, theLabel.text);
+
+    const int width = extent.Width();
+    const int height = extent.Height();
+
+    const double xfactor = XAlignmentFactor(theLabel.alignment);
+    const double yfactor = YAlignmentFactor(theLabel.alignment);
+
+    Box box;
+    box.x1 = static_cast<int>(round(theLabel.x - xfactor * width));
+    box.y2 = static_cast<int>(round(theLabel.y + (1 - yfactor) * height));
+    box.x2 = box.x1 + width;
+    box.y1 = box.y2 - height;
+
+    if (face.backgroundOn)
+    {
+      box.x1 -= face.backgroundWidth;
+      box.y1 -= face.backgroundHeight;
+      box.x2 += face.backgroundWidth;
+      box.y2 += face.backgroundHeight;
+    }
+
+    return box;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Resolve the collisions and render the surviving labels
+ *
+ * \return The number of labels drawn
+ */
+// ----------------------------------------------------------------------
+
+size_t NFmiLabelBatch::Render(NFmiImage& theImage)
+{
+  try
+  {
+    const size_t n = itsLabels.size();
+    itsPlaced.assign(n, false);
+
+    if (n == 0 || theImage.Width() <= 0 || theImage.Height() <= 0)
+      return 0;
+
+    // Measure the labels, dropping those outside the image
+
+    vector<Box> boxes(n);
+    vector<size_t> candidates;
+    candidates.reserve(n);
+
+    long long totalsize = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+      const Box box = LabelBox(itsLabels[i]);
+      boxes[i] = box;
+      if (box.x2 > 0 && box.y2 > 0 && box.x1 < theImage.Width() && box.y1 < theImage.Height())
+      {
+        candidates.push_back(i);
+        totalsize += (box.x2 - box.x1) + (box.y2 - box.y1);
+      }
+    }
+
+    if (candidates.empty())
+      return 0;
+
+    // Highest priority first, ties resolved in insertion order
+
+    stable_sort(candidates.begin(),
+                candidates.end(),
+                [this](size_t a, size_t b)
+                { return itsLabels[a].priority > itsLabels[b].priority; });
+
+    // The grid cell size is the mean label dimension so that a label
+    // typically overlaps only a few cells.
+
+    const long long meansize = totalsize / (2 * static_cast<long long>(candidates.size()));
+    const int cellsize = max(8, static_cast<int>(meansize) + itsMargin);
+
+    const int nx = (theImage.Width() + cellsize - 1) / cellsize;
+    const int ny = (theImage.Height() + cellsize - 1) / cellsize;
+
+    vector<vector<size_t> > cells(static_cast<size_t>(nx) * ny);
+
+    const int m = itsMargin;
+
+    for (size_t i : candidates)
+    {
+      const Box& box = boxes[i];
+
+      // The cells which may contain conflicting labels
+
+      const int i1 = max(0, (box.x1 - m) / cellsize);
+      const int j1 = max(0, (box.y1 - m) / cellsize);
+      const int i2 = min(nx - 1, (box.x2 + m) / cellsize);
+      const int j2 = min(ny - 1, (box.y2 + m) / cellsize);
+
+      bool conflict = false;
+      for (int jj = j1; jj <= j2 && !conflict; jj++)
+        for (int ii = i1; ii <= i2 && !conflict; ii++)
+          for (size_t k : cells[static_cast<size_t>(jj) * nx + ii])
+          {
+            const Box& other = boxes[k];
+            if (box.x1 < other.x2 + m && other.x1 < box.x2 + m && box.y1 < other.y2 + m &&
+                other.y1 < box.y2 + m)
+            {
+              conflict = true;
+              break;
+            }
+          }
+
+      if (conflict)
+        continue;
+
+      itsPlaced[i] = true;
+
+      // Register the label into the cells it covers
+
+      const int k1 = max(0, box.x1 / cellsize);
+      const int l1 = max(0, box.y1 / cellsize);
+      const int k2 = min(nx - 1, box.x2 / cellsize);
+      const int l2 = min(ny - 1, box.y2 / cellsize);
+
+      for (int jj = l1; jj <= l2; jj++)
+        for (int ii = k1; ii <= k2; ii++)
+          cells[static_cast<size_t>(jj) * nx + ii].push_back(i);
+    }
+
+    // Render the survivors grouped by face. The labels do not overlap,
+    // hence the order does not affect the result.
+
+    vector<size_t> survivors;
+    for (size_t i = 0; i < n; i++)
+      if (itsPlaced[i])
+        survivors.push_back(i);
+
+    stable_sort(survivors.begin(),
+                survivors.end(),
+                [this](size_t a, size_t b) { return itsLabels[a].face < itsLabels[b].face; });
+
+    NFmiFreeType& freetype = NFmiFreeType::Instance();
+
+    for (size_t i : survivors)
+    {
+      const Label& label = itsLabels[i];
+      const Face& face = itsFaces[label.face];
+      freetype.Draw(theImage,
+                    face.file,
+                    face.width,
+                    face.height,
+                    label.x,
+                    label.y,
+                    label.text,
+                    label.alignment,
+                    label.color,
+                    label.rule,
+                    face.backgroundOn,
+                    face.backgroundWidth,
+                    face.backgroundHeight,
+                    face.backgroundColor,
+                    face.backgroundRule);
+    }
+
+    return survivors.size();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test whether the label was drawn by the last Render call
+ */
+// ----------------------------------------------------------------------
+
+bool NFmiLabelBatch::Placed(size_t theIndex) const
+{
+  return (theIndex < itsPlaced.size() && itsPlaced[theIndex]);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the number of candidate labels
+ */
+// ----------------------------------------------------------------------
+
+size_t NFmiLabelBatch::Size() const
+{
+  return itsLabels.size();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Remove all labels
+ */
+// ----------------------------------------------------------------------
+
+void NFmiLabelBatch::Clear()
+{
+  itsLabels.clear();
+  itsPlaced.clear();
+  itsFaces.clear();
+}
+
+}  // namespace Imagine
+
+#endif  // UNIX
+
+#endif
+// IMAGINE_WITH_CAIRO
+
+// ======================================================================
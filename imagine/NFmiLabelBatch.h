@@ -0,0 +1,102 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of class Imagine::NFmiLabelBatch
+ */
+// ======================================================================
+
+#ifdef UNIX
+
+#pragma once
+
+#include "imagine-config.h"
+
+#ifdef IMAGINE_WITH_CAIRO
+#error "Either Cairo or us"
+#endif
+
+#include "NFmiAlignment.h"
+#include "NFmiColorTools.h"
+#include "NFmiFace.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Imagine
+{
+class NFmiImage;
+
+class NFmiLabelBatch
+{
+ public:
+  NFmiLabelBatch();
+
+  void Margin(int theMargin);
+
+  std::size_t Add(const NFmiFace& theFace,
+                  int theX,
+                  int theY,
+                  const std::string& theText,
+                  NFmiAlignment theAlignment = kFmiAlignNorthWest,
+                  NFmiColorTools::Color theColor = NFmiColorTools::Black,
+                  NFmiColorTools::NFmiBlendRule theRule = NFmiColorTools::kFmiColorOnOpaque,
+                  int thePriority = 0);
+
+  std::size_t Render(NFmiImage& theImage);
+
+  bool Placed(std::size_t theIndex) const;
+  std::size_t Size() const;
+  void Clear();
+
+ private:
+  // The rendering parameters of a face. NFmiFace itself is not copyable.
+
+  struct Face
+  {
+    std::string file;
+    int width;
+    int height;
+    bool backgroundOn;
+    int backgroundWidth;
+    int backgroundHeight;
+    NFmiColorTools::Color backgroundColor;
+    NFmiColorTools::NFmiBlendRule backgroundRule;
+  };
+
+  struct Label
+  {
+    std::size_t face;  // index to itsFaces
+    int x;
+    int y;
+    std::string text;
+    NFmiAlignment alignment;
+    NFmiColorTools::Color color;
+    NFmiColorTools::NFmiBlendRule rule;
+    int priority;
+  };
+
+  // A label bounding box including the background margins
+
+  struct Box
+  {
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+  };
+
+  std::size_t FaceIndex(const NFmiFace& theFace);
+  Box LabelBox(const Label& theLabel) const;
+
+  int itsMargin;
+  std::vector<Face> itsFaces;
+  std::vector<Label> itsLabels;
+  std::vector<bool> itsPlaced;
+
+};  // class NFmiLabelBatch
+}  // namespace Imagine
+
+#endif  // UNIX
+
+// ======================================================================
@@ -0,0 +1,194 @@
+// ======================================================================
+/*!
+ * \file NFmiLruCache.h
+ * \brief Interface and implementation of template class NFmiLruCache
+ */
+// ======================================================================
+/*!
+ * \class NFmiLruCache
+ *
+ * \brief A thread safe least recently used cache limited by memory use
+ *
+ * The cache holds shared read-only values identified by a key. The
+ * memory used by each value is estimated by the Size policy, which
+ * must provide
+ * \code
+ * std::size_t operator()(const Key& theKey, const Value& theValue) const;
+ * \endcode
+ * The least recently used values are dropped when the estimated memory
+ * use exceeds the limit. Values larger than the limit are not cached.
+ *
+ * Sample usage:
+ *
+ * \code
+ * NFmiLruCache<std::string, NFmiImage, std::hash<std::string>, ImageSize> cache(limit);
+ * auto image = cache.Find(filename);
+ * if (!image)
+ * {
+ *   image = std::make_shared<NFmiImage>(filename);
+ *   cache.Insert(filename, image);
+ * }
+ * \endcode
+ *
+ * All methods are thread safe. Values are created by the caller
+ * outside the lock. Should two threads race to insert the same key,
+ * the latter one replaces the former.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Imagine
+{
+template <class Key, class Value, class Hash, class Size>
+class NFmiLruCache
+{
+ public:
+  //! Cache usage counters
+
+  struct Statistics
+  {
+    std::size_t hits = 0;       //!< requests served from the cache
+    std::size_t misses = 0;     //!< requests not found in the cache
+    std::size_t evictions = 0;  //!< values dropped to satisfy the memory limit
+    std::size_t entries = 0;    //!< number of values currently cached
+    std::size_t bytes = 0;      //!< estimated memory used by the cached values
+    std::size_t maxbytes = 0;   //!< the memory limit
+  };
+
+  //! Constructor
+  explicit NFmiLruCache(std::size_t theMaxBytes = 0) { itsStatistics.maxbytes = theMaxBytes; }
+
+  //! Find a value, an empty pointer if the key is not cached
+  std::shared_ptr<const Value> Find(const Key& theKey)
+  {
+    return Find(theKey, [](const Value&) { return true; });
+  }
+
+  //! Find a value accepted by the given test
+  /*!
+   * A cached value rejected by the test is dropped, and the request
+   * counts as a miss.
+   */
+
+  template <class Valid>
+  std::shared_ptr<const Value> Find(const Key& theKey, Valid isValid)
+  {
+    std::lock_guard<std::mutex> lock(itsMutex);
+    auto it = itsEntries.find(theKey);
+    if (it != itsEntries.end())
+    {
+      if (isValid(*it->second.value))
+      {
+        ++itsStatistics.hits;
+        itsRecentlyUsed.splice(itsRecentlyUsed.begin(), itsRecentlyUsed, it->second.position);
+        return it->second.value;
+      }
+      Erase(it);
+    }
+    ++itsStatistics.misses;
+    return std::shared_ptr<const Value>();
+  }
+
+  //! Insert a value, returning false if it is too large to be cached
+  bool Insert(const Key& theKey, const std::shared_ptr<const Value>& theValue)
+  {
+    const std::size_t bytes = Size()(theKey, *theValue);
+
+    std::lock_guard<std::mutex> lock(itsMutex);
+
+    if (bytes > itsStatistics.maxbytes)
+      return false;
+
+    auto it = itsEntries.find(theKey);
+    if (it != itsEntries.end())
+      Erase(it);
+
+    itsRecentlyUsed.push_front(theKey);
+    itsEntries.insert(std::make_pair(theKey, Entry{bytes, theValue, itsRecentlyUsed.begin()}));
+    itsStatistics.bytes += bytes;
+
+    Shrink();
+    return true;
+  }
+
+  //! Set the memory limit in bytes, evicting values if necessary
+  void MaxBytes(std::size_t theBytes)
+  {
+    std::lock_guard<std::mutex> lock(itsMutex);
+    itsStatistics.maxbytes = theBytes;
+    Shrink();
+  }
+
+  //! Return the memory limit in bytes
+  std::size_t MaxBytes() const
+  {
+    std::lock_guard<std::mutex> lock(itsMutex);
+    return itsStatistics.maxbytes;
+  }
+
+  //! Drop all cached values. Values still in use remain valid.
+  void Clear()
+  {
+    std::lock_guard<std::mutex> lock(itsMutex);
+    itsEntries.clear();
+    itsRecentlyUsed.clear();
+    itsStatistics.bytes = 0;
+  }
+
+  //! Return a snapshot of the cache counters
+  Statistics GetStatistics() const
+  {
+    std::lock_guard<std::mutex> lock(itsMutex);
+    Statistics stats = itsStatistics;
+    stats.entries = itsEntries.size();
+    return stats;
+  }
+
+ private:
+  NFmiLruCache(const NFmiLruCache& theOther) = delete;
+  NFmiLruCache& operator=(const NFmiLruCache& theOther) = delete;
+
+  struct Entry
+  {
+    std::size_t bytes;
+    std::shared_ptr<const Value> value;
+    typename std::list<Key>::iterator position;  // position in itsRecentlyUsed
+  };
+
+  using Entries = std::unordered_map<Key, Entry, Hash>;
+
+  // Remove an entry. The caller must hold the lock.
+  void Erase(typename Entries::iterator theEntry)
+  {
+    itsStatistics.bytes -= theEntry->second.bytes;
+    itsRecentlyUsed.erase(theEntry->second.position);
+    itsEntries.erase(theEntry);
+  }
+
+  // Evict least recently used values until the limit is satisfied.
+  // The caller must hold the lock.
+  void Shrink()
+  {
+    while (itsStatistics.bytes > itsStatistics.maxbytes && !itsRecentlyUsed.empty())
+    {
+      Erase(itsEntries.find(itsRecentlyUsed.back()));
+      ++itsStatistics.evictions;
+    }
+  }
+
+  mutable std::mutex itsMutex;
+  Entries itsEntries;
+  std::list<Key> itsRecentlyUsed;  // most recently used first
+  Statistics itsStatistics;
+
+};  // class NFmiLruCache
+}  // namespace Imagine
+
+// ======================================================================
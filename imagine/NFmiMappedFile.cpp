@@ -0,0 +1,79 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of class Imagine::NFmiMappedFile
+ */
+// ======================================================================
+
+#include "NFmiMappedFile.h"
+#include <macgyver/Exception.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Map the given file
+ *
+ * Empty files are allowed, their data pointer is null.
+ */
+// ----------------------------------------------------------------------
+
+NFmiMappedFile::NFmiMappedFile(const string &theFile)
+    : itsName(theFile), itsData(nullptr), itsSize(0)
+{
+  try
+  {
+    const int fd = open(theFile.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw Fmi::Exception(BCP, "Failed to open '" + theFile + "'");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+      close(fd);
+      throw Fmi::Exception(BCP, "Failed to stat '" + theFile + "'");
+    }
+
+    if (st.st_size == 0)
+    {
+      close(fd);
+      return;
+    }
+
+    void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+      throw Fmi::Exception(BCP, "Failed to memory map '" + theFile + "'");
+
+    itsData = static_cast<const char *>(data);
+    itsSize = static_cast<size_t>(st.st_size);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Release the mapping
+ */
+// ----------------------------------------------------------------------
+
+NFmiMappedFile::~NFmiMappedFile()
+{
+  if (itsData != nullptr)
+    munmap(const_cast<char *>(itsData), itsSize);
+}
+
+}  // namespace Imagine
+
+// ======================================================================
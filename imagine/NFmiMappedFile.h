@@ -0,0 +1,47 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of class Imagine::NFmiMappedFile
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiMappedFile
+ *
+ * \brief A read only memory mapping of a file
+ *
+ * The file is mapped as shared, hence all processes mapping the same
+ * file use the same pages in the page cache, and only the pages which
+ * are actually accessed are ever read from the disk. The mapping stays
+ * valid for the lifetime of the object.
+ */
+// ======================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Imagine
+{
+class NFmiMappedFile
+{
+ public:
+  explicit NFmiMappedFile(const std::string &theFile);
+  ~NFmiMappedFile();
+
+  const std::string &Name() const { return itsName; }
+  const char *Data() const { return itsData; }
+  std::size_t Size() const { return itsSize; }
+
+ private:
+  NFmiMappedFile(const NFmiMappedFile &theOther) = delete;
+  NFmiMappedFile &operator=(const NFmiMappedFile &theOther) = delete;
+
+  std::string itsName;
+  const char *itsData;
+  std::size_t itsSize;
+};
+
+}  // namespace Imagine
+
+// ======================================================================
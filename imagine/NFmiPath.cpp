@@ -4,13 +4,15 @@
 // ======================================================================
 
 #include "NFmiPath.h"
-#include "NFmiContourTree.h"
 #include "NFmiCounter.h"
 #include "NFmiEsriBox.h"
+#include "NFmiFillMap.h"
 
+#include <fmt/format.h>
+#include <gis/CoordinateTransformation.h>
+#include <gis/SpatialReference.h>
 #include <macgyver/Exception.h>
 #include <newbase/NFmiGrid.h>
-#include <newbase/NFmiValueString.h>
 
 #ifdef IMAGINE_WITH_CAIRO
 #include "ImagineXr.h"
@@ -18,9 +20,14 @@
 #endif
 
 #include <algorithm>
-#include <set>
-#include <sstream>
+#include <charconv>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <memory>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 
 // ======================================================================
 //				HIDDEN INTERNAL FUNCTIONS
@@ -72,11 +79,1133 @@ bool intersects(
   }
 }
 
-std::string numstring(double value, int precision)
+// ----------------------------------------------------------------------
+/*!
+ * \brief Output buffer for SVG path descriptions
+ *
+ * The numbers are formatted into the buffer using fmt, without any
+ * temporary strings. A fixed number of decimals is used if the
+ * number of decimals is non-negative, and trailing zeros are removed
+ * as in NFmiValueString::GetStringWithMaxDecimalsSmartWay. A negative
+ * number of decimals selects the shortest representation which reads
+ * back to the same value. If an output stream is given, the buffer
+ * is written to it in blocks.
+ */
+// ----------------------------------------------------------------------
+
+class SVGWriter
+{
+ public:
+  SVGWriter(std::string &theBuffer, int theDecimals, std::ostream *theStream = nullptr)
+      : itsBuffer(theBuffer), itsDecimals(theDecimals), itsStream(theStream)
+  {
+  }
+
+  void Put(char theChar) { itsBuffer += theChar; }
+  void Put(const char *theString) { itsBuffer += theString; }
+
+  void Point(double theX, double theY)
+  {
+    Number(theX);
+    itsBuffer += ',';
+    Number(theY);
+  }
+
+  // Write the buffer to the stream if it is full enough or if forced to
+
+  void Flush(bool theForce)
+  {
+    if (itsStream != nullptr && (theForce || itsBuffer.size() >= flush_size))
+    {
+      itsStream->write(itsBuffer.data(), static_cast<std::streamsize>(itsBuffer.size()));
+      itsBuffer.clear();
+    }
+  }
+
+ private:
+  static const std::size_t flush_size = 65536;
+
+  void Number(double theValue)
+  {
+    if (FastNumber(theValue))
+      return;
+
+    char buffer[64];
+    auto result = (itsDecimals >= 0
+                       ? fmt::format_to_n(buffer, sizeof(buffer), "{:.{}f}", theValue, itsDecimals)
+                       : fmt::format_to_n(buffer, sizeof(buffer), "{}", theValue));
+
+    if (result.size <= sizeof(buffer))
+      Append(buffer, result.out);
+    else
+    {
+      // Very large numbers in fixed notation
+      std::string tmp = fmt::format("{:.{}f}", theValue, itsDecimals);
+      Append(&tmp[0], &tmp[0] + tmp.size());
+    }
+  }
+
+  // Fixed notation using integer arithmetic. The result is the same as
+  // above, but this fails for large values and for values so close to
+  // a rounding boundary that the scaling error could change the result.
+
+  bool FastNumber(double theValue)
+  {
+    static const double scales[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    static const long long divisors[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+    if (itsDecimals < 0 || itsDecimals > 9)
+      return false;
+
+    const double scaled = std::abs(theValue) * scales[itsDecimals];
+    if (!(scaled < 1e15))
+      return false;
+
+    const double whole = std::floor(scaled);
+    const double fraction = scaled - whole;
+    if (std::abs(fraction - 0.5) <= scaled * 1e-15)
+      return false;
+
+    const long long value = static_cast<long long>(whole) + (fraction > 0.5 ? 1 : 0);
+
+    if (theValue < 0 && value != 0)
+      itsBuffer += '-';
+
+    const long long divisor = divisors[itsDecimals];
+    char buffer[32];
+    char *end = std::to_chars(buffer, buffer + sizeof(buffer), value / divisor).ptr;
+
+    long long decimals = value % divisor;
+    if (decimals != 0)
+    {
+      int digits = itsDecimals;
+      while (decimals % 10 == 0)
+      {
+        decimals /= 10;
+        --digits;
+      }
+      *end++ = '.';
+      for (int i = digits - 1; i >= 0; i--)
+      {
+        end[i] = static_cast<char>('0' + decimals % 10);
+        decimals /= 10;
+      }
+      end += digits;
+    }
+
+    itsBuffer.append(buffer, end);
+    return true;
+  }
+
+  void Append(char *theBegin, char *theEnd)
+  {
+    if (itsDecimals >= 0 && std::find(theBegin, theEnd, '.') != theEnd)
+    {
+      while (theEnd[-1] == '0')
+        --theEnd;
+      if (theEnd[-1] == '.')
+        --theEnd;
+    }
+
+    if (theEnd - theBegin == 2 && theBegin[0] == '-' && theBegin[1] == '0')
+      ++theBegin;
+
+    itsBuffer.append(theBegin, theEnd);
+  }
+
+  std::string &itsBuffer;
+  int itsDecimals;
+  std::ostream *itsStream;
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Estimate the length of the SVG description of a path
+ */
+// ----------------------------------------------------------------------
+
+std::size_t svg_size_estimate(const Imagine::NFmiPathData &theElements, int theDecimals)
+{
+  // An operator or a space, two numbers with a sign, typically four
+  // integer digits and a decimal point, and the comma in between.
+  const std::size_t number_size = (theDecimals >= 0 ? theDecimals + 6 : 18);
+  return theElements.size() * (2 * number_size + 2) + 64;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Write a SVG description of path elements
+ */
+// ----------------------------------------------------------------------
+
+void write_svg(SVGWriter &out,
+               const Imagine::NFmiPathData &theElements,
+               bool theInsideOut,
+               bool relative_moves,
+               bool removeghostlines)
+{
+  using namespace Imagine;
+
+  try
+  {
+    double last_x, last_y;
+    double last_out_x, last_out_y;
+    NFmiPathOperation last_op = kFmiMoveTo;
+
+    last_x = last_y = kFloatMissing;
+    last_out_x = last_out_y = kFloatMissing;
+
+    int count_conic = 0;
+    int count_cubic = 0;
+
+    NFmiPathData::const_iterator iter = theElements.begin();
+
+    for (; iter != theElements.end(); ++iter)
+    {
+      const double x = iter->x;
+      const double y = iter->y;
+      const NFmiPathOperation op = iter->op;
+
+      switch (op)
+      {
+        case kFmiConicTo:
+          count_cubic = 0;
+          count_conic++;
+          break;
+        case kFmiCubicTo:
+          count_conic = 0;
+          count_cubic++;
+          break;
+        default:
+          count_conic = 0;
+          count_cubic = 0;
+      }
+
+      // Special code for first move
+
+      bool out_ok = true;
+      if (removeghostlines && op == kFmiGhostLineTo)
+      {
+        out_ok = false;
+      }
+      else
+      {
+        // If ghostlines are being ignored, we must output a moveto
+        // when the ghostlines end and next operation is not moveto
+        if (removeghostlines && (last_op == kFmiGhostLineTo) &&
+            (op != kFmiGhostLineTo && op != kFmiMoveTo))
+        {
+          if (relative_moves)
+          {
+            if (last_out_x == kFloatMissing && last_out_y == kFloatMissing)
+            {
+              out.Put('m');
+              out.Point(last_x, last_y);
+            }
+            else
+            {
+              out.Put(" m");
+              out.Point(last_x - last_out_x, last_y - last_out_y);
+            }
+          }
+          else
+          {
+            out.Put(" M");
+            out.Point(last_x, last_y);
+          }
+          last_op = kFmiMoveTo;
+          last_out_x = last_x;
+          last_out_y = last_y;
+        }
+
+        if (iter == theElements.begin())
+        {
+          out.Put(relative_moves ? "m" : "M");
+          out.Point(x, y);
+        }
+
+        // Relative moves are "m dx dy" and "l dx dy" etc
+        else if (relative_moves)
+        {
+          switch (op)
+          {
+            case kFmiMoveTo:
+              out.Put(last_op == kFmiMoveTo ? " " : " m");
+              break;
+            case kFmiLineTo:
+              out.Put((last_op == kFmiLineTo || last_op == kFmiGhostLineTo) ? " " : " l");
+              break;
+            case kFmiGhostLineTo:
+              if (!removeghostlines)
+                out.Put((last_op == kFmiLineTo || last_op == kFmiGhostLineTo) ? " " : " l");
+              else
+                out.Put(' ');
+              break;
+            case kFmiConicTo:
+              out.Put(last_op == kFmiConicTo ? " " : " q");
+              out_ok = (count_conic > 1);
+              break;
+            case kFmiCubicTo:
+              out.Put(last_op == kFmiCubicTo ? " " : " c");
+              out_ok = (count_conic > 2);
+              break;
+          }
+
+          out.Point(x - last_out_x, y - last_out_y);
+        }
+
+        // Absolute moves are "M x y" and "L x y" etc
+        else
+        {
+          switch (op)
+          {
+            case kFmiMoveTo:
+              out.Put(last_op == kFmiMoveTo ? " " : " M");
+              break;
+            case kFmiLineTo:
+              out.Put((last_op == kFmiLineTo || last_op == kFmiGhostLineTo) ? " " : " L");
+              break;
+            case kFmiGhostLineTo:
+              if (!removeghostlines)
+                out.Put((last_op == kFmiLineTo || last_op == kFmiGhostLineTo) ? " " : " L");
+              else
+                out.Put(' ');
+              break;
+            case kFmiConicTo:
+              out.Put(last_op == kFmiConicTo ? " " : " Q");
+              break;
+            case kFmiCubicTo:
+              out.Put(last_op == kFmiCubicTo ? " " : " C");
+              break;
+          }
+
+          out.Point(x, y);
+        }
+      }
+
+      last_op = op;
+
+      last_x = x;
+      last_y = y;
+      if (out_ok)
+      {
+        last_out_x = x;
+        last_out_y = y;
+      }
+
+      out.Flush(false);
+    }
+
+    if (!removeghostlines && theInsideOut)
+    {
+      if (inside_out_limit != 1e8)
+        throw Fmi::Exception(BCP, "Internal error in NFmiPath inside_out_limit");
+
+      out.Put("M -1e8,-1e8 L -1e8,1e8 L 1e8,1e8 L 1e8,-1e8 Z");
+    }
+
+    out.Flush(true);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Utilities for Simplify. Vertices are identified by their coordinates
+// and edges by their canonically ordered vertices.
+// ----------------------------------------------------------------------
+
+typedef std::pair<double, double> Vertex;
+typedef std::pair<Vertex, Vertex> Edge;
+
+Edge make_edge(const Vertex &theFirst, const Vertex &theSecond)
+{
+  return (theFirst < theSecond ? Edge(theFirst, theSecond) : Edge(theSecond, theFirst));
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Distance of a point from a line segment
+ *
+ * The segment is oriented canonically so that the result is exactly
+ * the same no matter in which direction the segment is traversed.
+ */
+// ----------------------------------------------------------------------
+
+double segment_distance(const Vertex &thePoint, Vertex theStart, Vertex theEnd)
+{
+  if (theEnd < theStart)
+    std::swap(theStart, theEnd);
+
+  const double dx = theEnd.first - theStart.first;
+  const double dy = theEnd.second - theStart.second;
+  const double len2 = dx * dx + dy * dy;
+
+  double t = 0;
+  if (len2 > 0)
+  {
+    t = ((thePoint.first - theStart.first) * dx + (thePoint.second - theStart.second) * dy) / len2;
+    t = std::max(0.0, std::min(1.0, t));
+  }
+
+  return std::hypot(theStart.first + t * dx - thePoint.first,
+                    theStart.second + t * dy - thePoint.second);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Douglas-Peucker simplification of a chain of vertices
+ *
+ * Marks the vertices between the given positions in theChain which
+ * must be kept. The recursion is done using an explicit stack, and
+ * ties are resolved by the coordinates so that the chain traversed
+ * in either direction is simplified identically. The expected time
+ * is O(n log n).
+ */
+// ----------------------------------------------------------------------
+
+void douglas_peucker(const std::vector<Vertex> &theChain,
+                     std::size_t theFirst,
+                     std::size_t theLast,
+                     double theEpsilon,
+                     std::vector<bool> &theKeep)
+{
+  std::vector<std::pair<std::size_t, std::size_t> > stack;
+  stack.emplace_back(theFirst, theLast);
+
+  while (!stack.empty())
+  {
+    const std::size_t first = stack.back().first;
+    const std::size_t last = stack.back().second;
+    stack.pop_back();
+
+    if (last <= first + 1)
+      continue;
+
+    std::size_t best = first + 1;
+    double bestdist = -1;
+    for (std::size_t i = first + 1; i < last; i++)
+    {
+      const double dist = segment_distance(theChain[i], theChain[first], theChain[last]);
+      if (dist > bestdist || (dist == bestdist && theChain[i] < theChain[best]))
+      {
+        best = i;
+        bestdist = dist;
+      }
+    }
+
+    if (bestdist > theEpsilon)
+    {
+      theKeep[best] = true;
+      stack.emplace_back(first, best);
+      stack.emplace_back(best, last);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Simplify one subpath
+ *
+ * The subpath is given as a chain of vertices along with the operation
+ * and the number of occurrences of the edge leading to each vertex, and
+ * the number of occurrences of each vertex. For a closed subpath the
+ * chain is given without the closing vertex, and the edge leading to
+ * the first vertex is the closing edge.
+ *
+ * A vertex is kept if it begins or ends a run of lines of equal type,
+ * or if the edges on its two sides are shared by a different number
+ * of subpaths, or if the vertex is shared by more subpaths than its
+ * edges are. Hence a border shared by two polygons is simplified
+ * identically in both polygons, and the vertices where three or
+ * more polygons meet are kept, which keeps adjacent polygons free
+ * of gaps. A closed subpath is rotated to start from a kept vertex
+ * if there is one.
+ */
+// ----------------------------------------------------------------------
+
+void simplify_subpath(Imagine::NFmiPathData &theOutput,
+                      const std::vector<Vertex> &theChain,
+                      const std::vector<Imagine::NFmiPathOperation> &theOps,
+                      const std::vector<long> &theVertexCounts,
+                      const std::vector<long> &theEdgeCounts,
+                      bool theClosedFlag,
+                      double theEpsilon)
+{
+  using namespace Imagine;
+
+  const std::size_t n = theChain.size();
+
+  std::vector<bool> keep(n, false);
+
+  for (std::size_t i = 0; i < n; i++)
+  {
+    const bool has_prev = (theClosedFlag || i > 0);
+    const bool has_next = (theClosedFlag || i + 1 < n);
+
+    if (!has_prev || !has_next)
+    {
+      keep[i] = true;
+      continue;
+    }
+
+    const std::size_t next = (i + 1 < n ? i + 1 : 0);
+
+    const NFmiPathOperation op1 = theOps[i];
+    const NFmiPathOperation op2 = theOps[next];
+
+    if (op1 != op2 || (op1 != kFmiLineTo && op1 != kFmiGhostLineTo))
+    {
+      keep[i] = true;
+      continue;
+    }
+
+    const long e1 = theEdgeCounts[i];
+    const long e2 = theEdgeCounts[next];
+    keep[i] = (e1 != e2 || theVertexCounts[i] > e1);
+  }
+
+  // Choose the starting vertex. For open subpaths it is always the
+  // first one, for closed ones the first vertex which must be kept.
+  // If there is none, the smallest vertex is used so that an enclave
+  // and the hole it fills start from the same vertex.
+
+  std::size_t start = 0;
+  if (theClosedFlag)
+  {
+    while (start < n && !keep[start])
+      ++start;
+    if (start == n)
+      start = std::min_element(theChain.begin(), theChain.end()) - theChain.begin();
+    keep[start] = true;
+  }
+
+  // Build the chain in traversal order, repeating the start vertex
+  // at the end of closed subpaths
+
+  const std::size_t m = (theClosedFlag ? n + 1 : n);
+  std::vector<std::size_t> order(m);
+  for (std::size_t i = 0; i < m; i++)
+    order[i] = (start + i) % n;
+
+  std::vector<Vertex> chain(m);
+  std::vector<bool> chainkeep(m);
+  for (std::size_t i = 0; i < m; i++)
+  {
+    chain[i] = theChain[order[i]];
+    chainkeep[i] = keep[order[i]];
+  }
+
+  // Simplify between the kept vertices
+
+  std::size_t first = 0;
+  for (std::size_t i = 1; i < m; i++)
+  {
+    if (chainkeep[i])
+    {
+      douglas_peucker(chain, first, i, theEpsilon, chainkeep);
+      first = i;
+    }
+  }
+
+  // And output the result
+
+  for (std::size_t i = 0; i < m; i++)
+  {
+    if (!chainkeep[i])
+      continue;
+    NFmiPathOperation op = theOps[order[i]];
+    if (i == 0 && theClosedFlag)
+      op = kFmiMoveTo;
+    theOutput.push_back(NFmiPathElement(op, chain[i].first, chain[i].second));
+  }
+}
+
+// Paths with fewer points are projected one point at a time, since
+// setting up the transformations would cost more than it saves
+const std::size_t batch_projection_limit = 1000;
+
+// Paths with fewer points are projected in a single thread
+const std::size_t parallel_projection_limit = 100000;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Project the coordinates of a path in large blocks
+ *
+ * The coordinates are first converted using thePrepare and then
+ * transformed from theSource to theTarget spatial reference using as
+ * many threads as is sensible, each with its own transformation since
+ * the transformations are not thread safe. The transformed points
+ * are finished using theFinish, which converts world XY coordinates
+ * to image coordinates or vice versa. Missing points and points which
+ * could not be transformed are passed to theFallback, which is
+ * expected to use the single point NFmiArea API so that such points
+ * are handled exactly as when projecting one point at a time.
+ *
+ * Small paths are projected using theFallback only, since the single
+ * point API uses the transformations cached by the area. The spatial
+ * references are hence requested from theSpatialReferences only when
+ * the path is large enough.
+ */
+// ----------------------------------------------------------------------
+
+template <typename SpatialReferences, typename Prepare, typename Finish, typename Fallback>
+void project_coordinates(Imagine::NFmiPathData &theData,
+                         SpatialReferences theSpatialReferences,
+                         Prepare thePrepare,
+                         Finish theFinish,
+                         Fallback theFallback)
+{
+  try
+  {
+    const std::size_t n = theData.size();
+    if (n == 0)
+      return;
+
+    if (n < batch_projection_limit)
+    {
+      for (std::size_t i = 0; i < n; i++)
+      {
+        NFmiPoint pt = theFallback(NFmiPoint(theData.X(i), theData.Y(i)));
+        theData.X(i, pt.X());
+        theData.Y(i, pt.Y());
+      }
+      return;
+    }
+
+    const Imagine::NFmiPathCoordinate *x0 = theData.XData();
+    const Imagine::NFmiPathCoordinate *y0 = theData.YData();
+
+    // Collect the coordinates. Missing points are replaced by zeros
+    // so that they will not fail the block transformation.
+
+    std::vector<double> xs(n);
+    std::vector<double> ys(n);
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+      if (x0[i] == kFloatMissing || y0[i] == kFloatMissing)
+        xs[i] = ys[i] = 0;
+      else
+      {
+        NFmiPoint pt = thePrepare(NFmiPoint(x0[i], y0[i]));
+        xs[i] = pt.X();
+        ys[i] = pt.Y();
+      }
+    }
+
+    // Transform the blocks. Failed points are set to HUGE_VAL by the
+    // transformation, hence the return value is not needed.
+
+    const std::size_t nthreads =
+        (n < parallel_projection_limit ? 1 : std::max(1u, std::thread::hardware_concurrency()));
+
+    const std::size_t blocksize = (n + nthreads - 1) / nthreads;
+
+    const auto references = theSpatialReferences();
+
+    std::vector<std::unique_ptr<Fmi::CoordinateTransformation>> transformations;
+    for (std::size_t i = 0; i < nthreads; i++)
+      transformations.emplace_back(
+          new Fmi::CoordinateTransformation(references.first, references.second));
+
+    std::vector<std::exception_ptr> errors(nthreads);
+
+    auto worker = [&](std::size_t theBlock)
+    {
+      try
+      {
+        const std::size_t first = theBlock * blocksize;
+        const std::size_t last = std::min(n, first + blocksize);
+        if (first >= last)
+          return;
+        std::vector<double> x(xs.begin() + first, xs.begin() + last);
+        std::vector<double> y(ys.begin() + first, ys.begin() + last);
+        transformations[theBlock]->transform(x, y);
+        std::copy(x.begin(), x.end(), xs.begin() + first);
+        std::copy(y.begin(), y.end(), ys.begin() + first);
+      }
+      catch (...)
+      {
+        errors[theBlock] = std::current_exception();
+      }
+    };
+
+    // Should starting a thread fail, the started ones must be joined
+    // before the exception is passed on
+
+    std::vector<std::thread> threads;
+    try
+    {
+      for (std::size_t block = 1; block < nthreads; block++)
+        threads.emplace_back(worker, block);
+    }
+    catch (...)
+    {
+      for (std::thread &t : threads)
+        t.join();
+      throw;
+    }
+
+    worker(0);
+
+    for (std::thread &t : threads)
+      t.join();
+
+    for (const auto &error : errors)
+      if (error)
+        std::rethrow_exception(error);
+
+    // Store the results
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+      NFmiPoint pt;
+      if (x0[i] == kFloatMissing || y0[i] == kFloatMissing || !std::isfinite(xs[i]) ||
+          !std::isfinite(ys[i]))
+        pt = theFallback(NFmiPoint(x0[i], y0[i]));
+      else
+        pt = theFinish(NFmiPoint(xs[i], ys[i]));
+      theData.X(i, pt.X());
+      theData.Y(i, pt.Y());
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Split paths at the seam of a Pacific or Atlantic view
+ *
+ * The subpaths are processed one at a time. Subpaths which do not
+ * cross the seam are copied to the output directly, possibly shifted
+ * by 360 degrees. Other subpaths are cut at the seam into open chains,
+ * and vertical lines at the old dateline are dropped so that polygons
+ * split at the dateline are merged back together. The chains are
+ * closed in Finish using seam segments between consecutive cut
+ * latitudes and by joining chains with matching end points.
+ *
+ * In a Pacific view the seam is at longitude 0, negative longitudes
+ * are shifted by +360 and the dateline is at -180 and 180. In an
+ * Atlantic view the seam is at longitude 180, longitudes above it are
+ * shifted by -360 and the dateline is at 0 and 360.
+ */
+// ----------------------------------------------------------------------
+
+class DatelineSplitter
+{
+ public:
+  explicit DatelineSplitter(bool thePacific)
+      : itsPacific(thePacific), itsShift(thePacific ? 360 : -360), itsSeam(thePacific ? 0 : 180)
+  {
+  }
+
+  void Add(const Imagine::NFmiPathData &theElements,
+           std::size_t theBegin,
+           std::size_t theEnd,
+           Imagine::NFmiPath &theOutput);
+
+  void Finish(Imagine::NFmiPath &theOutput);
+
+ private:
+  typedef std::pair<float, float> Key;
+
+  // Is the longitude on the side to be shifted
+  bool Shifted(double theX) const { return itsPacific ? theX < 0 : theX > 180; }
+
+  // The longitude in the new view
+  double Map(double theX) const { return Shifted(theX) ? theX + itsShift : theX; }
+
+  // The longitude of the seam on the given side in the new view
+  double SeamX(bool theShifted) const
+  {
+    if (itsPacific)
+      return theShifted ? 360 : 0;
+    return theShifted ? -180 : 180;
+  }
+
+  bool OnDateLine(double theX) const
+  {
+    if (itsPacific)
+      return theX == -180 || theX == 180;
+    return theX == 0 || theX == 360;
+  }
+
+  void Put(Imagine::NFmiPathOperation theOp, double theX, double theY);
+  void Break(double theX, double theY);
+  void EndChain();
+  void Emit(Imagine::NFmiPath &theOutput, std::size_t theChain, bool theReverse, bool theFirst);
+
+  std::size_t ChainBegin(std::size_t theChain) const { return itsStarts[theChain]; }
+  std::size_t ChainEnd(std::size_t theChain) const
+  {
+    return (theChain + 1 < itsStarts.size() ? itsStarts[theChain + 1] : itsChains.size());
+  }
+  Key PointKey(std::size_t thePos) const
+  {
+    return Key(static_cast<float>(itsChains.X(thePos)), static_cast<float>(itsChains.Y(thePos)));
+  }
+
+  bool itsPacific;
+  double itsShift;
+  double itsSeam;
+
+  Imagine::NFmiPathData itsHead;       // start of the current subpath up to its first cut
+  bool itsInHead = true;               // still collecting itsHead?
+  Imagine::NFmiPathData itsChains;     // open chains, each starting with a moveto
+  std::vector<std::size_t> itsStarts;  // start positions of the chains
+  std::vector<double> itsCuts;         // latitudes where the seam was crossed
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Append a point to the current chain
+ */
+// ----------------------------------------------------------------------
+
+void DatelineSplitter::Put(Imagine::NFmiPathOperation theOp, double theX, double theY)
+{
+  if (itsInHead)
+    itsHead.push_back(Imagine::NFmiPathElement(theOp, theX, theY));
+  else
+    itsChains.push_back(Imagine::NFmiPathElement(theOp, theX, theY));
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief End the current chain and start a new one at the given point
+ */
+// ----------------------------------------------------------------------
+
+void DatelineSplitter::Break(double theX, double theY)
+{
+  if (itsInHead)
+    itsInHead = false;
+  else
+    EndChain();
+  itsStarts.push_back(itsChains.size());
+  itsChains.push_back(Imagine::NFmiPathElement(Imagine::kFmiMoveTo, theX, theY));
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Discard the last chain if it consists of a single point
+ */
+// ----------------------------------------------------------------------
+
+void DatelineSplitter::EndChain()
+{
+  if (!itsStarts.empty() && itsChains.size() - itsStarts.back() < 2)
+  {
+    itsChains.pop_back();
+    itsStarts.pop_back();
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Process the subpath theElements[theBegin,theEnd)
+ */
+// ----------------------------------------------------------------------
+
+void DatelineSplitter::Add(const Imagine::NFmiPathData &theElements,
+                           std::size_t theBegin,
+                           std::size_t theEnd,
+                           Imagine::NFmiPath &theOutput)
+{
+  using namespace Imagine;
+
+  try
+  {
+    if (theBegin >= theEnd)
+      return;
+
+    // Find the longitude range and whether the dateline is touched
+
+    double xmin = theElements.X(theBegin);
+    double xmax = xmin;
+    bool dateline = false;
+    for (std::size_t i = theBegin; i < theEnd; i++)
+    {
+      const double x = theElements.X(i);
+      xmin = std::min(xmin, x);
+      xmax = std::max(xmax, x);
+      dateline |= OnDateLine(x);
+    }
+
+    // Note: In an Atlantic view we require xmin to be >=0 in the easy cases
+    // since some paths may look Pacific even though the coordinates are not.
+    // Example: Chuchki data
+
+    if (!dateline)
+    {
+      const bool unchanged = (itsPacific ? xmin >= 0 : xmin >= 0 && xmax <= 180);
+      const bool shifted = (itsPacific ? xmax < 0 : xmin >= 180);
+      if (unchanged || shifted)
+      {
+        const double dx = (unchanged ? 0 : itsShift);
+        for (std::size_t i = theBegin; i < theEnd; i++)
+          theOutput.Add(theElements.Op(i), theElements.X(i) + dx, theElements.Y(i));
+        return;
+      }
+    }
+
+    // Cut the subpath at the seam. Vertical lines at the dateline are
+    // omitted except near the poles, where they are needed to include
+    // the poles themselves in the path.
+
+    itsHead.clear();
+    itsInHead = true;
+
+    double lastX = theElements.X(theBegin);
+    double lastY = theElements.Y(theBegin);
+    Put(kFmiMoveTo, Map(lastX), lastY);
+
+    for (std::size_t i = theBegin + 1; i < theEnd; i++)
+    {
+      const double X = theElements.X(i);
+      const double Y = theElements.Y(i);
+      const NFmiPathOperation op = theElements.Op(i);
+
+      if (OnDateLine(lastX) && OnDateLine(X) && lastY > -80 && lastY < 75 && Y > -80 &&
+          Y < 75)  // works for the Antarctic and Chukotski Peninsula
+      {
+        Break(Map(X), Y);
+      }
+      else
+      {
+        const bool lastShifted = Shifted(lastX);
+        const bool shifted = Shifted(X);
+
+        // Atlantic views may contain lines longer than half the world which
+        // cross the seam at -180/180 instead of passing through Greenwich
+
+        const bool wrap = (!itsPacific && !lastShifted && !shifted &&
+                           ((lastX < -90 && X > 90) || (lastX > 90 && X < -90)));
+
+        if (lastShifted == shifted && !wrap)
+          Put(op, Map(X), Y);
+        else
+        {
+          double s = 0;
+          double x1 = SeamX(lastShifted);
+          double x2 = SeamX(shifted);
+          if (!wrap)
+            s = (itsSeam - lastX) / (X - lastX);
+          else if (lastX < X)
+          {
+            s = (180 - (lastX + 360)) / (X - (lastX + 360));
+            x1 = -180;
+            x2 = 180;
+          }
+          else
+          {
+            s = (180 - lastX) / (X + 360 - lastX);
+            x1 = 180;
+            x2 = -180;
+          }
+
+          const double ymid = (s <= 0 ? lastY : (s >= 1 ? Y : lastY + s * (Y - lastY)));
+
+          if (s > 0)
+            Put(op, x1, ymid);
+          Break(x2, ymid);
+          if (s < 1)
+            Put(op, Map(X), Y);
+          itsCuts.push_back(ymid);
+        }
+      }
+      lastX = X;
+      lastY = Y;
+    }
+
+    // An uncut subpath can be output as is
+
+    if (itsInHead)
+    {
+      for (std::size_t i = 0; i < itsHead.size(); i++)
+        theOutput.Add(itsHead[i]);
+      return;
+    }
+
+    // Otherwise the start of a closed subpath continues the last chain
+
+    if (!itsHead.empty())
+    {
+      const std::size_t last = itsChains.size() - 1;
+      if (itsHead.X(0) == itsChains.X(last) && itsHead.Y(0) == itsChains.Y(last))
+      {
+        for (std::size_t i = 1; i < itsHead.size(); i++)
+          itsChains.push_back(itsHead[i]);
+      }
+      else
+      {
+        EndChain();
+        itsStarts.push_back(itsChains.size());
+        for (std::size_t i = 0; i < itsHead.size(); i++)
+          itsChains.push_back(itsHead[i]);
+      }
+    }
+    EndChain();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Output a chain, skipping the first point unless theFirst is true
+ */
+// ----------------------------------------------------------------------
+
+void DatelineSplitter::Emit(Imagine::NFmiPath &theOutput,
+                            std::size_t theChain,
+                            bool theReverse,
+                            bool theFirst)
+{
+  using namespace Imagine;
+
+  const std::size_t begin = ChainBegin(theChain);
+  const std::size_t end = ChainEnd(theChain);
+
+  if (theFirst)
+  {
+    const std::size_t pos = (theReverse ? end - 1 : begin);
+    theOutput.Add(kFmiMoveTo, itsChains.X(pos), itsChains.Y(pos));
+  }
+
+  // When reversed the operation of a point is that of the following point
+
+  if (!theReverse)
+  {
+    for (std::size_t i = begin + 1; i < end; i++)
+      theOutput.Add(itsChains.Op(i), itsChains.X(i), itsChains.Y(i));
+  }
+  else
+  {
+    for (std::size_t i = end - 1; i > begin; i--)
+      theOutput.Add(itsChains.Op(i), itsChains.X(i - 1), itsChains.Y(i - 1));
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Close the cut chains and output them
+ *
+ * The seam crossings are sorted by latitude and consecutive pairs are
+ * connected by seam segments on both sides of the view. The chains are
+ * then joined at their end points, which are compared in single
+ * precision just like in NFmiEdgeTree. Only the chain end points are
+ * searched, hence the cost is independent of the number of vertices.
+ */
+// ----------------------------------------------------------------------
+
+void DatelineSplitter::Finish(Imagine::NFmiPath &theOutput)
 {
+  using namespace Imagine;
+
   try
   {
-    return NFmiValueString::GetStringWithMaxDecimalsSmartWay(value, precision).CharPtr();
+    // Add the seam segments
+
+    std::sort(itsCuts.begin(), itsCuts.end());
+    for (std::size_t i = 0; i + 1 < itsCuts.size(); i += 2)
+    {
+      if (itsCuts[i] == itsCuts[i + 1])
+        continue;
+      for (bool shifted : {false, true})
+      {
+        itsStarts.push_back(itsChains.size());
+        itsChains.push_back(NFmiPathElement(kFmiMoveTo, SeamX(shifted), itsCuts[i]));
+        itsChains.push_back(NFmiPathElement(kFmiLineTo, SeamX(shifted), itsCuts[i + 1]));
+      }
+    }
+
+    // Sorted chain end points. The index is 2*chain for the first point
+    // and 2*chain+1 for the last one.
+
+    const std::size_t n = itsStarts.size();
+    std::vector<std::pair<Key, std::size_t>> ends;
+    ends.reserve(2 * n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+      ends.push_back(std::make_pair(PointKey(ChainBegin(i)), 2 * i));
+      ends.push_back(std::make_pair(PointKey(ChainEnd(i) - 1), 2 * i + 1));
+    }
+    std::sort(ends.begin(), ends.end());
+
+    std::vector<bool> used(n, false);
+
+    // Find an unused chain with an end point at the given position
+
+    auto find = [&](const Key &theKey) -> std::size_t
+    {
+      auto it = std::lower_bound(
+          ends.begin(), ends.end(), std::make_pair(theKey, static_cast<std::size_t>(0)));
+      for (; it != ends.end() && it->first == theKey; ++it)
+        if (!used[it->second / 2])
+          return it->second;
+      return 2 * n;
+    };
+
+    // Join the chains into as long sequences as possible
+
+    std::deque<std::pair<std::size_t, bool>> sequence;  // chains and reverse flags
+
+    for (std::size_t chain = 0; chain < n; chain++)
+    {
+      if (used[chain])
+        continue;
+      used[chain] = true;
+
+      sequence.clear();
+      sequence.push_back(std::make_pair(chain, false));
+      Key head = PointKey(ChainBegin(chain));
+      Key tail = PointKey(ChainEnd(chain) - 1);
+
+      while (head != tail)
+      {
+        const std::size_t pos = find(tail);
+        if (pos == 2 * n)
+          break;
+        const std::size_t next = pos / 2;
+        const bool reverse = (pos % 2 == 1);
+        used[next] = true;
+        sequence.push_back(std::make_pair(next, reverse));
+        tail = PointKey(reverse ? ChainBegin(next) : ChainEnd(next) - 1);
+      }
+
+      while (head != tail)
+      {
+        const std::size_t pos = find(head);
+        if (pos == 2 * n)
+          break;
+        const std::size_t next = pos / 2;
+        const bool reverse = (pos % 2 == 0);
+        used[next] = true;
+        sequence.push_front(std::make_pair(next, reverse));
+        head = PointKey(reverse ? ChainEnd(next) - 1 : ChainBegin(next));
+      }
+
+      bool first = true;
+      for (const auto &item : sequence)
+      {
+        Emit(theOutput, item.first, item.second, first);
+        first = false;
+      }
+    }
+
+    itsChains.clear();
+    itsStarts.clear();
+    itsCuts.clear();
   }
   catch (...)
   {
@@ -84,6 +1213,164 @@ std::string numstring(double value, int precision)
   }
 }
 
+// ----------------------------------------------------------------------
+/*!
+ * \brief A vertex being clipped by Clip(const NFmiArea *)
+ *
+ * The coordinates are projected XY coordinates. The index refers to
+ * the original path element, or is clip_new_vertex for vertices
+ * created by the clipping.
+ */
+// ----------------------------------------------------------------------
+
+struct ClipVertex
+{
+  double x;
+  double y;
+  std::size_t index;
+  Imagine::NFmiPathOperation op;
+};
+
+const std::size_t clip_new_vertex = static_cast<std::size_t>(-1);
+
+// The sides of the clipping rectangle
+
+enum ClipSide
+{
+  kClipLeft,
+  kClipRight,
+  kClipTop,
+  kClipBottom
+};
+
+bool clip_inside(const ClipVertex &theVertex, ClipSide theSide, double theLimit)
+{
+  switch (theSide)
+  {
+    case kClipLeft:
+      return theVertex.x >= theLimit;
+    case kClipRight:
+      return theVertex.x <= theLimit;
+    case kClipTop:
+      return theVertex.y >= theLimit;
+    case kClipBottom:
+      return theVertex.y <= theLimit;
+  }
+  return false;
+}
+
+ClipVertex clip_intersection(const ClipVertex &theFirst,
+                             const ClipVertex &theSecond,
+                             ClipSide theSide,
+                             double theLimit,
+                             Imagine::NFmiPathOperation theOp)
+{
+  ClipVertex vertex;
+  vertex.index = clip_new_vertex;
+  vertex.op = theOp;
+  if (theSide == kClipLeft || theSide == kClipRight)
+  {
+    const double s = (theLimit - theFirst.x) / (theSecond.x - theFirst.x);
+    vertex.x = theLimit;
+    vertex.y = theFirst.y + s * (theSecond.y - theFirst.y);
+  }
+  else
+  {
+    const double s = (theLimit - theFirst.y) / (theSecond.y - theFirst.y);
+    vertex.x = theFirst.x + s * (theSecond.x - theFirst.x);
+    vertex.y = theLimit;
+  }
+  return vertex;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Clip a closed ring against one side of the clipping rectangle
+ *
+ * One pass of the Sutherland-Hodgman algorithm. The input ring is
+ * implicitly closed from its last vertex to the first one. The op of
+ * each vertex describes the edge ending at it. Edges running along the
+ * clipping boundary are ghost lines so that the clipped polygons are
+ * filled correctly but the boundary is not stroked.
+ */
+// ----------------------------------------------------------------------
+
+void clip_ring(const std::vector<ClipVertex> &theInput,
+               std::vector<ClipVertex> &theOutput,
+               ClipSide theSide,
+               double theLimit)
+{
+  theOutput.clear();
+  if (theInput.empty())
+    return;
+
+  const ClipVertex *prev = &theInput.back();
+  bool previnside = clip_inside(*prev, theSide, theLimit);
+
+  for (const ClipVertex &vertex : theInput)
+  {
+    const bool inside = clip_inside(vertex, theSide, theLimit);
+    if (inside)
+    {
+      if (!previnside)
+        theOutput.push_back(
+            clip_intersection(*prev, vertex, theSide, theLimit, Imagine::kFmiGhostLineTo));
+      theOutput.push_back(vertex);
+    }
+    else if (previnside)
+      theOutput.push_back(clip_intersection(*prev, vertex, theSide, theLimit, vertex.op));
+
+    prev = &vertex;
+    previnside = inside;
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test whether a line segment intersects a rectangle
+ *
+ * Liang-Barsky parametric clipping without computing the clipped
+ * segment itself.
+ */
+// ----------------------------------------------------------------------
+
+bool segment_intersects(double theX1,
+                        double theY1,
+                        double theX2,
+                        double theY2,
+                        double theXmin,
+                        double theYmin,
+                        double theXmax,
+                        double theYmax)
+{
+  const double dx = theX2 - theX1;
+  const double dy = theY2 - theY1;
+  const double p[4] = {-dx, dx, -dy, dy};
+  const double q[4] = {theX1 - theXmin, theXmax - theX1, theY1 - theYmin, theYmax - theY1};
+
+  double t0 = 0;
+  double t1 = 1;
+  for (int i = 0; i < 4; i++)
+  {
+    if (p[i] == 0)
+    {
+      if (q[i] < 0)
+        return false;
+    }
+    else
+    {
+      const double t = q[i] / p[i];
+      if (p[i] < 0)
+        t0 = std::max(t0, t);
+      else
+        t1 = std::min(t1, t);
+      if (t0 > t1)
+        return false;
+    }
+  }
+  return true;
+}
+
 }  // anonymous namespace
 
 namespace Imagine
@@ -169,11 +1456,11 @@ void NFmiPath::AddReverse(const NFmiPath &thePath, bool fExact)
 
     // Iterate
 
-    NFmiPathData::const_reverse_iterator iter = thePath.itsElements.rbegin();
-    for (; iter != thePath.itsElements.rend(); ++iter)
+    const NFmiPathData &elements = thePath.itsElements;
+    for (NFmiPathData::size_type i = elements.size(); i > 0; --i)
     {
-      Add(op, iter->x, iter->y);
-      op = iter->op;
+      Add(op, elements.X(i - 1), elements.Y(i - 1));
+      op = elements.Op(i - 1);
     }
   }
   catch (...)
@@ -192,14 +1479,13 @@ void NFmiPath::DoCloseLineTo(NFmiPathOperation theOper)
 {
   try
   {
-    NFmiPathData::reverse_iterator iter;
-    for (iter = itsElements.rbegin(); iter != itsElements.rend(); ++iter)
+    for (NFmiPathData::size_type i = itsElements.size(); i > 0; --i)
     {
-      if (iter->op == kFmiMoveTo)
+      if (itsElements.Op(i - 1) == kFmiMoveTo)
       {
         // The element to be added
 
-        NFmiPathElement tmp(theOper, iter->x, iter->y);
+        NFmiPathElement tmp(theOper, itsElements.X(i - 1), itsElements.Y(i - 1));
 
         // Don't add if the last element is exactly the same
 
@@ -383,6 +1669,11 @@ void NFmiPath::Add(const string &theString)
 // into a ghostline, we must simplify the line part and the ghostline
 // parts separately. Similarly a moveto *always* acts as a separator
 // of different paths to be simplified.
+//
+// Vertices where the sharing of edges between subpaths changes are
+// never removed, and shared edges are simplified identically in all
+// subpaths. Hence adjacent polygons such as national borders remain
+// free of gaps.
 // ----------------------------------------------------------------------
 
 void NFmiPath::Simplify(double epsilon)
@@ -392,22 +1683,85 @@ void NFmiPath::Simplify(double epsilon)
     if (epsilon < 0.0)
       return;
 
+    const size_t n = itsElements.size();
+
+    // Split into subpaths starting with a moveto
+
+    vector<size_t> subpaths;
+    for (size_t i = 0; i < n; i++)
+      if (i == 0 || itsElements.Op(i) == kFmiMoveTo)
+        subpaths.push_back(i);
+    subpaths.push_back(n);
+
+    // Closed subpaths are handled cyclically, their closing vertex
+    // is not counted as a separate vertex
+
+    auto closed = [this](size_t first, size_t last)
+    {
+      return (last - first >= 4 && itsElements.Op(first) == kFmiMoveTo &&
+              itsElements.X(first) == itsElements.X(last - 1) &&
+              itsElements.Y(first) == itsElements.Y(last - 1));
+    };
+
+    auto vertex = [this](size_t i) { return Vertex(itsElements.X(i), itsElements.Y(i)); };
+
+    // A line edge leads to each lineto and ghostlineto following a linear element
+
+    auto is_edge = [this](size_t i)
+    {
+      const NFmiPathOperation op = itsElements.Op(i);
+      const NFmiPathOperation prev = itsElements.Op(i - 1);
+      return ((op == kFmiLineTo || op == kFmiGhostLineTo) && prev != kFmiConicTo &&
+              prev != kFmiCubicTo);
+    };
+
     // Count the important points
 
-    NFmiCounter<pair<double, double> > counter;
+    NFmiCounter<Vertex> counter;
+    counter.Reserve(n);
 
-    NFmiPathData::const_iterator iter;
-    for (iter = Elements().begin(); iter != Elements().end(); ++iter)
+    for (size_t k = 0; k + 1 < subpaths.size(); k++)
     {
-      switch (iter->op)
+      const size_t first = subpaths[k];
+      const size_t last = subpaths[k + 1];
+      const size_t end = (closed(first, last) ? last - 1 : last);
+
+      for (size_t i = first; i < end; i++)
       {
-        case kFmiMoveTo:
-        case kFmiLineTo:
-        case kFmiGhostLineTo:
-          counter.Add(make_pair(iter->x, iter->y));
-          break;
-        default:
-          break;
+        switch (itsElements.Op(i))
+        {
+          case kFmiMoveTo:
+          case kFmiLineTo:
+          case kFmiGhostLineTo:
+            counter.Add(vertex(i));
+            break;
+          default:
+            break;
+        }
+      }
+    }
+
+    vector<long> vertexcounts(n);
+    for (size_t i = 0; i < n; i++)
+      vertexcounts[i] = counter.Count(vertex(i));
+
+    // Count the edges between shared vertices. An edge with an unshared
+    // vertex occurs only once, hence it need not be counted.
+
+    NFmiCounter<Edge> edgecounter;
+    for (size_t i = 1; i < n; i++)
+      if (vertexcounts[i - 1] > 1 && vertexcounts[i] > 1 && is_edge(i))
+        edgecounter.Add(make_edge(vertex(i - 1), vertex(i)));
+
+    vector<long> edgecounts(n, 0);
+    for (size_t i = 1; i < n; i++)
+    {
+      if (is_edge(i))
+      {
+        if (vertexcounts[i - 1] > 1 && vertexcounts[i] > 1)
+          edgecounts[i] = edgecounter.Count(make_edge(vertex(i - 1), vertex(i)));
+        else
+          edgecounts[i] = 1;
       }
     }
 
@@ -415,6 +1769,48 @@ void NFmiPath::Simplify(double epsilon)
     //
     // a) Optional one moveto + lineto's
     // b) Optional one moveto + ghostlineto's
+
+    NFmiPathData result;
+    result.reserve(n);
+
+    vector<Vertex> chain;
+    vector<NFmiPathOperation> ops;
+    vector<long> chainvertexcounts;
+    vector<long> chainedgecounts;
+
+    for (size_t k = 0; k + 1 < subpaths.size(); k++)
+    {
+      const size_t first = subpaths[k];
+      const size_t last = subpaths[k + 1];
+      const bool closedflag = closed(first, last);
+      const size_t end = (closedflag ? last - 1 : last);
+
+      chain.clear();
+      ops.clear();
+      chainvertexcounts.clear();
+      chainedgecounts.clear();
+
+      for (size_t i = first; i < end; i++)
+      {
+        chain.push_back(vertex(i));
+        ops.push_back(itsElements.Op(i));
+        chainvertexcounts.push_back(vertexcounts[i]);
+        chainedgecounts.push_back(i > first ? edgecounts[i] : 0);
+      }
+
+      // The first vertex of a closed subpath is reached by the closing edge
+      if (closedflag)
+      {
+        ops[0] = itsElements.Op(last - 1);
+        chainedgecounts[0] = edgecounts[last - 1];
+      }
+
+      simplify_subpath(
+          result, chain, ops, chainvertexcounts, chainedgecounts, closedflag, epsilon);
+    }
+
+    result.shrink_to_fit();
+    itsElements.swap(result);
   }
   catch (...)
   {
@@ -430,16 +1826,12 @@ void NFmiPath::Translate(double theX, double theY)
 {
   try
   {
-    NFmiPathData::iterator iter;
-
-    for (iter = itsElements.begin(); iter != itsElements.end(); ++iter)
-    {
-      iter->x += theX;
-      iter->y += theY;
-
-      //(*iter).X((*iter).X()+theX);	// X += theX
-      //(*iter).Y((*iter).Y()+theY);	// Y += theY
-    }
+    itsElements.Transform(
+        [theX, theY](double &x, double &y)
+        {
+          x += theX;
+          y += theY;
+        });
   }
   catch (...)
   {
@@ -471,16 +1863,12 @@ void NFmiPath::Scale(double theXScale, double theYScale)
 {
   try
   {
-    NFmiPathData::iterator iter;
-
-    for (iter = itsElements.begin(); iter != itsElements.end(); ++iter)
-    {
-      iter->x *= theXScale;
-      iter->y *= theYScale;
-
-      //(*iter).X((*iter).X()*theXScale);
-      //(*iter).Y((*iter).Y()*theYScale);
-    }
+    itsElements.Transform(
+        [theXScale, theYScale](double &x, double &y)
+        {
+          x *= theXScale;
+          y *= theYScale;
+        });
   }
   catch (...)
   {
@@ -498,18 +1886,16 @@ void NFmiPath::Rotate(double theAngle)
   {
     const double pi = 3.14159265358979f;
 
-    NFmiPathData::iterator iter;
-
     double cosa = cos(theAngle * pi / 180);
     double sina = sin(theAngle * pi / 180);
 
-    for (iter = itsElements.begin(); iter != itsElements.end(); ++iter)
-    {
-      double x = iter->x;
-      double y = iter->y;
-      iter->x = x * cosa + y * sina;
-      iter->y = -x * sina + y * cosa;
-    }
+    itsElements.Transform(
+        [cosa, sina](double &x, double &y)
+        {
+          const double x0 = x;
+          x = x0 * cosa + y * sina;
+          y = -x0 * sina + y * cosa;
+        });
   }
   catch (...)
   {
@@ -524,15 +1910,12 @@ void NFmiPath::Rotate(double theAngle)
 #if 0
   void NFmiPath::Transform(NFmiAffine & theAffine)
   {
-	NFmiPathData::iterator iter;
-	
-	for(iter=itsElements.begin(); iter!=itsElements.end(); ++iter)
+	itsElements.Transform([&theAffine](double &x, double &y)
 	  {
-		double x = iter->x;
-		double y = iter->y;
-		iter->x= theAffine.X( x,y );
-		iter->y= theAffine.Y( x,y );
-	  }
+		const double x0 = x;
+		x = theAffine.X( x0,y );
+		y = theAffine.Y( x0,y );
+	  });
   }
 #endif
 
@@ -584,13 +1967,16 @@ void NFmiPath::Project(const NFmiArea *const theArea)
       itsElements.swap(p.itsElements);
     }
 
-    NFmiPathData::iterator iter;
-    for (iter = itsElements.begin(); iter != itsElements.end(); ++iter)
-    {
-      NFmiPoint pt = theArea->ToXY(NFmiPoint(iter->x, iter->y));
-      iter->x = pt.X();
-      iter->y = pt.Y();
-    }
+    // Equivalent to calling ToXY for each point, but the geographic
+    // transformations are done in large blocks
+
+    project_coordinates(
+        itsElements,
+        [theArea]
+        { return std::make_pair(Fmi::SpatialReference("WGS84"), theArea->SpatialReference()); },
+        [](const NFmiPoint &theLatLon) { return theLatLon; },
+        [theArea](const NFmiPoint &theWorldXY) { return theArea->WorldXYToXY(theWorldXY); },
+        [theArea](const NFmiPoint &theLatLon) { return theArea->ToXY(theLatLon); });
   }
   catch (...)
   {
@@ -608,13 +1994,15 @@ void NFmiPath::InvProject(const NFmiArea *const theArea)
   {
     if (theArea != 0)
     {
-      NFmiPathData::iterator iter;
-      for (iter = itsElements.begin(); iter != itsElements.end(); ++iter)
-      {
-        NFmiPoint pt = theArea->ToLatLon(NFmiPoint(iter->x, iter->y));
-        iter->x = pt.X();
-        iter->y = pt.Y();
-      }
+      // Equivalent to calling ToLatLon for each point
+
+      project_coordinates(
+          itsElements,
+          [theArea]
+          { return std::make_pair(theArea->SpatialReference(), Fmi::SpatialReference("WGS84")); },
+          [theArea](const NFmiPoint &theXY) { return theArea->XYToWorldXY(theXY); },
+          [](const NFmiPoint &theLatLon) { return theLatLon; },
+          [theArea](const NFmiPoint &theXY) { return theArea->ToLatLon(theXY); });
     }
   }
   catch (...)
@@ -633,13 +2021,13 @@ void NFmiPath::InvGrid(const NFmiGrid *const theGrid)
   {
     if (theGrid != 0)
     {
-      NFmiPathData::iterator iter;
-      for (iter = itsElements.begin(); iter != itsElements.end(); ++iter)
-      {
-        NFmiPoint pt = theGrid->GridToLatLon(iter->x, iter->y);
-        iter->x = pt.X();
-        iter->y = pt.Y();
-      }
+      itsElements.Transform(
+          [theGrid](double &x, double &y)
+          {
+            NFmiPoint pt = theGrid->GridToLatLon(x, y);
+            x = pt.X();
+            y = pt.Y();
+          });
     }
   }
   catch (...)
@@ -666,20 +2054,38 @@ NFmiEsriBox NFmiPath::BoundingBox() const
     }
     else
     {
-      NFmiPathData::const_iterator iter;
+      // All operations contribute to the box, hence only the coordinates are needed.
+      // Use the subpath boxes if they are available.
 
-      for (iter = itsElements.begin(); iter != itsElements.end(); ++iter)
+      const NFmiPathData::size_type n = itsElements.size();
+      if (itsElements.HasBoxes())
       {
-        switch (iter->op)
+        for (const NFmiPathData::SubpathBox &b : itsElements.Boxes())
         {
-          case kFmiMoveTo:
-          case kFmiLineTo:
-          case kFmiGhostLineTo:
-          case kFmiConicTo:
-          case kFmiCubicTo:
-            box.Update(iter->x, iter->y);
-            break;
+          box.Update(b.xmin, b.ymin);
+          box.Update(b.xmax, b.ymax);
+        }
+      }
+      else if (n > 0)
+      {
+        const NFmiPathCoordinate *xs = itsElements.XData();
+        const NFmiPathCoordinate *ys = itsElements.YData();
+
+        double minx = xs[0];
+        double miny = ys[0];
+        double maxx = minx;
+        double maxy = miny;
+
+        for (NFmiPathData::size_type i = 1; i < n; i++)
+        {
+          minx = min(minx, static_cast<double>(xs[i]));
+          miny = min(miny, static_cast<double>(ys[i]));
+          maxx = max(maxx, static_cast<double>(xs[i]));
+          maxy = max(maxy, static_cast<double>(ys[i]));
         }
+
+        box.Update(minx, miny);
+        box.Update(maxx, maxy);
       }
     }
     return box;
@@ -710,8 +2116,8 @@ void NFmiPath::SimplifyLines(double theOffset)
 {
   try
   {
-    NFmiPathData::iterator iter = itsElements.begin();
-    NFmiPathData::iterator end = itsElements.end();
+    NFmiPathData::const_iterator iter = itsElements.begin();
+    NFmiPathData::const_iterator end = itsElements.end();
 
     NFmiPathData newelements;
 
@@ -832,208 +2238,42 @@ std::ostream &operator<<(std::ostream &os, const NFmiPath &thePath)
       else if (iter->op == kFmiLineTo)
         os << 'L';
       else if (iter->op == kFmiGhostLineTo)
-        os << 'G';
-      else if (iter->op == kFmiConicTo)
-        os << 'Q';
-      else if (iter->op == kFmiCubicTo)
-        os << 'C';
-      else
-        os << '?';
-
-      os << iter->x << "," << iter->y;
-    }
-    return os;
-  }
-  catch (...)
-  {
-    throw Fmi::Exception::Trace(BCP, "Operation failed!");
-  }
-}
-
-// ----------------------------------------------------------------------
-// Return a SVG-string representation of the path
-// If relative_moves=true, relative movements are preferred over
-// absolute moves. This usually generates shorter SVG.
-// Tulostetaan polku vain kolmen desimaalin tarkkuudella (kaksi desimaali
-// ei riitt�nyt, kun tuli pieni v�li maiden v�lille?).
-// ----------------------------------------------------------------------
-
-string NFmiPath::SVG(bool relative_moves, bool removeghostlines) const
-{
-  try
-  {
-    // Note: Do NOT use output string streams, atleast not with
-    //       g++ v2.92. The implementation is broken, and will
-    //       mess up the output string. Instead we reserve a reasonable
-    //       amount of space for the string from the beginning in the
-    //       hope that output will be reasonably fast.
-
-    string os;
-
-    double last_x, last_y;
-    double last_out_x, last_out_y;
-    NFmiPathOperation last_op = kFmiMoveTo;
-
-    last_x = last_y = kFloatMissing;
-    last_out_x = last_out_y = kFloatMissing;
-
-    int count_conic = 0;
-    int count_cubic = 0;
-
-    NFmiPathData::const_iterator iter = Elements().begin();
-
-    for (; iter != Elements().end(); ++iter)
-    {
-#ifdef _MSC_VER  // MSVC:n stringi on paska kun se t�yttyy ei sit� kasvateta tarpeeksi
-      if (os.size() > 0.9 * os.capacity())
-        os.reserve(os.size() * 2);
-#endif
-      const double x = iter->x;
-      const double y = iter->y;
-      const NFmiPathOperation op = iter->op;
-
-      switch (op)
-      {
-        case kFmiConicTo:
-          count_cubic = 0;
-          count_conic++;
-          break;
-        case kFmiCubicTo:
-          count_conic = 0;
-          count_cubic++;
-          break;
-        default:
-          count_conic = 0;
-          count_cubic = 0;
-      }
-
-      // Special code for first move
-
-      bool out_ok = true;
-      if (removeghostlines && op == kFmiGhostLineTo)
-      {
-        out_ok = false;
-      }
-      else
-      {
-        // If ghostlines are being ignored, we must output a moveto
-        // when the ghostlines end and next operation is not moveto
-        if (removeghostlines && (last_op == kFmiGhostLineTo) &&
-            (op != kFmiGhostLineTo && op != kFmiMoveTo))
-        {
-          if (relative_moves)
-          {
-            if (last_out_x == kFloatMissing && last_out_y == kFloatMissing)
-            {
-              os += 'm';
-              os += numstring(last_x, 3) + string(",");
-              os += numstring(last_y, 3);
-            }
-            else
-            {
-              os += " m";
-              os += numstring(last_x - last_out_x, 3) + string(",");
-              os += numstring(last_y - last_out_y, 3);
-            }
-          }
-          else
-          {
-            os += " M";
-            os += numstring(last_x, 3) + string(",");
-            os += numstring(last_y, 3);
-          }
-          last_op = kFmiMoveTo;
-          last_out_x = last_x;
-          last_out_y = last_y;
-        }
-
-        if (iter == Elements().begin())
-        {
-          os += (relative_moves ? "m" : "M");
-          os += numstring(x, 3) + string(",");
-          os += numstring(y, 3);
-        }
-
-        // Relative moves are "m dx dy" and "l dx dy" etc
-        else if (relative_moves)
-        {
-          switch (op)
-          {
-            case kFmiMoveTo:
-              os += (last_op == kFmiMoveTo ? " " : " m");
-              break;
-            case kFmiLineTo:
-              os += ((last_op == kFmiLineTo || last_op == kFmiGhostLineTo) ? " " : " l");
-              break;
-            case kFmiGhostLineTo:
-              if (!removeghostlines)
-                os += ((last_op == kFmiLineTo || last_op == kFmiGhostLineTo) ? " " : " l");
-              else
-                os += ' ';
-              break;
-            case kFmiConicTo:
-              os += (last_op == kFmiConicTo ? " " : " q");
-              out_ok = (count_conic > 1);
-              break;
-            case kFmiCubicTo:
-              os += (last_op == kFmiCubicTo ? " " : " c");
-              out_ok = (count_conic > 2);
-              break;
-          }
-
-          os += numstring(x - last_out_x, 3) + string(",");
-          os += numstring(y - last_out_y, 3);
-        }
-
-        // Absolute moves are "M x y" and "L x y" etc
-        else
-        {
-          switch (op)
-          {
-            case kFmiMoveTo:
-              os += (last_op == kFmiMoveTo ? " " : " M");
-              break;
-            case kFmiLineTo:
-              os += ((last_op == kFmiLineTo || last_op == kFmiGhostLineTo) ? " " : " L");
-              break;
-            case kFmiGhostLineTo:
-              if (!removeghostlines)
-                os += ((last_op == kFmiLineTo || last_op == kFmiGhostLineTo) ? " " : " L");
-              else
-                os += ' ';
-              break;
-            case kFmiConicTo:
-              os += (last_op == kFmiConicTo ? " " : " Q");
-              break;
-            case kFmiCubicTo:
-              os += (last_op == kFmiCubicTo ? " " : " C");
-              break;
-          }
-
-          os += numstring(x, 3) + string(",");
-          os += numstring(y, 3);
-        }
-      }
-
-      last_op = op;
-
-      last_x = x;
-      last_y = y;
-      if (out_ok)
-      {
-        last_out_x = x;
-        last_out_y = y;
-      }
-    }
-
-    if (!removeghostlines && itsInsideOut)
-    {
-      if (inside_out_limit != 1e8)
-        throw Fmi::Exception(BCP, "Internal error in NFmiPath inside_out_limit");
+        os << 'G';
+      else if (iter->op == kFmiConicTo)
+        os << 'Q';
+      else if (iter->op == kFmiCubicTo)
+        os << 'C';
+      else
+        os << '?';
 
-      os += "M -1e8,-1e8 L -1e8,1e8 L 1e8,1e8 L 1e8,-1e8 Z";
+      os << iter->x << "," << iter->y;
     }
+    return os;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Return a SVG-string representation of the path
+// If relative_moves=true, relative movements are preferred over
+// absolute moves. This usually generates shorter SVG.
+// Tulostetaan polku vain kolmen desimaalin tarkkuudella (kaksi desimaali
+// ei riitt�nyt, kun tuli pieni v�li maiden v�lille?).
+// The number of decimals may be changed, a negative value selects the
+// shortest representation which reads back to the same value.
+// ----------------------------------------------------------------------
 
+string NFmiPath::SVG(bool relative_moves, bool removeghostlines, int theDecimals) const
+{
+  try
+  {
+    string os;
+    os.reserve(svg_size_estimate(itsElements, theDecimals));
+    SVGWriter out(os, theDecimals);
+    write_svg(out, itsElements, itsInsideOut, relative_moves, removeghostlines);
     return os;
   }
   catch (...)
@@ -1043,16 +2283,42 @@ string NFmiPath::SVG(bool relative_moves, bool removeghostlines) const
 }
 
 // ----------------------------------------------------------------------
-// Convert floating point number to string for the benefit of SVG() method
+// Append the SVG-string representation of the path to the given string
+// ----------------------------------------------------------------------
+
+void NFmiPath::SVG(string &theOutput,
+                   bool relative_moves,
+                   bool removeghostlines,
+                   int theDecimals) const
+{
+  try
+  {
+    theOutput.reserve(theOutput.size() + svg_size_estimate(itsElements, theDecimals));
+    SVGWriter out(theOutput, theDecimals);
+    write_svg(out, itsElements, itsInsideOut, relative_moves, removeghostlines);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+// Write the SVG-string representation of the path to the given stream
+// The output is buffered in blocks, hence no full copy of the string
+// is ever made.
 // ----------------------------------------------------------------------
 
-string NFmiPath::ftoa(double theValue) const
+void NFmiPath::SVG(ostream &theOutput,
+                   bool relative_moves,
+                   bool removeghostlines,
+                   int theDecimals) const
 {
   try
   {
-    ostringstream str;
-    str << theValue;
-    return str.str();
+    string buffer;
+    SVGWriter out(buffer, theDecimals, &theOutput);
+    write_svg(out, itsElements, itsInsideOut, relative_moves, removeghostlines);
   }
   catch (...)
   {
@@ -1083,17 +2349,50 @@ void NFmiPath::Add(NFmiFillMap &theMap) const
     double y3 = kFloatMissing;
     double y4 = kFloatMissing;
 
-    // The iterator for traversing the data
+    // Subpaths above or below the map cannot affect it. Neither can closed
+    // subpaths left of the map, since their intersections come in pairs on
+    // each row and precede all other intersections. The same does not hold
+    // on the right side if some subpaths are open. A margin is used since
+    // the map rounds the coordinates.
 
-    NFmiPathData::const_iterator iter = Elements().begin();
+    const float lolimit = theMap.LoLimit();
+    const float hilimit = theMap.HiLimit();
+    const float leftlimit = theMap.LeftLimit();
 
-    for (; iter != Elements().end(); ++iter)
+    auto outside = [&](const NFmiPathData::SubpathBox &theBox)
     {
-      x1 = iter->x;
-      y1 = iter->y;
-      op1 = iter->op;
+      if (lolimit != kFloatMissing && theBox.ymax < lolimit - 1)
+        return true;
+      if (hilimit != kFloatMissing && theBox.ymin > hilimit + 1)
+        return true;
+      if (leftlimit == kFloatMissing || theBox.xmax >= leftlimit - 1)
+        return false;
+      return (itsElements.X(theBox.begin) == itsElements.X(theBox.end - 1) &&
+              itsElements.Y(theBox.begin) == itsElements.Y(theBox.end - 1));
+    };
+
+    const bool useboxes = itsElements.HasBoxes();
+    std::vector<NFmiPathData::SubpathBox>::const_iterator box = itsElements.Boxes().begin();
+
+    const NFmiPathData::size_type n = itsElements.size();
+
+    for (NFmiPathData::size_type i = 0; i < n; i++)
+    {
+      if (useboxes && box != itsElements.Boxes().end() && box->begin == i)
+      {
+        const NFmiPathData::SubpathBox &subpath = *box++;
+        if (outside(subpath))
+        {
+          i = subpath.end - 1;
+          continue;
+        }
+      }
 
-      switch (iter->op)
+      x1 = itsElements.X(i);
+      y1 = itsElements.Y(i);
+      op1 = itsElements.Op(i);
+
+      switch (op1)
       {
         case kFmiMoveTo:
           break;
@@ -1171,77 +2470,33 @@ void NFmiPath::Stroke(ImagineXr_or_NFmiImage &img,
     double lastX = kFloatMissing;
     double lastY = kFloatMissing;
 
+    // Subpaths outside the image are skipped if their bounding boxes are known
+
+    const double margin = 1;
+    const bool useboxes = itsElements.HasBoxes();
+    std::vector<NFmiPathData::SubpathBox>::const_iterator box = itsElements.Boxes().begin();
+
     NFmiPathData::const_iterator iter = Elements().begin();
 
     for (; iter != Elements().end(); ++iter)
     {
-      // Next point
-
-      double nextX = iter->x;
-      double nextY = iter->y;
-
-      if (iter->op == kFmiConicTo || iter->op == kFmiCubicTo)
-        throw Fmi::Exception(BCP,
-                             "Conic and Cubic control points not supported in NFmiPath::Stroke()");
-
-      // Only LineTo operations get rendered
-
-      if (iter->op == kFmiLineTo)
-        if (lastX != kFloatMissing && lastY != kFloatMissing && nextX != kFloatMissing &&
-            nextY != kFloatMissing)
+      if (useboxes && box != itsElements.Boxes().end() && box->begin == iter.Index())
+      {
+        const NFmiPathData::SubpathBox &subpath = *box++;
+        if (!intersects(subpath.xmin,
+                        subpath.ymin,
+                        subpath.xmax,
+                        subpath.ymax,
+                        -margin,
+                        -margin,
+                        img.Width() + margin,
+                        img.Height() + margin))
         {
-          img.StrokeBasic(lastX, lastY, nextX, nextY, theColor, theRule);
+          iter = Elements().begin() + (subpath.end - 1);
+          continue;
         }
+      }
 
-      // New last point
-
-      lastX = nextX;
-      lastY = nextY;
-    }
-  }
-  catch (...)
-  {
-    throw Fmi::Exception::Trace(BCP, "Operation failed!");
-  }
-}
-#endif
-
-// ----------------------------------------------------------------------
-// Stroke onto given image using various Porter-Duff rules
-// ----------------------------------------------------------------------
-
-void NFmiPath::Stroke(ImagineXr_or_NFmiImage &img,
-                      double theWidth,
-                      NFmiColorTools::Color theColor,
-                      NFmiColorTools::NFmiBlendRule theRule) const
-{
-  try
-  {
-    // Quick exit if color is not real
-
-    if (theColor == NFmiColorTools::NoColor)
-      return;
-
-    if (theWidth <= 0)
-      return;
-
-      /*
-       * Important that Cairo drawings are done the whole path at once;
-       * cutting to thousands of moveto/lineto segments kills performance,
-       * especially when creating PDF output (Cairo 1.6.4).
-       */
-#ifdef IMAGINE_WITH_CAIRO
-    img.Stroke(itsElements, theWidth, theColor, theRule);
-#else
-    // Current point is not defined yet
-
-    double lastX = kFloatMissing;
-    double lastY = kFloatMissing;
-
-    NFmiPathData::const_iterator iter = Elements().begin();
-
-    for (; iter != Elements().end(); ++iter)
-    {
       // Next point
 
       double nextX = iter->x;
@@ -1257,347 +2512,121 @@ void NFmiPath::Stroke(ImagineXr_or_NFmiImage &img,
         if (lastX != kFloatMissing && lastY != kFloatMissing && nextX != kFloatMissing &&
             nextY != kFloatMissing)
         {
-          // Calculate wide line box coordinates
-
-          if (lastX != nextX || lastY != nextY)
-          {
-            // Emulate thick line with a box
-            NFmiPath box;
-            double dx = nextX - lastX;
-            double dy = nextY - lastY;
-            double alpha = atan2(dy, dx);
-
-            box.MoveTo(lastX - theWidth / 2 * sin(alpha), lastY + theWidth / 2 * cos(alpha));
-            box.LineTo(lastX + theWidth / 2 * sin(alpha), lastY - theWidth / 2 * cos(alpha));
-            box.LineTo(nextX + theWidth / 2 * sin(alpha), nextY - theWidth / 2 * cos(alpha));
-            box.LineTo(nextX - theWidth / 2 * sin(alpha), nextY + theWidth / 2 * cos(alpha));
-            box.CloseLineTo();
-            box.Fill(img, theColor, theRule);
-          }
+          img.StrokeBasic(lastX, lastY, nextX, nextY, theColor, theRule);
         }
 
       // New last point
 
-      lastX = nextX;
-      lastY = nextY;
-    }
-#endif
-  }
-  catch (...)
-  {
-    throw Fmi::Exception::Trace(BCP, "Operation failed!");
-  }
-}
-
-#ifndef IMAGINE_WITH_CAIRO
-NFmiPath NFmiPath::Clip(
-    double theX1, double theY1, double theX2, double theY2, double theMargin) const
-{
-  try
-  {
-    if (itsElements.empty())
-      return *this;
-
-    NFmiPath outPath;
-    NFmiPath tmpPath;
-
-    const NFmiPathData::const_iterator begin = Elements().begin();
-    const NFmiPathData::const_iterator end = Elements().end();
-    int last_quadrant = 0;
-    int this_quadrant = 0;
-
-    // Initialize the new bounding box
-    double minx = 0;
-    double miny = 0;
-    double maxx = 0;
-    double maxy = 0;
-
-    double lastX = 0;
-    double lastY = 0;
-    NFmiPathOperation lastOp = kFmiMoveTo;
-
-    bool last_ignored = false;
-
-    for (NFmiPathData::const_iterator iter = begin; iter != end;)
-    {
-      double X = iter->x;
-      double Y = iter->y;
-      NFmiPathOperation op = iter->op;
-      ++iter;
-
-      this_quadrant = quadrant(X, Y, theX1, theY1, theX2, theY2, theMargin);
-
-      switch (op)
-      {
-        case kFmiMoveTo:
-        {
-          if (tmpPath.Size() > 0 && intersects(minx,
-                                               miny,
-                                               maxx,
-                                               maxy,
-                                               theX1 - theMargin,
-                                               theY1 - theMargin,
-                                               theX2 + theMargin,
-                                               theY2 + theMargin))
-          {
-            outPath.Add(tmpPath);
-          }
-          tmpPath.Clear();
-          tmpPath.Add(op, X, Y);
-          minx = maxx = X;
-          miny = maxy = Y;
-          lastOp = op;
-          lastX = X;
-          lastY = Y;
-          last_quadrant = this_quadrant;
-          last_ignored = false;
-          break;
-        }
-        case kFmiLineTo:
-        case kFmiGhostLineTo:
-        {
-          if (this_quadrant == central_quadrant || this_quadrant != last_quadrant)
-          {
-            if (last_ignored)
-              tmpPath.Add(lastOp, lastX, lastY);
-            tmpPath.Add(op, X, Y);
-            last_ignored = false;
-          }
-          else
-            last_ignored = true;
-
-          minx = min(minx, X);
-          miny = min(miny, Y);
-          maxx = max(maxx, X);
-          maxy = max(maxy, Y);
-          lastOp = op;
-          lastX = X;
-          lastY = Y;
-          last_quadrant = this_quadrant;
-          break;
-        }
-        case kFmiConicTo:
-        {
-          double X2 = iter->x;
-          double Y2 = iter->y;
-          ++iter;
-
-          int end_quadrant = quadrant(X2, Y2, theX1, theY1, theX2, theY2, theMargin);
-          if (end_quadrant == central_quadrant || end_quadrant != this_quadrant ||
-              end_quadrant != last_quadrant)
-          {
-            if (last_ignored)
-              tmpPath.Add(lastOp, lastX, lastY);
-            tmpPath.Add(op, X, Y);
-            tmpPath.Add(op, X2, Y2);
-            last_ignored = false;
-          }
-          else
-            last_ignored = true;
-          lastOp = kFmiLineTo;
-          lastX = X2;
-          lastY = Y2;
-          last_quadrant = end_quadrant;
-          minx = min(minx, X);
-          minx = min(minx, X2);
-          miny = min(miny, Y);
-          miny = min(miny, Y2);
-          maxx = max(maxx, X);
-          maxx = max(maxx, X2);
-          maxy = max(maxy, Y);
-          maxy = max(maxy, Y2);
-
-          break;
-        }
-        case kFmiCubicTo:
-        {
-          double X2 = iter->x;
-          double Y2 = iter->y;
-          ++iter;
-
-          double X3 = iter->x;
-          double Y3 = iter->y;
-          ++iter;
-
-          int middle_quadrant = quadrant(X2, Y2, theX1, theY1, theX2, theY2, theMargin);
-          int end_quadrant = quadrant(X3, Y3, theX1, theY1, theX2, theY2, theMargin);
-          if (end_quadrant == central_quadrant || end_quadrant != this_quadrant ||
-              end_quadrant != middle_quadrant || end_quadrant != last_quadrant)
-          {
-            if (last_ignored)
-              tmpPath.Add(lastOp, lastX, lastY);
-            tmpPath.Add(op, X, Y);
-            tmpPath.Add(op, X2, Y2);
-            tmpPath.Add(op, X3, Y3);
-            last_ignored = false;
-          }
-          else
-            last_ignored = true;
-          lastOp = kFmiLineTo;
-          lastX = X3;
-          lastY = Y3;
-          last_quadrant = end_quadrant;
-          minx = min(minx, X);
-          minx = min(minx, X2);
-          minx = min(minx, X3);
-          miny = min(miny, Y);
-          miny = min(miny, Y2);
-          miny = min(miny, Y3);
-          maxx = max(maxx, X);
-          maxx = max(maxx, X2);
-          maxx = max(maxx, X3);
-          maxy = max(maxy, Y);
-          maxy = max(maxy, Y2);
-          maxy = max(maxy, Y3);
-          break;
-        }
-      }
-    }
-
-    if (tmpPath.Size() > 0 && intersects(minx,
-                                         miny,
-                                         maxx,
-                                         maxy,
-                                         theX1 - theMargin,
-                                         theY1 - theMargin,
-                                         theX2 + theMargin,
-                                         theY2 + theMargin))
-    {
-      outPath.Add(tmpPath);
-    }
-
-    return outPath;
-  }
-  catch (...)
-  {
-    throw Fmi::Exception::Trace(BCP, "Operation failed!");
-  }
-}
-#endif
-
-static bool IsInside(const NFmiArea *const theArea, const NFmiPathElement &theElement)
-{
-  try
-  {
-    return theArea->IsInside(NFmiPoint(theElement.x, theElement.y));
-  }
-  catch (...)
-  {
-    throw Fmi::Exception::Trace(BCP, "Operation failed!");
-  }
-}
-
-static void AddElementToCutPath(NFmiPath &thePath,
-                                bool prevInside,
-                                bool currentInside,
-                                const NFmiPathElement &theElem,
-                                NFmiPathOperation oper,
-                                bool lastOperation)
-{
-  try
-  {
-    if (oper == kFmiMoveTo)
-    {
-      if (prevInside == false && currentInside)  // ulkoa sis�lle
-        ;  // moveto sis�lt� ulos, ei lis�t� uuteen path:iin
-      else if (prevInside && currentInside == false)  // sis�lt� ulos
-        thePath.Add(theElem);
-      else if (prevInside && currentInside)  // sis�ll� kokonaan
-        thePath.Add(theElem);
-      else  // ulkona
-      {
-      }  // moveto ulkona, ei lis�t� uuteen path:iin
-    }
-    else
-    {  // joku viiva tyyppi, oletetaan ett� lineto (ei oikeastaan v�li�)
-      if (prevInside == false && currentInside)  // ulkoa sis�lle
-      {
-        if (lastOperation)  // t�m� on ainoa poikkeus k�sittely, kun kyseess� on viimeisest� viivan
-                            // p�tk�st�
-          thePath.Add(theElem);
-        else
-        {
-          NFmiPathElement elem(theElem);
-          elem.op = kFmiMoveTo;  // pit�� muuttaa moveto-tyypiksi
-          thePath.Add(elem);
-        }
-      }
-      else if (prevInside && currentInside == false)  // sis�lt� ulos
-        thePath.Add(theElem);
-      else if (prevInside && currentInside)  // sis�ll� kokonaan
-        thePath.Add(theElem);
-      else  // ulkona
-      {
-      }  // moveto ulkona, ei lis�t� uuteen path:iin
-    }
-  }
-  catch (...)
-  {
-    throw Fmi::Exception::Trace(BCP, "Operation failed!");
-  }
-}
-
-// ----------------------------------------------------------------------
-// Create new path that is cut inside the given area. But so that the lines
-// at the edges goes out of area (by one point along the polyline).
-// HUOM! T�m� on raakile versio ja toimii vain rajojen katkaisijana,
-// pit�isi tehd� sellainen versio joka osaisi tehd� alue leikkaukset
-// ghost-viivojen kanssa.
-// ----------------------------------------------------------------------
-
-NFmiPath NFmiPath::Clip(const NFmiArea *const theArea) const
-{
-  try
-  {
-    NFmiPath path;
-    if (theArea && itsElements.size() > 1)
-    {
-      NFmiPathData::const_iterator iter = itsElements.begin();
-      NFmiPathData::const_iterator prevIter = iter++;
-      bool prevInside = IsInside(theArea, *prevIter);
-      bool currentInside = prevInside;
-      for (; iter != itsElements.end(); ++iter)
-      {
-        prevInside = currentInside;  // t�m� pit�� tehd� loopin alussa, jotta loopin lopuksi on
-                                     // tiedot kahden viimeisen pisteen tilasta
-        currentInside = IsInside(theArea, *iter);
-        AddElementToCutPath(path, prevInside, currentInside, *prevIter, iter->op, false);
-        prevIter = iter;
-      }
-      // lopuksi pit�� lis�t� tarvittaessa viel� viimeinen piste
-      AddElementToCutPath(path,
-                          prevInside,
-                          currentInside,
-                          *prevIter,
-                          prevIter->op,
-                          true);  // huom! t�ss� on prevIter->op
+      lastX = nextX;
+      lastY = nextY;
     }
-    return path;
   }
   catch (...)
   {
     throw Fmi::Exception::Trace(BCP, "Operation failed!");
   }
 }
+#endif
+
+// ----------------------------------------------------------------------
+// Stroke onto given image using various Porter-Duff rules
+// ----------------------------------------------------------------------
 
-void add_cuts(NFmiContourTree &theTree, std::set<double> &theCuts, double theLon1, double theLon2)
+void NFmiPath::Stroke(ImagineXr_or_NFmiImage &img,
+                      double theWidth,
+                      NFmiColorTools::Color theColor,
+                      NFmiColorTools::NFmiBlendRule theRule) const
 {
   try
   {
-    std::set<double>::const_iterator iter = theCuts.begin();
-    std::set<double>::const_iterator end = theCuts.end();
+    // Quick exit if color is not real
 
-    while (iter != end)
+    if (theColor == NFmiColorTools::NoColor)
+      return;
+
+    if (theWidth <= 0)
+      return;
+
+      /*
+       * Important that Cairo drawings are done the whole path at once;
+       * cutting to thousands of moveto/lineto segments kills performance,
+       * especially when creating PDF output (Cairo 1.6.4).
+       */
+#ifdef IMAGINE_WITH_CAIRO
+    img.Stroke(itsElements, theWidth, theColor, theRule);
+#else
+    // Current point is not defined yet
+
+    double lastX = kFloatMissing;
+    double lastY = kFloatMissing;
+
+    // Subpaths outside the image are skipped if their bounding boxes are known
+
+    const double margin = theWidth / 2 + 1;
+    const bool useboxes = itsElements.HasBoxes();
+    std::vector<NFmiPathData::SubpathBox>::const_iterator box = itsElements.Boxes().begin();
+
+    NFmiPathData::const_iterator iter = Elements().begin();
+
+    for (; iter != Elements().end(); ++iter)
     {
-      double lat1 = *iter;
-      if (++iter != end)
+      if (useboxes && box != itsElements.Boxes().end() && box->begin == iter.Index())
       {
-        double lat2 = *iter;
-        ++iter;
-        theTree.Add(NFmiEdge(theLon1, lat1, theLon1, lat2, true, false));
-        theTree.Add(NFmiEdge(theLon2, lat1, theLon2, lat2, true, false));
+        const NFmiPathData::SubpathBox &subpath = *box++;
+        if (!intersects(subpath.xmin,
+                        subpath.ymin,
+                        subpath.xmax,
+                        subpath.ymax,
+                        -margin,
+                        -margin,
+                        img.Width() + margin,
+                        img.Height() + margin))
+        {
+          iter = Elements().begin() + (subpath.end - 1);
+          continue;
+        }
       }
+
+      // Next point
+
+      double nextX = iter->x;
+      double nextY = iter->y;
+
+      if (iter->op == kFmiConicTo || iter->op == kFmiCubicTo)
+        throw Fmi::Exception(BCP,
+                             "Conic and Cubic control points not supported in NFmiPath::Stroke()");
+
+      // Only LineTo operations get rendered
+
+      if (iter->op == kFmiLineTo)
+        if (lastX != kFloatMissing && lastY != kFloatMissing && nextX != kFloatMissing &&
+            nextY != kFloatMissing)
+        {
+          // Calculate wide line box coordinates
+
+          if (lastX != nextX || lastY != nextY)
+          {
+            // Emulate thick line with a box
+            NFmiPath box;
+            double dx = nextX - lastX;
+            double dy = nextY - lastY;
+            double alpha = atan2(dy, dx);
+
+            box.MoveTo(lastX - theWidth / 2 * sin(alpha), lastY + theWidth / 2 * cos(alpha));
+            box.LineTo(lastX + theWidth / 2 * sin(alpha), lastY - theWidth / 2 * cos(alpha));
+            box.LineTo(nextX + theWidth / 2 * sin(alpha), nextY - theWidth / 2 * cos(alpha));
+            box.LineTo(nextX - theWidth / 2 * sin(alpha), nextY + theWidth / 2 * cos(alpha));
+            box.CloseLineTo();
+            box.Fill(img, theColor, theRule);
+          }
+        }
+
+      // New last point
+
+      lastX = nextX;
+      lastY = nextY;
     }
+#endif
   }
   catch (...)
   {
@@ -1605,257 +2634,402 @@ void add_cuts(NFmiContourTree &theTree, std::set<double> &theCuts, double theLon
   }
 }
 
-// ----------------------------------------------------------------------
-/*!
- * \brief Utility subroutine for PacificView
- */
-// ----------------------------------------------------------------------
-
-void make_pacific(const NFmiPath &thePath,
-                  const NFmiEsriBox &theBox,
-                  NFmiPath &theOutPath,
-                  NFmiContourTree &theTree,
-                  std::set<double> &theCuts,
-                  bool theDateLine)
+#ifndef IMAGINE_WITH_CAIRO
+NFmiPath NFmiPath::Clip(
+    double theX1, double theY1, double theX2, double theY2, double theMargin) const
 {
   try
   {
-    if (thePath.Empty())
-      return;
+    if (itsElements.empty())
+      return *this;
 
-    if (theBox.Xmin() >= 0 && !theDateLine)
-    {
-      theOutPath.Add(thePath);  // already in range 0-360
-      return;
-    }
+    NFmiPath outPath;
+    NFmiPath tmpPath;
 
-    if (theBox.Xmax() < 0 && !theDateLine)
+    // Clip the subpaths in the given range of elements
+
+    auto clip = [&](NFmiPathData::size_type theFirst, NFmiPathData::size_type theLast)
     {
-      // Only shift from Atlantic to Pacific
-      for (NFmiPathData::const_iterator iter = thePath.Elements().begin(),
-                                        end = thePath.Elements().end();
-           iter != end;
-           ++iter)
-      {
-        theOutPath.Add(NFmiPathElement(iter->op, iter->x + 360, iter->y));
-      }
-      return;
-    }
+      const NFmiPathData::const_iterator begin = Elements().begin() + theFirst;
+      const NFmiPathData::const_iterator end = Elements().begin() + theLast;
+      tmpPath.Clear();
 
-    // Now splitting some lines in half may be necessary. We also omit vertical lines
-    // at the dateline boundary (-180 or 180) except near the poles, where they are
-    // needed to include the poles themselves in the path. We also need to create
-    // the lines at 0 and 360 to reconnect the polygons
+      int last_quadrant = 0;
+      int this_quadrant = 0;
 
-    double lastX = kFloatMissing;
-    double lastY = kFloatMissing;
+      // Initialize the new bounding box
+      double minx = 0;
+      double miny = 0;
+      double maxx = 0;
+      double maxy = 0;
 
-    for (NFmiPathData::const_iterator iter = thePath.Elements().begin(),
-                                      end = thePath.Elements().end();
-         iter != end;
-         ++iter)
-    {
-      double X = iter->x;
-      double Y = iter->y;
-      NFmiPathOperation op = iter->op;
+      double lastX = 0;
+      double lastY = 0;
+      NFmiPathOperation lastOp = kFmiMoveTo;
 
-      switch (op)
-      {
-        case kFmiMoveTo:
-        {
-          break;
-        }
-        case kFmiLineTo:
-        case kFmiGhostLineTo:
-        {
-          // Omit vertical lines at the dateline boundary
+      bool last_ignored = false;
 
-          if ((lastX == -180 || lastX == 180) && (X == -180 || X == 180) &&
-              (lastY > -80 && lastY < 75 && Y > -80 &&
-               Y < 75))  // works for the Antarctic and Chukotski Peninsula
-            break;
+      for (NFmiPathData::const_iterator iter = begin; iter != end;)
+      {
+        double X = iter->x;
+        double Y = iter->y;
+        NFmiPathOperation op = iter->op;
+        ++iter;
 
-          bool exact = (op == kFmiLineTo);
+        this_quadrant = quadrant(X, Y, theX1, theY1, theX2, theY2, theMargin);
 
-          if (lastX < 0 && X < 0)
-          {
-            theTree.Add(NFmiEdge(lastX + 360, lastY, X + 360, Y, exact, true));
-          }
-          else if (lastX > 0 && X > 0)
+        switch (op)
+        {
+          case kFmiMoveTo:
           {
-            theTree.Add(NFmiEdge(lastX, lastY, X, Y, exact, true));
+            if (tmpPath.Size() > 0 && intersects(minx,
+                                                 miny,
+                                                 maxx,
+                                                 maxy,
+                                                 theX1 - theMargin,
+                                                 theY1 - theMargin,
+                                                 theX2 + theMargin,
+                                                 theY2 + theMargin))
+            {
+              outPath.Add(tmpPath);
+            }
+            tmpPath.Clear();
+            tmpPath.Add(op, X, Y);
+            minx = maxx = X;
+            miny = maxy = Y;
+            lastOp = op;
+            lastX = X;
+            lastY = Y;
+            last_quadrant = this_quadrant;
+            last_ignored = false;
+            break;
           }
-          else if (lastX == X)
+          case kFmiLineTo:
+          case kFmiGhostLineTo:
           {
-            theTree.Add(NFmiEdge(lastX, lastY, X, Y, exact, true));
+            if (this_quadrant == central_quadrant || this_quadrant != last_quadrant)
+            {
+              if (last_ignored)
+                tmpPath.Add(lastOp, lastX, lastY);
+              tmpPath.Add(op, X, Y);
+              last_ignored = false;
+            }
+            else
+              last_ignored = true;
+
+            minx = min(minx, X);
+            miny = min(miny, Y);
+            maxx = max(maxx, X);
+            maxy = max(maxy, Y);
+            lastOp = op;
+            lastX = X;
+            lastY = Y;
+            last_quadrant = this_quadrant;
+            break;
           }
-          else if (lastX < X)
+          case kFmiConicTo:
           {
-            // now lastX < 0 and X >= 0
-            double s = (0 - lastX) / (X - lastX);
-            double ymid = lastY + s * (Y - lastY);
-            theTree.Add(NFmiEdge(lastX + 360, lastY, 360, ymid, exact, true));
-            theTree.Add(NFmiEdge(0, ymid, X, Y, exact, true));
-            theCuts.insert(ymid);
+            double X2 = iter->x;
+            double Y2 = iter->y;
+            ++iter;
+
+            int end_quadrant = quadrant(X2, Y2, theX1, theY1, theX2, theY2, theMargin);
+            if (end_quadrant == central_quadrant || end_quadrant != this_quadrant ||
+                end_quadrant != last_quadrant)
+            {
+              if (last_ignored)
+                tmpPath.Add(lastOp, lastX, lastY);
+              tmpPath.Add(op, X, Y);
+              tmpPath.Add(op, X2, Y2);
+              last_ignored = false;
+            }
+            else
+              last_ignored = true;
+            lastOp = kFmiLineTo;
+            lastX = X2;
+            lastY = Y2;
+            last_quadrant = end_quadrant;
+            minx = min(minx, X);
+            minx = min(minx, X2);
+            miny = min(miny, Y);
+            miny = min(miny, Y2);
+            maxx = max(maxx, X);
+            maxx = max(maxx, X2);
+            maxy = max(maxy, Y);
+            maxy = max(maxy, Y2);
+
+            break;
           }
-          else
+          case kFmiCubicTo:
           {
-            // now lastX >= 0 and X < 0
-            double s = (0 - X) / (lastX - X);
-            double ymid = Y + s * (lastY - Y);
-            theTree.Add(NFmiEdge(lastX, lastY, 0, ymid, exact, true));
-            theTree.Add(NFmiEdge(360, ymid, X + 360, Y, exact, true));
-            theCuts.insert(ymid);
+            double X2 = iter->x;
+            double Y2 = iter->y;
+            ++iter;
+
+            double X3 = iter->x;
+            double Y3 = iter->y;
+            ++iter;
+
+            int middle_quadrant = quadrant(X2, Y2, theX1, theY1, theX2, theY2, theMargin);
+            int end_quadrant = quadrant(X3, Y3, theX1, theY1, theX2, theY2, theMargin);
+            if (end_quadrant == central_quadrant || end_quadrant != this_quadrant ||
+                end_quadrant != middle_quadrant || end_quadrant != last_quadrant)
+            {
+              if (last_ignored)
+                tmpPath.Add(lastOp, lastX, lastY);
+              tmpPath.Add(op, X, Y);
+              tmpPath.Add(op, X2, Y2);
+              tmpPath.Add(op, X3, Y3);
+              last_ignored = false;
+            }
+            else
+              last_ignored = true;
+            lastOp = kFmiLineTo;
+            lastX = X3;
+            lastY = Y3;
+            last_quadrant = end_quadrant;
+            minx = min(minx, X);
+            minx = min(minx, X2);
+            minx = min(minx, X3);
+            miny = min(miny, Y);
+            miny = min(miny, Y2);
+            miny = min(miny, Y3);
+            maxx = max(maxx, X);
+            maxx = max(maxx, X2);
+            maxx = max(maxx, X3);
+            maxy = max(maxy, Y);
+            maxy = max(maxy, Y2);
+            maxy = max(maxy, Y3);
+            break;
           }
-          break;
         }
-        default:;
       }
 
-      lastX = X;
-      lastY = Y;
+      if (tmpPath.Size() > 0 && intersects(minx,
+                                           miny,
+                                           maxx,
+                                           maxy,
+                                           theX1 - theMargin,
+                                           theY1 - theMargin,
+                                           theX2 + theMargin,
+                                           theY2 + theMargin))
+      {
+        outPath.Add(tmpPath);
+      }
+    };
+
+    // Use the subpath bounding boxes to skip subpaths outside the rectangle
+    // and to accept subpaths inside it without checking individual points
+
+    if (!itsElements.HasBoxes())
+      clip(0, itsElements.size());
+    else
+    {
+      const double xmin = theX1 - theMargin;
+      const double ymin = theY1 - theMargin;
+      const double xmax = theX2 + theMargin;
+      const double ymax = theY2 + theMargin;
+
+      for (const NFmiPathData::SubpathBox &box : itsElements.Boxes())
+      {
+        if (!intersects(box.xmin, box.ymin, box.xmax, box.ymax, xmin, ymin, xmax, ymax))
+          continue;
+
+        if (box.xmin >= xmin && box.xmax <= xmax && box.ymin >= ymin && box.ymax <= ymax)
+        {
+          tmpPath.Clear();
+          for (NFmiPathData::size_type i = box.begin; i < box.end; i++)
+            tmpPath.Add(itsElements[i]);
+          outPath.Add(tmpPath);
+        }
+        else
+          clip(box.begin, box.end);
+      }
     }
+
+    return outPath;
   }
   catch (...)
   {
     throw Fmi::Exception::Trace(BCP, "Operation failed!");
   }
 }
+#endif
 
 // ----------------------------------------------------------------------
 /*!
- * \brief Utility subroutine for AtlanticView
+ * \brief Clip a path in geographic coordinates to the given area
+ *
+ * The path is converted into a Pacific or Atlantic view as in Project,
+ * and all points are projected in one block. The clipping is done in
+ * the projected XY coordinates against the rectangle of the area, but
+ * the result is returned in geographic coordinates so that it can be
+ * projected as usual. Subpaths whose bounding boxes are fully inside
+ * the area are copied as is, and those fully outside are dropped.
+ *
+ * Closed subpaths are clipped as polygons using the Sutherland-Hodgman
+ * algorithm, hence filled polygons with holes are clipped correctly.
+ * The new edges along the area boundary are ghost lines. Points
+ * created by the clipping are inverse projected, hence they will be
+ * exactly on the boundary after projection.
+ *
+ * Open subpaths are clipped as lines by keeping the segments which
+ * intersect the area. The lines thus extend outside the area by at
+ * most one segment so that no gaps appear at the edges.
+ *
+ * Segments with an end point which cannot be projected are omitted.
+ * Closed subpaths with such points are clipped as lines as before,
+ * since dropping the points would join distant vertices.
  */
 // ----------------------------------------------------------------------
 
-void make_atlantic(const NFmiPath &thePath,
-                   const NFmiEsriBox &theBox,
-                   NFmiPath &theOutPath,
-                   NFmiContourTree &theTree,
-                   std::set<double> &theCuts,
-                   bool theDateLine)
+NFmiPath NFmiPath::Clip(const NFmiArea *const theArea) const
 {
   try
   {
-    if (thePath.Empty())
-      return;
+    NFmiPath path;
+    if (!theArea || itsElements.size() < 2)
+      return path;
 
-    // Note: We require Xmin to be >=0 in this easy cases since some paths
-    // may look Pacific even though the coordinates are not. Example: Chuchki data
+    // Geographic coordinates in the same view as the area
 
-    if (theBox.Xmin() >= 0 && theBox.Xmax() <= 180 && !theDateLine)
-    {
-      theOutPath.Add(thePath);  // already in range 0...180
-      return;
-    }
+    NFmiPathData source = itsElements;
 
-    if (theBox.Xmin() >= 180 && !theDateLine)
-    {
-      // Only shift from Pacific to Atlantic
-      for (NFmiPathData::const_iterator iter = thePath.Elements().begin(),
-                                        end = thePath.Elements().end();
-           iter != end;
-           ++iter)
-      {
-        theOutPath.Add(NFmiPathElement(iter->op, iter->x - 360, iter->y));
-      }
-      return;
-    }
+    bool path_is_pacific = IsPacificView();
+    bool area_is_pacific = theArea->PacificView();
 
-    // Now splitting some lines in half may be necessary. We also omit vertical lines
-    // at the dateline boundary (0 or 360) except near the poles, where they are
-    // needed to include the poles themselves in the path.
+    if (path_is_pacific && !area_is_pacific)
+      source = AtlanticView(true).itsElements;
+    else if (!path_is_pacific && area_is_pacific)
+      source = PacificView(true).itsElements;
 
-    double lastX = kFloatMissing;
-    double lastY = kFloatMissing;
+    // And the respective XY coordinates
+
+    NFmiPathData xy = source;
+    project_coordinates(
+        xy,
+        [theArea]
+        { return std::make_pair(Fmi::SpatialReference("WGS84"), theArea->SpatialReference()); },
+        [](const NFmiPoint &theLatLon) { return theLatLon; },
+        [theArea](const NFmiPoint &theWorldXY) { return theArea->WorldXYToXY(theWorldXY); },
+        [theArea](const NFmiPoint &theLatLon) { return theArea->ToXY(theLatLon); });
 
-    for (NFmiPathData::const_iterator iter = thePath.Elements().begin(),
-                                      end = thePath.Elements().end();
-         iter != end;
-         ++iter)
+    const double xmin = std::min(theArea->Left(), theArea->Right());
+    const double xmax = std::max(theArea->Left(), theArea->Right());
+    const double ymin = std::min(theArea->Top(), theArea->Bottom());
+    const double ymax = std::max(theArea->Top(), theArea->Bottom());
+
+    auto valid = [&xy](std::size_t i)
     {
-      double X = iter->x;
-      double Y = iter->y;
-      NFmiPathOperation op = iter->op;
+      return xy.X(i) != kFloatMissing && xy.Y(i) != kFloatMissing;
+    };
 
-      switch (op)
+    std::vector<ClipVertex> ring;
+    std::vector<ClipVertex> work;
+
+    const std::size_t n = source.size();
+    std::size_t begin = 0;
+    while (begin < n)
+    {
+      std::size_t end = begin + 1;
+      while (end < n && source.Op(end) != kFmiMoveTo)
+        ++end;
+
+      // Bounding box of the subpath
+
+      bool missing = false;
+      bool empty = true;
+      double x1 = 0;
+      double y1 = 0;
+      double x2 = 0;
+      double y2 = 0;
+      for (std::size_t i = begin; i < end; i++)
       {
-        case kFmiMoveTo:
+        if (!valid(i))
+          missing = true;
+        else if (empty)
         {
-          break;
+          x1 = x2 = xy.X(i);
+          y1 = y2 = xy.Y(i);
+          empty = false;
         }
-        case kFmiLineTo:
-        case kFmiGhostLineTo:
+        else
         {
-          // Omit vertical lines at the dateline boundary
+          x1 = std::min(x1, xy.X(i));
+          y1 = std::min(y1, xy.Y(i));
+          x2 = std::max(x2, xy.X(i));
+          y2 = std::max(y2, xy.Y(i));
+        }
+      }
 
-          if ((lastX == 0 || lastX == 360) && (X == 0 || X == 360) &&
-              (lastY > -80 && lastY < 75 && Y > -80 &&
-               Y < 75))  // works for the Antarctic and Chukotski Peninsula
-            break;
+      if (empty || x1 > xmax || x2 < xmin || y1 > ymax || y2 < ymin)
+      {
+        // Completely outside
+      }
+      else if (!missing && x1 >= xmin && x2 <= xmax && y1 >= ymin && y2 <= ymax)
+      {
+        // Completely inside
+        for (std::size_t i = begin; i < end; i++)
+          path.Add(source[i]);
+      }
+      else if (!missing && end - begin >= 4 && source.X(begin) == source.X(end - 1) &&
+               source.Y(begin) == source.Y(end - 1))
+      {
+        // Clip a polygon. The ring excludes the initial moveto, the closing
+        // point carries the operation of the closing edge.
 
-          bool exact = (op == kFmiLineTo);
+        ring.clear();
+        for (std::size_t i = begin + 1; i < end; i++)
+          ring.push_back(ClipVertex{xy.X(i), xy.Y(i), i, source.Op(i)});
 
-          if (lastX > 180 && X > 180)
-          {
-            theTree.Add(NFmiEdge(lastX - 360, lastY, X - 360, Y, exact, true));
-          }
-          else if (lastX >= 0 && lastX < 180 && X >= 0 && X < 180)
-          {
-            theTree.Add(NFmiEdge(lastX, lastY, X, Y, exact, true));
-          }
-          else if (lastX >= -180 && lastX <= 0 && X >= -180 && X <= 0)
-          {
-            theTree.Add(NFmiEdge(lastX, lastY, X, Y, exact, true));
-          }
-          else if (lastX == X)
-          {
-            theTree.Add(NFmiEdge(lastX, lastY, X, Y, exact, true));
-          }
-          else if (lastX < -90 && X > 90)
+        clip_ring(ring, work, kClipLeft, xmin);
+        clip_ring(work, ring, kClipRight, xmax);
+        clip_ring(ring, work, kClipTop, ymin);
+        clip_ring(work, ring, kClipBottom, ymax);
+
+        if (ring.size() >= 3)
+        {
+          auto latlon = [&](const ClipVertex &theVertex)
           {
-            double x = lastX + 360;
-            double s = (180 - x) / (X - x);
-            double ymid = lastY + s * (Y - lastY);
-            theTree.Add(NFmiEdge(lastX, lastY, -180, ymid, exact, true));
-            theTree.Add(NFmiEdge(180, ymid, X, Y, exact, true));
-            theCuts.insert(ymid);
-          }
-          else if (lastX > 90 && X < -90)
+            if (theVertex.index != clip_new_vertex)
+              return NFmiPoint(source.X(theVertex.index), source.Y(theVertex.index));
+            return theArea->ToLatLon(NFmiPoint(theVertex.x, theVertex.y));
+          };
+
+          NFmiPoint pt = latlon(ring.back());
+          path.MoveTo(pt.X(), pt.Y());
+          for (const ClipVertex &vertex : ring)
           {
-            double x = X + 360;
-            double s = (180 - lastX) / (x - lastX);
-            double ymid = lastY + s * (Y - lastY);
-            theTree.Add(NFmiEdge(lastX, lastY, 180, ymid, exact, true));
-            theTree.Add(NFmiEdge(-180, ymid, X, Y, exact, true));
-            theCuts.insert(ymid);
+            pt = latlon(vertex);
+            path.Add(vertex.op, pt.X(), pt.Y());
           }
-          else if (lastX < X)
+        }
+      }
+      else
+      {
+        // Clip a line by keeping the segments which intersect the area
+
+        bool drawing = false;
+        for (std::size_t i = begin + 1; i < end; i++)
+        {
+          if (valid(i - 1) && valid(i) &&
+              segment_intersects(
+                  xy.X(i - 1), xy.Y(i - 1), xy.X(i), xy.Y(i), xmin, ymin, xmax, ymax))
           {
-            // now lastX < 180 and X >= 180
-            double s = (180 - lastX) / (X - lastX);
-            double ymid = lastY + s * (Y - lastY);
-            theTree.Add(NFmiEdge(lastX, lastY, 180, ymid, exact, true));
-            theTree.Add(NFmiEdge(-180, ymid, X - 360, Y, exact, true));
-            theCuts.insert(ymid);
+            if (!drawing)
+              path.MoveTo(source.X(i - 1), source.Y(i - 1));
+            path.Add(source[i]);
+            drawing = true;
           }
           else
-          {
-            // now lastX >= 180 and X < 180
-            double s = (180 - X) / (lastX - X);
-            double ymid = Y + s * (lastY - Y);
-            theTree.Add(NFmiEdge(lastX - 360, lastY, -180, ymid, exact, true));
-            theTree.Add(NFmiEdge(180, ymid, X, Y, exact, true));
-            theCuts.insert(ymid);
-          }
-          break;
+            drawing = false;
         }
-        default:;
       }
 
-      lastX = X;
-      lastY = Y;
+      begin = end;
     }
+
+    return path;
   }
   catch (...)
   {
@@ -1866,6 +3040,9 @@ void make_atlantic(const NFmiPath &thePath,
 // ----------------------------------------------------------------------
 /*!
  * \brief Rebuild the path into a Pacific view if so requested
+ *
+ * Subpaths crossing longitude 0 are cut there and closed along the
+ * new edges of the view at 0 and 360 in a single pass over the path.
  */
 // ----------------------------------------------------------------------
 
@@ -1881,40 +3058,20 @@ NFmiPath NFmiPath::PacificView(bool pacific) const
       return *this;
 
     NFmiPath outpath;
-    NFmiPath currentpath;
-
-    NFmiContourTree tree(0, 0);
-    NFmiEsriBox box;
-    bool dateline = false;
-
-    std::set<double> cuts;
+    DatelineSplitter splitter(true);
 
-    // Iterate over subsegments, calculating the bounding box simultaneously
-
-    for (NFmiPathData::const_iterator iter = Elements().begin(), end = Elements().end();
-         iter != end;
-         ++iter)
+    std::size_t begin = 0;
+    for (std::size_t i = 1; i < itsElements.size(); i++)
     {
-      if (iter->op == kFmiMoveTo)
+      if (itsElements.Op(i) == kFmiMoveTo)
       {
-        make_pacific(currentpath, box, outpath, tree, cuts, dateline);
-        currentpath.Clear();
-        box = NFmiEsriBox();
-        dateline = false;
+        splitter.Add(itsElements, begin, i, outpath);
+        begin = i;
       }
-
-      currentpath.Add(*iter);
-      box.Update(iter->x, iter->y);
-
-      if (iter->x == -180 || iter->x == 180)
-        dateline = true;
     }
+    splitter.Add(itsElements, begin, itsElements.size(), outpath);
+    splitter.Finish(outpath);
 
-    make_pacific(currentpath, box, outpath, tree, cuts, dateline);
-
-    add_cuts(tree, cuts, 0, 360);
-
-    outpath.Add(tree.Path());
     return outpath;
   }
   catch (...)
@@ -1926,6 +3083,9 @@ NFmiPath NFmiPath::PacificView(bool pacific) const
 // ----------------------------------------------------------------------
 /*!
  * \brief Rebuild the path into a Atlantic view if so requested
+ *
+ * Subpaths crossing longitude 180 are cut there and closed along the
+ * new edges of the view at -180 and 180 in a single pass over the path.
  */
 // ----------------------------------------------------------------------
 
@@ -1941,40 +3101,20 @@ NFmiPath NFmiPath::AtlanticView(bool atlantic) const
       return *this;
 
     NFmiPath outpath;
-    NFmiPath currentpath;
-
-    NFmiContourTree tree(0, 0);
-    NFmiEsriBox box;
-    bool dateline = false;
-
-    std::set<double> cuts;
+    DatelineSplitter splitter(false);
 
-    // Iterate over subsegments, calculating the bounding box simultaneously
-
-    for (NFmiPathData::const_iterator iter = Elements().begin(), end = Elements().end();
-         iter != end;
-         ++iter)
+    std::size_t begin = 0;
+    for (std::size_t i = 1; i < itsElements.size(); i++)
     {
-      if (iter->op == kFmiMoveTo)
+      if (itsElements.Op(i) == kFmiMoveTo)
       {
-        make_atlantic(currentpath, box, outpath, tree, cuts, dateline);
-        currentpath.Clear();
-        box = NFmiEsriBox();
-        dateline = false;
+        splitter.Add(itsElements, begin, i, outpath);
+        begin = i;
       }
-
-      currentpath.Add(*iter);
-      box.Update(iter->x, iter->y);
-
-      if (iter->x == 0 || iter->x == 360)
-        dateline = true;
     }
+    splitter.Add(itsElements, begin, itsElements.size(), outpath);
+    splitter.Finish(outpath);
 
-    make_atlantic(currentpath, box, outpath, tree, cuts, dateline);
-
-    add_cuts(tree, cuts, -180, 180);
-
-    outpath.Add(tree.Path());
     return outpath;
   }
   catch (...)
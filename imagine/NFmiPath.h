@@ -34,6 +34,7 @@
 
 // Essential includes
 
+#include "NFmiPathData.h"
 #include "NFmiPathElement.h"
 
 #include "NFmiAlignment.h"
@@ -50,8 +51,6 @@
 
 #include <newbase/NFmiArea.h>
 
-#include <deque>
-
 #include <iostream>  // << is overloaded
 
 class NFmiGrid;
@@ -60,8 +59,6 @@ namespace Imagine
 {
 class NFmiEsriBox;
 
-typedef std::deque<NFmiPathElement> NFmiPathData;
-
 // ----------------------------------------------------------------------
 // A class defining a path
 // ----------------------------------------------------------------------
@@ -88,6 +85,7 @@ class NFmiPath
   const NFmiPathData &Elements() const { return itsElements; }
   int Size() const { return static_cast<int>(itsElements.size()); }
   int Empty() const { return itsElements.empty(); }
+  std::size_t HashValue() const { return itsElements.HashValue() * 31 + itsInsideOut; }
   // Clear contents
 
   void Clear()
@@ -131,7 +129,7 @@ class NFmiPath
 
   void InsertLineTo(double theX, double theY)
   {
-    itsElements.front().op = kFmiLineTo;
+    itsElements.Op(0, kFmiLineTo);
     itsElements.push_front(NFmiPathElement(kFmiMoveTo, theX, theY));
   }
 
@@ -139,7 +137,7 @@ class NFmiPath
 
   void InsertGhostLineTo(double theX, double theY)
   {
-    itsElements.front().op = kFmiGhostLineTo;
+    itsElements.Op(0, kFmiGhostLineTo);
     itsElements.push_front(NFmiPathElement(kFmiMoveTo, theX, theY));
   }
 
@@ -203,9 +201,20 @@ class NFmiPath
 
   void SimplifyLines(double offset = 0.0);
 
-  // Return SVG-string description
-
-  std::string SVG(bool relative_moves = false, bool removeghostlines = true) const;
+  // Return SVG-string description, or append it to a string or stream.
+  // A negative number of decimals selects the shortest exact output.
+
+  std::string SVG(bool relative_moves = false,
+                  bool removeghostlines = true,
+                  int theDecimals = 3) const;
+  void SVG(std::string &theOutput,
+           bool relative_moves = false,
+           bool removeghostlines = true,
+           int theDecimals = 3) const;
+  void SVG(std::ostream &theOutput,
+           bool relative_moves = false,
+           bool removeghostlines = true,
+           int theDecimals = 3) const;
 
   // Test if the path is Pacific
 
@@ -281,9 +290,12 @@ class NFmiPath
 
   NFmiEsriBox BoundingBox() const;
 
+  // Maintain bounding boxes of the subpaths for faster clipping and rendering
+
+  void UpdateBoundingBoxes() { itsElements.UpdateBoxes(); }
+
   NFmiPath Clip(double theX1, double theY1, double theX2, double theY2, double theMargin = 0) const;
-  NFmiPath Clip(
-      const NFmiArea *const theArea) const;  // HUOM! toimii vain rajaviivoille oikein, ei alueille
+  NFmiPath Clip(const NFmiArea *const theArea) const;  // geographic coordinates in and out
 
   void InsideOut() { itsInsideOut = !itsInsideOut; }
   bool IsInsideOut() const { return itsInsideOut; }
@@ -309,13 +321,6 @@ class NFmiPath
   //
   void DoCloseLineTo(NFmiPathOperation theOper);
 
-  // Floating point number to string
-  // This is needed because stringstream version of SVG() does not
-  // work using g++ v2.95, instead we must format the numbers by
-  // ourselves for string concatenation operations
-  //
-  std::string ftoa(double theValue) const;
-
   // Simplification subroutines
   //
   void SimplifyTrivial();
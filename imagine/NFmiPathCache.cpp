@@ -0,0 +1,632 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of singleton class Imagine::NFmiPathCache
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiPathCache
+ *
+ * \brief Process wide cache of projected paths
+ *
+ * Static map layers such as borders, coastlines and lakes are projected
+ * into the same few areas over and over again. Instead of projecting
+ * the path returned by NFmiGeoShape::Path on every request, use
+ * \code
+ * auto borders = NFmiPathCache::Instance().Get(
+ *     bordersid, [&shape]() { return shape.Path(); }, *area);
+ * borders->Stroke(image, color);
+ * \endcode
+ * The source function is called only if the projected path is not
+ * already cached. Alternatively the path itself may be given, in which
+ * case the content hash of the path is used instead of an identifier.
+ * The projected path may also be clipped to a rectangle as in
+ * NFmiPath::Clip, the rectangle then being part of the cache key.
+ *
+ * A cached path is identified by the geometry identifier, the hash
+ * value of the area and the clipping rectangle. The caller is
+ * responsible for using identifiers which change when the geometry
+ * changes. Identifiers and content hashes never match each other.
+ * Since different paths and areas may have equal hashes, the original
+ * of a path given by value and the projection and corners of the area
+ * are cached too, and a cached projection is used only if they are
+ * equal. The path caches its hash value, hence
+ * passing the same unmodified path again costs only the comparison.
+ * The paths are shared between all users and must not be modified.
+ *
+ * The least recently used paths are dropped when the estimated memory
+ * use of the cached paths exceeds the limit, which defaults to
+ * imagine::path_cache_size megabytes (default 128). Paths larger than
+ * the limit are returned without caching them.
+ *
+ * All methods are thread safe. The projection is done outside the
+ * lock, so a slow projection never blocks other threads from using
+ * the cache.
+ */
+// ======================================================================
+
+#include "NFmiPathCache.h"
+#include "NFmiLruCache.h"
+#include "NFmiPath.h"
+#include <macgyver/Exception.h>
+#include <newbase/NFmiArea.h>
+#include <newbase/NFmiPoint.h>
+#include <newbase/NFmiSettings.h>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace Imagine
+{
+namespace
+{
+//! The identity of an area, the hash value of the area may collide
+
+struct AreaIdentity
+{
+  string projection;
+  double left;
+  double top;
+  double right;
+  double bottom;
+  NFmiPoint bottomleft;
+  NFmiPoint topright;
+
+  bool operator==(const AreaIdentity& theOther) const
+  {
+    return (projection == theOther.projection && left == theOther.left && top == theOther.top &&
+            right == theOther.right && bottom == theOther.bottom &&
+            bottomleft.X() == theOther.bottomleft.X() &&
+            bottomleft.Y() == theOther.bottomleft.Y() && topright.X() == theOther.topright.X() &&
+            topright.Y() == theOther.topright.Y());
+  }
+};
+
+//! A projected path, the area it was projected into and the original
+//! if the path was identified by its contents
+
+struct CachedPath
+{
+  AreaIdentity area;
+  shared_ptr<const NFmiPath> original;
+  shared_ptr<const NFmiPath> path;
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the identity of an area
+ */
+// ----------------------------------------------------------------------
+
+AreaIdentity area_identity(const NFmiArea& theArea)
+{
+  return AreaIdentity{theArea.AreaStr(),
+                      theArea.Left(),
+                      theArea.Top(),
+                      theArea.Right(),
+                      theArea.Bottom(),
+                      theArea.BottomLeftLatLon(),
+                      theArea.TopRightLatLon()};
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Estimated memory use of a path
+ */
+// ----------------------------------------------------------------------
+
+size_t path_bytes(const NFmiPath& thePath)
+{
+  return sizeof(NFmiPath) + thePath.Elements().Bytes();
+}
+
+}  // namespace
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Implementation hiding pimple for NFmiPathCache
+ */
+// ----------------------------------------------------------------------
+
+class NFmiPathCache::Pimple
+{
+ public:
+  //! The identity of a projected path
+
+  struct Key
+  {
+    bool content;     // geometry is a content hash instead of an identifier
+    size_t geometry;  // the geometry identifier or content hash
+    size_t area;
+    bool clipped;
+    double x1;
+    double y1;
+    double x2;
+    double y2;
+    double margin;
+
+    bool operator==(const Key& theOther) const
+    {
+      return (content == theOther.content && geometry == theOther.geometry &&
+              area == theOther.area && clipped == theOther.clipped && x1 == theOther.x1 &&
+              y1 == theOther.y1 && x2 == theOther.x2 && y2 == theOther.y2 &&
+              margin == theOther.margin);
+    }
+  };
+
+  static Key MakeKey(size_t theId, const NFmiArea& theArea);
+  static Key MakeKey(size_t theId,
+                     const NFmiArea& theArea,
+                     double theX1,
+                     double theY1,
+                     double theX2,
+                     double theY2,
+                     double theMargin);
+  static Key MakeKey(const NFmiPath& thePath, const NFmiArea& theArea);
+  static Key MakeKey(const NFmiPath& thePath,
+                     const NFmiArea& theArea,
+                     double theX1,
+                     double theY1,
+                     double theX2,
+                     double theY2,
+                     double theMargin);
+
+  Pimple();
+
+  shared_ptr<const NFmiPath> Get(const Key& theKey,
+                                 const Source& theSource,
+                                 const NFmiArea& theArea);
+  shared_ptr<const NFmiPath> Get(const Key& theKey,
+                                 const NFmiPath& thePath,
+                                 const NFmiArea& theArea);
+
+  struct Hash
+  {
+    size_t operator()(const Key& theKey) const
+    {
+      size_t hash = theKey.geometry;
+      hash = hash * 31 + static_cast<size_t>(theKey.content);
+      hash = hash * 31 + theKey.area;
+      hash = hash * 31 + static_cast<size_t>(theKey.clipped);
+      hash = hash * 31 + std::hash<double>()(theKey.x1);
+      hash = hash * 31 + std::hash<double>()(theKey.y1);
+      hash = hash * 31 + std::hash<double>()(theKey.x2);
+      hash = hash * 31 + std::hash<double>()(theKey.y2);
+      hash = hash * 31 + std::hash<double>()(theKey.margin);
+      return hash;
+    }
+  };
+
+  struct Size
+  {
+    size_t operator()(const Key&, const CachedPath& thePath) const
+    {
+      size_t bytes = sizeof(Key) + sizeof(CachedPath) + thePath.area.projection.capacity() +
+                     path_bytes(*thePath.path);
+      if (thePath.original)
+        bytes += path_bytes(*thePath.original);
+      return bytes;
+    }
+  };
+
+  NFmiLruCache<Key, CachedPath, Hash, Size> itsCache;
+
+ private:
+  shared_ptr<const NFmiPath> Project(const Key& theKey,
+                                     const NFmiPath& thePath,
+                                     const NFmiArea& theArea) const;
+
+};  // class NFmiPathCache::Pimple
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Build a cache key for an unclipped path
+ */
+// ----------------------------------------------------------------------
+
+NFmiPathCache::Pimple::Key NFmiPathCache::Pimple::MakeKey(size_t theId, const NFmiArea& theArea)
+{
+  try
+  {
+    return Key{false, theId, theArea.HashValue(), false, 0, 0, 0, 0, 0};
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Build a cache key for a clipped path
+ */
+// ----------------------------------------------------------------------
+
+NFmiPathCache::Pimple::Key NFmiPathCache::Pimple::MakeKey(size_t theId,
+                                                          const NFmiArea& theArea,
+                                                          double theX1,
+                                                          double theY1,
+                                                          double theX2,
+                                                          double theY2,
+                                                          double theMargin)
+{
+  try
+  {
+    return Key{false, theId, theArea.HashValue(), true, theX1, theY1, theX2, theY2, theMargin};
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Build a cache key for an unclipped path identified by its contents
+ */
+// ----------------------------------------------------------------------
+
+NFmiPathCache::Pimple::Key NFmiPathCache::Pimple::MakeKey(const NFmiPath& thePath,
+                                                          const NFmiArea& theArea)
+{
+  try
+  {
+    return Key{true, thePath.HashValue(), theArea.HashValue(), false, 0, 0, 0, 0, 0};
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Build a cache key for a clipped path identified by its contents
+ */
+// ----------------------------------------------------------------------
+
+NFmiPathCache::Pimple::Key NFmiPathCache::Pimple::MakeKey(const NFmiPath& thePath,
+                                                          const NFmiArea& theArea,
+                                                          double theX1,
+                                                          double theY1,
+                                                          double theX2,
+                                                          double theY2,
+                                                          double theMargin)
+{
+  try
+  {
+    return Key{true,
+               thePath.HashValue(),
+               theArea.HashValue(),
+               true,
+               theX1,
+               theY1,
+               theX2,
+               theY2,
+               theMargin};
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Pimple constructor
+ */
+// ----------------------------------------------------------------------
+
+NFmiPathCache::Pimple::Pimple()
+{
+  try
+  {
+    const int megabytes = NFmiSettings::Optional<int>("imagine::path_cache_size", 128);
+    itsCache.MaxBytes(static_cast<size_t>(max(0, megabytes)) * 1024 * 1024);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Project and optionally clip a path as specified by the key
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiPath> NFmiPathCache::Pimple::Project(const Key& theKey,
+                                                          const NFmiPath& thePath,
+                                                          const NFmiArea& theArea) const
+{
+  try
+  {
+    NFmiPath path = thePath;
+    path.Project(&theArea);
+
+    shared_ptr<NFmiPath> result;
+    if (theKey.clipped)
+      result = make_shared<NFmiPath>(
+          path.Clip(theKey.x1, theKey.y1, theKey.x2, theKey.y2, theKey.margin));
+    else
+      result = make_shared<NFmiPath>(path);
+
+    // Cached paths are rendered repeatedly, usually only partly visible
+
+    result->UpdateBoundingBoxes();
+    return result;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the projected path for the given identifier key
+ *
+ * A cached projection is used only if it was projected into an equal area.
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiPath> NFmiPathCache::Pimple::Get(const Key& theKey,
+                                                      const Source& theSource,
+                                                      const NFmiArea& theArea)
+{
+  try
+  {
+    AreaIdentity area = area_identity(theArea);
+
+    shared_ptr<const CachedPath> cached = itsCache.Find(
+        theKey, [&area](const CachedPath& theCandidate) { return theCandidate.area == area; });
+    if (cached)
+      return cached->path;
+
+    // Project without holding the lock. Should two threads race to project
+    // the same path, the latter one simply replaces the former entry.
+
+    shared_ptr<const NFmiPath> result = Project(theKey, theSource(), theArea);
+    itsCache.Insert(theKey, make_shared<CachedPath>(CachedPath{move(area), nullptr, result}));
+    return result;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Failed to get projected path from cache");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the projected path for the given content key
+ *
+ * A cached projection is used only if its original equals the path
+ * and it was projected into an equal area.
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiPath> NFmiPathCache::Pimple::Get(const Key& theKey,
+                                                      const NFmiPath& thePath,
+                                                      const NFmiArea& theArea)
+{
+  try
+  {
+    AreaIdentity area = area_identity(theArea);
+
+    shared_ptr<const CachedPath> cached =
+        itsCache.Find(theKey, [&thePath, &area](const CachedPath& theCandidate) {
+          return (theCandidate.area == area &&
+                  theCandidate.original->IsInsideOut() == thePath.IsInsideOut() &&
+                  theCandidate.original->Elements() == thePath.Elements());
+        });
+    if (cached)
+      return cached->path;
+
+    shared_ptr<const NFmiPath> result = Project(theKey, thePath, theArea);
+    shared_ptr<const NFmiPath> original = make_shared<NFmiPath>(thePath);
+    itsCache.Insert(theKey, make_shared<CachedPath>(CachedPath{move(area), original, result}));
+    return result;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Failed to get projected path from cache");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Destructor
+ */
+// ----------------------------------------------------------------------
+
+NFmiPathCache::~NFmiPathCache() {}
+// ----------------------------------------------------------------------
+/*!
+ * \brief Constructor used privately by Instance()
+ */
+// ----------------------------------------------------------------------
+
+NFmiPathCache::NFmiPathCache() : itsPimple(new Pimple()) {}
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return an instance of NFmiPathCache
+ *
+ * \return A reference to a NFmiPathCache singleton
+ */
+// ----------------------------------------------------------------------
+
+NFmiPathCache& NFmiPathCache::Instance()
+{
+  try
+  {
+    static NFmiPathCache cache;
+    return cache;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the path projected into the given area
+ *
+ * The content hash of the path identifies the geometry.
+ *
+ * \param thePath The path in geographic coordinates
+ * \param theArea The area to project into
+ * \return A shared read-only projected path
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiPath> NFmiPathCache::Get(const NFmiPath& thePath, const NFmiArea& theArea)
+{
+  try
+  {
+    return itsPimple->Get(Pimple::MakeKey(thePath, theArea), thePath, theArea);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the path projected into the area and clipped
+ *
+ * The clipping arguments are as in NFmiPath::Clip.
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiPath> NFmiPathCache::Get(const NFmiPath& thePath,
+                                              const NFmiArea& theArea,
+                                              double theX1,
+                                              double theY1,
+                                              double theX2,
+                                              double theY2,
+                                              double theMargin)
+{
+  try
+  {
+    return itsPimple->Get(
+        Pimple::MakeKey(thePath, theArea, theX1, theY1, theX2, theY2, theMargin), thePath, theArea);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the identified geometry projected into the given area
+ *
+ * \param theId The unique identifier of the geometry
+ * \param theSource Function returning the geometry when it is not cached
+ * \param theArea The area to project into
+ * \return A shared read-only projected path
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiPath> NFmiPathCache::Get(size_t theId,
+                                              const Source& theSource,
+                                              const NFmiArea& theArea)
+{
+  try
+  {
+    return itsPimple->Get(Pimple::MakeKey(theId, theArea), theSource, theArea);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the identified geometry projected into the area and clipped
+ *
+ * The clipping arguments are as in NFmiPath::Clip.
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<const NFmiPath> NFmiPathCache::Get(size_t theId,
+                                              const Source& theSource,
+                                              const NFmiArea& theArea,
+                                              double theX1,
+                                              double theY1,
+                                              double theX2,
+                                              double theY2,
+                                              double theMargin)
+{
+  try
+  {
+    return itsPimple->Get(
+        Pimple::MakeKey(theId, theArea, theX1, theY1, theX2, theY2, theMargin), theSource, theArea);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Set the memory limit in bytes, evicting paths if necessary
+ */
+// ----------------------------------------------------------------------
+
+void NFmiPathCache::MaxBytes(size_t theBytes)
+{
+  itsPimple->itsCache.MaxBytes(theBytes);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the memory limit in bytes
+ */
+// ----------------------------------------------------------------------
+
+size_t NFmiPathCache::MaxBytes() const
+{
+  return itsPimple->itsCache.MaxBytes();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Drop all cached paths
+ */
+// ----------------------------------------------------------------------
+
+void NFmiPathCache::Clear()
+{
+  itsPimple->itsCache.Clear();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the cache counters
+ */
+// ----------------------------------------------------------------------
+
+NFmiPathCache::Statistics NFmiPathCache::GetStatistics() const
+{
+  const auto cachestats = itsPimple->itsCache.GetStatistics();
+
+  Statistics stats;
+  stats.hits = cachestats.hits;
+  stats.misses = cachestats.misses;
+  stats.evictions = cachestats.evictions;
+  stats.paths = cachestats.entries;
+  stats.bytes = cachestats.bytes;
+  stats.maxbytes = cachestats.maxbytes;
+  return stats;
+}
+
+}  // namespace Imagine
+
+// ======================================================================
@@ -0,0 +1,86 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of singleton class Imagine::NFmiPathCache
+ */
+// ======================================================================
+
+#pragma once
+
+#include "imagine-config.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+class NFmiArea;
+
+namespace Imagine
+{
+class NFmiPath;
+
+class NFmiPathCache
+{
+ public:
+  //! Cache usage counters
+
+  struct Statistics
+  {
+    std::size_t hits = 0;       //!< requests served from the cache
+    std::size_t misses = 0;     //!< requests which required projecting the path
+    std::size_t evictions = 0;  //!< paths dropped to satisfy the memory limit
+    std::size_t paths = 0;      //!< number of paths currently cached
+    std::size_t bytes = 0;      //!< estimated memory used by the cached paths
+    std::size_t maxbytes = 0;   //!< the memory limit
+  };
+
+  using Source = std::function<NFmiPath()>;
+
+  static NFmiPathCache& Instance();
+
+  std::shared_ptr<const NFmiPath> Get(const NFmiPath& thePath, const NFmiArea& theArea);
+
+  std::shared_ptr<const NFmiPath> Get(const NFmiPath& thePath,
+                                      const NFmiArea& theArea,
+                                      double theX1,
+                                      double theY1,
+                                      double theX2,
+                                      double theY2,
+                                      double theMargin = 0);
+
+  std::shared_ptr<const NFmiPath> Get(std::size_t theId,
+                                      const Source& theSource,
+                                      const NFmiArea& theArea);
+
+  std::shared_ptr<const NFmiPath> Get(std::size_t theId,
+                                      const Source& theSource,
+                                      const NFmiArea& theArea,
+                                      double theX1,
+                                      double theY1,
+                                      double theX2,
+                                      double theY2,
+                                      double theMargin = 0);
+
+  void MaxBytes(std::size_t theBytes);
+  std::size_t MaxBytes() const;
+
+  void Clear();
+  Statistics GetStatistics() const;
+
+ private:
+  class Pimple;
+  std::shared_ptr<Pimple> itsPimple;
+
+  // Private - only NFmiPathCache itself is allowed to call these
+  ~NFmiPathCache();
+  NFmiPathCache();
+
+  // Disabled intentionally:
+
+  NFmiPathCache(const NFmiPathCache& theOb);
+  NFmiPathCache& operator=(const NFmiPathCache& theOb);
+
+};  // class NFmiPathCache
+}  // namespace Imagine
+
+// ======================================================================
@@ -0,0 +1,237 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Implementation of class Imagine::NFmiPathData
+ */
+// ======================================================================
+
+#include "NFmiPathData.h"
+#include <macgyver/Exception.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace Imagine
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Insert a range of elements before the given position
+ */
+// ----------------------------------------------------------------------
+
+void NFmiPathData::insert(const_iterator thePos, const_iterator theFirst, const_iterator theLast)
+{
+  try
+  {
+    if (theFirst == theLast)
+      return;
+
+    // Inserting from self would invalidate the source range
+
+    if (theFirst.itsData == this)
+    {
+      NFmiPathData tmp;
+      tmp.insert(tmp.end(), theFirst, theLast);
+      insert(thePos, tmp.begin(), tmp.end());
+      return;
+    }
+
+    const NFmiPathData &other = *theFirst.itsData;
+
+    const size_type pos = itsFront + thePos.itsPos;
+    const size_type first = other.itsFront + theFirst.itsPos;
+    const size_type last = other.itsFront + theLast.itsPos;
+
+    // Appending maintains the subpath boxes, other insertions discard them
+
+    const bool append = (thePos.itsPos == size());
+    if (!append)
+      DiscardBoxes();
+
+    DiscardHash();
+
+    itsOps.insert(itsOps.begin() + pos, other.itsOps.begin() + first, other.itsOps.begin() + last);
+    itsX.insert(itsX.begin() + pos, other.itsX.begin() + first, other.itsX.begin() + last);
+    itsY.insert(itsY.begin() + pos, other.itsY.begin() + first, other.itsY.begin() + last);
+
+    if (append && itsHasBoxes)
+      for (size_type i = thePos.itsPos; i < size(); i++)
+        ExtendBoxes(i);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Release unused capacity
+ */
+// ----------------------------------------------------------------------
+
+void NFmiPathData::shrink_to_fit()
+{
+  try
+  {
+    itsOps.erase(itsOps.begin(), itsOps.begin() + itsFront);
+    itsX.erase(itsX.begin(), itsX.begin() + itsFront);
+    itsY.erase(itsY.begin(), itsY.begin() + itsFront);
+    itsFront = 0;
+
+    itsOps.shrink_to_fit();
+    itsX.shrink_to_fit();
+    itsY.shrink_to_fit();
+    itsBoxes.shrink_to_fit();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Hash value of the contents
+ *
+ * The operations and the bit patterns of the coordinates are combined
+ * using a word oriented FNV-1a style hash. Equal contents always
+ * produce equal values, the capacity and headroom do not matter.
+ * The value is calculated only once after each modification.
+ */
+// ----------------------------------------------------------------------
+
+std::size_t NFmiPathData::HashValue() const
+{
+  try
+  {
+    const std::size_t cached = itsHash.Get();
+    if (cached != 0)
+      return cached;
+
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t hash = 14695981039346656037ULL;
+
+    const size_type n = size();
+    hash = (hash ^ n) * prime;
+
+    const unsigned char *ops = OpData();
+    const NFmiPathCoordinate *xs = XData();
+    const NFmiPathCoordinate *ys = YData();
+
+    for (size_type i = 0; i < n; i++)
+    {
+      uint64_t x = 0;
+      uint64_t y = 0;
+      memcpy(&x, xs + i, sizeof(NFmiPathCoordinate));
+      memcpy(&y, ys + i, sizeof(NFmiPathCoordinate));
+      hash = (hash ^ ops[i]) * prime;
+      hash = (hash ^ x) * prime;
+      hash = (hash ^ y) * prime;
+    }
+
+    // Zero is reserved for an unknown value
+
+    std::size_t value = static_cast<std::size_t>(hash ^ (hash >> 32));
+    if (value == 0)
+      value = 1;
+
+    itsHash.Set(value);
+    return value;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test whether the contents are equal
+ *
+ * The coordinates are compared bitwise, consistently with HashValue.
+ */
+// ----------------------------------------------------------------------
+
+bool NFmiPathData::operator==(const NFmiPathData &theOther) const
+{
+  try
+  {
+    if (this == &theOther)
+      return true;
+
+    const size_type n = size();
+    if (n != theOther.size())
+      return false;
+
+    if (n == 0)
+      return true;
+
+    const std::size_t hash = itsHash.Get();
+    const std::size_t otherhash = theOther.itsHash.Get();
+    if (hash != 0 && otherhash != 0 && hash != otherhash)
+      return false;
+
+    return (memcmp(OpData(), theOther.OpData(), n) == 0 &&
+            memcmp(XData(), theOther.XData(), n * sizeof(NFmiPathCoordinate)) == 0 &&
+            memcmp(YData(), theOther.YData(), n * sizeof(NFmiPathCoordinate)) == 0);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Calculate the subpath bounding boxes and maintain them from now on
+ */
+// ----------------------------------------------------------------------
+
+void NFmiPathData::UpdateBoxes()
+{
+  try
+  {
+    itsBoxes.clear();
+    itsHasBoxes = true;
+    for (size_type i = 0; i < size(); i++)
+      ExtendBoxes(i);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Make room for new elements at the front
+ *
+ * The room grows with the size of the container so that a sequence
+ * of push_front calls takes amortized constant time per element.
+ */
+// ----------------------------------------------------------------------
+
+void NFmiPathData::GrowFront()
+{
+  try
+  {
+    const size_type extra = max<size_type>(size(), 8);
+
+    itsOps.insert(itsOps.begin(), extra, 0);
+    itsX.insert(itsX.begin(), extra, 0);
+    itsY.insert(itsY.begin(), extra, 0);
+    itsFront += extra;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception::Trace(BCP, "Operation failed!");
+  }
+}
+
+}  // namespace Imagine
+
+// ======================================================================
@@ -0,0 +1,416 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Interface of class Imagine::NFmiPathData
+ */
+// ======================================================================
+/*!
+ * \class Imagine::NFmiPathData
+ *
+ * \brief Compact storage for path elements
+ *
+ * The path operations and coordinates are stored in separate
+ * contiguous arrays, one byte per operation and one coordinate
+ * value per axis. Country borders and coastlines with millions of
+ * vertices thus take roughly 17 bytes per vertex instead of 24 plus
+ * the overhead of a deque, and loops over the coordinates touch
+ * only the memory they need.
+ *
+ * NFmiPathData used to be a typedef of std::deque<NFmiPathElement>.
+ * The container provides the parts of the std::deque interface
+ * needed by existing code. Iterators dereference to NFmiPathElement
+ * values, hence elements can be read as before but must be modified
+ * using the indexed setters or Transform:
+ * \code
+ * path.Transform([](double& x, double& y) { x += 10; });
+ * \endcode
+ * Elements may be added to both ends in amortized constant time.
+ *
+ * Bounding boxes of the subpaths can optionally be maintained to
+ * speed up clipping and rendering of large paths of which only a
+ * small part is visible. Once enabled with UpdateBoxes they are kept
+ * up to date when elements are appended, any other modification
+ * discards them until UpdateBoxes is called again.
+ *
+ * The hash value of the contents is calculated when first needed
+ * and kept until the contents are modified. Since the value may be
+ * calculated by concurrent readers of a shared path, it is atomic.
+ */
+// ======================================================================
+
+#pragma once
+
+#include "NFmiPathElement.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace Imagine
+{
+typedef double NFmiPathCoordinate;
+
+class NFmiPathData
+{
+ public:
+  typedef NFmiPathElement value_type;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  // Bounding box of the subpath [begin,end), subpaths start at movetos
+
+  struct SubpathBox
+  {
+    size_type begin;
+    size_type end;
+    double xmin;
+    double ymin;
+    double xmax;
+    double ymax;
+  };
+
+  // ----------------------------------------------------------------------
+  // Read only random access iterator producing element values
+  // ----------------------------------------------------------------------
+
+  class const_iterator
+  {
+   public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef NFmiPathElement value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef NFmiPathElement reference;
+
+    // Holder for the element so that iter->x works
+
+    class pointer
+    {
+     public:
+      explicit pointer(const NFmiPathElement &theElement) : itsElement(theElement) {}
+      const NFmiPathElement *operator->() const { return &itsElement; }
+
+     private:
+      NFmiPathElement itsElement;
+    };
+
+    const_iterator() : itsData(nullptr), itsPos(0) {}
+    const_iterator(const NFmiPathData *theData, size_type thePos) : itsData(theData), itsPos(thePos)
+    {
+    }
+
+    reference operator*() const { return (*itsData)[itsPos]; }
+    pointer operator->() const { return pointer((*itsData)[itsPos]); }
+    reference operator[](difference_type n) const { return (*itsData)[itsPos + n]; }
+
+    const_iterator &operator++()
+    {
+      ++itsPos;
+      return *this;
+    }
+    const_iterator operator++(int)
+    {
+      const_iterator tmp(*this);
+      ++itsPos;
+      return tmp;
+    }
+    const_iterator &operator--()
+    {
+      --itsPos;
+      return *this;
+    }
+    const_iterator operator--(int)
+    {
+      const_iterator tmp(*this);
+      --itsPos;
+      return tmp;
+    }
+    const_iterator &operator+=(difference_type n)
+    {
+      itsPos += n;
+      return *this;
+    }
+    const_iterator &operator-=(difference_type n)
+    {
+      itsPos -= n;
+      return *this;
+    }
+    const_iterator operator+(difference_type n) const
+    {
+      return const_iterator(itsData, itsPos + n);
+    }
+    const_iterator operator-(difference_type n) const
+    {
+      return const_iterator(itsData, itsPos - n);
+    }
+    difference_type operator-(const const_iterator &theOther) const
+    {
+      return static_cast<difference_type>(itsPos) - static_cast<difference_type>(theOther.itsPos);
+    }
+
+    bool operator==(const const_iterator &theOther) const { return itsPos == theOther.itsPos; }
+    bool operator!=(const const_iterator &theOther) const { return itsPos != theOther.itsPos; }
+    bool operator<(const const_iterator &theOther) const { return itsPos < theOther.itsPos; }
+    bool operator>(const const_iterator &theOther) const { return itsPos > theOther.itsPos; }
+    bool operator<=(const const_iterator &theOther) const { return itsPos <= theOther.itsPos; }
+    bool operator>=(const const_iterator &theOther) const { return itsPos >= theOther.itsPos; }
+
+    // The index of the element in the container
+    size_type Index() const { return itsPos; }
+
+   private:
+    friend class NFmiPathData;
+    const NFmiPathData *itsData;
+    size_type itsPos;
+  };
+
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  NFmiPathData() : itsFront(0), itsHasBoxes(false) {}
+
+  // Size information
+
+  size_type size() const { return itsOps.size() - itsFront; }
+  bool empty() const { return itsOps.size() == itsFront; }
+
+  // Iteration
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  // Element access by value
+
+  NFmiPathElement operator[](size_type i) const
+  {
+    const size_type pos = itsFront + i;
+    return NFmiPathElement(
+        static_cast<NFmiPathOperation>(itsOps[pos]), itsX[pos], itsY[pos]);
+  }
+
+  NFmiPathElement front() const { return (*this)[0]; }
+  NFmiPathElement back() const { return (*this)[size() - 1]; }
+
+  // Element component access
+
+  NFmiPathOperation Op(size_type i) const
+  {
+    return static_cast<NFmiPathOperation>(itsOps[itsFront + i]);
+  }
+  double X(size_type i) const { return itsX[itsFront + i]; }
+  double Y(size_type i) const { return itsY[itsFront + i]; }
+
+  void Op(size_type i, NFmiPathOperation theOp)
+  {
+    DiscardHash();
+    DiscardBoxes();
+    itsOps[itsFront + i] = static_cast<unsigned char>(theOp);
+  }
+  void X(size_type i, double theX)
+  {
+    DiscardHash();
+    DiscardBoxes();
+    itsX[itsFront + i] = static_cast<NFmiPathCoordinate>(theX);
+  }
+  void Y(size_type i, double theY)
+  {
+    DiscardHash();
+    DiscardBoxes();
+    itsY[itsFront + i] = static_cast<NFmiPathCoordinate>(theY);
+  }
+
+  // Modification
+
+  void clear()
+  {
+    DiscardHash();
+    itsOps.clear();
+    itsX.clear();
+    itsY.clear();
+    itsFront = 0;
+    itsBoxes.clear();
+  }
+
+  void reserve(size_type n)
+  {
+    itsOps.reserve(itsFront + n);
+    itsX.reserve(itsFront + n);
+    itsY.reserve(itsFront + n);
+  }
+
+  void push_back(const NFmiPathElement &theElement)
+  {
+    DiscardHash();
+    itsOps.push_back(static_cast<unsigned char>(theElement.op));
+    itsX.push_back(static_cast<NFmiPathCoordinate>(theElement.x));
+    itsY.push_back(static_cast<NFmiPathCoordinate>(theElement.y));
+    if (itsHasBoxes)
+      ExtendBoxes(size() - 1);
+  }
+
+  void push_front(const NFmiPathElement &theElement)
+  {
+    DiscardHash();
+    DiscardBoxes();
+    if (itsFront == 0)
+      GrowFront();
+    --itsFront;
+    itsOps[itsFront] = static_cast<unsigned char>(theElement.op);
+    itsX[itsFront] = static_cast<NFmiPathCoordinate>(theElement.x);
+    itsY[itsFront] = static_cast<NFmiPathCoordinate>(theElement.y);
+  }
+
+  void pop_back()
+  {
+    DiscardHash();
+    DiscardBoxes();
+    itsOps.pop_back();
+    itsX.pop_back();
+    itsY.pop_back();
+  }
+
+  void insert(const_iterator thePos, const_iterator theFirst, const_iterator theLast);
+
+  void swap(NFmiPathData &theOther)
+  {
+    itsOps.swap(theOther.itsOps);
+    itsX.swap(theOther.itsX);
+    itsY.swap(theOther.itsY);
+    std::swap(itsFront, theOther.itsFront);
+    itsBoxes.swap(theOther.itsBoxes);
+    std::swap(itsHasBoxes, theOther.itsHasBoxes);
+    itsHash.swap(theOther.itsHash);
+  }
+
+  // Release unused capacity
+
+  void shrink_to_fit();
+
+  // Hash value of the contents, equality of the contents and the memory used by them
+
+  std::size_t HashValue() const;
+  bool operator==(const NFmiPathData &theOther) const;
+  bool operator!=(const NFmiPathData &theOther) const { return !(*this == theOther); }
+  std::size_t Bytes() const
+  {
+    return (size() * (sizeof(unsigned char) + 2 * sizeof(NFmiPathCoordinate)) +
+            itsBoxes.size() * sizeof(SubpathBox));
+  }
+
+  // Optional bounding boxes of the subpaths
+
+  void UpdateBoxes();
+  bool HasBoxes() const { return itsHasBoxes; }
+  const std::vector<SubpathBox> &Boxes() const { return itsBoxes; }
+
+  // Apply a function modifying the coordinates of all elements
+  //
+  // The function is called as theFunction(x,y) with the coordinates
+  // passed as modifiable doubles.
+
+  template <typename Function>
+  void Transform(Function theFunction)
+  {
+    DiscardHash();
+    DiscardBoxes();
+    NFmiPathCoordinate *xs = itsX.data() + itsFront;
+    NFmiPathCoordinate *ys = itsY.data() + itsFront;
+    const size_type n = size();
+    for (size_type i = 0; i < n; i++)
+    {
+      double x = xs[i];
+      double y = ys[i];
+      theFunction(x, y);
+      xs[i] = static_cast<NFmiPathCoordinate>(x);
+      ys[i] = static_cast<NFmiPathCoordinate>(y);
+    }
+  }
+
+  // Raw access to the arrays for tight loops
+
+  const unsigned char *OpData() const { return itsOps.data() + itsFront; }
+  const NFmiPathCoordinate *XData() const { return itsX.data() + itsFront; }
+  const NFmiPathCoordinate *YData() const { return itsY.data() + itsFront; }
+
+ private:
+  void GrowFront();
+
+  // Add element i, which must be the last one, to the subpath boxes
+
+  void ExtendBoxes(size_type i)
+  {
+    const double x = X(i);
+    const double y = Y(i);
+    if (itsBoxes.empty() || Op(i) == kFmiMoveTo)
+      itsBoxes.push_back(SubpathBox{i, i + 1, x, y, x, y});
+    else
+    {
+      SubpathBox &box = itsBoxes.back();
+      box.end = i + 1;
+      box.xmin = std::min(box.xmin, x);
+      box.ymin = std::min(box.ymin, y);
+      box.xmax = std::max(box.xmax, x);
+      box.ymax = std::max(box.ymax, y);
+    }
+  }
+
+  void DiscardBoxes()
+  {
+    if (itsHasBoxes)
+    {
+      itsBoxes.clear();
+      itsHasBoxes = false;
+    }
+  }
+
+  void DiscardHash() { itsHash.Reset(); }
+
+  // Copyable holder of the hash value, zero if not calculated yet
+
+  class CachedHash
+  {
+   public:
+    CachedHash() : itsValue(0) {}
+    CachedHash(const CachedHash &theOther) : itsValue(theOther.Get()) {}
+    CachedHash &operator=(const CachedHash &theOther)
+    {
+      Set(theOther.Get());
+      return *this;
+    }
+
+    std::size_t Get() const { return itsValue.load(std::memory_order_relaxed); }
+    void Set(std::size_t theValue) const { itsValue.store(theValue, std::memory_order_relaxed); }
+    void Reset() { Set(0); }
+    void swap(CachedHash &theOther)
+    {
+      const std::size_t value = Get();
+      Set(theOther.Get());
+      theOther.Set(value);
+    }
+
+   private:
+    mutable std::atomic<std::size_t> itsValue;
+  };
+
+  std::vector<unsigned char> itsOps;     // NFmiPathOperation values
+  std::vector<NFmiPathCoordinate> itsX;  // x-coordinates
+  std::vector<NFmiPathCoordinate> itsY;  // y-coordinates
+  size_type itsFront;                    // unused slots at the front of the arrays
+
+  std::vector<SubpathBox> itsBoxes;  // subpath bounding boxes if itsHasBoxes is set
+  bool itsHasBoxes;
+
+  CachedHash itsHash;
+};
+
+inline void swap(NFmiPathData &theFirst, NFmiPathData &theSecond)
+{
+  theFirst.swap(theSecond);
+}
+
+}  // namespace Imagine
+
+// ======================================================================
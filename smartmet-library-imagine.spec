@@ -4,7 +4,7 @@
 %define DEVELNAME %{SPECNAME}-devel
 Summary: imagine library
 Name: %{SPECNAME}
-Version: 25.2.18
+Version: 26.10.18
 Release: 1%{?dist}.fmi
 License: MIT
 Group: Development/Libraries
@@ -61,6 +61,7 @@ Requires: zlib
 #TestRequires: smartmet-library-newbase-devel >= 25.2.18
 #TestRequires: %{smartmet_boost}-devel
 #TestRequires: freetype-devel
+#TestRequires: dejavu-sans-fonts
 #TestRequires: libjpeg
 #TestRequires: libpng
 #TestRequires: zlib
@@ -109,6 +110,12 @@ FMI %{DIRNAME} development files
 %{_includedir}/smartmet/%{DIRNAME}/*.h
 
 %changelog
+* Sun Oct 18 2026 agent <agent@local> 26.10.18-1.fmi
+- API change: NFmiPathData is now a compact container class instead of a
+  std::deque<NFmiPathElement> typedef. Iterators return NFmiPathElement
+  values, so elements must be modified with the indexed setters or Transform.
+  Dependent packages must be rebuilt and adapted.
+
 * Tue Feb 18 2025 Andris Pavēnis <andris.pavenis@fmi.fi> 25.2.18-1.fmi
 - Update to gdal-3.10, geos-3.13 and proj-9.5
 
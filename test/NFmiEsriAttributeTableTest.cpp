@@ -0,0 +1,133 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for class NFmiEsriAttributeTable
+ */
+// ======================================================================
+
+#include "NFmiEsriAttributeTable.h"
+#include "tframe.h"
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiEsriAttributeTableTest
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief A table with a string, an integer, a double and a date column
+ */
+// ----------------------------------------------------------------------
+
+shared_ptr<Imagine::NFmiEsriAttributeTable> make_table()
+{
+  using namespace Imagine;
+
+  vector<NFmiEsriAttributeName> names{NFmiEsriAttributeName("NAME", kFmiEsriString, -1, -1, 6),
+                                      NFmiEsriAttributeName("NUM", kFmiEsriInteger, 4, 0, -1),
+                                      NFmiEsriAttributeName("VALUE", kFmiEsriDouble, 6, 2, -1),
+                                      NFmiEsriAttributeName("DATE", kFmiEsriDate, 8, 8, -1)};
+  vector<int> offsets{1, 7, 11, 17};
+  vector<int> sizes{6, 4, 6, 8};
+
+  string data =
+      " Oulu    12  1.5020010830"
+      "*  Kemi  -3 -2.2520201231";
+
+  return make_shared<NFmiEsriAttributeTable>(names, offsets, sizes, 2, 25, data);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test field lookups
+ */
+// ----------------------------------------------------------------------
+
+void fieldindex()
+{
+  using namespace Imagine;
+
+  auto table = make_table();
+
+  if (table->NumFields() != 4)
+    TEST_FAILED("Expected 4 fields");
+  if (table->NumRecords() != 2)
+    TEST_FAILED("Expected 2 records");
+  if (table->FieldIndex("NAME") != 0 || table->FieldIndex("DATE") != 3)
+    TEST_FAILED("Wrong field indexes");
+  if (table->FieldIndex("FOO") != -1)
+    TEST_FAILED("Missing field should have index -1");
+  if (table->Type(1) != kFmiEsriInteger || table->Name(2).Name() != "VALUE")
+    TEST_FAILED("Wrong field definitions");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test value conversions
+ */
+// ----------------------------------------------------------------------
+
+void values()
+{
+  using namespace Imagine;
+
+  auto table = make_table();
+
+  if (table->GetString(0, 0) != "Oulu" || table->GetString(0, 1) != "Kemi")
+    TEST_FAILED("Failed to convert strings");
+  if (table->GetInteger(1, 0) != 12 || table->GetInteger(1, 1) != -3)
+    TEST_FAILED("Failed to convert integers");
+  if (table->GetDouble(2, 0) != 1.5 || table->GetDouble(2, 1) != -2.25)
+    TEST_FAILED("Failed to convert doubles");
+  if (table->GetDate(3, 0).GetYear() != 2001 || table->GetDate(3, 1).GetMonth() != 12)
+    TEST_FAILED("Failed to convert dates");
+  if (table->Integers(1).size() != 2)
+    TEST_FAILED("Wrong column size");
+
+  bool ok = false;
+  try
+  {
+    table->GetDouble(1, 0);
+  }
+  catch (...)
+  {
+    ok = true;
+  }
+  if (!ok)
+    TEST_FAILED("Reading a value of wrong type should fail");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(fieldindex);
+    TEST(values);
+  }
+};
+
+}  // namespace NFmiEsriAttributeTableTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl
+       << "NFmiEsriAttributeTable tester" << endl
+       << "=============================" << endl;
+  NFmiEsriAttributeTableTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
@@ -0,0 +1,260 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for class NFmiEsriMappedShape and filtered shapefile reading
+ */
+// ======================================================================
+
+#include "NFmiEsriMappedShape.h"
+#include "NFmiEsriPolygon.h"
+#include "NFmiEsriShape.h"
+#include "tframe.h"
+#include <cstdio>
+#include <memory>
+#include <set>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiEsriMappedShapeTest
+{
+const string filename = "/tmp/NFmiEsriMappedShapeTest";
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Write a small polygon shapefile for the tests
+ */
+// ----------------------------------------------------------------------
+
+void write_shape()
+{
+  using namespace Imagine;
+
+  NFmiEsriShape shape(kFmiEsriPolygon);
+  NFmiEsriAttributeName* name = new NFmiEsriAttributeName("NAME", kFmiEsriString, -1, -1, 10);
+  shape.Add(name);
+
+  for (int k = 0; k < 10; k++)
+  {
+    NFmiEsriPolygon* polygon = new NFmiEsriPolygon(k + 1);
+    polygon->AddPart(NFmiEsriPoint(k, 0));
+    polygon->Add(NFmiEsriPoint(k + 1, 0));
+    polygon->Add(NFmiEsriPoint(k + 1, 1.5));
+    polygon->Add(NFmiEsriPoint(k, 0));
+    if (k % 2 == 0)
+    {
+      polygon->AddPart(NFmiEsriPoint(k, 10));
+      polygon->Add(NFmiEsriPoint(k + 0.5, 10));
+      polygon->Add(NFmiEsriPoint(k, 11));
+      polygon->Add(NFmiEsriPoint(k, 10));
+    }
+    polygon->Add(NFmiEsriAttribute("name" + to_string(k), name));
+    shape.Add(polygon);
+  }
+
+  shape.Write(filename);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Compare the mapped records with NFmiEsriShape::Read
+ */
+// ----------------------------------------------------------------------
+
+void compare(const Imagine::NFmiEsriMappedShape& theMapped)
+{
+  using namespace Imagine;
+
+  NFmiEsriShape shape;
+  if (!shape.Read(filename))
+    TEST_FAILED("Failed to read the test shapefile");
+
+  if (theMapped.Size() != shape.Elements().size())
+    TEST_FAILED("Wrong number of records");
+
+  if (theMapped.Type() != kFmiEsriPolygon)
+    TEST_FAILED("Wrong shape type");
+
+  const int name = theMapped.AttributeIndex("NAME");
+  if (name < 0)
+    TEST_FAILED("Attribute NAME not found");
+
+  for (size_t i = 0; i < theMapped.Size(); i++)
+  {
+    const NFmiEsriMappedShape::Record record = theMapped[i];
+    const NFmiEsriPolygon* polygon = static_cast<const NFmiEsriPolygon*>(shape.Elements()[i]);
+
+    if (record.Number() != polygon->Number() || record.NumParts() != polygon->NumParts() ||
+        record.NumPoints() != polygon->NumPoints())
+      TEST_FAILED("Record " + to_string(i) + " has the wrong size");
+
+    for (int j = 0; j < record.NumParts(); j++)
+      if (record.Part(j) != polygon->Parts()[j])
+        TEST_FAILED("Record " + to_string(i) + " has the wrong parts");
+
+    for (int j = 0; j < record.NumPoints(); j++)
+      if (record.X(j) != polygon->Points()[j].X() || record.Y(j) != polygon->Points()[j].Y())
+        TEST_FAILED("Record " + to_string(i) + " has the wrong coordinates");
+
+    if (theMapped.String(i, name) != polygon->GetString("NAME"))
+      TEST_FAILED("Record " + to_string(i) + " has the wrong NAME");
+
+    unique_ptr<NFmiEsriElement> element(record.Element());
+    if (element->Type() != kFmiEsriPolygon || element->NumPoints() != polygon->NumPoints())
+      TEST_FAILED("Failed to decode record " + to_string(i));
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test reading with the .shx file
+ */
+// ----------------------------------------------------------------------
+
+void read()
+{
+  using namespace Imagine;
+
+  write_shape();
+  NFmiEsriMappedShape shape(filename);
+  compare(shape);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test reading without the .shx file
+ */
+// ----------------------------------------------------------------------
+
+void readwithoutindex()
+{
+  using namespace Imagine;
+
+  write_shape();
+  remove((filename + ".shx").c_str());
+  NFmiEsriMappedShape shape(filename);
+  compare(shape);
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test records with corrupted part counts are rejected
+ */
+// ----------------------------------------------------------------------
+
+void readcorrupted()
+{
+  using namespace Imagine;
+
+  write_shape();
+
+  // Part count 2^30 of the first record overflows a 32-bit offset
+
+  FILE* file = fopen((filename + ".shp").c_str(), "r+b");
+  if (file == nullptr)
+    TEST_FAILED("Failed to open the test shapefile");
+  const unsigned char numparts[4] = {0, 0, 0, 0x40};
+  fseek(file, 100 + 8 + 36, SEEK_SET);
+  fwrite(numparts, 1, 4, file);
+  fclose(file);
+
+  NFmiEsriMappedShape shape(filename);
+
+  try
+  {
+    shape[0];
+  }
+  catch (...)
+  {
+    TEST_PASSED();
+  }
+  TEST_FAILED("Corrupted part count should have been detected");
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test NFmiEsriShape::Read with a bounding box and a record set
+ */
+// ----------------------------------------------------------------------
+
+void readfiltered()
+{
+  using namespace Imagine;
+
+  write_shape();
+
+  auto check = [](const NFmiEsriShape& theShape, const vector<int>& theNumbers)
+  {
+    if (theShape.Elements().size() != theNumbers.size())
+      TEST_FAILED("Expected " + to_string(theNumbers.size()) + " elements, got " +
+                  to_string(theShape.Elements().size()));
+    for (size_t i = 0; i < theNumbers.size(); i++)
+    {
+      const NFmiEsriElement* element = theShape.Elements()[i];
+      if (element->Number() != theNumbers[i])
+        TEST_FAILED("Wrong element " + to_string(element->Number()));
+      if (element->GetString("NAME") != "name" + to_string(theNumbers[i] - 1))
+        TEST_FAILED("Wrong NAME for element " + to_string(element->Number()));
+    }
+  };
+
+  NFmiEsriBox box;
+  box.Update(2.5, 0);
+  box.Update(4.2, 1);
+
+  NFmiEsriShape shape1;
+  if (!shape1.Read(filename, box))
+    TEST_FAILED("Failed to read the records within a box");
+  check(shape1, {3, 4, 5});
+
+  NFmiEsriShape shape2;
+  if (!shape2.Read(filename, set<size_t>{1, 3, 20}))
+    TEST_FAILED("Failed to read the selected records");
+  check(shape2, {2, 4});
+
+  NFmiEsriShape shape3;
+  if (!shape3.Read(filename, box, set<size_t>{1, 3}))
+    TEST_FAILED("Failed to read the selected records within a box");
+  check(shape3, {4});
+
+  NFmiEsriShape shape4;
+  if (shape4.Read(filename + "_missing", box))
+    TEST_FAILED("Reading a missing file should fail");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(read);
+    TEST(readwithoutindex);
+    TEST(readcorrupted);
+    TEST(readfiltered);
+  }
+};
+
+}  // namespace NFmiEsriMappedShapeTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiEsriMappedShape tester" << endl << "==========================" << endl;
+  NFmiEsriMappedShapeTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
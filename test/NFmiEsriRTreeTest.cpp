@@ -0,0 +1,98 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for class NFmiEsriRTree
+ */
+// ======================================================================
+
+#include "NFmiEsriBox.h"
+#include "NFmiEsriRTree.h"
+#include "tframe.h"
+#include <cstdlib>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiEsriRTreeTest
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test NFmiEsriRTree::Query against a linear search
+ */
+// ----------------------------------------------------------------------
+
+void query()
+{
+  using namespace Imagine;
+
+  // Random boxes, every tenth one left invalid
+
+  srand(123);
+  vector<NFmiEsriBox> boxes(5000);
+  for (size_t i = 0; i < boxes.size(); i++)
+  {
+    if (i % 10 == 0)
+      continue;
+    double x = rand() % 1000;
+    double y = rand() % 1000;
+    boxes[i].Update(x, y);
+    boxes[i].Update(x + rand() % 50, y + rand() % 50);
+  }
+
+  NFmiEsriRTree tree(boxes);
+  if (tree.Size() != 4500)
+    TEST_FAILED("Expected 4500 valid boxes in the tree");
+
+  for (int test = 0; test < 100; test++)
+  {
+    double x1 = rand() % 1000;
+    double y1 = rand() % 1000;
+    double x2 = x1 + rand() % 200;
+    double y2 = y1 + rand() % 200;
+
+    vector<size_t> expected;
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+      const NFmiEsriBox& box = boxes[i];
+      if (box.IsValid() && box.Xmin() <= x2 && box.Xmax() >= x1 && box.Ymin() <= y2 &&
+          box.Ymax() >= y1)
+        expected.push_back(i);
+    }
+
+    if (tree.Query(x1, y1, x2, y2) != expected)
+      TEST_FAILED("Query result differs from a linear search");
+  }
+
+  // Empty trees are allowed
+
+  NFmiEsriRTree empty(vector<NFmiEsriBox>(3));
+  if (!empty.Query(0, 0, 1000, 1000).empty())
+    TEST_FAILED("Query from an empty tree should return nothing");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void) { TEST(query); }
+};
+
+}  // namespace NFmiEsriRTreeTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiEsriRTree tester" << endl << "====================" << endl;
+  NFmiEsriRTreeTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
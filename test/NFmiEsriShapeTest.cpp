@@ -0,0 +1,148 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for class NFmiEsriShape
+ */
+// ======================================================================
+
+#include "NFmiEsriBox.h"
+#include "NFmiEsriPoint.h"
+#include "NFmiEsriPolygon.h"
+#include "NFmiEsriProjector.h"
+#include "NFmiEsriShape.h"
+#include "tframe.h"
+#include <cmath>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiEsriShapeTest
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief A stateful projector similar to the one used by NFmiGeoShape
+ */
+// ----------------------------------------------------------------------
+
+class TestProjector : public Imagine::NFmiEsriProjector
+{
+ public:
+  TestProjector(bool fCloneable) : itsCloneable(fCloneable), itsShift(0) {}
+
+  Imagine::NFmiEsriPoint operator()(const Imagine::NFmiEsriPoint& thePoint) const
+  {
+    const double x = thePoint.X() + itsShift;
+    return Imagine::NFmiEsriPoint(100 * sin(x / 100) + thePoint.Y(), x * cos(thePoint.Y() / 50));
+  }
+
+  void SetBox(const Imagine::NFmiEsriBox& theBox) const
+  {
+    itsShift = (theBox.Xmin() < 50 ? 360 : 0);
+  }
+
+  Imagine::NFmiEsriProjector* Clone() const
+  {
+    return (itsCloneable ? new TestProjector(true) : nullptr);
+  }
+
+ private:
+  bool itsCloneable;
+  mutable double itsShift;
+};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief A polygon shape large enough to be projected in parallel
+ */
+// ----------------------------------------------------------------------
+
+void build_shape(Imagine::NFmiEsriShape& theShape)
+{
+  using namespace Imagine;
+
+  for (int i = 0; i < 2000; i++)
+  {
+    NFmiEsriPolygon* polygon = new NFmiEsriPolygon(i + 1);
+    const int n = 10 + (i * 37) % 150;
+    const double x0 = (i * 13) % 100;
+    const double y0 = (i * 7) % 80;
+    polygon->AddPart(NFmiEsriPoint(x0, y0));
+    for (int j = 1; j < n; j++)
+      polygon->Add(NFmiEsriPoint(x0 + 5 * cos(j * 0.1), y0 + 5 * sin(j * 0.1)));
+    polygon->Add(NFmiEsriPoint(x0, y0));
+    theShape.Add(polygon);
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test that parallel projection equals serial projection
+ */
+// ----------------------------------------------------------------------
+
+void project()
+{
+  using namespace Imagine;
+
+  NFmiEsriShape serial(kFmiEsriPolygon);
+  NFmiEsriShape parallel(kFmiEsriPolygon);
+  build_shape(serial);
+  build_shape(parallel);
+
+  serial.Project(TestProjector(false));
+  parallel.Project(TestProjector(true));
+
+  NFmiEsriBox expected;
+  for (size_t i = 0; i < serial.Elements().size(); i++)
+  {
+    const auto* p1 = static_cast<const NFmiEsriPolygon*>(serial.Elements()[i]);
+    const auto* p2 = static_cast<const NFmiEsriPolygon*>(parallel.Elements()[i]);
+
+    for (int j = 0; j < p1->NumPoints(); j++)
+    {
+      const NFmiEsriPoint& pt = p1->Points()[j];
+      if (pt.X() != p2->Points()[j].X() || pt.Y() != p2->Points()[j].Y())
+        TEST_FAILED("Element " + to_string(i) + " was projected differently in parallel");
+      expected.Update(pt.X(), pt.Y());
+    }
+
+    const NFmiEsriBox& box = p2->Box();
+    if (!box.IsValid() || box.Xmin() > p2->Points()[0].X() || box.Xmax() < p2->Points()[0].X())
+      TEST_FAILED("Element " + to_string(i) + " bounding box was not updated");
+  }
+
+  const NFmiEsriBox& box = parallel.Box();
+  if (box.Xmin() != expected.Xmin() || box.Xmax() != expected.Xmax() ||
+      box.Ymin() != expected.Ymin() || box.Ymax() != expected.Ymax())
+    TEST_FAILED("Shape bounding box was not updated");
+
+  if (serial.Box().Xmin() != box.Xmin() || serial.Box().Ymax() != box.Ymax())
+    TEST_FAILED("Serial and parallel bounding boxes differ");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void) { TEST(project); }
+};
+
+}  // namespace NFmiEsriShapeTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiEsriShape tester" << endl << "====================" << endl;
+  NFmiEsriShapeTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
@@ -0,0 +1,222 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for namespace NFmiEsriTools
+ */
+// ======================================================================
+
+#include "NFmiEsriAttributeTable.h"
+#include "NFmiEsriPoint.h"
+#include "NFmiEsriShape.h"
+#include "NFmiEsriTools.h"
+#include "tframe.h"
+#include <memory>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiEsriToolsTest
+{
+const string filename = "/tmp/NFmiEsriToolsTest";
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Build a point shape with attributes CLASS, AREA and NAME
+ */
+// ----------------------------------------------------------------------
+
+void build_shape(Imagine::NFmiEsriShape& theShape)
+{
+  using namespace Imagine;
+
+  NFmiEsriAttributeName* cls = new NFmiEsriAttributeName("CLASS", kFmiEsriInteger, 4, 0, -1);
+  NFmiEsriAttributeName* area = new NFmiEsriAttributeName("AREA", kFmiEsriDouble, 8, 2, -1);
+  NFmiEsriAttributeName* name = new NFmiEsriAttributeName("NAME", kFmiEsriString, -1, -1, 8);
+  theShape.Add(cls);
+  theShape.Add(area);
+  theShape.Add(name);
+
+  for (int i = 0; i < 100; i++)
+  {
+    NFmiEsriPoint* point = new NFmiEsriPoint(i, i % 7, i + 1);
+    point->Add(NFmiEsriAttribute((i * 37) % 5, cls));
+    point->Add(NFmiEsriAttribute(((i * 53) % 101) / 4.0, area));
+    point->Add(NFmiEsriAttribute(string(i % 3 == 0 ? "road" : "lake"), name));
+    theShape.Add(point);
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Evaluate a condition element by element for reference
+ */
+// ----------------------------------------------------------------------
+
+bool reference(const Imagine::NFmiEsriElement& theElement, int theCase)
+{
+  const int cls = theElement.GetInteger("CLASS");
+  const double area = theElement.GetDouble("AREA");
+  const string name = theElement.GetString("NAME");
+
+  switch (theCase)
+  {
+    case 0:
+      return cls == 2;
+    case 1:
+      return cls != 2;
+    case 2:
+      return area >= 12.5 && name == "lake";
+    case 3:
+      return cls < 1 || (area > 20 && name != "road");
+    default:
+      return name <= "lake" && cls >= 3;
+  }
+}
+
+const char* conditions[] = {"CLASS=2",
+                            "CLASS<>2",
+                            "AREA>=12.5 && NAME==lake",
+                            "CLASS<1 || AREA>20 && NAME<>road",
+                            "NAME<=lake&&CLASS>=3"};
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Compare the selections with the reference
+ */
+// ----------------------------------------------------------------------
+
+void check(const Imagine::NFmiEsriShape& theShape, const string& theDescription)
+{
+  using namespace Imagine;
+
+  for (int c = 0; c < 5; c++)
+  {
+    NFmiEsriTools::Predicate predicate(theShape, conditions[c]);
+
+    vector<size_t> expected;
+    for (size_t i = 0; i < theShape.Elements().size(); i++)
+    {
+      if (reference(*theShape.Elements()[i], c))
+        expected.push_back(i);
+      if (predicate(*theShape.Elements()[i]) != reference(*theShape.Elements()[i], c))
+        TEST_FAILED(theDescription + ": wrong result for element " + to_string(i) + " with " +
+                    conditions[c]);
+    }
+
+    if (predicate.Select(theShape) != expected)
+      TEST_FAILED(theDescription + ": wrong selection with " + conditions[c]);
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test predicates on elements with individual attributes
+ */
+// ----------------------------------------------------------------------
+
+void predicate()
+{
+  using namespace Imagine;
+
+  NFmiEsriShape shape(kFmiEsriPoint);
+  build_shape(shape);
+  check(shape, "in memory");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test predicates on attribute tables with and without indexes
+ */
+// ----------------------------------------------------------------------
+
+void indexed()
+{
+  using namespace Imagine;
+
+  {
+    NFmiEsriShape shape(kFmiEsriPoint);
+    build_shape(shape);
+    shape.Write(filename);
+  }
+
+  NFmiEsriShape shape;
+  if (!shape.Read(filename))
+    TEST_FAILED("Failed to read the test shapefile");
+
+  check(shape, "table");
+
+  const NFmiEsriAttributeTable* table = shape.Elements()[0]->AttributeTable().get();
+  for (const char* name : {"CLASS", "AREA", "NAME"})
+    table->BuildIndex(table->FieldIndex(name));
+
+  check(shape, "index");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test filtered views and filtered copies
+ */
+// ----------------------------------------------------------------------
+
+void filter()
+{
+  using namespace Imagine;
+
+  NFmiEsriShape shape(kFmiEsriPoint);
+  build_shape(shape);
+
+  NFmiEsriTools::Predicate predicate(shape, "CLASS=2");
+  NFmiEsriTools::FilteredView view(shape, predicate);
+
+  if (view.Elements().empty() || view.Elements().size() != view.Indices().size())
+    TEST_FAILED("Filtered view is empty");
+
+  for (size_t i = 0; i < view.Indices().size(); i++)
+    if (view.Elements()[i] != shape.Elements()[view.Indices()[i]])
+      TEST_FAILED("Filtered view should refer to the original elements");
+
+  unique_ptr<NFmiEsriShape> copy(NFmiEsriTools::filter(shape, "CLASS=2"));
+  if (copy->Elements().size() != view.Elements().size())
+    TEST_FAILED("Filtered copy has a wrong number of elements");
+
+  const NFmiEsriElement* first = view.Elements().front();
+  shape.Retain(view.Indices());
+  if (shape.Elements().size() != view.Indices().size() || shape.Elements().front() != first)
+    TEST_FAILED("Retain failed to keep the selected elements");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(predicate);
+    TEST(indexed);
+    TEST(filter);
+  }
+};
+
+}  // namespace NFmiEsriToolsTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiEsriTools tester" << endl << "====================" << endl;
+  NFmiEsriToolsTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
@@ -0,0 +1,243 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for class NFmiFreeType
+ *
+ * The font is DejaVuSans.ttf unless IMAGINE_TEST_FONT names another one.
+ */
+// ======================================================================
+
+#include "NFmiColorTools.h"
+#include "NFmiFreeType.h"
+#include "NFmiGlyphCache.h"
+#include "NFmiImage.h"
+#include "tframe.h"
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiFreeTypeTest
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief The font to test with
+ */
+// ----------------------------------------------------------------------
+
+string font()
+{
+  const char* env = getenv("IMAGINE_TEST_FONT");
+  if (env != nullptr)
+    return env;
+  return "/usr/share/fonts/dejavu-sans-fonts/DejaVuSans.ttf";
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Draw a set of labels like a station plot does
+ */
+// ----------------------------------------------------------------------
+
+void draw_labels(Imagine::NFmiImage* theImage, int theCount)
+{
+  using namespace Imagine;
+
+  for (int k = 0; k < theCount; k++)
+    NFmiFreeType::Instance().Draw(*theImage,
+                                  font(),
+                                  0,
+                                  8 + k % 7,
+                                  (k * 37) % theImage->Width(),
+                                  (k * 91) % theImage->Height(),
+                                  to_string(k % 997),
+                                  kFmiAlignCenter,
+                                  NFmiColorTools::Black,
+                                  NFmiColorTools::kFmiColorOver);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Compare two images
+ */
+// ----------------------------------------------------------------------
+
+bool equal(const Imagine::NFmiImage& theImage1, const Imagine::NFmiImage& theImage2)
+{
+  if (theImage1.Width() != theImage2.Width() || theImage1.Height() != theImage2.Height())
+    return false;
+  for (int j = 0; j < theImage1.Height(); j++)
+    for (int i = 0; i < theImage1.Width(); i++)
+      if (theImage1(i, j) != theImage2(i, j))
+        return false;
+  return true;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test measuring text
+ */
+// ----------------------------------------------------------------------
+
+void measure()
+{
+  using namespace Imagine;
+
+  const NFmiFreeType& freetype = NFmiFreeType::Instance();
+
+  const NFmiTextExtent empty = freetype.Measure(font(), 0, 20, "");
+  if (empty.advance != 0 || empty.Width() != 0 || empty.Height() != 0)
+    TEST_FAILED("An empty text should have empty extents");
+
+  const NFmiTextExtent one = freetype.Measure(font(), 0, 20, "1");
+  const NFmiTextExtent two = freetype.Measure(font(), 0, 20, "11");
+
+  if (one.advance <= 0 || one.Width() <= 0 || one.Height() <= 0)
+    TEST_FAILED("A digit should have nonempty extents");
+  if (two.advance != 2 * one.advance)
+    TEST_FAILED("Two digits should advance twice as much as one, got " +
+                to_string(two.advance) + " and " + to_string(one.advance));
+  if (two.ymin != one.ymin || two.ymax != one.ymax)
+    TEST_FAILED("Repeating a glyph should not change the height of the text");
+  if (one.ymin >= 0 || one.ymax > 0)
+    TEST_FAILED("A digit should be above the baseline");
+
+  // The run cache must return the same extents
+
+  const NFmiTextExtent again = freetype.Measure(font(), 0, 20, "1");
+  if (again.xmin != one.xmin || again.xmax != one.xmax || again.ymin != one.ymin ||
+      again.ymax != one.ymax || again.advance != one.advance)
+    TEST_FAILED("Measuring the same text again changed the extents");
+
+  const NFmiTextExtent larger = freetype.Measure(font(), 0, 40, "1");
+  if (larger.advance <= one.advance || larger.Height() <= one.Height())
+    TEST_FAILED("A larger font should produce larger extents");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test that cached glyphs and runs are reused
+ */
+// ----------------------------------------------------------------------
+
+void reuse()
+{
+  using namespace Imagine;
+
+  NFmiGlyphCache& cache = NFmiFreeType::Instance().GlyphCache();
+  cache.Clear();
+
+  const NFmiColorTools::Color white = NFmiColorTools::MakeColor(255, 255, 255);
+
+  NFmiImage image1(200, 200, white);
+  draw_labels(&image1, 500);
+  const NFmiGlyphCache::Statistics stats1 = cache.GetStatistics();
+
+  if (stats1.glyphs == 0)
+    TEST_FAILED("Drawing should have cached some glyphs");
+
+  // Drawing the same labels again requires no rendering
+
+  NFmiImage image2(200, 200, white);
+  draw_labels(&image2, 500);
+  const NFmiGlyphCache::Statistics stats2 = cache.GetStatistics();
+
+  if (stats2.misses != stats1.misses)
+    TEST_FAILED("Drawing the same labels again should not render any glyphs");
+  if (!equal(image1, image2))
+    TEST_FAILED("Drawing from the caches changed the image");
+
+  // Laid out texts keep their glyphs even if the glyph cache is cleared
+
+  cache.Clear();
+  NFmiImage image3(200, 200, white);
+  draw_labels(&image3, 500);
+  if (!equal(image1, image3))
+    TEST_FAILED("Drawing after clearing the glyph cache changed the image");
+
+  // Texts larger than the glyph cache are still drawn
+
+  const size_t maxbytes = cache.MaxBytes();
+  cache.MaxBytes(0);
+  cache.Clear();
+  NFmiImage image4(200, 200, white);
+  NFmiFreeType::Instance().Draw(image4, font(), 0, 30, 100, 100, "12345");
+  cache.MaxBytes(maxbytes);
+
+  if (cache.GetStatistics().glyphs != 0)
+    TEST_FAILED("Glyphs should not be cached when the limit is zero");
+  if (equal(image4, NFmiImage(200, 200, white)))
+    TEST_FAILED("The text was not drawn when the glyph cache is disabled");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test drawing text concurrently
+ */
+// ----------------------------------------------------------------------
+
+void threads()
+{
+  using namespace Imagine;
+
+  const int count = 2000;
+  const NFmiColorTools::Color white = NFmiColorTools::MakeColor(255, 255, 255);
+
+  NFmiFreeType::Instance().GlyphCache().Clear();
+
+  NFmiImage reference(300, 300, white);
+  draw_labels(&reference, count);
+
+  NFmiFreeType::Instance().GlyphCache().Clear();
+
+  const int nthreads = 8;
+  vector<NFmiImage> images(nthreads, NFmiImage(300, 300, white));
+  vector<thread> workers;
+  for (int i = 0; i < nthreads; i++)
+    workers.emplace_back(draw_labels, &images[i], count);
+  for (auto& worker : workers)
+    worker.join();
+
+  for (int i = 0; i < nthreads; i++)
+    if (!equal(images[i], reference))
+      TEST_FAILED("Thread " + to_string(i) + " produced a different image");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(measure);
+    TEST(reuse);
+    TEST(threads);
+  }
+};
+
+}  // namespace NFmiFreeTypeTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiFreeType tester" << endl << "===================" << endl;
+  NFmiFreeTypeTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
@@ -0,0 +1,253 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for class NFmiGshhsFile
+ */
+// ======================================================================
+
+#include "NFmiGshhsFile.h"
+#include "tframe.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiGshhsFileTest
+{
+const string filename = "/tmp/NFmiGshhsFileTest.b";
+const string indexfile = "/tmp/NFmiGshhsFileTest.b.idx";
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Append integers in big or little endian order
+ */
+// ----------------------------------------------------------------------
+
+void put(string& theData, int theValue, int theBytes, bool fBigEndian)
+{
+  for (int i = 0; i < theBytes; i++)
+  {
+    const int shift = 8 * (fBigEndian ? theBytes - 1 - i : i);
+    theData += static_cast<char>((static_cast<unsigned int>(theValue) >> shift) & 0xff);
+  }
+}
+
+void polygon(string& theData,
+             int theId,
+             int theWest,
+             int theEast,
+             int theSouth,
+             int theNorth,
+             int theArea,
+             int theGreenwich,
+             bool fBigEndian)
+{
+  const int n = 4;
+  for (int value : {theId, n, 1, theWest, theEast, theSouth, theNorth, theArea})
+    put(theData, value, 4, fBigEndian);
+  put(theData, theGreenwich, 2, fBigEndian);
+  put(theData, 0, 2, fBigEndian);
+
+  const int x[] = {theWest, theEast, theEast, theWest};
+  const int y[] = {theSouth, theSouth, theNorth, theNorth};
+  for (int i = 0; i < n; i++)
+  {
+    put(theData, x[i], 4, fBigEndian);
+    put(theData, y[i], 4, fBigEndian);
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Write a test file
+ *
+ * Polygon 0 wraps around the world like Eurasiafrica, polygon 1 is in
+ * Scandinavia, polygon 2 is a small island west of Greenwich and
+ * polygon 3 is east of the dateline. Each polygon is a rectangle.
+ */
+// ----------------------------------------------------------------------
+
+void write_file(bool fBigEndian, size_t theRemovedBytes = 0)
+{
+  string data;
+  polygon(data, 0, 340000000, 190000000, -35000000, 78000000, 500000000, 1, fBigEndian);
+  polygon(data, 1, 5000000, 31000000, 55000000, 71000000, 10000000, 0, fBigEndian);
+  polygon(data, 2, 359000000, 361000000, 50000000, 51000000, 30, 1, fBigEndian);
+  polygon(data, 3, 195000000, 200000000, 60000000, 65000000, 2000, 0, fBigEndian);
+
+  data.resize(data.size() - theRemovedBytes);
+
+  ofstream out(filename.c_str(), ios::out | ios::binary);
+  out << data;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Verify the selections from the test file
+ */
+// ----------------------------------------------------------------------
+
+void check(const Imagine::NFmiGshhsFile& theFile)
+{
+  if (theFile.Size() != 4)
+    TEST_FAILED("Expected 4 polygons, got " + to_string(theFile.Size()));
+
+  if (theFile[1].id != 1 || theFile[1].n != 4 || theFile[1].north != 71000000)
+    TEST_FAILED("Polygon 1 header was decoded incorrectly");
+
+  if (theFile.Select(10, 60, 20, 70) != vector<size_t>{0, 1})
+    TEST_FAILED("Scandinavia should intersect polygons 0 and 1");
+
+  if (theFile.Select(10, 60, 20, 70, 2000000) != vector<size_t>{0})
+    TEST_FAILED("Polygon 1 should be rejected by its area");
+
+  if (theFile.Select(-2, 49, -0.5, 52) != vector<size_t>{0, 2})
+    TEST_FAILED("The island west of Greenwich should be found");
+
+  if (theFile.Select(-168, 55, -150, 70) != vector<size_t>{3})
+    TEST_FAILED("Only polygon 3 is east of the dateline");
+
+  if (!theFile.Select(20, 60, 10, 70).empty())
+    TEST_FAILED("Invalid box should select nothing");
+
+  if (theFile.Longitude(1, 1) != 31 || theFile.Latitude(1, 2) != 71)
+    TEST_FAILED("Polygon 1 coordinates were decoded incorrectly");
+
+  if (theFile.Longitude(0, 0) != -20 || theFile.Longitude(0, 1) != 190)
+    TEST_FAILED("Eurasiafrica should be shifted only beyond 270 degrees");
+
+  if (theFile.Longitude(2, 0) != -1 || theFile.Longitude(2, 1) != 1)
+    TEST_FAILED("Polygons crossing Greenwich should be shifted");
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test reading files in both byte orders
+ */
+// ----------------------------------------------------------------------
+
+void read()
+{
+  for (bool bigendian : {true, false})
+  {
+    write_file(bigendian);
+    Imagine::NFmiGshhsFile file(filename);
+    check(file);
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test the sidecar index
+ */
+// ----------------------------------------------------------------------
+
+void sidecar()
+{
+  remove(indexfile.c_str());
+  write_file(true);
+
+  {
+    Imagine::NFmiGshhsFile file(filename, indexfile);
+    check(file);
+  }
+
+  struct stat st;
+  if (stat(indexfile.c_str(), &st) != 0)
+    TEST_FAILED("Sidecar index was not written");
+
+  {
+    Imagine::NFmiGshhsFile file(filename, indexfile);
+    check(file);
+  }
+
+  // A rewritten sidecar would have a new inode
+
+  struct stat st2;
+  if (stat(indexfile.c_str(), &st2) != 0 || st2.st_ino != st.st_ino)
+    TEST_FAILED("Valid sidecar index should not be rewritten");
+
+  // A sidecar not matching the file must be ignored
+
+  {
+    ofstream out(filename.c_str(), ios::out | ios::binary | ios::app);
+    out << "trailing";
+  }
+
+  {
+    Imagine::NFmiGshhsFile file(filename, indexfile);
+    check(file);
+  }
+
+  // A corrupt sidecar must be ignored
+
+  {
+    string data(st.st_size, '\0');
+    ofstream out(indexfile.c_str(), ios::out | ios::binary);
+    out << data;
+  }
+
+  {
+    Imagine::NFmiGshhsFile file(filename, indexfile);
+    check(file);
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test that truncated files are detected
+ */
+// ----------------------------------------------------------------------
+
+void corrupt()
+{
+  write_file(true, 8);
+
+  try
+  {
+    Imagine::NFmiGshhsFile file(filename);
+  }
+  catch (...)
+  {
+    TEST_PASSED();
+  }
+
+  TEST_FAILED("Truncated file should not be accepted");
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(read);
+    TEST(sidecar);
+    TEST(corrupt);
+  }
+};
+
+}  // namespace NFmiGshhsFileTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiGshhsFile tester" << endl << "====================" << endl;
+  NFmiGshhsFileTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
@@ -0,0 +1,231 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for class NFmiImageCache
+ */
+// ======================================================================
+
+#include "NFmiColorTools.h"
+#include "NFmiImage.h"
+#include "NFmiImageCache.h"
+#include "tframe.h"
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <utime.h>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiImageCacheTest
+{
+const string prefix = "/tmp/NFmiImageCacheTest";
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Write a single colour square image
+ */
+// ----------------------------------------------------------------------
+
+void write_image(const string& theFile, int theSize, Imagine::NFmiColorTools::Color theColor)
+{
+  Imagine::NFmiImage image(theSize, theSize, theColor);
+  image.WritePnm(theFile);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Set the modification time of a file
+ */
+// ----------------------------------------------------------------------
+
+void set_modtime(const string& theFile, time_t theTime)
+{
+  struct utimbuf times;
+  times.actime = theTime;
+  times.modtime = theTime;
+  if (utime(theFile.c_str(), &times) != 0)
+    TEST_FAILED("Failed to set the modification time of " + theFile);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Estimated memory use of a cached image
+ */
+// ----------------------------------------------------------------------
+
+size_t image_bytes(int theSize)
+{
+  return sizeof(Imagine::NFmiImage) +
+         static_cast<size_t>(theSize) * theSize * sizeof(Imagine::NFmiColorTools::Color);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test that unchanged files are served from the cache
+ */
+// ----------------------------------------------------------------------
+
+void hits()
+{
+  using namespace Imagine;
+
+  NFmiImageCache& cache = NFmiImageCache::Instance();
+  cache.Clear();
+  cache.MaxBytes(1024 * 1024);
+
+  const string file = prefix + "hits.pnm";
+  write_image(file, 4, NFmiColorTools::MakeColor(255, 0, 0));
+
+  const auto before = cache.GetStatistics();
+  auto image1 = cache.Get(file);
+  auto image2 = cache.Get(file);
+  const auto after = cache.GetStatistics();
+  remove(file.c_str());
+
+  if (image1 != image2)
+    TEST_FAILED("The same unchanged file should return the same image");
+  if (after.hits != before.hits + 1 || after.misses != before.misses + 1)
+    TEST_FAILED("Expected 1 hit and 1 miss");
+  if (after.images != 1 || after.bytes != image_bytes(4))
+    TEST_FAILED("Expected 1 image using " + to_string(image_bytes(4)) + " bytes, got " +
+                to_string(after.bytes));
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test that modified files are decoded again
+ */
+// ----------------------------------------------------------------------
+
+void invalidation()
+{
+  using namespace Imagine;
+
+  NFmiImageCache& cache = NFmiImageCache::Instance();
+  cache.Clear();
+  cache.MaxBytes(1024 * 1024);
+
+  const string file = prefix + "changes.pnm";
+  const NFmiColorTools::Color red = NFmiColorTools::MakeColor(255, 0, 0);
+  const NFmiColorTools::Color blue = NFmiColorTools::MakeColor(0, 0, 255);
+  const time_t modtime = time(nullptr) - 100;
+
+  write_image(file, 4, red);
+  set_modtime(file, modtime);
+  auto image1 = cache.Get(file);
+
+  // Same size, different modification time
+
+  write_image(file, 4, blue);
+  set_modtime(file, modtime + 10);
+  auto image2 = cache.Get(file);
+
+  if (image2 == image1 || (*image2)(0, 0) != blue)
+    TEST_FAILED("A file with a new modification time should be decoded again");
+
+  // Same modification time, different size
+
+  write_image(file, 5, red);
+  set_modtime(file, modtime + 10);
+  auto image3 = cache.Get(file);
+  remove(file.c_str());
+
+  if (image3 == image2 || image3->Width() != 5 || (*image3)(0, 0) != red)
+    TEST_FAILED("A file with a new size should be decoded again");
+
+  if ((*image1)(0, 0) != red || (*image2)(0, 0) != blue)
+    TEST_FAILED("Replaced images still in use should remain valid");
+
+  if (cache.GetStatistics().images != 1)
+    TEST_FAILED("Only the latest version of the file should be cached");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test the memory limit
+ */
+// ----------------------------------------------------------------------
+
+void limit()
+{
+  using namespace Imagine;
+
+  NFmiImageCache& cache = NFmiImageCache::Instance();
+  cache.Clear();
+  cache.MaxBytes(2 * image_bytes(10) + image_bytes(10) / 2);
+
+  const string files[] = {prefix + "a.pnm", prefix + "b.pnm", prefix + "c.pnm"};
+  for (const auto& file : files)
+    write_image(file, 10, NFmiColorTools::MakeColor(0, 255, 0));
+
+  const auto before = cache.GetStatistics();
+  for (const auto& file : files)
+    cache.Get(file);
+  const auto middle = cache.GetStatistics();
+
+  if (middle.evictions != before.evictions + 1)
+    TEST_FAILED("Expected 1 eviction when the third image is cached");
+  if (middle.images != 2 || middle.bytes != 2 * image_bytes(10))
+    TEST_FAILED("Expected 2 images to fit the limit");
+
+  // The least recently used image was dropped
+
+  cache.Get(files[0]);
+  const auto after = cache.GetStatistics();
+  if (after.misses != middle.misses + 1)
+    TEST_FAILED("The first image should have been evicted");
+
+  for (const auto& file : files)
+    remove(file.c_str());
+
+  // Images larger than the limit are returned without caching them
+
+  const string file = prefix + "large.pnm";
+  write_image(file, 30, NFmiColorTools::MakeColor(0, 255, 0));
+  cache.Clear();
+
+  auto image = cache.Get(file);
+  remove(file.c_str());
+
+  if (!image || image->Width() != 30)
+    TEST_FAILED("An image larger than the limit should still be returned");
+  if (cache.GetStatistics().images != 0)
+    TEST_FAILED("An image larger than the limit should not be cached");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(hits);
+    TEST(invalidation);
+    TEST(limit);
+  }
+};
+
+}  // namespace NFmiImageCacheTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiImageCache tester" << endl << "=====================" << endl;
+  NFmiImageCacheTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
@@ -0,0 +1,234 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for writing several image outputs at once
+ */
+// ======================================================================
+
+#include "NFmiColorTools.h"
+#include "NFmiImage.h"
+#include "tframe.h"
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiImageExportTest
+{
+const string prefix = "/tmp/NFmiImageExportTest";
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Create a test image with some detail for the encoders
+ *
+ * The image has 32 colours so that it can be written as a GIF.
+ */
+// ----------------------------------------------------------------------
+
+Imagine::NFmiImage test_image()
+{
+  using namespace Imagine;
+
+  NFmiImage image(80, 40);
+  for (int j = 0; j < image.Height(); j++)
+    for (int i = 0; i < image.Width(); i++)
+      image(i, j) = NFmiColorTools::MakeColor(32 * (i / 10), 64 * (j / 10), 255 * ((i + j) % 2));
+  return image;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Create an output specification
+ */
+// ----------------------------------------------------------------------
+
+Imagine::NFmiImageOutput output(
+    const string& theName, const string& theType, int theWidth, int theHeight, int theQuality = -1)
+{
+  Imagine::NFmiImageOutput out;
+  out.filename = prefix + theName;
+  out.type = theType;
+  out.width = theWidth;
+  out.height = theHeight;
+  out.quality = theQuality;
+  return out;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Return the size of a file, -1 if it does not exist
+ */
+// ----------------------------------------------------------------------
+
+long file_size(const string& theFile)
+{
+  struct stat st;
+  if (stat(theFile.c_str(), &st) != 0)
+    return -1;
+  return static_cast<long>(st.st_size);
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test the output sizes and formats
+ */
+// ----------------------------------------------------------------------
+
+void sizes()
+{
+  using namespace Imagine;
+
+  const NFmiImage image = test_image();
+
+  vector<NFmiImageOutput> outputs;
+  outputs.push_back(output("1.png", "png", 0, 0));
+  outputs.push_back(output("2.png", "png", 40, 0));
+  outputs.push_back(output("3.jpg", "jpeg", 0, 10));
+  outputs.push_back(output("4.pnm", "pnm", 40, 0));
+  outputs.push_back(output("5.pgm", "pgm", 30, 30));
+  outputs.push_back(output("6.gif", "gif", 40, 20));
+
+  image.Write(outputs);
+
+  // The GIF is not read back, only checked to exist
+
+  if (file_size(outputs.back().filename) <= 0)
+    TEST_FAILED("Failed to write '" + outputs.back().filename + "'");
+  remove(outputs.back().filename.c_str());
+  outputs.pop_back();
+
+  const int expected[][2] = {{80, 40}, {40, 20}, {20, 10}, {40, 20}, {30, 30}};
+
+  for (size_t i = 0; i < outputs.size(); i++)
+  {
+    NFmiImage result(outputs[i].filename);
+    if (result.Width() != expected[i][0] || result.Height() != expected[i][1])
+      TEST_FAILED("Wrong size for '" + outputs[i].filename + "'");
+    remove(outputs[i].filename.c_str());
+  }
+
+  // The full size PNG must be exact
+
+  NFmiImage png = test_image();
+  image.Write(vector<NFmiImageOutput>{output("1.png", "png", 0, 0)});
+  NFmiImage result(prefix + "1.png");
+  for (int j = 0; j < png.Height(); j++)
+    for (int i = 0; i < png.Width(); i++)
+      if (result(i, j) != png(i, j))
+        TEST_FAILED("The full size PNG differs from the image");
+  remove((prefix + "1.png").c_str());
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test quality overrides
+ */
+// ----------------------------------------------------------------------
+
+void quality()
+{
+  using namespace Imagine;
+
+  NFmiImage image = test_image();
+  image.JpegQuality(95);
+
+  vector<NFmiImageOutput> outputs;
+  outputs.push_back(output("low.jpg", "jpeg", 0, 0, 10));
+  outputs.push_back(output("default.jpg", "jpeg", 0, 0));
+  image.Write(outputs);
+
+  const long low = file_size(prefix + "low.jpg");
+  const long high = file_size(prefix + "default.jpg");
+  remove((prefix + "low.jpg").c_str());
+  remove((prefix + "default.jpg").c_str());
+
+  if (low <= 0 || high <= 0)
+    TEST_FAILED("Failed to write the JPEG images");
+  if (low >= high)
+    TEST_FAILED("Quality 10 should produce a smaller file than the image setting 95");
+  if (image.JpegQuality() != 95)
+    TEST_FAILED("The quality override must not change the image setting");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test many outputs and errors
+ *
+ * There are more outputs than there are processors on most machines,
+ * and one of them fails. The error must be reported only after all
+ * the other outputs have been written.
+ */
+// ----------------------------------------------------------------------
+
+void errors()
+{
+  using namespace Imagine;
+
+  const NFmiImage image = test_image();
+
+  vector<NFmiImageOutput> outputs;
+  for (int i = 0; i < 50; i++)
+    outputs.push_back(output("many" + to_string(i) + ".pnm", "pnm", 10 + i % 5, 0));
+  outputs.push_back(output("bad.xyz", "xyz", 0, 0));
+
+  bool failed = false;
+  try
+  {
+    image.Write(outputs);
+  }
+  catch (...)
+  {
+    failed = true;
+  }
+
+  for (size_t i = 0; i + 1 < outputs.size(); i++)
+  {
+    if (file_size(outputs[i].filename) <= 0)
+      TEST_FAILED("Output '" + outputs[i].filename + "' was not written");
+    remove(outputs[i].filename.c_str());
+  }
+
+  if (!failed)
+    TEST_FAILED("Writing an unsupported format should fail");
+  if (file_size(prefix + "bad.xyz") >= 0)
+    TEST_FAILED("The failed output should not have been created");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(sizes);
+    TEST(quality);
+    TEST(errors);
+  }
+};
+
+}  // namespace NFmiImageExportTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiImage export tester" << endl << "=======================" << endl;
+  NFmiImageExportTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
@@ -0,0 +1,297 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for PNM and PGM reading and writing
+ */
+// ======================================================================
+
+#include "NFmiColorTools.h"
+#include "NFmiImage.h"
+#include "tframe.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiImagePnmTest
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Create an image containing all 8-bit sample values
+ */
+// ----------------------------------------------------------------------
+
+Imagine::NFmiImage color_image()
+{
+  using namespace Imagine;
+
+  NFmiImage image(256, 3);
+  for (int j = 0; j < image.Height(); j++)
+    for (int i = 0; i < image.Width(); i++)
+      image(i, j) = NFmiColorTools::MakeColor(i, (i * 7 + j) % 256, (255 - i + 31 * j) % 256);
+  return image;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Create a gray image containing all 8-bit sample values
+ */
+// ----------------------------------------------------------------------
+
+Imagine::NFmiImage gray_image()
+{
+  using namespace Imagine;
+
+  NFmiImage image(16, 16);
+  for (int j = 0; j < image.Height(); j++)
+    for (int i = 0; i < image.Width(); i++)
+      image(i, j) = NFmiColorTools::MakeColor(16 * j + i, 16 * j + i, 16 * j + i);
+  return image;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Compare the colours of two images within the given tolerance
+ */
+// ----------------------------------------------------------------------
+
+void compare(const Imagine::NFmiImage& theResult,
+             const Imagine::NFmiImage& theExpected,
+             int theTolerance,
+             const string& theName)
+{
+  using namespace Imagine;
+
+  if (theResult.Width() != theExpected.Width() || theResult.Height() != theExpected.Height())
+    TEST_FAILED(theName + " changed the size of the image");
+
+  for (int j = 0; j < theExpected.Height(); j++)
+    for (int i = 0; i < theExpected.Width(); i++)
+    {
+      const NFmiColorTools::Color c1 = theResult(i, j);
+      const NFmiColorTools::Color c2 = theExpected(i, j);
+      if (abs(NFmiColorTools::GetRed(c1) - NFmiColorTools::GetRed(c2)) > theTolerance ||
+          abs(NFmiColorTools::GetGreen(c1) - NFmiColorTools::GetGreen(c2)) > theTolerance ||
+          abs(NFmiColorTools::GetBlue(c1) - NFmiColorTools::GetBlue(c2)) > theTolerance ||
+          NFmiColorTools::GetAlpha(c1) != NFmiColorTools::Opaque)
+        TEST_FAILED(theName + " changed pixel " + to_string(i) + "," + to_string(j));
+    }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test round trips through memory buffers
+ */
+// ----------------------------------------------------------------------
+
+void memory()
+{
+  using namespace Imagine;
+
+  NFmiImage result;
+
+  const NFmiImage color = color_image();
+  const string pnm = color.PnmData();
+  result.ReadPnm(pnm.data(), pnm.size());
+  compare(result, color, 0, "PnmData round trip");
+  if (result.Type() != "pnm")
+    TEST_FAILED("Expected PnmData to be read as a pnm image");
+
+  const NFmiImage gray = gray_image();
+  const string pgm = gray.PgmData();
+  result.ReadPnm(pgm.data(), pgm.size());
+  compare(result, gray, 0, "PgmData round trip");
+  if (result.Type() != "pgm")
+    TEST_FAILED("Expected PgmData to be read as a pgm image");
+
+  // Comments and any whitespace are allowed in the header
+
+  const string data = string("P5 # comment\n2\t1\r\n255\n") + '\x10' + '\x20';
+  result.ReadPnm(data.data(), data.size());
+  if (result.Width() != 2 || result.Height() != 1 ||
+      result(1, 0) != NFmiColorTools::MakeColor(32, 32, 32))
+    TEST_FAILED("Failed to read a header with comments");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test 16-bit samples
+ */
+// ----------------------------------------------------------------------
+
+void sixteenbit()
+{
+  using namespace Imagine;
+
+  const NFmiImage color = color_image();
+  const string data = color.PnmData(65535);
+
+  // Each 8-bit value v is written as the big endian 16-bit value 257*v
+
+  const string header = "P6\n256 3\n65535\n";
+  if (data.size() != header.size() + 6 * 256 * 3 || data.compare(0, header.size(), header) != 0)
+    TEST_FAILED("Expected a 16-bit PNM with 6 bytes per pixel");
+
+  const unsigned char* raster = reinterpret_cast<const unsigned char*>(data.data() + header.size());
+  for (int i = 0; i < 256; i++)
+    if (raster[6 * i] != i || raster[6 * i + 1] != i)
+      TEST_FAILED("Red value " + to_string(i) + " was not scaled to " + to_string(257 * i));
+
+  NFmiImage result;
+  result.ReadPnm(data.data(), data.size());
+  compare(result, color, 0, "16-bit PnmData round trip");
+
+  const NFmiImage gray = gray_image();
+  const string pgm = gray.PgmData(65535);
+  result.ReadPnm(pgm.data(), pgm.size());
+  compare(result, gray, 0, "16-bit PgmData round trip");
+
+  // And through files
+
+  const string file = "/tmp/NFmiImagePnmTest16.pnm";
+  color.WritePnm(file, 65535);
+  compare(NFmiImage(file), color, 0, "16-bit PNM file round trip");
+  remove(file.c_str());
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test rescaling samples with a maximum value below 255
+ */
+// ----------------------------------------------------------------------
+
+void rescaling()
+{
+  using namespace Imagine;
+
+  const NFmiImage color = color_image();
+  const NFmiImage gray = gray_image();
+  NFmiImage result;
+
+  for (int maxval : {1, 15, 100, 254})
+  {
+    // The error is at most half a quantization step
+
+    const int tolerance = (255 + 2 * maxval - 1) / (2 * maxval);
+    const string name = "maxval " + to_string(maxval);
+
+    const string pnm = color.PnmData(maxval);
+    result.ReadPnm(pnm.data(), pnm.size());
+    compare(result, color, tolerance, name + " PnmData round trip");
+
+    const string pgm = gray.PgmData(maxval);
+    result.ReadPnm(pgm.data(), pgm.size());
+    compare(result, gray, tolerance, name + " PgmData round trip");
+
+    const string file = "/tmp/NFmiImagePnmTest.pgm";
+    gray.WritePgm(file, maxval);
+    compare(NFmiImage(file), gray, tolerance, name + " PGM file round trip");
+    remove(file.c_str());
+  }
+
+  // Values representable exactly with maxval 15 survive unchanged
+
+  NFmiImage steps(16, 1);
+  for (int i = 0; i < 16; i++)
+    steps(i, 0) = NFmiColorTools::MakeColor(17 * i, 17 * i, 17 * i);
+  const string data = steps.PnmData(15);
+  result.ReadPnm(data.data(), data.size());
+  compare(result, steps, 0, "maxval 15 round trip of multiples of 17");
+
+  // Samples above maxval are clamped
+
+  const string clamped = string("P5\n2 1\n15\n") + '\x0f' + '\xff';
+  result.ReadPnm(clamped.data(), clamped.size());
+  if (result(0, 0) != NFmiColorTools::MakeColor(255, 255, 255) || result(1, 0) != result(0, 0))
+    TEST_FAILED("Samples above maxval should be clamped to white");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test invalid data
+ */
+// ----------------------------------------------------------------------
+
+void errors()
+{
+  using namespace Imagine;
+
+  const string pnm = color_image().PnmData();
+
+  const string invalid[] = {"",
+                            "P3\n1 1\n255\n\x01\x02\x03",
+                            "P6\n1 1\n0\n\x01\x02\x03",
+                            "P6\n1 1\n65536\n\x01\x02\x03",
+                            "P6\n0 1\n255\n",
+                            "P6\n1 1\n255",
+                            pnm.substr(0, pnm.size() - 1)};
+
+  for (const auto& data : invalid)
+  {
+    NFmiImage image;
+    bool failed = false;
+    try
+    {
+      image.ReadPnm(data.data(), data.size());
+    }
+    catch (...)
+    {
+      failed = true;
+    }
+    if (!failed)
+      TEST_FAILED("Reading invalid PNM data should fail: '" + data.substr(0, 20) + "'");
+  }
+
+  bool failed = false;
+  try
+  {
+    color_image().PnmData(0);
+  }
+  catch (...)
+  {
+    failed = true;
+  }
+  if (!failed)
+    TEST_FAILED("Writing with maxval 0 should fail");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(memory);
+    TEST(sixteenbit);
+    TEST(rescaling);
+    TEST(errors);
+  }
+};
+
+}  // namespace NFmiImagePnmTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiImage PNM tester" << endl << "====================" << endl;
+  NFmiImagePnmTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
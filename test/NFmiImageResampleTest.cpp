@@ -0,0 +1,242 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for NFmiImageTools::Resample and MipPyramid
+ */
+// ======================================================================
+
+#include "NFmiColorTools.h"
+#include "NFmiImage.h"
+#include "NFmiImageTools.h"
+#include "tframe.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiImageResampleTest
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Create a single row image of opaque gray values
+ */
+// ----------------------------------------------------------------------
+
+Imagine::NFmiImage gray_row(const vector<int>& theValues)
+{
+  using namespace Imagine;
+
+  NFmiImage image(static_cast<int>(theValues.size()), 1);
+  for (size_t i = 0; i < theValues.size(); i++)
+    image(static_cast<int>(i), 0) =
+        NFmiColorTools::MakeColor(theValues[i], theValues[i], theValues[i]);
+  return image;
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Compare a single row image with the expected gray values
+ */
+// ----------------------------------------------------------------------
+
+void check_row(const Imagine::NFmiImage& theImage,
+               const vector<int>& theExpected,
+               const string& theName)
+{
+  using namespace Imagine;
+
+  if (theImage.Width() != static_cast<int>(theExpected.size()) || theImage.Height() != 1)
+    TEST_FAILED(theName + " produced an image of the wrong size");
+
+  for (size_t i = 0; i < theExpected.size(); i++)
+  {
+    const NFmiColorTools::Color c = theImage(static_cast<int>(i), 0);
+    const NFmiColorTools::Color expected =
+        NFmiColorTools::MakeColor(theExpected[i], theExpected[i], theExpected[i]);
+    if (c != expected)
+      TEST_FAILED(theName + ": pixel " + to_string(i) + " should be " +
+                  to_string(theExpected[i]) + ", got " + to_string(NFmiColorTools::GetRed(c)));
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test the box filter
+ */
+// ----------------------------------------------------------------------
+
+void box()
+{
+  using namespace Imagine;
+  using namespace Imagine::NFmiImageTools;
+
+  // Shrinking averages the covered pixels
+
+  check_row(Resample(gray_row({0, 100, 200, 40}), 2, 1, kFmiResampleBox),
+            {50, 120},
+            "Box shrinking");
+
+  // Enlarging replicates the nearest pixel
+
+  check_row(Resample(gray_row({10, 200}), 4, 1, kFmiResampleBox),
+            {10, 10, 200, 200},
+            "Box enlarging");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test the bilinear filter
+ */
+// ----------------------------------------------------------------------
+
+void bilinear()
+{
+  using namespace Imagine;
+  using namespace Imagine::NFmiImageTools;
+
+  // The pixel centers of the target are at 1/4 and 3/4 between the
+  // source pixel centers, the edges are clamped
+
+  check_row(Resample(gray_row({0, 255}), 4, 1, kFmiResampleBilinear),
+            {0, 64, 191, 255},
+            "Bilinear enlarging");
+
+  // Transparent pixels must not bleed their colour
+
+  NFmiImage image(2, 1);
+  image(0, 0) = NFmiColorTools::MakeColor(255, 0, 0);
+  image(1, 0) = NFmiColorTools::MakeColor(0, 0, 255, NFmiColorTools::Transparent);
+
+  NFmiImage result = Resample(image, 4, 1, kFmiResampleBilinear);
+  if (result(1, 0) != NFmiColorTools::MakeColor(255, 0, 0, 32))
+    TEST_FAILED("Expected 75% opaque red next to the transparent pixel");
+  if (NFmiColorTools::GetAlpha(result(3, 0)) != NFmiColorTools::Transparent)
+    TEST_FAILED("Expected the last pixel to remain transparent");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test the Lanczos filter
+ */
+// ----------------------------------------------------------------------
+
+void lanczos()
+{
+  using namespace Imagine;
+  using namespace Imagine::NFmiImageTools;
+
+  // A constant image must stay constant, the large one is processed
+  // in parallel
+
+  const NFmiColorTools::Color color = NFmiColorTools::MakeColor(30, 60, 90, 20);
+
+  const int sizes[][4] = {{5, 5, 3, 3}, {5, 5, 8, 8}, {300, 300, 200, 250}};
+  for (const auto& size : sizes)
+  {
+    NFmiImage result =
+        Resample(NFmiImage(size[0], size[1], color), size[2], size[3], kFmiResampleLanczos);
+    if (result.Width() != size[2] || result.Height() != size[3])
+      TEST_FAILED("Resampling produced an image of the wrong size");
+    for (int j = 0; j < result.Height(); j++)
+      for (int i = 0; i < result.Width(); i++)
+        if (result(i, j) != color)
+          TEST_FAILED("Resampling a constant " + to_string(size[0]) + "x" + to_string(size[1]) +
+                      " image changed pixel " + to_string(i) + "," + to_string(j));
+  }
+
+  // Transparent pixels must not bleed their colour even though the
+  // filter has negative weights
+
+  NFmiImage image(6, 1, NFmiColorTools::MakeColor(0, 0, 255, NFmiColorTools::Transparent));
+  image(2, 0) = NFmiColorTools::MakeColor(255, 0, 0);
+  image(3, 0) = NFmiColorTools::MakeColor(255, 0, 0);
+
+  NFmiImage result = Resample(image, 15, 1, kFmiResampleLanczos);
+  for (int i = 0; i < result.Width(); i++)
+  {
+    const NFmiColorTools::Color c = result(i, 0);
+    if (NFmiColorTools::GetAlpha(c) != NFmiColorTools::Transparent &&
+        (NFmiColorTools::GetBlue(c) != 0 || NFmiColorTools::GetRed(c) != 255))
+      TEST_FAILED("Transparent blue bled into pixel " + to_string(i));
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test MipPyramid
+ */
+// ----------------------------------------------------------------------
+
+void pyramid()
+{
+  using namespace Imagine;
+  using namespace Imagine::NFmiImageTools;
+
+  // Sizes are halved and rounded up until the image is 1x1
+
+  vector<NFmiImage> levels = MipPyramid(NFmiImage(5, 3));
+  const int expected[][2] = {{3, 2}, {2, 1}, {1, 1}};
+  if (levels.size() != 3)
+    TEST_FAILED("Expected 3 levels for a 5x3 image, got " + to_string(levels.size()));
+  for (size_t i = 0; i < levels.size(); i++)
+    if (levels[i].Width() != expected[i][0] || levels[i].Height() != expected[i][1])
+      TEST_FAILED("Level " + to_string(i) + " has the wrong size");
+
+  if (MipPyramid(NFmiImage(5, 3), 2).size() != 2)
+    TEST_FAILED("Expected the number of levels to be limited to 2");
+
+  if (!MipPyramid(NFmiImage(1, 1)).empty())
+    TEST_FAILED("Expected no levels for a 1x1 image");
+
+  // Each pixel is the average of a 2x2 block
+
+  NFmiImage image(2, 2);
+  image(0, 0) = NFmiColorTools::MakeColor(0, 0, 0);
+  image(1, 0) = NFmiColorTools::MakeColor(100, 100, 100);
+  image(0, 1) = NFmiColorTools::MakeColor(200, 200, 200);
+  image(1, 1) = NFmiColorTools::MakeColor(40, 40, 40);
+
+  levels = MipPyramid(image);
+  if (levels.size() != 1 || levels[0](0, 0) != NFmiColorTools::MakeColor(85, 85, 85))
+    TEST_FAILED("Expected the 2x2 block to be averaged into gray 85");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(box);
+    TEST(bilinear);
+    TEST(lanczos);
+    TEST(pyramid);
+  }
+};
+
+}  // namespace NFmiImageResampleTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiImageResample tester" << endl << "========================" << endl;
+  NFmiImageResampleTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
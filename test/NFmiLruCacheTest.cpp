@@ -0,0 +1,142 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for class NFmiLruCache
+ */
+// ======================================================================
+
+#include "NFmiLruCache.h"
+#include "tframe.h"
+#include <functional>
+#include <string>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiLruCacheTest
+{
+//! Each string is charged by its length
+struct StringSize
+{
+  size_t operator()(int, const string& theValue) const { return theValue.size(); }
+};
+
+using Cache = Imagine::NFmiLruCache<int, string, hash<int>, StringSize>;
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test finding inserted values
+ */
+// ----------------------------------------------------------------------
+
+void find()
+{
+  Cache cache(100);
+
+  if (cache.Find(1))
+    TEST_FAILED("Empty cache should not find anything");
+
+  cache.Insert(1, make_shared<string>("one"));
+  cache.Insert(2, make_shared<string>("two"));
+  cache.Insert(2, make_shared<string>("TWO"));
+
+  auto value = cache.Find(2);
+  if (!value || *value != "TWO")
+    TEST_FAILED("Latter insert should replace the former");
+
+  const auto stats = cache.GetStatistics();
+  if (stats.hits != 1 || stats.misses != 1)
+    TEST_FAILED("Expected 1 hit and 1 miss");
+  if (stats.entries != 2 || stats.bytes != 6)
+    TEST_FAILED("Expected 2 entries using 6 bytes");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test least recently used values are evicted first
+ */
+// ----------------------------------------------------------------------
+
+void evict()
+{
+  Cache cache(10);
+
+  cache.Insert(1, make_shared<string>("aaaa"));
+  cache.Insert(2, make_shared<string>("bbbb"));
+  cache.Find(1);
+  cache.Insert(3, make_shared<string>("cccc"));
+
+  if (!cache.Find(1) || cache.Find(2) || !cache.Find(3))
+    TEST_FAILED("Value 2 should have been evicted");
+
+  if (cache.Insert(4, make_shared<string>("too long value")))
+    TEST_FAILED("Values larger than the limit should not be cached");
+
+  cache.MaxBytes(4);
+  if (cache.GetStatistics().entries != 1 || !cache.Find(3))
+    TEST_FAILED("Lowering the limit should evict all but value 3");
+
+  if (cache.GetStatistics().evictions != 2)
+    TEST_FAILED("Expected 2 evictions");
+
+  cache.Clear();
+  if (cache.Find(3) || cache.GetStatistics().bytes != 0)
+    TEST_FAILED("Clear should drop all values");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test values rejected by the validity test are dropped
+ */
+// ----------------------------------------------------------------------
+
+void validate()
+{
+  Cache cache(100);
+  cache.Insert(1, make_shared<string>("old"));
+
+  if (cache.Find(1, [](const string& theValue) { return theValue == "new"; }))
+    TEST_FAILED("Invalid value should not be returned");
+
+  if (cache.Find(1))
+    TEST_FAILED("Invalid value should have been dropped");
+
+  if (cache.GetStatistics().misses != 2)
+    TEST_FAILED("Invalid values should count as misses");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(find);
+    TEST(evict);
+    TEST(validate);
+  }
+};
+
+}  // namespace NFmiLruCacheTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiLruCache tester" << endl << "===================" << endl;
+  NFmiLruCacheTest::tests t;
+  return t.run();
+}
+
+// ======================================================================
@@ -0,0 +1,513 @@
+// ======================================================================
+/*!
+ * \file
+ * \brief Regression tests for class NFmiPath
+ */
+// ======================================================================
+
+#include "NFmiEsriBox.h"
+#include "NFmiPath.h"
+#include "tframe.h"
+#include <newbase/NFmiArea.h>
+#include <newbase/NFmiAreaFactory.h>
+#include <newbase/NFmiGlobals.h>
+#include <cmath>
+
+using namespace std;
+
+//! Protection against conflicts with global functions
+namespace NFmiPathTest
+{
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test NFmiPath::Simplify
+ */
+// ----------------------------------------------------------------------
+
+void simplify()
+{
+  using namespace Imagine;
+
+  // Collinear points are removed even with zero tolerance
+
+  {
+    NFmiPath path;
+    path.MoveTo(0, 0);
+    path.LineTo(1, 0);
+    path.LineTo(2, 0);
+    path.LineTo(3, 0);
+    path.Simplify(0);
+    if (path.SVG() != "M0,0 L3,0")
+      TEST_FAILED("Failed to simplify a straight line, got " + path.SVG());
+  }
+
+  // Small deviations are removed, large ones kept
+
+  {
+    NFmiPath path;
+    path.MoveTo(0, 0);
+    path.LineTo(1, 0.1);
+    path.LineTo(2, 0);
+    path.LineTo(3, 5);
+    path.LineTo(4, 0);
+    path.Simplify(0.5);
+    if (path.SVG() != "M0,0 L2,0 3,5 4,0")
+      TEST_FAILED("Failed to simplify a polyline, got " + path.SVG());
+  }
+
+  // Line type changes are kept
+
+  {
+    NFmiPath path;
+    path.MoveTo(0, 0);
+    path.LineTo(1, 0);
+    path.GhostLineTo(2, 0);
+    path.GhostLineTo(3, 0);
+    path.Simplify(0);
+    if (path.SVG(false, false) != "M0,0 L1,0 3,0")
+      TEST_FAILED("Failed to keep a change of line type, got " + path.SVG(false, false));
+  }
+
+  // Shared vertices are kept
+
+  {
+    NFmiPath path;
+    path.MoveTo(0, 0);
+    path.LineTo(1, 0);
+    path.LineTo(2, 0);
+    path.MoveTo(1, 0);
+    path.LineTo(1, 1);
+    path.Simplify(0);
+    if (path.SVG() != "M0,0 L1,0 2,0 M1,0 L1,1")
+      TEST_FAILED("Failed to keep a shared vertex, got " + path.SVG());
+  }
+
+  // A border shared by two polygons is simplified identically in both
+
+  {
+    NFmiPath path;
+    path.MoveTo(0, 0);
+    path.LineTo(2, 0);
+    path.LineTo(2, 1);
+    path.LineTo(2.1, 2);
+    path.LineTo(2, 3);
+    path.LineTo(0, 3);
+    path.LineTo(0, 0);
+
+    path.MoveTo(2, 1);
+    path.LineTo(2, 0);
+    path.LineTo(4, 0);
+    path.LineTo(4, 3);
+    path.LineTo(2, 3);
+    path.LineTo(2.1, 2);
+    path.LineTo(2, 1);
+
+    path.Simplify(0.5);
+    if (path.SVG() != "M2,0 L2,3 0,3 0,0 2,0 M2,0 L4,0 4,3 2,3 2,0")
+      TEST_FAILED("Failed to simplify adjacent polygons, got " + path.SVG());
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test NFmiPath::PacificView
+ */
+// ----------------------------------------------------------------------
+
+void pacificview()
+{
+  using namespace Imagine;
+
+  // A polygon crossing Greenwich is split and closed at 0 and 360
+
+  {
+    NFmiPath path;
+    path.MoveTo(-10, 0);
+    path.LineTo(10, 0);
+    path.LineTo(10, 10);
+    path.LineTo(-10, 10);
+    path.LineTo(-10, 0);
+    string result = path.PacificView(true).SVG();
+    if (result != "M0,0 L10,0 10,10 0,10 0,0 M360,10 L350,10 350,0 360,0 360,10")
+      TEST_FAILED("Failed to split a polygon at Greenwich, got " + result);
+  }
+
+  // Polygons split at the dateline are merged
+
+  {
+    NFmiPath path;
+    path.MoveTo(170, 60);
+    path.LineTo(180, 62);
+    path.LineTo(180, 70);
+    path.LineTo(170, 60);
+    path.MoveTo(-180, 62);
+    path.LineTo(-175, 63);
+    path.LineTo(-180, 70);
+    path.LineTo(-180, 62);
+    string result = path.PacificView(true).SVG();
+    if (result != "M180,70 L170,60 180,62 185,63 180,70")
+      TEST_FAILED("Failed to merge polygons at the dateline, got " + result);
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test NFmiPath::AtlanticView
+ */
+// ----------------------------------------------------------------------
+
+void atlanticview()
+{
+  using namespace Imagine;
+
+  // A polygon crossing the dateline is split and closed at -180 and 180
+
+  {
+    NFmiPath path;
+    path.MoveTo(170, 0);
+    path.LineTo(190, 0);
+    path.LineTo(190, 10);
+    path.LineTo(170, 10);
+    path.LineTo(170, 0);
+    string result = path.AtlanticView(true).SVG();
+    if (result != "M-180,0 L-170,0 -170,10 -180,10 -180,0 M180,10 L170,10 170,0 180,0 180,10")
+      TEST_FAILED("Failed to split a polygon at the dateline, got " + result);
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test NFmiPath::UpdateBoundingBoxes
+ */
+// ----------------------------------------------------------------------
+
+void boundingboxes()
+{
+  using namespace Imagine;
+
+  NFmiPath path;
+  path.MoveTo(0, 0);
+  path.LineTo(10, 0);
+  path.LineTo(10, 10);
+  path.LineTo(0, 0);
+  path.MoveTo(100, 100);
+  path.LineTo(110, 100);
+  path.LineTo(110, 110);
+  path.LineTo(100, 100);
+  path.MoveTo(5, -20);
+  path.LineTo(5, 30);
+
+  NFmiPath boxed = path;
+  boxed.UpdateBoundingBoxes();
+  if (boxed.Elements().Boxes().size() != 3)
+    TEST_FAILED("Expected 3 subpath boxes");
+
+  // Appending elements keeps the boxes up to date
+
+  boxed.LineTo(200, 30);
+  path.LineTo(200, 30);
+  if (!boxed.Elements().HasBoxes() || boxed.Elements().Boxes().back().xmax != 200)
+    TEST_FAILED("Failed to update the subpath boxes when appending");
+
+  // Clipping gives the same result with or without the boxes
+
+  string expected = path.Clip(-1, -1, 20, 20, 2).SVG();
+  string result = boxed.Clip(-1, -1, 20, 20, 2).SVG();
+  if (result != expected)
+    TEST_FAILED("Clipping with subpath boxes failed, expected " + expected + ", got " + result);
+
+  // Transformations discard the boxes
+
+  boxed.Translate(1, 1);
+  if (boxed.Elements().HasBoxes())
+    TEST_FAILED("Failed to discard the subpath boxes when translating");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test NFmiPath::HashValue and content equality
+ */
+// ----------------------------------------------------------------------
+
+void hashvalue()
+{
+  using namespace Imagine;
+
+  NFmiPath path;
+  path.MoveTo(0, 0);
+  path.LineTo(10, 0);
+  path.LineTo(10, 10);
+
+  NFmiPath other;
+  other.MoveTo(0, 0);
+  other.LineTo(10, 0);
+  other.LineTo(10, 10);
+
+  if (path.HashValue() != other.HashValue() || path.Elements() != other.Elements())
+    TEST_FAILED("Equal paths should have equal hash values");
+
+  // Modifications after the hash value was calculated must change it
+
+  const size_t hash = path.HashValue();
+
+  NFmiPath copy = path;
+  copy.LineTo(0, 0);
+  if (copy.HashValue() == hash || copy.Elements() == path.Elements())
+    TEST_FAILED("Appending should change the hash value");
+
+  copy = path;
+  copy.Translate(1, 0);
+  if (copy.HashValue() == hash || copy.Elements() == path.Elements())
+    TEST_FAILED("Translating should change the hash value");
+
+  copy.Translate(-1, 0);
+  if (copy.HashValue() != hash || copy.Elements() != path.Elements())
+    TEST_FAILED("Translating back should restore the hash value");
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test whether projected coordinates are equal
+ *
+ * Missing values must match exactly, others within rounding errors.
+ */
+// ----------------------------------------------------------------------
+
+bool same_coordinate(double theValue, double theExpected)
+{
+  if (theValue == kFloatMissing || theExpected == kFloatMissing)
+    return (theValue == theExpected);
+  if (!std::isfinite(theValue) || !std::isfinite(theExpected))
+    return (std::isfinite(theValue) == std::isfinite(theExpected));
+  return (std::abs(theValue - theExpected) < 1e-6 * std::max(1.0, std::abs(theExpected)));
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Compare a projected path with projecting each point separately
+ */
+// ----------------------------------------------------------------------
+
+template <typename Projection>
+void compare_projection(const Imagine::NFmiPath& thePath,
+                        const Imagine::NFmiPath& theResult,
+                        Projection theProjection,
+                        const string& theName)
+{
+  const Imagine::NFmiPathData& input = thePath.Elements();
+  const Imagine::NFmiPathData& output = theResult.Elements();
+
+  if (input.size() != output.size())
+    TEST_FAILED(theName + " changed the number of points");
+
+  for (size_t i = 0; i < input.size(); i++)
+  {
+    const NFmiPoint expected = theProjection(NFmiPoint(input.X(i), input.Y(i)));
+    if (!same_coordinate(output.X(i), expected.X()) || !same_coordinate(output.Y(i), expected.Y()))
+      TEST_FAILED(theName + " differs from projecting point " + to_string(i) + " separately");
+  }
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test NFmiPath::Project and NFmiPath::InvProject
+ *
+ * The results must equal those of NFmiArea::ToXY and NFmiArea::ToLatLon
+ * both for small paths and for paths large enough to be projected in
+ * blocks, including missing points and points which cannot be projected.
+ */
+// ----------------------------------------------------------------------
+
+void project()
+{
+  using namespace Imagine;
+
+  auto area = NFmiAreaFactory::Create("latlon:0,30,20,50:200,200");
+
+  // Missing points are moves so that the path does not look like a
+  // Pacific one and hence is projected as is
+
+  for (int n : {10, 5000})
+  {
+    NFmiPath path;
+    path.MoveTo(0, 30);
+    for (int i = 1; i < n; i++)
+    {
+      const double lon = -10 + 40.0 * i / n;
+      const double lat = 20 + 40.0 * i / n;
+      if (i % 7 == 3)
+        path.MoveTo(kFloatMissing, kFloatMissing);
+      else if (i % 7 == 4)
+        path.MoveTo(lon, lat);
+      else if (i % 7 == 5)
+        path.LineTo(lon, 95);  // invalid latitude
+      else
+        path.LineTo(lon, lat);
+    }
+
+    const string size = " of " + to_string(n) + " points";
+
+    NFmiPath projected = path;
+    projected.Project(area.get());
+    compare_projection(path,
+                       projected,
+                       [&area](const NFmiPoint& thePoint) { return area->ToXY(thePoint); },
+                       "Project" + size);
+
+    NFmiPath inverse = projected;
+    inverse.InvProject(area.get());
+    compare_projection(projected,
+                       inverse,
+                       [&area](const NFmiPoint& thePoint) { return area->ToLatLon(thePoint); },
+                       "InvProject" + size);
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * \brief Test NFmiPath::Clip(const NFmiArea *) with polygons
+ *
+ * The area is a plain latlon area so that the boundary of the area is
+ * the rectangle 0-20 x 30-50 in geographic coordinates too.
+ */
+// ----------------------------------------------------------------------
+
+void cliparea()
+{
+  using namespace Imagine;
+
+  auto area = NFmiAreaFactory::Create("latlon:0,30,20,50:200,200");
+
+  // Count subpaths and check that exactly the edges along the area
+  // boundary are ghost lines
+
+  auto check = [](const NFmiPath& thePath, int theSubpaths, const string& theName)
+  {
+    const NFmiPathData& data = thePath.Elements();
+    int subpaths = 0;
+    for (size_t i = 0; i < data.size(); i++)
+    {
+      if (data.Op(i) == kFmiMoveTo)
+      {
+        ++subpaths;
+        continue;
+      }
+      const bool left = (std::abs(data.X(i - 1)) < 1e-6 && std::abs(data.X(i)) < 1e-6);
+      const bool right =
+          (std::abs(data.X(i - 1) - 20) < 1e-6 && std::abs(data.X(i) - 20) < 1e-6);
+      const bool bottom =
+          (std::abs(data.Y(i - 1) - 30) < 1e-6 && std::abs(data.Y(i) - 30) < 1e-6);
+      const bool top = (std::abs(data.Y(i - 1) - 50) < 1e-6 && std::abs(data.Y(i) - 50) < 1e-6);
+      const bool boundary = (left || right || bottom || top);
+      if (boundary != (data.Op(i) == kFmiGhostLineTo))
+        TEST_FAILED(theName + ": only edges along the area boundary should be ghost lines, got " +
+                    thePath.SVG());
+    }
+    if (subpaths != theSubpaths)
+      TEST_FAILED(theName + ": expected " + to_string(theSubpaths) + " subpaths, got " +
+                  thePath.SVG());
+  };
+
+  auto check_box = [](const NFmiPath& thePath,
+                      double theX1,
+                      double theY1,
+                      double theX2,
+                      double theY2,
+                      const string& theName)
+  {
+    const NFmiEsriBox box = thePath.BoundingBox();
+    if (std::abs(box.Xmin() - theX1) > 1e-6 || std::abs(box.Ymin() - theY1) > 1e-6 ||
+        std::abs(box.Xmax() - theX2) > 1e-6 || std::abs(box.Ymax() - theY2) > 1e-6)
+      TEST_FAILED(theName + ": wrong bounding box for " + thePath.SVG());
+  };
+
+  // A polygon with a hole crossing the right edge of the area. The hole
+  // is inside the area and must be kept as is.
+
+  {
+    NFmiPath path;
+    path.MoveTo(10, 35);
+    path.LineTo(30, 35);
+    path.LineTo(30, 45);
+    path.LineTo(10, 45);
+    path.LineTo(10, 35);
+    path.MoveTo(12, 38);
+    path.LineTo(12, 40);
+    path.LineTo(14, 40);
+    path.LineTo(14, 38);
+    path.LineTo(12, 38);
+
+    NFmiPath clipped = path.Clip(area.get());
+    check(clipped, 2, "Polygon with a hole");
+    check_box(clipped, 10, 35, 20, 45, "Polygon with a hole");
+
+    const NFmiPathData& data = clipped.Elements();
+    const size_t n = data.size();
+    if (n < 5 || data.Op(n - 5) != kFmiMoveTo || data.X(n - 5) != 12 || data.Y(n - 5) != 38 ||
+        data.X(n - 3) != 14 || data.Y(n - 3) != 40)
+      TEST_FAILED("The hole should have been kept as is, got " + clipped.SVG());
+  }
+
+  // A polygon covering the whole area is reduced to the area boundary
+
+  {
+    NFmiPath path;
+    path.MoveTo(-10, 20);
+    path.LineTo(30, 20);
+    path.LineTo(30, 60);
+    path.LineTo(-10, 60);
+    path.LineTo(-10, 20);
+
+    NFmiPath clipped = path.Clip(area.get());
+    check(clipped, 1, "Polygon covering the area");
+    check_box(clipped, 0, 30, 20, 50, "Polygon covering the area");
+  }
+
+  TEST_PASSED();
+}
+
+// ----------------------------------------------------------------------
+/*!
+ * The actual test suite
+ */
+// ----------------------------------------------------------------------
+
+class tests : public tframe::tests
+{
+  virtual const char* error_message_prefix() const { return "\n\t"; }
+  void test(void)
+  {
+    TEST(simplify);
+    TEST(pacificview);
+    TEST(atlanticview);
+    TEST(boundingboxes);
+    TEST(hashvalue);
+    TEST(project);
+    TEST(cliparea);
+  }
+};
+
+}  // namespace NFmiPathTest
+
+//! The main program
+int main(void)
+{
+  using namespace std;
+  cout << endl << "NFmiPath tester" << endl << "===============" << endl;
+  NFmiPathTest::tests t;
+  return t.run();
+}
+
+// ======================================================================